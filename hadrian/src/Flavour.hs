@@ -86,6 +86,7 @@ flavourTransformers = M.fromList
     , "dump_stg"         =: enableDumpStg
     , "hash_unit_ids"    =: enableHashUnitIds
     , "hie_files"        =: enableHieFiles
+    , "linear_hash"      =: enableLinearHash
     ]
   where (=:) = (,)
 
@@ -390,6 +391,15 @@ omitPragmas = addArgs
     $ notStage0 ? builder (Ghc CompileHs) ? package compiler
     ? arg "-fomit-interface-pragmas"
 
+-- | Build the RTS with the old linear hash table (rts/HashLinear.c) instead
+-- of the open-addressing one (rts/Hash.c), e.g. to compare the two.
+enableLinearHash :: Flavour -> Flavour
+enableLinearHash =
+  addArgs $ mconcat
+    [ package rts ? builder (Cabal Flags) ? arg "linear-hash"
+    , builder Testsuite ? arg "--config=rts_linear_hash=True"
+    ]
+
 -- | Build stage2 dependencies with options to enable IPE debugging
 -- information.
 enableIPE :: Flavour -> Flavour
@@ -368,7 +368,7 @@ rtsPackageArgs = package rts ? do
 
           -- We're after pure performance here. So make sure fast math and
           -- vectorization is enabled.
-          , input "**/Hash.c" ? pure [ "-O3" ]
+          , inputs ["**/Hash.c", "**/HashLinear.c"] ? pure [ "-O3" ]
 
           , inputs ["**/Evac.c", "**/Evac_thr.c"] ? arg "-funroll-loops"
 
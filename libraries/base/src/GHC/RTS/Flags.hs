@@ -402,6 +402,12 @@ internal_to_base_MiscFlags i@Internal.MiscFlags{..} =
     internal_to_base_ioManager Internal.IoManagerFlagMIO         = IoManagerFlagMIO
     internal_to_base_ioManager Internal.IoManagerFlagWinIO       = IoManagerFlagWinIO
     internal_to_base_ioManager Internal.IoManagerFlagWin32Legacy = IoManagerFlagWin32Legacy
+#if __GLASGOW_HASKELL__ >= 1001
+    internal_to_base_ioManager Internal.IoManagerFlagEpoll       = IoManagerFlagAuto
+      -- As for poll above, we cannot translate epoll accurately.
+    internal_to_base_ioManager Internal.IoManagerFlagIoUring     = IoManagerFlagAuto
+      -- Nor io-uring.
+#endif
 
 internal_to_base_DebugFlags :: Internal.DebugFlags -> DebugFlags
 internal_to_base_DebugFlags Internal.DebugFlags{..} = DebugFlags{..}
@@ -24,6 +24,8 @@ module GHC.Compact.Serialized(
   withSerializedCompact,
   importCompact,
   importCompactByteStrings,
+  writeCompactToFd,
+  readCompactFromFd,
 ) where
 
 import GHC.Exts
@@ -35,8 +37,13 @@ import Control.Concurrent
 import qualified Data.ByteString as ByteString
 import Data.ByteString.Internal(toForeignPtr)
 import Data.IORef(newIORef, readIORef, writeIORef)
+import Foreign.C.Error(throwErrnoIfMinus1_, throwErrnoIfNull)
+import Foreign.C.Types(CInt(..))
 import Foreign.ForeignPtr(withForeignPtr)
+import Foreign.Marshal.Alloc(alloca)
 import Foreign.Marshal.Utils(copyBytes)
+import Foreign.Storable(peek)
+import System.Posix.Types(Fd(..))
 
 import GHC.Compact
 
@@ -198,3 +205,46 @@ importCompactByteStrings serialized stringList =
             copyBytes to (from `plusPtr` off) (fromIntegral size)
           writeIORef state rest
     importCompact serialized filler
+
+foreign import ccall safe "compactWriteFd"
+  c_compactWriteFd :: Ptr a -> Ptr b -> CInt -> IO CInt
+
+foreign import ccall unsafe "compactReadFd"
+  c_compactReadFd :: CInt -> Ptr (Ptr b) -> IO (Ptr a)
+
+-- | Write the 'Compact' to a file descriptor, at its current position, in a
+-- form that 'readCompactFromFd' can read back. The blocks of the 'Compact'
+-- are written directly from memory, without copying them.
+--
+-- Throws an 'IOError' if the write fails.
+--
+-- /Since: 0.1.1.0/
+writeCompactToFd :: Compact a -> Fd -> IO ()
+writeCompactToFd (Compact buffer root lock) (Fd fd) = withMVar lock $ \_ -> do
+  (firstBlock, _) <- compactGetFirstBlock buffer
+  rootPtr <- IO (\s -> case anyToAddr# root s of
+                    (# s', rootAddr #) -> (# s', Ptr rootAddr #) )
+  let write = throwErrnoIfMinus1_ "writeCompactToFd" $
+                c_compactWriteFd firstBlock rootPtr fd
+  IO $ \s -> keepAlive# buffer s (unIO write)
+
+-- | Read a 'Compact' written by 'writeCompactToFd' from a file descriptor,
+-- starting at its current position. If the file descriptor refers to a
+-- regular file the blocks of the 'Compact' are mapped from the file rather
+-- than read, so that only the parts of it which are used are ever loaded;
+-- the file must then not be modified while the 'Compact' is alive (closing
+-- the file descriptor is fine).
+--
+-- Like 'importCompact', this returns Nothing if the pointers in the
+-- 'Compact' could not be adjusted, and it throws an 'IOError' if the
+-- file descriptor can't be read or doesn't contain a 'Compact'. The read is
+-- done with an unsafe foreign call, so this is best used with files rather
+-- than with pipes or sockets.
+--
+-- /Since: 0.1.1.0/
+readCompactFromFd :: Fd -> IO (Maybe (Compact a))
+readCompactFromFd (Fd fd) = alloca $ \rootOut -> do
+  Ptr firstBlock <- throwErrnoIfNull "readCompactFromFd" $
+    c_compactReadFd fd rootOut
+  Ptr rootAddr <- peek rootOut
+  IO (fixupPointers firstBlock rootAddr)
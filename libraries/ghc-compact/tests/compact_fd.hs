@@ -0,0 +1,67 @@
+module Main where
+
+import Control.Exception
+import System.IO (IOMode(..))
+import System.Mem
+import System.Posix.Types (Fd(..))
+
+import qualified GHC.IO.Device as Device
+import qualified GHC.IO.FD as FD
+
+import GHC.Compact
+import GHC.Compact.Serialized
+
+assertFail :: String -> IO ()
+assertFail msg = throwIO $ AssertionFailed msg
+
+assertEquals :: (Eq a, Show a) => a -> a -> IO ()
+assertEquals expected actual =
+  if expected == actual then return ()
+  else assertFail $ "expected " ++ (show expected)
+       ++ ", got " ++ (show actual)
+
+type Val = (String, [Int], Maybe Integer)
+
+main :: IO ()
+main = do
+  let val1 = ("hello", [1..10000], Just 42) :: Val
+      val2 = ("world", [], Nothing) :: Val
+  cnf1 <- compactSized 4096 True val1
+  cnf2 <- compact val2
+
+  -- Two compacts in the same file: the second one starts where the first
+  -- one ends.
+  (fd, _) <- FD.openFile "compact_fd.bin" WriteMode False
+  writeCompactToFd cnf1 (Fd (FD.fdFD fd))
+  writeCompactToFd cnf2 (Fd (FD.fdFD fd))
+  Device.close fd
+  performMajorGC
+
+  (fd', _) <- FD.openFile "compact_fd.bin" ReadMode False
+  mcnf1 <- readCompactFromFd (Fd (FD.fdFD fd')) :: IO (Maybe (Compact Val))
+  mcnf2 <- readCompactFromFd (Fd (FD.fdFD fd')) :: IO (Maybe (Compact Val))
+  Device.close fd'
+  performMajorGC
+
+  case (mcnf1, mcnf2) of
+    (Just c1, Just c2) -> do
+      assertEquals val1 (getCompact c1)
+      assertEquals val2 (getCompact c2)
+    _ -> assertFail "import failed"
+
+  -- A truncated file is rejected rather than read past its end.
+  (fd'', _) <- FD.openFile "compact_fd_truncated.bin" ReadWriteMode False
+  writeCompactToFd cnf1 (Fd (FD.fdFD fd''))
+  size <- Device.getSize fd''
+  Device.setSize fd'' (size `div` 2)
+  Device.close fd''
+  (fd''', _) <- FD.openFile "compact_fd_truncated.bin" ReadMode False
+  r <- try (readCompactFromFd (Fd (FD.fdFD fd''')))
+         :: IO (Either IOException (Maybe (Compact Val)))
+  Device.close fd'''
+  case r of
+    Left _ -> return ()
+    Right _ -> assertFail "read a truncated compact"
+
+  -- The compacts are freed (and unmapped) by this GC.
+  performMajorGC
@@ -0,0 +1,37 @@
+module Main where
+
+import Control.Exception
+import Control.Monad
+import System.Mem
+
+import Data.ByteString (packCStringLen)
+import Foreign.Ptr
+
+import GHC.Compact
+import GHC.Compact.Serialized
+
+assertFail :: String -> IO ()
+assertFail msg = throwIO $ AssertionFailed msg
+
+-- A compact large enough to be fixed up by several threads (see
+-- Note [Compact fixup table]). The original stays alive, so the copy is
+-- necessarily imported at a different address.
+main :: IO ()
+main = do
+  let val = [ (i, show i) | i <- [1..200000] ] :: [(Int, String)]
+  cnf <- compact val
+  (sc, bytestrs) <- withSerializedCompact cnf $ \sc -> do
+    bs <- forM (serializedCompactBlockList sc) $ \(ptr, size) ->
+      packCStringLen (castPtr ptr, fromIntegral size)
+    return (sc, bs)
+  performMajorGC
+
+  mcnf <- importCompactByteStrings sc bytestrs
+  case mcnf of
+    Nothing -> assertFail "import failed"
+    Just cnf' -> do
+      performMajorGC
+      unless (getCompact cnf' == val) $ assertFail "wrong value"
+      print (length (getCompact cnf'))
+  -- Keep the original alive until the copy has been checked.
+  void $ evaluate (getCompact cnf)
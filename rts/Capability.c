@@ -58,6 +58,12 @@ Capability **capabilities;
 // locking, so we don't do that.
 static Capability *last_free_capability[MAX_NUMA_NODES];
 
+#if defined(THREADED_RTS)
+// Capacity of each Capability's stealable_threads deque.  Threads that don't
+// fit simply stay on the run queue; see Note [Thread stealing].
+#define STEALABLE_THREADS_SIZE 256
+#endif
+
 /*
  * Indicates that the RTS wants to synchronise all the Capabilities
  * for some reason.  All Capabilities should yieldCapability().
@@ -121,11 +127,13 @@ findSpark (Capability *cap)
       spark = tryStealSpark(cap->sparks);
       while (spark != NULL && fizzledSpark(spark)) {
           cap->spark_stats.fizzled++;
+          atomic_inc(&cap->spark_throttle.wasted, 1);
           traceEventSparkFizzle(cap);
           spark = tryStealSpark(cap->sparks);
       }
       if (spark != NULL) {
           cap->spark_stats.converted++;
+          atomic_inc(&cap->spark_throttle.converted, 1);
 
           // Post event for running a spark from capability's own pool.
           traceEventSparkRun(cap);
@@ -155,6 +163,9 @@ findSpark (Capability *cap)
           spark = tryStealSpark(robbed->sparks);
           while (spark != NULL && fizzledSpark(spark)) {
               cap->spark_stats.fizzled++;
+              // The spark counts against the pool it was made in, see
+              // Note [Spark throttling] in Sparks.c.
+              atomic_inc(&robbed->spark_throttle.wasted, 1);
               traceEventSparkFizzle(cap);
               spark = tryStealSpark(robbed->sparks);
           }
@@ -166,6 +177,7 @@ findSpark (Capability *cap)
 
           if (spark != NULL) {
               cap->spark_stats.converted++;
+              atomic_inc(&robbed->spark_throttle.converted, 1);
               traceEventSparkSteal(cap, robbed->no);
 
               return spark;
@@ -283,6 +295,11 @@ initCapability (Capability *cap, uint32_t i)
     cap->spark_stats.converted  = 0;
     cap->spark_stats.gcd        = 0;
     cap->spark_stats.fizzled    = 0;
+    initSparkThrottle(&cap->spark_throttle);
+    cap->stealable_threads  = NULL;
+    if (RtsFlags.ParFlags.stealThreads && RtsFlags.ParFlags.migrate) {
+        cap->stealable_threads = newWSDeque(STEALABLE_THREADS_SIZE);
+    }
 #endif
     cap->total_allocated        = 0;
 
@@ -316,6 +333,8 @@ initCapability (Capability *cap, uint32_t i)
     cap->free_trec_chunks = END_STM_CHUNK_LIST;
     cap->free_trec_headers = NO_TREC;
     cap->transaction_tokens = 0;
+    memset(&cap->stm_stats, 0, sizeof(cap->stm_stats));
+    cap->stack_sample_pending = false;
     cap->context_switch = 0;
     cap->interrupt = 0;
     cap->pinned_object_block = NULL;
@@ -1302,6 +1321,9 @@ freeCapability (Capability *cap)
     }
 #if defined(THREADED_RTS)
     freeSparkPool(cap->sparks);
+    if (cap->stealable_threads != NULL) {
+        freeWSDeque(cap->stealable_threads);
+    }
 #endif
     traceCapsetRemoveCap(CAPSET_OSPROCESS_DEFAULT, cap->no);
     traceCapsetRemoveCap(CAPSET_CLOCKDOMAIN_DEFAULT, cap->no);
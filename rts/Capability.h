@@ -147,6 +147,11 @@ struct Capability_ {
     StgTRecChunk *free_trec_chunks;
     StgTRecHeader *free_trec_headers;
     uint32_t transaction_tokens;
+    STMStats stm_stats;             // See Note [STM statistics] in STM.c
+
+    // Set by the ticker when the thread running on this Capability should
+    // have its stack sampled. See Note [Stack sampling] in Proftimer.c.
+    bool stack_sample_pending;
 
     // WARNING: unconditional struct members must come before ones
     // conditional on THREADED_RTS. Otherwise the CMM Capability_*
@@ -186,6 +191,14 @@ struct Capability_ {
 
     // Stats on spark creation/conversion
     SparkCounters spark_stats;
+
+    // See Note [Spark throttling] in Sparks.c
+    SparkThrottle spark_throttle;
+
+    // Runnable threads this Capability has offered up for stealing, or
+    // NULL when thread stealing (+RTS -qs) is off.
+    // See Note [Thread stealing] in Schedule.c.
+    WSDeque *stealable_threads;
 #endif
 
     // WARNING: No more unconditional struct members here, or they will
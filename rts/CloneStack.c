@@ -69,6 +69,46 @@ StgStack* cloneStack(Capability* capability, const StgStack* stack)
   return top_stack;
 }
 
+// Store the info pointers (as in the IPE map) of the (at most max_frames) topmost frames of a
+// stack in frames, following underflow frames into the older chunks, and
+// return how many there were. The stack must belong to a thread which isn't
+// running. Used for stack samples, see Note [Stack sampling] in Proftimer.c.
+uint32_t stackFrameInfoPointers(const StgStack *stack, StgWord64 *frames,
+                                uint32_t max_frames)
+{
+  uint32_t n = 0;
+  StgPtr sp = stack->sp;
+  while (n < max_frames) {
+    StgClosure *frame = (StgClosure *) sp;
+    const StgRetInfoTable *info = get_ret_itbl(frame);
+    switch (info->i.type) {
+    case UNDERFLOW_FRAME:
+      stack = ((StgUnderflowFrame *) frame)->next_chunk;
+      sp = stack->sp;
+      continue;
+    case STOP_FRAME:
+      return n;
+    case RET_FUN:
+      // A function application suspended at a heap or stack check: the
+      // function says more about where we are than stg_gc_fun does.
+      frames[n++] = (StgWord64)(W_)
+        UNTAG_CLOSURE(((StgRetFun *) frame)->fun)->header.info;
+      break;
+    default:
+      if (frame->header.info == &stg_enter_info) {
+        // Likewise for a closure about to be entered.
+        frames[n++] = (StgWord64)(W_)
+          UNTAG_CLOSURE((StgClosure *) sp[1])->header.info;
+      } else {
+        frames[n++] = (StgWord64)(W_) frame->header.info;
+      }
+      break;
+    }
+    sp += stack_frame_sizeW(frame);
+  }
+  return n;
+}
+
 #if defined(THREADED_RTS)
 
 // ThreadId# in Haskell is a StgTSO* in RTS.
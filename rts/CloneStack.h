@@ -16,6 +16,9 @@ void sendCloneStackMessage(StgTSO *tso, HsStablePtr mvar);
 
 #include "BeginPrivate.h"
 
+uint32_t stackFrameInfoPointers(const StgStack *stack, StgWord64 *frames,
+                                uint32_t max_frames);
+
 #if defined(THREADED_RTS)
 void handleCloneStackMessage(Capability *cap, MessageCloneStack *msg);
 #endif
@@ -1,11 +1,12 @@
 /*-----------------------------------------------------------------------------
  *
- * (c) The AQUA Project, Glasgow University, 1995-1998
- * (c) The GHC Team, 1999
+ * (c) The GHC Team, 2026
  *
- * Dynamically expanding linear hash tables, as described in
- * Per-\AAke Larson, ``Dynamic Hash Tables,'' CACM 31(4), April 1988,
- * pp. 446 -- 457.
+ * Open-addressing hash tables with one byte of metadata per slot, in the
+ * style of the "Swiss tables" of the Abseil C++ library.
+ *
+ * The previous implementation, using linear hashing and separate chaining,
+ * is in HashLinear.c and can be selected with RTS_LINEAR_HASH.
  * -------------------------------------------------------------------------- */
 
 #include "rts/PosixSource.h"
@@ -14,43 +15,169 @@
 #include "Hash.h"
 #include "RtsUtils.h"
 
+#if !defined(RTS_LINEAR_HASH)
+
 #define XXH_INLINE_ALL
 
 #include "xxhash.h"
 
 #include <string.h>
 
-#define HSEGSIZE    1024    /* Size of a single hash table segment */
-                            /* Also the minimum size of a hash table */
-#define HDIRSIZE    1024    /* Size of the segment directory */
-                            /* Maximum hash table size is HSEGSIZE * HDIRSIZE */
-#define HLOAD       5       /* Maximum average load of a single hash bucket */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Note [Open-addressing hash tables]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * A table is an array of 2^n groups of GROUP_SIZE slots. Each slot holds a
+ * (key, data) pair and has a control byte, kept in a separate array, which is
+ * one of
+ *
+ *   - CTRL_EMPTY: the slot has never been used since the last rehash,
+ *   - CTRL_DELETED: a tombstone, left behind when an entry is removed,
+ *   - 0x00..0x7f: the slot is full, and this is the low 7 bits of the hash of
+ *     its key ("H2").
+ *
+ * The remaining bits of the hash ("H1") select the group at which to start
+ * probing. Groups are probed in triangular order (H1, H1+1, H1+3, H1+6, ...),
+ * which visits every group since their number is a power of two. Within a
+ * group we compare all the control bytes with H2 at once, with SSE2 where
+ * available and otherwise with arithmetic on a 64-bit word holding a group
+ * of 8 bytes, and only compare the keys of the slots that match. A lookup
+ * ends at the first group containing an EMPTY slot, so most lookups touch
+ * one cache line of control bytes and one slot, rather than walking a
+ * linked list of separately allocated cells.
+ *
+ * We rehash when inserting would leave fewer than 1/8 of the slots EMPTY
+ * (counting tombstones as used), so a lookup always finds an EMPTY slot
+ * eventually. The table doubles in size if more than 7/16 of the slots hold
+ * live entries, and otherwise is rebuilt at the same size to get rid of the
+ * tombstones. Removing an entry from a group which still has an EMPTY slot
+ * doesn't need a tombstone, since no probe sequence can have passed through
+ * that group.
+ *
+ * Unlike the linear hash table, inserting a key that is already present
+ * replaces both the stored key and its value. As for lookups, keys are
+ * compared with the CompareFunction of the table, so e.g. inserting a copy
+ * of a string key replaces the entry for the original.
+ *
+ * Hash functions (hashWord, hashStr, hashBuffer and those built on them)
+ * return a full 32-bit hash, independent of the size of the table.
+ */
+
+#define CTRL_EMPTY   ((uint8_t) 0x80)
+#define CTRL_DELETED ((uint8_t) 0xfe)
+
+#define IS_FULL(c)   ((c) < 0x80)
+
+#define H1(h)        ((h) >> 7)
+#define H2(h)        ((uint8_t) ((h) & 0x7f))
+
+/* A bit mask of matching slots in a group, as returned by the match*()
+ * functions below. Use lowestMatch() to get the index of the first match and
+ * m & (m - 1) to clear it.
+ */
+#if defined(__SSE2__)
+
+#define GROUP_SIZE 16
+typedef uint32_t GroupMask;
+
+STATIC_INLINE GroupMask
+matchByte(const uint8_t *ctrl, uint8_t b)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(b)));
+}
+
+STATIC_INLINE GroupMask
+matchEmpty(const uint8_t *ctrl)
+{
+    return matchByte(ctrl, CTRL_EMPTY);
+}
+
+// Empty or deleted: exactly the control bytes with the high bit set.
+STATIC_INLINE GroupMask
+matchFree(const uint8_t *ctrl)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    return _mm_movemask_epi8(group);
+}
+
+STATIC_INLINE uint32_t
+lowestMatch(GroupMask m)
+{
+    return __builtin_ctz(m);
+}
+
+#else
+
+#define GROUP_SIZE 8
+typedef uint64_t GroupMask;
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+STATIC_INLINE uint64_t
+loadGroup(const uint8_t *ctrl)
+{
+    uint64_t group;
+    memcpy(&group, ctrl, sizeof(group));
+#if defined(WORDS_BIGENDIAN)
+    group = __builtin_bswap64(group);
+#endif
+    return group;
+}
+
+// Sets the high bit of each byte equal to b. This may also report a byte
+// that immediately follows a real match, but we always compare the keys
+// anyway.
+STATIC_INLINE GroupMask
+matchByte(const uint8_t *ctrl, uint8_t b)
+{
+    uint64_t x = loadGroup(ctrl) ^ (LSBS * b);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+// EMPTY is the only control byte with the high bit set and bit 1 clear.
+STATIC_INLINE GroupMask
+matchEmpty(const uint8_t *ctrl)
+{
+    uint64_t group = loadGroup(ctrl);
+    return group & ~(group << 6) & MSBS;
+}
+
+STATIC_INLINE GroupMask
+matchFree(const uint8_t *ctrl)
+{
+    return loadGroup(ctrl) & MSBS;
+}
 
-#define HCHUNK      (1024 * sizeof(W_) / sizeof(HashList))
-                            /* Number of HashList cells to allocate in one go */
+// See rts/prim/ctz.c for why we avoid __builtin_ctzll() on 32-bit platforms.
+STATIC_INLINE uint32_t
+lowestMatch(GroupMask m)
+{
+#if WORD_SIZE_IN_BITS == 64
+    return __builtin_ctzll(m) >> 3;
+#else
+    return ((uint32_t) m ? __builtin_ctz((uint32_t) m)
+                         : __builtin_ctz((uint32_t) (m >> 32)) + 32) >> 3;
+#endif
+}
 
+#endif
 
-/* Linked list of (key, data) pairs for separate chaining */
-typedef struct hashlist {
+/* (key, data) pair stored in each slot */
+typedef struct {
     StgWord key;
     const void *data;
-    struct hashlist *next;  /* Next cell in bucket chain (same hash value) */
-} HashList;
-
-typedef struct chunklist {
-  struct chunklist *next;
-} HashListChunk;
+} HashEntry;
 
 struct hashtable {
-    int split;              /* Next bucket to split when expanding */
-    int max;                /* Max bucket of smaller table */
-    int mask1;              /* Mask for doing the mod of h_1 (smaller table) */
-    int mask2;              /* Mask for doing the mod of h_2 (larger table) */
+    HashEntry *slots;       /* Slots, GROUP_SIZE * (mask + 1) of them */
+    uint8_t *ctrl;          /* Control bytes, one per slot */
+    StgWord mask;           /* Number of groups - 1 */
     int kcount;             /* Number of keys */
-    int bcount;             /* Number of buckets */
-    HashList **dir[HDIRSIZE];   /* Directory of segments */
-    HashList *freeList;         /* free list of HashLists */
-    HashListChunk *chunks;      /* list of HashListChunks so we can later free them */
+    int growth_left;        /* EMPTY slots we may fill before rehashing */
 };
 
 /* Create an identical structure, but is distinct on a type level,
@@ -60,29 +187,32 @@ struct hashtable {
 struct strhashtable { struct hashtable table; };
 
 /* -----------------------------------------------------------------------------
- * Hash first using the smaller table.  If the bucket is less than the
- * next bucket to be split, re-hash using the larger table.
+ * Hash functions
  * -------------------------------------------------------------------------- */
+
 int
-hashWord(const HashTable *table, StgWord key)
+hashWord(const HashTable *table STG_UNUSED, StgWord key)
 {
-    int bucket;
-
-    /* Strip the boring zero bits */
-    key /= sizeof(StgWord);
-
-    /* Mod the size of the hash table (a power of 2) */
-    bucket = key & table->mask1;
-
-    if (bucket < table->split) {
-        /* Mod the size of the expanded hash table (also a power of 2) */
-        bucket = key & table->mask2;
-    }
-    return bucket;
+    /* The finaliser of MurmurHash3: keys are often pointers, which have
+     * boring low bits, but we need all the bits of the hash to be good. */
+#if WORD_SIZE_IN_BITS == 64
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    key *= UINT64_C(0xc4ceb9fe1a85ec53);
+    key ^= key >> 33;
+#else
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+#endif
+    return (int) (uint32_t) key;
 }
 
 int
-hashBuffer(const HashTable *table, const void *buf, size_t len)
+hashBuffer(const HashTable *table STG_UNUSED, const void *buf, size_t len)
 {
     const char *key = (char*) buf;
 #if WORD_SIZE_IN_BITS == 64
@@ -91,15 +221,7 @@ hashBuffer(const HashTable *table, const void *buf, size_t len)
     StgWord h = XXH32 (key, len, 1048583);
 #endif
 
-    /* Mod the size of the hash table (a power of 2) */
-    int bucket = h & table->mask1;
-
-    if (bucket < table->split) {
-        /* Mod the size of the expanded hash table (also a power of 2) */
-        bucket = h & table->mask2;
-    }
-
-    return bucket;
+    return (int) (uint32_t) h;
 }
 
 int
@@ -121,102 +243,113 @@ compareStr(StgWord key1, StgWord key2)
     return (strcmp((char *)key1, (char *)key2) == 0);
 }
 
-
 /* -----------------------------------------------------------------------------
- * Allocate a new segment of the dynamically growing hash table.
+ * Allocating the slots
  * -------------------------------------------------------------------------- */
 
-STATIC_INLINE void
-allocSegment(HashTable *table, int segment)
+#define HMINGROUPS  1       /* Initial number of groups */
+
+STATIC_INLINE StgWord
+capacity(const HashTable *table)
 {
-    table->dir[segment] = stgMallocBytes(HSEGSIZE * sizeof(HashList *),
-                                         "allocSegment");
+    return (table->mask + 1) * GROUP_SIZE;
 }
 
+static void
+allocSlots(HashTable *table, StgWord groups)
+{
+    const StgWord n = groups * GROUP_SIZE;
+
+    // One allocation for both arrays; the control bytes go last so they
+    // don't upset the alignment of the slots.
+    table->slots = stgMallocBytes(n * (sizeof(HashEntry) + 1), "allocSlots");
+    table->ctrl = (uint8_t *) (table->slots + n);
+    memset(table->ctrl, CTRL_EMPTY, n);
+    table->mask = groups - 1;
+    table->growth_left = n - n / 8 - table->kcount;
+}
+
+// Find the first EMPTY or DELETED slot on the probe sequence of hash h.
+STATIC_INLINE StgWord
+findFreeSlot(const HashTable *table, uint32_t h)
+{
+    StgWord g = H1(h) & table->mask;
+    for (StgWord stride = 1; ; stride++) {
+        const GroupMask m = matchFree(&table->ctrl[g * GROUP_SIZE]);
+        if (m != 0) {
+            return g * GROUP_SIZE + lowestMatch(m);
+        }
+        g = (g + stride) & table->mask;
+    }
+}
 
 /* -----------------------------------------------------------------------------
- * Expand the larger hash table by one bucket, and split one bucket
- * from the smaller table into two parts.  Only the bucket referenced
- * by @table->split@ is affected by the expansion.
+ * Rebuild the table, larger if it's getting full, or at the same size to get
+ * rid of tombstones. See Note [Open-addressing hash tables].
  * -------------------------------------------------------------------------- */
 
-STATIC_INLINE void
-expand(HashTable *table, HashFunction f)
-{
-    int oldsegment;
-    int oldindex;
-    int newbucket;
-    int newsegment;
-    int newindex;
-    HashList *hl;
-    HashList *next;
-    HashList *old, *new;
-
-    if (table->split + table->max >= HDIRSIZE * HSEGSIZE)
-        /* Wow!  That's big.  Too big, so don't expand. */
-        return;
+static void
+rehash(HashTable *table, HashFunction f)
+{
+    HashEntry *old_slots = table->slots;
+    const uint8_t *old_ctrl = table->ctrl;
+    const StgWord old_capacity = capacity(table);
 
-    /* Calculate indices of bucket to split */
-    oldsegment = table->split / HSEGSIZE;
-    oldindex = table->split % HSEGSIZE;
+    StgWord groups = table->mask + 1;
+    if (((StgWord) table->kcount + 1) * 16 > old_capacity * 7) {
+        groups *= 2;
+    }
+    allocSlots(table, groups);
+
+    for (StgWord i = 0; i < old_capacity; i++) {
+        if (IS_FULL(old_ctrl[i])) {
+            const uint32_t h = (uint32_t) f(table, old_slots[i].key);
+            const StgWord s = findFreeSlot(table, h);
+            table->ctrl[s] = H2(h);
+            table->slots[s] = old_slots[i];
+        }
+    }
 
-    newbucket = table->max + table->split;
+    stgFree(old_slots);
+}
 
-    /* And the indices of the new bucket */
-    newsegment = newbucket / HSEGSIZE;
-    newindex = newbucket % HSEGSIZE;
+/* -----------------------------------------------------------------------------
+ * Lookup, insertion and removal
+ * -------------------------------------------------------------------------- */
 
-    if (newindex == 0)
-        allocSegment(table, newsegment);
+#define NO_SLOT (~(StgWord) 0)
 
-    if (++table->split == table->max) {
-        table->split = 0;
-        table->max *= 2;
-        table->mask1 = table->mask2;
-        table->mask2 = table->mask2 << 1 | 1;
-    }
-    table->bcount++;
-
-    /* Split the bucket, paying no attention to the original order */
-
-    old = new = NULL;
-    for (hl = table->dir[oldsegment][oldindex]; hl != NULL; hl = next) {
-        next = hl->next;
-        if (f(table, hl->key) == newbucket) {
-            hl->next = new;
-            new = hl;
-        } else {
-            hl->next = old;
-            old = hl;
+// Find the slot holding key, or NO_SLOT.
+STATIC_INLINE StgWord
+findSlot(const HashTable *table, StgWord key, uint32_t h, CompareFunction cmp)
+{
+    const uint8_t h2 = H2(h);
+    StgWord g = H1(h) & table->mask;
+
+    for (StgWord stride = 1; ; stride++) {
+        const uint8_t *ctrl = &table->ctrl[g * GROUP_SIZE];
+        for (GroupMask m = matchByte(ctrl, h2); m != 0; m &= m - 1) {
+            const StgWord s = g * GROUP_SIZE + lowestMatch(m);
+            if (cmp(table->slots[s].key, key)) {
+                return s;
+            }
+        }
+        if (matchEmpty(ctrl) != 0) {
+            return NO_SLOT;
         }
+        g = (g + stride) & table->mask;
     }
-    table->dir[oldsegment][oldindex] = old;
-    table->dir[newsegment][newindex] = new;
-
-    return;
 }
 
 STATIC_INLINE void*
 lookupHashTable_inlined(const HashTable *table, StgWord key,
                         HashFunction f, CompareFunction cmp)
 {
-    int bucket;
-    int segment;
-    int index;
-
-    HashList *hl;
-
-    bucket = f(table, key);
-    segment = bucket / HSEGSIZE;
-    index = bucket % HSEGSIZE;
-
-    for (hl = table->dir[segment][index]; hl != NULL; hl = hl->next) {
-        if (cmp(hl->key, key))
-            return (void *) hl->data;
+    const StgWord s = findSlot(table, key, (uint32_t) f(table, key), cmp);
+    if (s == NO_SLOT) {
+        return NULL;
     }
-
-    /* It's not there */
-    return NULL;
+    return (void *) table->slots[s].data;
 }
 
 void *
@@ -245,159 +378,90 @@ lookupStrHashTable(const StrHashTable* table, const char* key)
 // If the table is modified concurrently, the function behavior is undefined.
 //
 int keysHashTable(HashTable *table, StgWord keys[], int szKeys) {
-    int segment, index;
     int k = 0;
-    HashList *hl;
-
+    const StgWord n = capacity(table);
 
-    /* The last bucket with something in it is table->max + table->split - 1 */
-    segment = (table->max + table->split - 1) / HSEGSIZE;
-    index = (table->max + table->split - 1) % HSEGSIZE;
-
-    while (segment >= 0 && k < szKeys) {
-        while (index >= 0 && k < szKeys) {
-            hl = table->dir[segment][index];
-            while (hl && k < szKeys) {
-                keys[k] = hl->key;
-                k += 1;
-                hl = hl->next;
-            }
-            index--;
+    for (StgWord i = 0; i < n && k < szKeys; i++) {
+        if (IS_FULL(table->ctrl[i])) {
+            keys[k] = table->slots[i].key;
+            k += 1;
         }
-        segment--;
-        index = HSEGSIZE - 1;
     }
     return k;
 }
 
-/* -----------------------------------------------------------------------------
- * We allocate the hashlist cells in large chunks to cut down on malloc
- * overhead.  Although we keep a free list of hashlist cells, we make
- * no effort to actually return the space to the malloc arena. Eventually
- * they will all be freed when we free the HashListChunks.
- * -------------------------------------------------------------------------- */
-
-static HashList *
-allocHashList (HashTable *table)
-{
-    if (table->freeList != NULL) {
-        HashList *hl = table->freeList;
-        table->freeList = hl->next;
-        return hl;
-    } else {
-        /* We allocate one block of memory which contains:
-         *
-         *  1. A HashListChunk, which gets linked onto HashTable.chunks.
-         *     This forms a list of all chunks associated with the HashTable
-         *     and is what we will free when we free the HashTable.
-         *
-         *  2. Several HashLists. One of these will get returned. The rest are
-         *     placed on the freeList.
-         *
-         */
-        HashListChunk *cl = stgMallocBytes(sizeof(HashListChunk) + HCHUNK * sizeof(HashList), "allocHashList");
-        HashList *hl = (HashList *) &cl[1];
-        cl->next = table->chunks;
-        table->chunks = cl;
-
-        table->freeList = hl + 1;
-        HashList *p = table->freeList;
-        for (; p < hl + HCHUNK - 1; p++)
-            p->next = p + 1;
-        p->next = NULL;
-        return hl;
-    }
-}
-
-static void
-freeHashList (HashTable *table, HashList *hl)
-{
-    // We place the HashList on the freeList. We make no attempt to bound the
-    // size of the free list for the time being. The HashLists on the freeList
-    // are freed when the HashTable itself is freed as a result of freeing the
-    // HashListChunks.
-    hl->next = table->freeList;
-    table->freeList = hl;
-}
-
 STATIC_INLINE void
 insertHashTable_inlined(HashTable *table, StgWord key,
-                        const void *data, HashFunction f)
+                        const void *data, HashFunction f, CompareFunction cmp)
 {
-    int bucket;
-    int segment;
-    int index;
-    HashList *hl;
-
-    // Disable this assert; sometimes it's useful to be able to
-    // overwrite entries in the hash table.
-    // ASSERT(lookupHashTable(table, key) == NULL);
-
-    /* When the average load gets too high, we expand the table */
-    if (++table->kcount >= HLOAD * table->bcount)
-        expand(table, f);
-
-    bucket = f(table, key);
-    segment = bucket / HSEGSIZE;
-    index = bucket % HSEGSIZE;
+    const uint32_t h = (uint32_t) f(table, key);
+
+    // An existing entry for this key gets the new key and value: the caller
+    // may be about to free the old key (e.g. the SPT, whose keys live in the
+    // module that inserted them).
+    StgWord s = findSlot(table, key, h, cmp);
+    if (s != NO_SLOT) {
+        table->slots[s].key = key;
+        table->slots[s].data = data;
+        return;
+    }
 
-    hl = allocHashList(table);
+    s = findFreeSlot(table, h);
+    if (table->ctrl[s] == CTRL_EMPTY) {
+        if (table->growth_left == 0) {
+            rehash(table, f);
+            s = findFreeSlot(table, h);
+        }
+        table->growth_left--;
+    }
 
-    hl->key = key;
-    hl->data = data;
-    hl->next = table->dir[segment][index];
-    table->dir[segment][index] = hl;
+    table->ctrl[s] = H2(h);
+    table->slots[s].key = key;
+    table->slots[s].data = data;
+    table->kcount++;
 }
 
 void
 insertHashTable_(HashTable *table, StgWord key,
-                 const void *data, HashFunction f)
+                 const void *data, HashFunction f, CompareFunction cmp)
 {
-    return insertHashTable_inlined(table, key, data, f);
+    insertHashTable_inlined(table, key, data, f, cmp);
 }
 
 void
 insertHashTable(HashTable *table, StgWord key, const void *data)
 {
-    insertHashTable_inlined(table, key, data, hashWord);
+    insertHashTable_inlined(table, key, data, hashWord, compareWord);
 }
 
 void
 insertStrHashTable(StrHashTable *table, const char * key, const void *data)
 {
-    insertHashTable_inlined(&table->table, (StgWord) key, data, hashStr);
+    insertHashTable_inlined(&table->table, (StgWord) key, data,
+                            hashStr, compareStr);
 }
 
 STATIC_INLINE void*
 removeHashTable_inlined(HashTable *table, StgWord key, const void *data,
                         HashFunction f, CompareFunction cmp)
 {
-    int bucket;
-    int segment;
-    int index;
-    HashList *hl;
-    HashList *prev = NULL;
-
-    bucket = f(table, key);
-    segment = bucket / HSEGSIZE;
-    index = bucket % HSEGSIZE;
-
-    for (hl = table->dir[segment][index]; hl != NULL; hl = hl->next) {
-        if (cmp(hl->key, key) && (data == NULL || hl->data == data)) {
-            if (prev == NULL)
-                table->dir[segment][index] = hl->next;
-            else
-                prev->next = hl->next;
-            freeHashList(table,hl);
-            table->kcount--;
-            return (void *) hl->data;
-        }
-        prev = hl;
+    const StgWord s = findSlot(table, key, (uint32_t) f(table, key), cmp);
+
+    if (s == NO_SLOT || (data != NULL && table->slots[s].data != data)) {
+        /* It's not there */
+        ASSERT(data == NULL);
+        return NULL;
     }
 
-    /* It's not there */
-    ASSERT(data == NULL);
-    return NULL;
+    const StgWord g = s / GROUP_SIZE;
+    if (matchEmpty(&table->ctrl[g * GROUP_SIZE]) != 0) {
+        table->ctrl[s] = CTRL_EMPTY;
+        table->growth_left++;
+    } else {
+        table->ctrl[s] = CTRL_DELETED;
+    }
+    table->kcount--;
+    return (void *) table->slots[s].data;
 }
 
 void*
@@ -429,35 +493,16 @@ removeStrHashTable(StrHashTable *table, const char * key, const void *data)
 void
 freeHashTable(HashTable *table, void (*freeDataFun)(void *) )
 {
-    /* The last bucket with something in it is table->max + table->split - 1 */
-    long segment = (table->max + table->split - 1) / HSEGSIZE;
-    long index = (table->max + table->split - 1) % HSEGSIZE;
-
-    /* Free table segments */
-    while (segment >= 0) {
-        if (freeDataFun) {
-            while (index >= 0) {
-                HashList *next;
-                for (HashList *hl = table->dir[segment][index]; hl != NULL; hl = next) {
-                    next = hl->next;
-                    (*freeDataFun)((void *) hl->data);
-                }
-                index--;
+    if (freeDataFun) {
+        const StgWord n = capacity(table);
+        for (StgWord i = 0; i < n; i++) {
+            if (IS_FULL(table->ctrl[i])) {
+                (*freeDataFun)((void *) table->slots[i].data);
             }
         }
-        stgFree(table->dir[segment]);
-        segment--;
-        index = HSEGSIZE - 1;
-    }
-
-    /* Free chunks */
-    HashListChunk *cl = table->chunks;
-    while (cl != NULL) {
-        HashListChunk *old = cl;
-        cl = cl->next;
-        stgFree(old);
     }
 
+    stgFree(table->slots);
     stgFree(table);
 }
 
@@ -468,88 +513,53 @@ freeHashTable(HashTable *table, void (*freeDataFun)(void *) )
 void
 mapHashTable(HashTable *table, void *data, MapHashFn fn)
 {
-    /* The last bucket with something in it is table->max + table->split - 1 */
-    long segment = (table->max + table->split - 1) / HSEGSIZE;
-    long index = (table->max + table->split - 1) % HSEGSIZE;
-
-    while (segment >= 0) {
-        while (index >= 0) {
-            for (HashList *hl = table->dir[segment][index]; hl != NULL; hl = hl->next) {
-                fn(data, hl->key, hl->data);
-            }
-            index--;
+    const StgWord n = capacity(table);
+    for (StgWord i = 0; i < n; i++) {
+        if (IS_FULL(table->ctrl[i])) {
+            fn(data, table->slots[i].key, table->slots[i].data);
         }
-        segment--;
-        index = HSEGSIZE - 1;
     }
 }
 
+// Note that fn may change the keys (e.g. the compacting GC threads them, see
+// Note [CNFs in compacting GC] in Compact.c), after which lookups no longer
+// work; the table can still be traversed and freed.
 void
 mapHashTableKeys(HashTable *table, void *data, MapHashFnKeys fn)
 {
-    /* The last bucket with something in it is table->max + table->split - 1 */
-    long segment = (table->max + table->split - 1) / HSEGSIZE;
-    long index = (table->max + table->split - 1) % HSEGSIZE;
-
-    while (segment >= 0) {
-        while (index >= 0) {
-            for (HashList *hl = table->dir[segment][index]; hl != NULL; hl = hl->next) {
-                fn(data, &hl->key, hl->data);
-            }
-            index--;
+    const StgWord n = capacity(table);
+    for (StgWord i = 0; i < n; i++) {
+        if (IS_FULL(table->ctrl[i])) {
+            fn(data, &table->slots[i].key, table->slots[i].data);
         }
-        segment--;
-        index = HSEGSIZE - 1;
     }
 }
 
 void
 iterHashTable(HashTable *table, void *data, IterHashFn fn)
 {
-    /* The last bucket with something in it is table->max + table->split - 1 */
-    long segment = (table->max + table->split - 1) / HSEGSIZE;
-    long index = (table->max + table->split - 1) % HSEGSIZE;
-
-    while (segment >= 0) {
-        while (index >= 0) {
-            for (HashList *hl = table->dir[segment][index]; hl != NULL; hl = hl->next) {
-                if (!fn(data, hl->key, hl->data)) {
-                    return;
-                }
+    const StgWord n = capacity(table);
+    for (StgWord i = 0; i < n; i++) {
+        if (IS_FULL(table->ctrl[i])) {
+            if (!fn(data, table->slots[i].key, table->slots[i].data)) {
+                return;
             }
-            index--;
         }
-        segment--;
-        index = HSEGSIZE - 1;
     }
 }
 
 /* -----------------------------------------------------------------------------
- * When we initialize a hash table, we set up the first segment as well,
- * initializing all of the first segment's hash buckets to NULL.
+ * A new table starts with HMINGROUPS groups, all slots EMPTY.
  * -------------------------------------------------------------------------- */
 
 HashTable *
 allocHashTable(void)
 {
     HashTable *table;
-    HashList **hb;
 
     table = stgMallocBytes(sizeof(HashTable),"allocHashTable");
-
-    allocSegment(table, 0);
-
-    for (hb = table->dir[0]; hb < table->dir[0] + HSEGSIZE; hb++)
-        *hb = NULL;
-
-    table->split = 0;
-    table->max = HSEGSIZE;
-    table->mask1 = HSEGSIZE - 1;
-    table->mask2 = 2 * HSEGSIZE - 1;
     table->kcount = 0;
-    table->bcount = HSEGSIZE;
-    table->freeList = NULL;
-    table->chunks = NULL;
+    allocSlots(table, HMINGROUPS);
 
     return table;
 }
@@ -558,3 +568,5 @@ int keyCountHashTable (HashTable *table)
 {
     return table->kcount;
 }
+
+#endif /* !RTS_LINEAR_HASH */
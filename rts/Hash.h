@@ -18,6 +18,10 @@ typedef struct strhashtable StrHashTable;
  * but when the value is looked up or removed, the value is returned without the
  * `const` so that calling function can mutate what the pointer points to if it
  * needs to.
+ *
+ * Inserting a key that is already in the table replaces its value. (With the
+ * old linear hash table, selected with RTS_LINEAR_HASH, the new entry instead
+ * shadows the old one until it is removed; don't rely on either.)
  */
 HashTable * allocHashTable  ( void );
 void        insertHashTable ( HashTable *table, StgWord key, const void *data );
@@ -70,13 +74,16 @@ void *      removeStrHashTable ( StrHashTable *table, const char * key,
 typedef int HashFunction(const HashTable *table, StgWord key);
 typedef int CompareFunction(StgWord key1, StgWord key2);
 
-// Helper for implementing hash functions
+// Helper for implementing hash functions. A HashFunction should be built on
+// hashWord, hashStr or hashBuffer and return their result unchanged: what it
+// means depends on the implementation of the table.
 int hashBuffer(const HashTable *table, const void *buf, size_t len);
 
 int hashWord(const HashTable *table, StgWord key);
 int hashStr(const HashTable *table, StgWord w);
 void        insertHashTable_ ( HashTable *table, StgWord key,
-                               const void *data, HashFunction f );
+                               const void *data, HashFunction f,
+                               CompareFunction cmp );
 void *      lookupHashTable_ ( const HashTable *table, StgWord key,
                                HashFunction f, CompareFunction cmp );
 void *      removeHashTable_ ( HashTable *table, StgWord key,
@@ -38,6 +38,16 @@
 #include "posix/Timeout.h"
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+#include "posix/Epoll.h"
+#include "posix/Timeout.h"
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+#include "posix/IOUring.h"
+#include "posix/Timeout.h"
+#endif
+
 #if defined(IOMGR_ENABLED_MIO_POSIX)
 #include "posix/MIO.h"
 #include "Prelude.h"
@@ -125,6 +135,22 @@ parseIOManagerFlag(const char *iomgrstr, IO_MANAGER_FLAG *flag)
         return IOManagerAvailable;
 #else
         return IOManagerUnavailable;
+#endif
+    }
+    else if (strcmp("epoll", iomgrstr) == 0) {
+#if defined(IOMGR_ENABLED_EPOLL)
+        *flag = IO_MNGR_FLAG_EPOLL;
+        return IOManagerAvailable;
+#else
+        return IOManagerUnavailable;
+#endif
+    }
+    else if (strcmp("io-uring", iomgrstr) == 0) {
+#if defined(IOMGR_ENABLED_IO_URING)
+        *flag = IO_MNGR_FLAG_IO_URING;
+        return IOManagerAvailable;
+#else
+        return IOManagerUnavailable;
 #endif
     }
     else if (strcmp("mio", iomgrstr) == 0) {
@@ -199,43 +225,53 @@ parseIOManagerFlag(const char *iomgrstr, IO_MANAGER_FLAG *flag)
     }
 }
 
-/* Based on the I/O manager RTS flag, select an I/O manager to use.
- *
- * This fills in the iomgr_type and rts_IOManagerIsWin32Native globals.
- * Must be called before the I/O manager is started.
- *
- * Called early in the RTS initialisation, after the RTS flags have been
- * processed.
+/* The I/O manager to use if none is explicitly requested: the one determined
+ * at configure time, for the RTS way.
  */
-void selectIOManager(void)
+static IOManagerType defaultIOManager(void)
 {
-    switch (RtsFlags.MiscFlags.ioManager) {
-        case IO_MNGR_FLAG_AUTO:
 #if defined(THREADED_RTS)
 #if   defined(IOMGR_DEFAULT_THREADED_MIO)
 #if defined(mingw32_HOST_OS)
-            iomgr_type = IO_MANAGER_MIO_WIN32;
+    return IO_MANAGER_MIO_WIN32;
 #else
-            iomgr_type = IO_MANAGER_MIO_POSIX;
+    return IO_MANAGER_MIO_POSIX;
 #endif
 #elif defined(IOMGR_DEFAULT_THREADED_WINIO)
-            iomgr_type = IO_MANAGER_WINIO;
+    return IO_MANAGER_WINIO;
 #else
 #error No I/O default manager. See IOMGR_DEFAULT_THREADED_ flags
 #endif
 #else // !defined(THREADED_RTS)
 #if   defined(IOMGR_DEFAULT_NON_THREADED_SELECT)
-            iomgr_type = IO_MANAGER_SELECT;
+    return IO_MANAGER_SELECT;
 #elif defined(IOMGR_DEFAULT_NON_THREADED_POLL)
-            iomgr_type = IO_MANAGER_POLL;
+    return IO_MANAGER_POLL;
+#elif defined(IOMGR_DEFAULT_NON_THREADED_EPOLL)
+    return IO_MANAGER_EPOLL;
 #elif defined(IOMGR_DEFAULT_NON_THREADED_WINIO)
-            iomgr_type = IO_MANAGER_WINIO;
+    return IO_MANAGER_WINIO;
 #elif defined(IOMGR_DEFAULT_NON_THREADED_WIN32_LEGACY)
-            iomgr_type = IO_MANAGER_WIN32_LEGACY;
+    return IO_MANAGER_WIN32_LEGACY;
 #else
 #error No I/O default manager. See IOMGR_DEFAULT_NON_THREADED_ flags
 #endif
 #endif
+}
+
+/* Based on the I/O manager RTS flag, select an I/O manager to use.
+ *
+ * This fills in the iomgr_type and rts_IOManagerIsWin32Native globals.
+ * Must be called before the I/O manager is started.
+ *
+ * Called early in the RTS initialisation, after the RTS flags have been
+ * processed.
+ */
+void selectIOManager(void)
+{
+    switch (RtsFlags.MiscFlags.ioManager) {
+        case IO_MNGR_FLAG_AUTO:
+            iomgr_type = defaultIOManager();
             break;
 
 #if defined(IOMGR_ENABLED_SELECT)
@@ -250,6 +286,38 @@ void selectIOManager(void)
             break;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MNGR_FLAG_EPOLL:
+            iomgr_type = IO_MANAGER_EPOLL;
+            break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MNGR_FLAG_IO_URING:
+        {
+            /* io_uring may be unavailable at runtime even though we built
+             * support for it: the kernel may be too old, or io_uring may have
+             * been disabled by the system administrator or a seccomp policy.
+             * In that case we fall back to epoll, or else the default. The
+             * user asked for io_uring explicitly, so tell them.
+             */
+            const char *reason = NULL;
+            if (isAvailableIOManagerIOUring(&reason)) {
+                iomgr_type = IO_MANAGER_IO_URING;
+            } else {
+#if defined(IOMGR_ENABLED_EPOLL)
+                iomgr_type = IO_MANAGER_EPOLL;
+#else
+                iomgr_type = defaultIOManager();
+#endif
+                errorBelch("warning: io_uring is not available (%s), "
+                           "using the %s I/O manager instead",
+                           reason, showIOManager());
+            }
+            break;
+        }
+#endif
+
 #if defined(IOMGR_ENABLED_MIO_POSIX)
         case IO_MNGR_FLAG_MIO:
             iomgr_type = IO_MANAGER_MIO_POSIX;
@@ -295,6 +363,14 @@ char * showIOManager(void)
         case IO_MANAGER_POLL:
             return "poll";
 #endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            return "epoll";
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            return "io-uring";
+#endif
 #if defined(IOMGR_ENABLED_MIO_POSIX)
         case IO_MANAGER_MIO_POSIX:
             return "mio";
@@ -353,6 +429,18 @@ void initCapabilityIOManager(CapIOManager *iomgr)
             break;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            initCapabilityIOManagerEpoll(iomgr);
+            break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            initCapabilityIOManagerIOUring(iomgr);
+            break;
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
         case IO_MANAGER_WIN32_LEGACY:
             iomgr->blocked_queue_hd = END_TSO_QUEUE;
@@ -385,6 +473,18 @@ void freeCapabilityIOManager(CapIOManager *iomgr)
             freeCapabilityIOManagerPoll(iomgr);
             break;
 #endif
+
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            freeCapabilityIOManagerEpoll(iomgr);
+            break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            freeCapabilityIOManagerIOUring(iomgr);
+            break;
+#endif
         default:
             break;
     }
@@ -399,12 +499,19 @@ void startIOManager(void)
 
     switch (iomgr_type) {
 
-#if defined(IOMGR_ENABLED_SELECT) || defined(IOMGR_ENABLED_POLL)
+#if defined(IOMGR_ENABLED_SELECT) || defined(IOMGR_ENABLED_POLL) \
+ || defined(IOMGR_ENABLED_EPOLL) || defined(IOMGR_ENABLED_IO_URING)
 #if defined(IOMGR_ENABLED_SELECT)
         case IO_MANAGER_SELECT:
 #endif
 #if defined(IOMGR_ENABLED_POLL)
         case IO_MANAGER_POLL:
+#endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
 #endif
             /* Make the exception CAF a GC root. See initBuiltinGcRoots for
              * similar examples. We throw this exception if a thread tries to
@@ -480,6 +587,8 @@ restartIOManager(CapIOManager *iomgr, Capability **pcap)
 #endif
         /* The IO_MANAGER_SELECT needs no initialisation */
         /* The IO_MANAGER_POLL needs no initialisation */
+        /* The IO_MANAGER_EPOLL was re-initialised by initCapabilityIOManager */
+        /* The IO_MANAGER_IO_URING likewise */
 
         /* No impl for any of the Windows I/O managers, since no forking. */
         default:
@@ -570,10 +679,19 @@ void markCapabilityIOManager(evac_fn evac, void *user, CapIOManager *iomgr)
             break;
 #endif
 
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
 #if defined(IOMGR_ENABLED_POLL)
         case IO_MANAGER_POLL:
+#endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+#endif
             markClosureTable(evac, user, &iomgr->aiop_table);
-            evac(user, (StgClosure **)(void *)&iomgr->timeout_queue);
+            markTimeouts(evac, user, iomgr);
             break;
 #endif
 
@@ -620,6 +738,16 @@ bool anyPendingTimeoutsOrIO(CapIOManager *iomgr)
             return anyPendingTimeoutsOrIOPoll(iomgr);
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            return anyPendingTimeoutsOrIOEpoll(iomgr);
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            return anyPendingTimeoutsOrIOIOUring(iomgr);
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
         case IO_MANAGER_WIN32_LEGACY:
             return (iomgr->blocked_queue_hd != END_TSO_QUEUE);
@@ -680,6 +808,18 @@ void pollCompletedTimeoutsOrIO(CapIOManager *iomgr)
           break;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+          pollCompletedTimeoutsOrIOEpoll(iomgr);
+          break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+          pollCompletedTimeoutsOrIOIOUring(iomgr);
+          break;
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY) || \
    (defined(IOMGR_ENABLED_WINIO) && !defined(THREADED_RTS))
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
@@ -714,6 +854,18 @@ bool awaitCompletedTimeoutsOrIO(CapIOManager *iomgr)
           break;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+          completed = awaitCompletedTimeoutsOrIOEpoll(iomgr);
+          break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+          completed = awaitCompletedTimeoutsOrIOIOUring(iomgr);
+          break;
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY) || \
    (defined(IOMGR_ENABLED_WINIO) && !defined(THREADED_RTS))
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
@@ -755,6 +907,18 @@ void interruptIOManager(CapIOManager *iomgr)
             break;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            interruptIOManagerEpoll(iomgr);
+            break;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            interruptIOManagerIOUring(iomgr);
+            break;
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
         case IO_MANAGER_WIN32_LEGACY:
             abandonRequestWait();
@@ -801,6 +965,14 @@ bool syncIOWaitReady(CapIOManager *iomgr,
 #if defined(IOMGR_ENABLED_POLL)
         case IO_MANAGER_POLL:
             return syncIOWaitReadyPoll(iomgr, tso, rw, fd);
+#endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            return syncIOWaitReadyEpoll(iomgr, tso, rw, fd);
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            return syncIOWaitReadyIOUring(iomgr, tso, rw, fd);
 #endif
         default:
             barf("waitRead# / waitWrite# not available for current I/O manager");
@@ -825,6 +997,16 @@ void syncIOCancel(CapIOManager *iomgr, StgTSO *tso)
             syncIOCancelPoll(iomgr, tso);
             break;
 #endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+            syncIOCancelEpoll(iomgr, tso);
+            break;
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+            syncIOCancelIOUring(iomgr, tso);
+            break;
+#endif
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
         case IO_MANAGER_WIN32_LEGACY:
             removeThreadFromDeQueue(iomgr->cap,
@@ -861,8 +1043,17 @@ bool syncDelay(CapIOManager *iomgr, StgTSO *tso, HsInt us_delay)
             return true;
         }
 #endif
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
 #if defined(IOMGR_ENABLED_POLL)
         case IO_MANAGER_POLL:
+#endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+#endif
             return syncDelayTimeout(iomgr, tso, us_delay);
 #endif
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
@@ -898,8 +1089,17 @@ void syncDelayCancel(CapIOManager *iomgr, StgTSO *tso)
             removeThreadFromQueue(iomgr->cap, &iomgr->sleeping_queue, tso);
             break;
 #endif
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
 #if defined(IOMGR_ENABLED_POLL)
         case IO_MANAGER_POLL:
+#endif
+#if defined(IOMGR_ENABLED_EPOLL)
+        case IO_MANAGER_EPOLL:
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+        case IO_MANAGER_IO_URING:
+#endif
             syncDelayCancelTimeout(iomgr, tso);
             break;
 #endif
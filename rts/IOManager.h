@@ -56,6 +56,12 @@ extern bool rts_IOManagerIsWin32Native;
 #if defined(IOMGR_BUILD_POLL) && !defined(THREADED_RTS)
     #define IOMGR_ENABLED_POLL
 #endif
+#if defined(IOMGR_BUILD_EPOLL) && !defined(THREADED_RTS)
+    #define IOMGR_ENABLED_EPOLL
+#endif
+#if defined(IOMGR_BUILD_IO_URING) && !defined(THREADED_RTS)
+    #define IOMGR_ENABLED_IO_URING
+#endif
 #if defined(IOMGR_BUILD_MIO) && defined(THREADED_RTS)
 /* For MIO, it is really two separate I/O manager implementations: one for
  * Windows and one for non-Windows. This is clear from both the C code on the
@@ -97,6 +103,8 @@ extern bool rts_IOManagerIsWin32Native;
     #define IOMGR_DEFAULT_STR "select"
 #elif defined(IOMGR_DEFAULT_NON_THREADED_POLL)
     #define IOMGR_DEFAULT_STR "poll"
+#elif defined(IOMGR_DEFAULT_NON_THREADED_EPOLL)
+    #define IOMGR_DEFAULT_STR "epoll"
 #elif defined(IOMGR_DEFAULT_NON_THREADED_WINIO)
     #define IOMGR_DEFAULT_STR "winio"
 #elif defined(IOMGR_DEFAULT_NON_THREADED_WIN32_LEGACY)
@@ -120,6 +128,16 @@ extern bool rts_IOManagerIsWin32Native;
 #else
     #define IOMGR_ENABLED_STR_POLL ""
 #endif
+#if defined(IOMGR_ENABLED_EPOLL)
+    #define IOMGR_ENABLED_STR_EPOLL " epoll"
+#else
+    #define IOMGR_ENABLED_STR_EPOLL ""
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+    #define IOMGR_ENABLED_STR_IO_URING " io-uring"
+#else
+    #define IOMGR_ENABLED_STR_IO_URING ""
+#endif
 #if defined(IOMGR_ENABLED_MIO_POSIX) || defined(IOMGR_ENABLED_MIO_WIN32)
     #define IOMGR_ENABLED_STR_MIO " mio"
 #else
@@ -138,6 +156,8 @@ extern bool rts_IOManagerIsWin32Native;
 #define IOMGRS_ENABLED_STR \
           IOMGR_ENABLED_STR_SELECT \
           IOMGR_ENABLED_STR_POLL \
+          IOMGR_ENABLED_STR_EPOLL \
+          IOMGR_ENABLED_STR_IO_URING \
           IOMGR_ENABLED_STR_MIO \
           IOMGR_ENABLED_STR_WINIO \
           IOMGR_ENABLED_STR_WIN32_LEGACY
@@ -153,6 +173,12 @@ typedef enum {
 #if defined(IOMGR_ENABLED_POLL)
     IO_MANAGER_POLL,
 #endif
+#if defined(IOMGR_ENABLED_EPOLL)
+    IO_MANAGER_EPOLL,
+#endif
+#if defined(IOMGR_ENABLED_IO_URING)
+    IO_MANAGER_IO_URING,
+#endif
 #if defined(IOMGR_ENABLED_MIO_POSIX)
     IO_MANAGER_MIO_POSIX,
 #endif
@@ -16,8 +16,13 @@
 
 #if defined(IOMGR_ENABLED_POLL)
 #include <poll.h> /* for struct pollfd */
+#endif
+
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
 #include "ClosureTable.h"
 #include "TimeoutQueue.h"
+#include "TimerWheel.h"
 #endif
 
 #include "BeginPrivate.h"
@@ -46,17 +51,24 @@ struct _CapIOManager {
     StgTSO *sleeping_queue;
 #endif
 
-#if defined(IOMGR_ENABLED_SELECT) || defined(IOMGR_ENABLED_POLL)
+#if defined(IOMGR_ENABLED_SELECT) || defined(IOMGR_ENABLED_POLL) \
+ || defined(IOMGR_ENABLED_EPOLL) || defined(IOMGR_ENABLED_IO_URING)
 #if defined(HAVE_PREEMPTION)
     /* FDs for waking up the I/O manager when it is blocked waiting */
     int interrupt_fd_r, interrupt_fd_w;
 #endif
 #endif
 
-#if defined(IOMGR_ENABLED_POLL)
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
     /* AIOP and timeout collections shared by several I/O manager impls */
     ClosureTable     aiop_table;
     StgTimeoutQueue *timeout_queue;
+
+    /* Used instead of the timeout_queue with --io-timer-wheel, NULL otherwise.
+     * See Timeout.c.
+     */
+    TimerWheel      *timer_wheel;
 #endif
 
 #if defined(IOMGR_ENABLED_POLL)
@@ -67,6 +79,36 @@ struct _CapIOManager {
     struct pollfd *aiop_poll_table, *full_poll_table;
 #endif
 
+#if defined(IOMGR_ENABLED_EPOLL)
+    /* The epoll instance, which holds the persistent kernel interest set */
+    int epoll_fd;
+
+    /* Auxiliary table with size and indexes matching the aiop_table, used to
+     * link operations into per-fd lists of waiters.
+     */
+    struct EpollAIOPInfo *aiop_epoll_table;
+
+    /* Table indexed by fd number, tracking the waiters on each fd and the
+     * state of the fd within the kernel interest set.
+     */
+    struct EpollFdInfo *fd_table;
+    int fd_table_size;
+
+    /* Buffer for the results of epoll_wait() */
+    struct epoll_event *event_buffer;
+    int event_buffer_size;
+
+    /* List of operations that completed at submission, pending notification */
+    int completed_hd;
+#endif
+
+#if defined(IOMGR_ENABLED_IO_URING)
+    /* The io_uring instance: its rings, and the auxiliary state we keep for
+     * submission and for matching up completions with operations.
+     */
+    struct IOUringState *uring;
+#endif
+
 #if defined(IOMGR_ENABLED_WIN32_LEGACY)
     /* Thread queue for threads blocked on I/O completion. */
     StgTSO *blocked_queue_hd;
@@ -105,7 +105,6 @@ static IpeBufferListNode *ipeBufferList = NULL;
 static StgWord next_module_id = 1; // Start at 1 to reserve 0 as "invalid"
 
 static void decompressIPEBufferListNodeIfCompressed(IpeBufferListNode*);
-static void updateIpeMap(void);
 
 // Check whether the IpeBufferListNode has the relevant magic words.
 // See Note [IPE Stripping and magic words]
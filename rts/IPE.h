@@ -14,6 +14,12 @@
 #include "BeginPrivate.h"
 
 void dumpIPEToEventLog(void);
+
+// Move any newly registered IPE buffers into the lookup map. The lookup
+// functions do this themselves, but a lookup may then race with another
+// thread that is still filling in the map, so callers that look up IPEs from
+// several threads at once (e.g. the heap census) must call this first.
+void updateIpeMap(void);
 void initIpe(void);
 void exitIpe(void);
 
@@ -32,6 +32,7 @@
 #include "linker/CacheFlush.h"
 #include "linker/SymbolExtras.h"
 #include "linker/MMap.h"
+#include "linker/ArchiveIndex.h"
 #include "PathUtils.h"
 #include "CheckUnload.h" // createOCSectionIndices
 #include "ReportMemoryMap.h"
@@ -211,8 +212,18 @@ StrHashTable *symhash;
 Mutex linker_mutex;
 #endif
 
+#if defined(LINKER_PARALLEL_RESOLVE)
+/* This protects the objects queued by a parallel resolveObjs, see
+   Note [Parallel object resolution] */
+static Mutex resolve_mutex;
+#endif
+
 /* Generic wrapper function to try and resolve oc files */
 static int ocTryLoad( ObjectCode* oc );
+#if defined(LINKER_PARALLEL_RESOLVE)
+static void deferObjectResolution( ObjectCode* oc );
+static void exitParallelResolve( void );
+#endif
 /* Run initializers */
 static int ocRunInit( ObjectCode* oc );
 static int runPendingInitializers (void);
@@ -419,10 +430,12 @@ HsBool ghciLookupSymbolInfo(StrHashTable *table,
         *result = NULL;
         return HS_BOOL_FALSE;
     }
-    if (pinfo->strength == STRENGTH_WEAK) {
+    // This may race with other threads relocating in parallel, which all
+    // store the same value.
+    if (RELAXED_LOAD(&pinfo->strength) == STRENGTH_WEAK) {
         IF_DEBUG(linker, debugBelch("lookupSymbolInfo: promoting %s\n", key));
         /* Once it's looked up, it can no longer be overridden */
-        pinfo->strength = STRENGTH_NORMAL;
+        RELAXED_STORE(&pinfo->strength, STRENGTH_NORMAL);
     }
 
     *result = pinfo;
@@ -474,6 +487,9 @@ initLinker_ (int retain_cafs)
 #if defined(THREADED_RTS)
     initMutex(&linker_mutex);
 #endif
+#if defined(LINKER_PARALLEL_RESOLVE)
+    initMutex(&resolve_mutex);
+#endif
 
     symhash = allocStrHashTable();
 
@@ -546,7 +562,11 @@ exitLinker( void ) {
 #endif
    if (linker_init_done == 1) {
        freeStrHashTable(symhash, free);
+       exitArchiveIndices();
        exitUnloadCheck();
+#if defined(LINKER_PARALLEL_RESOLVE)
+       exitParallelResolve();
+#endif
    }
 #if defined(THREADED_RTS)
    closeMutex(&linker_mutex);
@@ -597,8 +617,9 @@ static void *
 internal_dlsym(const char *symbol) {
     void *v;
 
-    // concurrent dl* calls may alter dlerror
-    ASSERT_LOCK_HELD(&linker_mutex);
+    // concurrent dl* calls may alter dlerror. dlerror is per-thread, so the
+    // helpers of a parallel resolveObjs don't interfere with each other.
+    ASSERT_LINKER_LOCK_HELD();
 
     // clears dlerror
     dlerror();
@@ -795,7 +816,7 @@ SymbolAddr* lookupDependentSymbol (SymbolName* lbl, ObjectCode *dependent, SymTy
 
 SymbolAddr* lookupDependentSymbol (SymbolName* lbl, ObjectCode *dependent, SymType *type)
 {
-    ASSERT_LOCK_HELD(&linker_mutex);
+    ASSERT_LINKER_LOCK_HELD();
     IF_DEBUG(linker_verbose, debugBelch("lookupSymbol: looking up '%s'\n", lbl));
 
     ASSERT(symhash != NULL);
@@ -825,7 +846,15 @@ SymbolAddr* lookupDependentSymbol (SymbolName* lbl, ObjectCode *dependent, SymTy
     }
 #endif
 
-    if (!ghciLookupSymbolInfo(symhash, lbl, &pinfo)) {
+    bool found = ghciLookupSymbolInfo(symhash, lbl, &pinfo);
+    // See Note [Lazy archive loading]. While relocating in parallel the
+    // members have already been loaded (see Note [Parallel object
+    // resolution]).
+    if (!found && !linkerResolvingInParallel() && loadArchiveMemberForSymbol(lbl)) {
+        found = ghciLookupSymbolInfo(symhash, lbl, &pinfo);
+    }
+
+    if (!found) {
         IF_DEBUG(linker_verbose, debugBelch("lookupSymbol: symbol '%s' not found, trying dlsym\n", lbl));
 
 #       if defined(OBJFORMAT_ELF)
@@ -930,7 +959,13 @@ SymbolAddr* loadSymbol(SymbolName *lbl, RtsSymbolInfo *pinfo) {
 
     /* Symbol can be found during linking, but hasn't been relocated. Do so now.
         See Note [runtime-linker-phases] */
-    if (oc && lbl && oc->status == OBJECT_LOADED) {
+    if (oc && lbl && RELAXED_LOAD(&oc->status) == OBJECT_LOADED) {
+#if defined(LINKER_PARALLEL_RESOLVE)
+        if (linker_parallel_resolve) {
+            deferObjectResolution(oc);
+            return pinfo->value;
+        }
+#endif
         oc->status = OBJECT_NEEDED;
         IF_DEBUG(linker, debugBelch("lookupSymbol: on-demand "
                                     "loading symbol '%s'\n", lbl));
@@ -1614,24 +1649,18 @@ HsInt loadOc (ObjectCode* oc)
 *
 * Returns: 1 if ok, 0 on error.
 */
-int ocTryLoad (ObjectCode* oc) {
-    int r;
-
-    if (oc->status != OBJECT_NEEDED) {
-        return 1;
-    }
+/* Check for duplicate symbols by looking into `symhash`.
+   Duplicate symbols are any symbols which exist
+   in different ObjectCodes that have both been loaded, or
+   are to be loaded by this call.
 
-    /*  Check for duplicate symbols by looking into `symhash`.
-        Duplicate symbols are any symbols which exist
-        in different ObjectCodes that have both been loaded, or
-        are to be loaded by this call.
+   This call is intended to have no side-effects when a non-duplicate
+   symbol is re-inserted.
 
-        This call is intended to have no side-effects when a non-duplicate
-        symbol is re-inserted.
-
-        We set the Address to NULL since that is not used to distinguish
-        symbols. Duplicate symbols are distinguished by name and oc.
-    */
+   We set the Address to NULL since that is not used to distinguish
+   symbols. Duplicate symbols are distinguished by name and oc.
+*/
+static int ocCheckSymbols (ObjectCode* oc) {
     int x;
     Symbol_t symbol;
     for (x = 0; x < oc->n_symbols; x++) {
@@ -1644,6 +1673,13 @@ int ocTryLoad (ObjectCode* oc) {
             return 0;
         }
     }
+    return 1;
+}
+
+/* Relocate oc. This only writes to oc itself, so it may run concurrently for
+   different objects; see Note [Parallel object resolution]. */
+static int ocResolve (ObjectCode* oc) {
+    int r;
 
     IF_DEBUG(linker, ocDebugBelch(oc, "resolving\n"));
 #   if defined(OBJFORMAT_ELF)
@@ -1664,7 +1700,10 @@ int ocTryLoad (ObjectCode* oc) {
 #if defined(NEED_SYMBOL_EXTRAS)
     ocProtectExtras(oc);
 #endif
+    return 1;
+}
 
+static void ocFinishResolve (ObjectCode* oc) {
     // We have finished loading and relocating; flush the m32 allocators to
     // setup page protections.
 #if defined(NEED_M32)
@@ -1674,7 +1713,17 @@ int ocTryLoad (ObjectCode* oc) {
 
     IF_DEBUG(linker, ocDebugBelch(oc, "resolved\n"));
     oc->status = OBJECT_RESOLVED;
+}
 
+int ocTryLoad (ObjectCode* oc) {
+    if (oc->status != OBJECT_NEEDED) {
+        return 1;
+    }
+
+    if (!ocCheckSymbols(oc) || !ocResolve(oc)) {
+        return 0;
+    }
+    ocFinishResolve(oc);
     return 1;
 }
 
@@ -1728,6 +1777,218 @@ int runPendingInitializers (void)
     return 1;
 }
 
+#if defined(LINKER_PARALLEL_RESOLVE)
+
+/* Note [Parallel object resolution]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Relocating objects dominates the time it takes to load a large amount of
+ * code, such as the dependency closure of a Template Haskell splice. With
+ * +RTS --linker-threads=<n>, resolveObjs relocates objects on up to n threads.
+ *
+ * Relocating an object reads symhash and writes only to the object itself, so
+ * different objects can be relocated concurrently as long as nothing modifies
+ * symhash meanwhile. Three things normally do:
+ *
+ *  - ocTryLoad reinserts the symbols of the object into symhash to check for
+ *    duplicates (ocCheckSymbols);
+ *
+ *  - looking up a symbol defined by an object which has been loaded but not
+ *    resolved (see Note [runtime-linker-phases]) resolves that object
+ *    recursively, including its ocCheckSymbols;
+ *
+ *  - looking up a symbol defined by an archive member which hasn't been
+ *    loaded yet loads it (see Note [Lazy archive loading]).
+ *
+ * resolveObjsParallel therefore works in rounds. Each round takes the objects
+ * which are OBJECT_NEEDED and
+ *
+ *  1. calls ocCheckSymbols on them and loads the archive members they refer
+ *     to, on the calling thread;
+ *
+ *  2. relocates them on up to n threads, which claim objects from resolve_ocs.
+ *     Meanwhile linker_parallel_resolve is set, which makes loadSymbol mark
+ *     objects it would have resolved recursively as OBJECT_NEEDED and queue
+ *     them for the next round (deferObjectResolution). The address of a
+ *     symbol is known before the object defining it is relocated, so this
+ *     doesn't change the outcome;
+ *
+ *  3. flushes the objects' m32 allocators, which share a pool of free pages,
+ *     and marks them OBJECT_RESOLVED, on the calling thread again.
+ *
+ * Rounds continue until no more objects are queued. Initializers are run
+ * afterwards by runPendingInitializers on the calling thread, as usual.
+ *
+ * Helper threads are started for each round, and only if the round has more
+ * than one object, so loading a single object (as GHCi often does) is
+ * unaffected. The helpers don't take linker_mutex: the calling thread holds
+ * it on their behalf (see ASSERT_LINKER_LOCK_HELD).
+ */
+
+bool linker_parallel_resolve = false;
+
+// The objects relocated by the current round, and whether each succeeded.
+static ObjectCode **resolve_ocs = NULL;
+static StgWord n_resolve_ocs = 0;
+static StgWord resolve_ocs_size = 0;
+static bool *resolve_ok = NULL;
+static StgWord resolve_ok_size = 0;
+static volatile StgWord resolve_next = 0;
+
+// The objects queued for the next round; protected by resolve_mutex.
+static ObjectCode **deferred_ocs = NULL;
+static StgWord n_deferred_ocs = 0;
+static StgWord deferred_ocs_size = 0;
+
+static void
+pushObjectCode(ObjectCode ***ocs, StgWord *n, StgWord *size, ObjectCode *oc)
+{
+    if (*n == *size) {
+        *size = *size ? 2 * *size : 64;
+        *ocs = stgReallocBytes(*ocs, *size * sizeof(ObjectCode *),
+                               "pushObjectCode");
+    }
+    (*ocs)[(*n)++] = oc;
+}
+
+static void
+deferObjectResolution(ObjectCode *oc)
+{
+    ACQUIRE_LOCK(&resolve_mutex);
+    if (oc->status == OBJECT_LOADED) {
+        IF_DEBUG(linker, ocDebugBelch(oc, "needed, resolving in next round\n"));
+        RELAXED_STORE(&oc->status, OBJECT_NEEDED);
+        pushObjectCode(&deferred_ocs, &n_deferred_ocs, &deferred_ocs_size, oc);
+    }
+    RELEASE_LOCK(&resolve_mutex);
+}
+
+static void
+resolveClaimedObjects(void)
+{
+    while (true) {
+        const StgWord i = atomic_inc(&resolve_next, 1) - 1;
+        if (i >= n_resolve_ocs) {
+            break;
+        }
+        resolve_ok[i] = ocResolve(resolve_ocs[i]);
+    }
+}
+
+static void *
+resolveObjsHelper(void *data STG_UNUSED)
+{
+    resolveClaimedObjects();
+    return NULL;
+}
+
+// Returns the object which failed to resolve, if any.
+static ObjectCode *
+resolveObjsParallel(void)
+{
+    ObjectCode *failed = NULL;
+
+    n_resolve_ocs = 0;
+    for (ObjectCode *oc = objects; oc; oc = oc->next) {
+        if (oc->status == OBJECT_NEEDED) {
+            pushObjectCode(&resolve_ocs, &n_resolve_ocs, &resolve_ocs_size, oc);
+        }
+    }
+
+    while (n_resolve_ocs > 0) {
+        IF_DEBUG(linker, debugBelch("resolveObjs: resolving %" FMT_Word
+                                    " objects\n", n_resolve_ocs));
+        for (StgWord i = 0; i < n_resolve_ocs; i++) {
+            if (!ocCheckSymbols(resolve_ocs[i])) {
+                failed = resolve_ocs[i];
+                goto done;
+            }
+            loadArchiveMembersForObject(resolve_ocs[i]);
+        }
+
+        if (resolve_ok_size < n_resolve_ocs) {
+            resolve_ok_size = resolve_ocs_size;
+            resolve_ok = stgReallocBytes(resolve_ok, resolve_ok_size * sizeof(bool),
+                                         "resolveObjsParallel");
+        }
+        resolve_next = 0;
+        const uint32_t n_helpers =
+            stg_min((StgWord) RtsFlags.MiscFlags.linkerThreads, n_resolve_ocs) - 1;
+        OSThreadId *helpers = NULL;
+        uint32_t n_started = 0;
+        linker_parallel_resolve = true;
+        if (n_helpers > 0) {
+            helpers = stgMallocBytes(n_helpers * sizeof(OSThreadId),
+                                     "resolveObjsParallel");
+            for (; n_started < n_helpers; n_started++) {
+                // Too many threads is not an error; we just use fewer.
+                if (createAttachedOSThread(&helpers[n_started], "ghc_linker",
+                                           resolveObjsHelper, NULL) != 0) {
+                    break;
+                }
+            }
+        }
+        resolveClaimedObjects();
+        for (uint32_t i = 0; i < n_started; i++) {
+            joinOSThread(helpers[i]);
+        }
+        linker_parallel_resolve = false;
+        if (helpers != NULL) {
+            stgFree(helpers);
+        }
+
+        for (StgWord i = 0; i < n_resolve_ocs; i++) {
+            if (resolve_ok[i]) {
+                ocFinishResolve(resolve_ocs[i]);
+            } else if (failed == NULL) {
+                failed = resolve_ocs[i];
+            }
+        }
+        if (failed != NULL) {
+            goto done;
+        }
+
+        // The objects queued by this round make up the next one.
+        ObjectCode **tmp = resolve_ocs;
+        StgWord tmp_size = resolve_ocs_size;
+        resolve_ocs = deferred_ocs;
+        resolve_ocs_size = deferred_ocs_size;
+        n_resolve_ocs = n_deferred_ocs;
+        deferred_ocs = tmp;
+        deferred_ocs_size = tmp_size;
+        n_deferred_ocs = 0;
+    }
+
+done:
+    // Objects still queued stay OBJECT_NEEDED and are resolved by the next
+    // resolveObjs.
+    n_resolve_ocs = 0;
+    n_deferred_ocs = 0;
+    return failed;
+}
+
+static void
+exitParallelResolve(void)
+{
+    closeMutex(&resolve_mutex);
+    if (resolve_ocs != NULL) {
+        stgFree(resolve_ocs);
+        resolve_ocs = NULL;
+        resolve_ocs_size = 0;
+    }
+    if (deferred_ocs != NULL) {
+        stgFree(deferred_ocs);
+        deferred_ocs = NULL;
+        deferred_ocs_size = 0;
+    }
+    if (resolve_ok != NULL) {
+        stgFree(resolve_ok);
+        resolve_ok = NULL;
+        resolve_ok_size = 0;
+    }
+}
+
+#endif /* LINKER_PARALLEL_RESOLVE */
+
 /* -----------------------------------------------------------------------------
  * resolve all the currently unlinked objects in memory
  *
@@ -1737,15 +1998,27 @@ static HsInt resolveObjs_ (void)
 {
     IF_DEBUG(linker, debugBelch("resolveObjs: start\n"));
 
-    for (ObjectCode *oc = objects; oc; oc = oc->next) {
-        int r = ocTryLoad(oc);
-        if (!r) {
-            errorBelch("Could not load Object Code %" PATH_FMT ".\n", OC_INFORMATIVE_FILENAME(oc));
-            IF_DEBUG(linker, printLoadedObjects());
-            fflush(stderr);
-            return r;
+    ObjectCode *failed = NULL;
+#if defined(LINKER_PARALLEL_RESOLVE)
+    // See Note [Parallel object resolution]
+    if (RtsFlags.MiscFlags.linkerThreads > 1) {
+        failed = resolveObjsParallel();
+    } else
+#endif
+    {
+        for (ObjectCode *oc = objects; oc; oc = oc->next) {
+            if (!ocTryLoad(oc)) {
+                failed = oc;
+                break;
+            }
         }
     }
+    if (failed != NULL) {
+        errorBelch("Could not load Object Code %" PATH_FMT ".\n", OC_INFORMATIVE_FILENAME(failed));
+        IF_DEBUG(linker, printLoadedObjects());
+        fflush(stderr);
+        return 0;
+    }
 
     if (!runPendingInitializers()) {
         return 0;
@@ -1802,6 +2075,11 @@ static HsInt unloadObj_ (pathchar *path, bool just_purge)
         }
     }
 
+    // Members which haven't been loaded yet must not be loaded later.
+    if (unloadArchiveIndex(path)) {
+        unloadedAnyObj = true;
+    }
+
     if (unloadedAnyObj) {
         return 1;
     } else {
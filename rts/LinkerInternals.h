@@ -401,6 +401,28 @@ extern Elf_Word shndx_table_uninit_label;
 extern Mutex linker_mutex;
 #endif /* THREADED_RTS */
 
+#if defined(THREADED_RTS) && defined(OBJFORMAT_ELF)
+/* resolveObjs can relocate objects on several threads, see
+ * Note [Parallel object resolution] in Linker.c. */
+#define LINKER_PARALLEL_RESOLVE 1
+
+/* True while it does so. The thread running resolveObjs then holds
+ * linker_mutex on behalf of the threads helping it. */
+extern bool linker_parallel_resolve;
+
+#define linkerResolvingInParallel() linker_parallel_resolve
+
+#define ASSERT_LINKER_LOCK_HELD()                       \
+    do {                                                \
+        if (!linker_parallel_resolve) {                 \
+            ASSERT_LOCK_HELD(&linker_mutex);            \
+        }                                               \
+    } while (0)
+#else
+#define linkerResolvingInParallel() false
+#define ASSERT_LINKER_LOCK_HELD() ASSERT_LOCK_HELD(&linker_mutex)
+#endif
+
 /* Type of an initializer */
 typedef void (*init_t) (int argc, char **argv, char **env);
 
@@ -143,11 +143,13 @@ loop:
     }
     else if(i == &stg_MSG_SET_TSO_FLAG_info){
         MessageUpdTSOFlag *u = (MessageUpdTSOFlag*) m;
+        settleStealableThread(cap, u->tso);
         u->tso->flags |= u->flag;
         return;
     }
     else if(i == &stg_MSG_UNSET_TSO_FLAG_info){
         MessageUpdTSOFlag *u = (MessageUpdTSOFlag*) m;
+        settleStealableThread(cap, u->tso);
         u->tso->flags &= ~u->flag;
         return;
     }
@@ -226,6 +228,7 @@ uint32_t messageBlackHole(Capability *cap, MessageBlackHole *msg)
         StgTSO *owner = (StgTSO*)p;
 
 #if defined(THREADED_RTS)
+        settleStealableThread(cap, owner);
         if (RELAXED_LOAD(&owner->cap) != cap) {
             sendMessage(cap, owner->cap, (Message*)msg);
             debugTraceCap(DEBUG_sched, cap, "forwarding message to cap %d",
@@ -297,6 +300,7 @@ uint32_t messageBlackHole(Capability *cap, MessageBlackHole *msg)
         ASSERT(owner != END_TSO_QUEUE);
 
 #if defined(THREADED_RTS)
+        settleStealableThread(cap, owner);
         if (RELAXED_LOAD(&owner->cap) != cap) {
             sendMessage(cap, owner->cap, (Message*)msg);
             debugTraceCap(DEBUG_sched, cap, "forwarding message to cap %d",
@@ -22,6 +22,7 @@
 #include "Arena.h"
 #include "Printer.h"
 #include "Trace.h"
+#include "sm/GC.h"
 #include "sm/GCThread.h"
 #include "IPE.h"
 
@@ -1159,14 +1160,12 @@ static void heapProfObject(Census *census, StgClosure *p, size_t size,
 //
 // See Note [Compact Normal Forms] for details.
 static void
-heapCensusCompactList(Census *census, bdescr *bd)
+heapCensusCompactBlock(Census *census, bdescr *bd)
 {
-    for (; bd != NULL; bd = bd->link) {
-        StgCompactNFDataBlock *block = (StgCompactNFDataBlock*)bd->start;
-        StgCompactNFData *str = block->owner;
-        heapProfObject(census, (StgClosure*)str,
-                       compact_nfdata_full_sizeW(str), true);
-    }
+    StgCompactNFDataBlock *block = (StgCompactNFDataBlock*)bd->start;
+    StgCompactNFData *str = block->owner;
+    heapProfObject(census, (StgClosure*)str,
+                   compact_nfdata_full_sizeW(str), true);
 }
 
 /*
@@ -1424,39 +1423,207 @@ heapCensusSegment (Census* census, struct NonmovingSegment* seg )
  * is running.
  */
 
+/* -----------------------------------------------------------------------------
+ * Code to perform a heap census.
+ * -------------------------------------------------------------------------- */
 static void
-heapCensusSegmentList (Census* census, struct NonmovingSegment* seg )
+heapCensusChainBlock( Census *census, bdescr *bd )
 {
-  for (; seg; seg = seg->link) {
-    heapCensusSegment(census, seg);
-  }
+    // When we shrink a large ARR_WORDS, we do not adjust the free pointer
+    // of the associated block descriptor, thus introducing slop at the end
+    // of the object.  This slop remains after GC, violating the assumption
+    // of the loop in heapCensusBlock that all slop has been eliminated
+    // (#11627). Consequently, we handle large ARR_WORDS objects as a special
+    // case.
+    if (bd->flags & BF_LARGE) {
+        StgPtr p = bd->start;
+        // There may be some initial zeros due to object alignment.
+        while (p < bd->free && !*p) p++;
+        if (get_itbl((StgClosure *)p)->type == ARR_WORDS) {
+            size_t size = arr_words_sizeW((StgArrBytes *)p);
+            bool prim = true;
+            heapProfObject(census, (StgClosure *)p, size, prim);
+            return;
+        }
+    }
+
+    heapCensusBlock(census, bd);
 }
 
 /* -----------------------------------------------------------------------------
- * Code to perform a heap census.
+ * Parallel census
+ *
+ * Note [Parallel heap census]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * The census reads every live object in the heap, which takes a long time for
+ * a big heap, and the whole program is stopped while it happens.  Since it
+ * runs right at the end of a GC, we use the GC threads to do it in parallel
+ * (see Note [Parallel tasks after GC] in sm/GC.c).
+ *
+ * The leader first splits every block list and nonmoving segment list that
+ * the census visits into chunks of about CENSUS_CHUNK_BLOCKS blocks.  Walking
+ * the lists is cheap compared to walking the objects in them.  Each thread
+ * then repeatedly claims the next unclaimed chunk and takes a census of it
+ * into its own Census, so the threads share nothing but the chunk counter.
+ * Finally the leader merges the per-thread censuses into censuses[era].
+ *
+ * Nothing in the heap is modified by the census, so there is no other
+ * synchronisation to worry about, with one exception: IPE lookups (for -hi
+ * with an info table selector) may need to update the IPE map, so we make
+ * sure it is up to date beforehand.
+ *
+ * When the GC was not parallel, the leader just processes all the chunks
+ * itself.
  * -------------------------------------------------------------------------- */
+
+#define CENSUS_CHUNK_BLOCKS 64
+
+typedef enum {
+    CENSUS_CHAIN,     // heapCensusChainBlock
+    CENSUS_COMPACTS,  // heapCensusCompactBlock
+    CENSUS_SEGMENTS,  // heapCensusSegment
+} CensusChunkType;
+
+typedef struct {
+    CensusChunkType type;
+    // the number of list entries in this chunk
+    uint32_t n;
+    // the first list entry: a bdescr, or a struct NonmovingSegment
+    void *start;
+} CensusChunk;
+
+typedef struct {
+    CensusChunk *chunks;
+    uint32_t n_chunks;
+    uint32_t size;
+    // index of the next chunk to be claimed
+    StgWord next_chunk;
+    // one Census per gc_thread, indexed by thread_index
+    Census *thread_censuses;
+} ParCensus;
+
+static void
+addCensusChunk (ParCensus *pc, CensusChunkType type, void *start, uint32_t n)
+{
+    if (pc->n_chunks == pc->size) {
+        pc->size = pc->size == 0 ? 64 : pc->size * 2;
+        pc->chunks = stgReallocBytes(pc->chunks, pc->size * sizeof(CensusChunk),
+                                     "addCensusChunk");
+    }
+    pc->chunks[pc->n_chunks].type  = type;
+    pc->chunks[pc->n_chunks].start = start;
+    pc->chunks[pc->n_chunks].n     = n;
+    pc->n_chunks++;
+}
+
 static void
-heapCensusChain( Census *census, bdescr *bd )
+addCensusBlockList (ParCensus *pc, CensusChunkType type, bdescr *bd)
 {
+    bdescr *start = bd;
+    uint32_t n = 0, blocks = 0;
+
     for (; bd != NULL; bd = bd->link) {
-        // When we shrink a large ARR_WORDS, we do not adjust the free pointer
-        // of the associated block descriptor, thus introducing slop at the end
-        // of the object.  This slop remains after GC, violating the assumption
-        // of the loop below that all slop has been eliminated (#11627).
-        // Consequently, we handle large ARR_WORDS objects as a special case.
-        if (bd->flags & BF_LARGE) {
-            StgPtr p = bd->start;
-            // There may be some initial zeros due to object alignment.
-            while (p < bd->free && !*p) p++;
-            if (get_itbl((StgClosure *)p)->type == ARR_WORDS) {
-                size_t size = arr_words_sizeW((StgArrBytes *)p);
-                bool prim = true;
-                heapProfObject(census, (StgClosure *)p, size, prim);
-                continue;
-            }
+        n++;
+        blocks += bd->blocks;
+        if (blocks >= CENSUS_CHUNK_BLOCKS) {
+            addCensusChunk(pc, type, start, n);
+            start = bd->link;
+            n = 0;
+            blocks = 0;
         }
+    }
+    if (n > 0) {
+        addCensusChunk(pc, type, start, n);
+    }
+}
 
-        heapCensusBlock(census, bd);
+static void
+addCensusSegmentList (ParCensus *pc, struct NonmovingSegment *seg)
+{
+    struct NonmovingSegment *start = seg;
+    uint32_t n = 0;
+
+    for (; seg != NULL; seg = seg->link) {
+        n++;
+        if (n * NONMOVING_SEGMENT_BLOCKS >= CENSUS_CHUNK_BLOCKS) {
+            addCensusChunk(pc, CENSUS_SEGMENTS, start, n);
+            start = seg->link;
+            n = 0;
+        }
+    }
+    if (n > 0) {
+        addCensusChunk(pc, CENSUS_SEGMENTS, start, n);
+    }
+}
+
+static void
+heapCensusChunk (Census *census, CensusChunk *chunk)
+{
+    uint32_t i;
+
+    switch (chunk->type) {
+    case CENSUS_CHAIN:
+    {
+        bdescr *bd = chunk->start;
+        for (i = 0; i < chunk->n; i++, bd = bd->link) {
+            heapCensusChainBlock(census, bd);
+        }
+        break;
+    }
+    case CENSUS_COMPACTS:
+    {
+        bdescr *bd = chunk->start;
+        for (i = 0; i < chunk->n; i++, bd = bd->link) {
+            heapCensusCompactBlock(census, bd);
+        }
+        break;
+    }
+    case CENSUS_SEGMENTS:
+    {
+        struct NonmovingSegment *seg = chunk->start;
+        for (i = 0; i < chunk->n; i++, seg = seg->link) {
+            heapCensusSegment(census, seg);
+        }
+        break;
+    }
+    }
+}
+
+static void
+heapCensusWorker (uint32_t thread_index, void *user)
+{
+    ParCensus *pc = user;
+    Census *census = &pc->thread_censuses[thread_index];
+    StgWord i;
+
+    initEra(census);
+    while ((i = atomic_inc(&pc->next_chunk, 1) - 1) < pc->n_chunks) {
+        heapCensusChunk(census, &pc->chunks[i]);
+    }
+}
+
+// Add the counts in one census to another.  The census being merged into
+// must be the current era's census.
+static void
+mergeCensus (Census *census, Census *from)
+{
+    counter *ctr, *c;
+
+    census->prim     += from->prim;
+    census->not_used += from->not_used;
+    census->used     += from->used;
+
+    for (ctr = from->ctrs; ctr != NULL; ctr = ctr->next) {
+        c = lookupHashTable(census->hash, (StgWord)ctr->identity);
+        if (c == NULL) {
+            c = heapInsertNewCounter(census, (StgWord)ctr->identity);
+        }
+        // c.resid shares its storage with c.ldv.prim, and the other ldv
+        // fields are zero unless we are profiling by biography, so this
+        // handles both kinds of counter.
+        c->c.ldv.prim     += ctr->c.ldv.prim;
+        c->c.ldv.not_used += ctr->c.ldv.not_used;
+        c->c.ldv.used     += ctr->c.ldv.used;
     }
 }
 
@@ -1467,6 +1634,7 @@ void heapCensus (Time t)
   uint32_t g, n;
   Census *census;
   gen_workspace *ws;
+  ParCensus pc;
 
   census = &censuses[era];
   census->time  = TimeToSecondsDbl(t);
@@ -1484,40 +1652,65 @@ void heapCensus (Time t)
   stat_startHeapCensus();
 #endif
 
-  // Traverse the heap, collecting the census info
+  // Divide the heap into chunks; see Note [Parallel heap census]
+  pc.chunks = NULL;
+  pc.n_chunks = 0;
+  pc.size = 0;
+  pc.next_chunk = 0;
+
   for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
-      heapCensusChain( census, generations[g].blocks );
+      addCensusBlockList(&pc, CENSUS_CHAIN, generations[g].blocks);
       // Are we interested in large objects?  might be
       // confusing to include the stack in a heap profile.
-      heapCensusChain( census, generations[g].large_objects );
-      heapCensusCompactList ( census, generations[g].compact_objects );
+      addCensusBlockList(&pc, CENSUS_CHAIN, generations[g].large_objects);
+      addCensusBlockList(&pc, CENSUS_COMPACTS, generations[g].compact_objects);
 
       for (n = 0; n < getNumCapabilities(); n++) {
           ws = &gc_threads[n]->gens[g];
-          heapCensusChain(census, ws->todo_bd);
-          heapCensusChain(census, ws->part_list);
-          heapCensusChain(census, ws->scavd_list);
+          addCensusBlockList(&pc, CENSUS_CHAIN, ws->todo_bd);
+          addCensusBlockList(&pc, CENSUS_CHAIN, ws->part_list);
+          addCensusBlockList(&pc, CENSUS_CHAIN, ws->scavd_list);
       }
   }
 
   if (RtsFlags.GcFlags.useNonmoving) {
     for (unsigned int i = 0; i < nonmoving_alloca_cnt; i++) {
-      heapCensusSegmentList(census, nonmovingHeap.allocators[i].filled);
-      heapCensusSegmentList(census, nonmovingHeap.allocators[i].saved_filled);
-      heapCensusSegmentList(census, nonmovingHeap.allocators[i].active);
+      addCensusSegmentList(&pc, nonmovingHeap.allocators[i].filled);
+      addCensusSegmentList(&pc, nonmovingHeap.allocators[i].saved_filled);
+      addCensusSegmentList(&pc, nonmovingHeap.allocators[i].active);
 
-      heapCensusChain(census, nonmoving_large_objects);
-      heapCensusCompactList(census, nonmoving_compact_objects);
+      addCensusBlockList(&pc, CENSUS_CHAIN, nonmoving_large_objects);
+      addCensusBlockList(&pc, CENSUS_COMPACTS, nonmoving_compact_objects);
 
       // segments living on capabilities
       for (unsigned int j = 0; j < getNumCapabilities(); j++) {
         Capability* cap = getCapability(j);
-        heapCensusSegment(census, cap->current_segments[i]);
+        addCensusChunk(&pc, CENSUS_SEGMENTS, cap->current_segments[i], 1);
       }
     }
 
   }
 
+  if (RtsFlags.ProfFlags.doHeapProfile == HEAP_BY_INFO_TABLE) {
+      updateIpeMap();
+  }
+
+  // Traverse the heap, collecting the census info
+  pc.thread_censuses = stgCallocBytes(getNumCapabilities(), sizeof(Census),
+                                      "heapCensus");
+  n = runParallelGcTask(heapCensusWorker, &pc);
+  debugTrace(DEBUG_gc, "heap census: %" FMT_Word32 " chunks on %" FMT_Word32
+             " threads", pc.n_chunks, n);
+
+  for (n = 0; n < getNumCapabilities(); n++) {
+      if (pc.thread_censuses[n].hash != NULL) {
+          mergeCensus(census, &pc.thread_censuses[n]);
+          freeEra(&pc.thread_censuses[n]);
+      }
+  }
+  stgFree(pc.thread_censuses);
+  stgFree(pc.chunks);
+
   // dump out the census info
 #if defined(PROFILING)
     // We can't generate any info for LDV profiling until
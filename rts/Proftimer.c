@@ -13,6 +13,7 @@
 #include "Proftimer.h"
 #include "Capability.h"
 #include "Trace.h"
+#include "rts/EventLogWriter.h"
 
 /*
  * N.B. These flags must all always be accessed via atomics since even in the
@@ -115,6 +116,50 @@ initProfTimer( void )
 
 uint32_t total_ticks = 0;
 
+/* Note [Stack sampling]
+   ~~~~~~~~~~~~~~~~~~~~~
+   With --stack-samples[=<frames>] the RTS periodically logs what the running
+   Haskell threads are doing, in every way and not only when profiling. Each
+   sample is a STACK_SAMPLE event holding the info pointers of the topmost
+   frames of a thread's stack. They say nothing by themselves, but when the
+   program is built with -finfo-table-map the IPE events in the same eventlog
+   map them to the source locations of the return continuations, which is
+   enough to draw a flame graph. The sample rate is that of the ticker (-V).
+
+   The ticker can't look at the stack of a running thread, since its stack
+   pointer lives in a register. Instead, on each tick, handleProfTick sets
+   stack_sample_pending on every capability which is running Haskell code and
+   interrupts it, just as a context switch does. The thread returns to the
+   scheduler at its next heap check, where schedule() finds the flag set and
+   takes the sample, before putting the thread back at the front of the run
+   queue (see scheduleHandleYield). Its stack is then well-formed, and we walk
+   it with stackFrameInfoPointers in CloneStack.c.
+
+   The cost is one extra return to the scheduler per capability and tick, and
+   writing 8 bytes per frame to the capability's event buffer. Capabilities
+   which are idle, in a foreign call or in the GC are not sampled, so the
+   samples of a capability add up to the time it spent running Haskell code.
+   Like context switches, a sample of a thread in a loop which doesn't
+   allocate is delayed until it does.
+*/
+#if defined(TRACING)
+static void
+requestStackSamples(void)
+{
+    if (eventLogStatus() != EVENTLOG_RUNNING
+        && RtsFlags.TraceFlags.tracing != TRACE_STDERR) {
+        return;
+    }
+    for (uint32_t n = 0; n < getNumCapabilities(); n++) {
+        Capability *cap = getCapability(n);
+        if (RELAXED_LOAD_ALWAYS(&cap->in_haskell)) {
+            RELAXED_STORE_ALWAYS(&cap->stack_sample_pending, true);
+            interruptCapability(cap);
+        }
+    }
+}
+#endif
+
 void
 handleProfTick(void)
 {
@@ -141,6 +186,12 @@ handleProfTick(void)
     }
 #endif
 
+#if defined(TRACING)
+    if (TRACE_stack_samples) {
+        requestStackSamples();
+    }
+#endif
+
     if (RELAXED_LOAD_ALWAYS(&do_heap_prof_ticks) && RELAXED_LOAD_ALWAYS(&heap_prof_timer_active))  {
         ticks_to_heap_profile--;
         if (ticks_to_heap_profile <= 0) {
@@ -15,6 +15,11 @@ void handleProfTick     ( void );
 void pauseHeapProfTimer  ( void );
 void resumeHeapProfTimer ( void );
 
+// Frames per stack sample for --stack-samples without a depth, and at most.
+// See Note [Stack sampling] in Proftimer.c.
+#define STACK_SAMPLE_DEFAULT_DEPTH 16
+#define STACK_SAMPLE_MAX_DEPTH     256
+
 extern bool performHeapProfile;
 extern bool performTickySample;
 
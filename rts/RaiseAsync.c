@@ -261,6 +261,7 @@ check_target:
     traceThreadStatus(DEBUG_sched, target);
 #endif
 
+    settleStealableThread(cap, target);
     target_cap = target->cap;
     if (target->cap != cap) {
         throwToSendMsg(cap, target_cap, msg);
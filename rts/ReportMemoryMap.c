@@ -22,6 +22,7 @@
 #endif
 
 #include "ReportMemoryMap.h"
+#include "sm/OSMem.h"
 
 #if defined(mingw32_HOST_OS)
 
@@ -111,6 +112,42 @@ void reportMemoryMap(void) {
 
 #else
 
+#if defined(USE_LARGE_ADDRESS_SPACE)
+// Summarise the heap's use of huge pages (see +RTS --huge-pages), along with
+// the kernel's accounting of them where available.
+static void reportHugePages(void) {
+    HugePageStats stats;
+    osGetHugePageStats(&stats);
+    if (stats.mode == HUGE_PAGES_NONE) {
+        return;
+    }
+
+    debugBelch("Huge pages (%s, %" FMT_Word "K):\n",
+               stats.mode == HUGE_PAGES_HUGETLB ? "hugetlb" : "thp",
+               stats.huge_page_size >> 10);
+    if (stats.mode == HUGE_PAGES_HUGETLB) {
+        debugBelch("  %" FMT_Word " from the hugetlbfs pool, "
+                   "%" FMT_Word " from ordinary pages\n",
+                   stats.hugetlb_pages, stats.fallback_pages);
+    }
+
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    if (f == NULL) {
+        return;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (!strncmp(line, "AnonHugePages:", 14)
+            || !strncmp(line, "Private_Hugetlb:", 16)
+            || !strncmp(line, "Shared_Hugetlb:", 15)) {
+            debugBelch("  %s", line);
+        }
+    }
+    debugBelch("\n");
+    fclose(f);
+}
+#endif
+
 // Linux et al.
 void reportMemoryMap(void) {
     debugBelch("\nMemory map:\n");
@@ -135,6 +172,10 @@ void reportMemoryMap(void) {
     }
     debugBelch("\n");
     fclose(f);
+
+#if defined(USE_LARGE_ADDRESS_SPACE)
+    reportHugePages();
+#endif
 }
 
 #endif
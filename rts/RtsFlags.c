@@ -17,6 +17,8 @@
 #include "hooks/Hooks.h"
 #include "Capability.h"
 #include "IOManager.h"
+#include "Proftimer.h"
+#include "eventlog/EventLog.h"
 
 #if defined(HAVE_CTYPE_H)
 #include <ctype.h>
@@ -166,6 +168,8 @@ void initRtsFlagsDefaults(void)
     RtsFlags.GcFlags.returnDecayFactor  = 4;
     RtsFlags.GcFlags.useNonmoving       = false;
     RtsFlags.GcFlags.nonmovingDenseAllocatorCount = 16;
+    RtsFlags.GcFlags.nonmovingSweepThreads = 1;
+    RtsFlags.GcFlags.nonmovingMarkThreads = 1;
     RtsFlags.GcFlags.generations        = 2;
     RtsFlags.GcFlags.squeezeUpdFrames   = true;
     RtsFlags.GcFlags.compact            = false;
@@ -187,6 +191,9 @@ void initRtsFlagsDefaults(void)
 
     // 1 TBytes
     RtsFlags.GcFlags.addressSpaceSize   = (StgWord64)1 << 40;
+    RtsFlags.GcFlags.hugePages          = HUGE_PAGES_NONE;
+    RtsFlags.GcFlags.gcPauseTarget      = 0;    /* off */
+    RtsFlags.GcFlags.gcCpuTarget        = 0;    /* off */
 
     RtsFlags.DebugFlags.scheduler       = false;
     RtsFlags.DebugFlags.interpreter     = false;
@@ -254,8 +261,11 @@ void initRtsFlagsDefaults(void)
     RtsFlags.TraceFlags.trace_output  = NULL;
 #  if defined(THREADED_RTS)
     RtsFlags.TraceFlags.eventlogFlushTime = 0;
+    RtsFlags.TraceFlags.eventlogAsyncBuffers = 0;
 #  endif
     RtsFlags.TraceFlags.nullWriter = false;
+    RtsFlags.TraceFlags.eventlogSocketBlock = true;
+    RtsFlags.TraceFlags.stackSampleDepth = 0;
 #endif
 
 // See Note [No timer on wasm32]
@@ -274,8 +284,14 @@ void initRtsFlagsDefaults(void)
     RtsFlags.MiscFlags.machineReadable         = false;
     RtsFlags.MiscFlags.disableDelayedOsMemoryReturn = false;
     RtsFlags.MiscFlags.internalCounters        = false;
+    RtsFlags.MiscFlags.threadAccounting        = false;
     RtsFlags.MiscFlags.linkerAlwaysPic         = DEFAULT_LINKER_ALWAYS_PIC;
     RtsFlags.MiscFlags.linkerOptimistic        = false;
+    RtsFlags.MiscFlags.linkerLazyArchives      = false;
+    RtsFlags.MiscFlags.linkerThreads           = 1;
+    RtsFlags.MiscFlags.compactFixupThreads     = 1;
+    RtsFlags.MiscFlags.stmVersionClock         = false;
+    RtsFlags.MiscFlags.ioTimerWheel            = false;
     RtsFlags.MiscFlags.linkerMemBase           = 0;
     RtsFlags.MiscFlags.ioManager               = IO_MNGR_FLAG_AUTO;
 #if defined(THREADED_RTS) && defined(mingw32_HOST_OS)
@@ -294,6 +310,9 @@ void initRtsFlagsDefaults(void)
     RtsFlags.ParFlags.parGcNoSyncWithIdle   = 0;
     RtsFlags.ParFlags.parGcThreads      = 0; /* defaults to -N */
     RtsFlags.ParFlags.setAffinity       = 0;
+    RtsFlags.ParFlags.stealThreads      = false;
+    RtsFlags.ParFlags.parCompact        = false;
+    RtsFlags.ParFlags.sparkThrottle     = 0;
 #endif
 
 #if defined(THREADED_RTS)
@@ -330,6 +349,12 @@ usage_text[] = {
 "            manage the oldest generation.",
 "  --copying-gc",
 "            Selects the copying garbage collector to manage all generations.",
+#if defined(THREADED_RTS)
+"  --nonmoving-mark-threads=<n>",
+"            Mark the non-moving heap using <n> threads (default: 1)",
+"  --nonmoving-sweep-threads=<n>",
+"            Sweep the non-moving heap using <n> threads (default: 1)",
+#endif
 "",
 "  -K<size>  Sets the maximum stack size (default: 80% of the heap)",
 "            e.g.: -K32k -K512k -K8M",
@@ -350,6 +375,12 @@ usage_text[] = {
 "            to 0 means memory is not returned.",
 "            (default 4.0)",
 "  -n<size>  Allocation area chunk size (0 = disabled, default: 0)",
+"  --gc-pause-target=<sec>",
+"            Adjust the allocation area to keep minor GC pauses under <sec>",
+"            (default: 0, 0 == off)",
+"  --gc-cpu-target=<fraction>",
+"            Adjust the allocation area and -F to spend about <fraction> of",
+"            the CPU time in the GC, e.g. 0.05 (default: 0, 0 == off)",
 "  -O<size>  Sets the minimum size of the old generation (default 1M)",
 "  -M<size>  Sets the maximum heap size (default unlimited)  e.g.: -M256k -M1G",
 "  -H<size>  Sets the minimum heap size (default 0M)   e.g.: -H24m  -H1G",
@@ -365,6 +396,9 @@ usage_text[] = {
 "  -c        Use in-place compaction for all oldest generation collections",
 "            (the default is to use copying)",
 "  -w        Use mark-region for the oldest generation (experimental)",
+"  --huge-pages[=<thp|hugetlb>]",
+"             Back the heap with huge pages, either transparent (thp, the",
+"             default) or from the hugetlbfs pool (hugetlb) (default: off)",
 #if defined(THREADED_RTS)
 "  -I<sec>   Perform full GC after <sec> idle time (default: 0.3, 0 == off)",
 "  -Iw<sec>  Minimum wait time between idle GC runs (default: 0, 0 == no min wait time)",
@@ -374,6 +408,8 @@ usage_text[] = {
 "  -t[<file>] One-line GC statistics (if <file> omitted, uses stderr)",
 "  -s[<file>] Summary  GC statistics (if <file> omitted, uses stderr)",
 "  -S[<file>] Detailed GC statistics (if <file> omitted, uses stderr)",
+"  --thread-accounting",
+"             Track the allocation and CPU time of each Haskell thread",
 "",
 "",
 "  -Z         Don't squeeze out update frames on context switch",
@@ -439,6 +475,12 @@ usage_text[] = {
 #if defined(TRACING)
 "",
 "  -ol<file>  Send binary eventlog to <file> (default: <program>.eventlog)",
+#  if !defined(mingw32_HOST_OS)
+"  -olunix:<path>",
+"             Stream the binary eventlog to the Unix domain socket <path>",
+" --eventlog-socket-policy=<block|drop>",
+"             What to do when the -olunix: consumer falls behind (default: block)",
+#  endif
 "  -l[flags]  Log events to a file",
 #  if defined(DEBUG)
 "  -v[flags]  Log events to stderr",
@@ -460,9 +502,17 @@ usage_text[] = {
 #  endif
 "               -x    disable an event class, for any flag above",
 "             the initial enabled event classes are 'sgIpu'",
+" --stack-samples[=<frames>]",
+"             On every tick, log the top <frames> stack frames of the",
+"             threads running Haskell code (default: 16 frames)",
 #  if defined(THREADED_RTS)
 " --eventlog-flush-interval=<secs>",
 "             Periodically flush the eventlog at the specified interval.",
+" --eventlog-async-buffers=<n>",
+"             Hand full eventlog buffers to a background thread, keeping",
+"             up to <n> buffers (at most 256) per capability in flight",
+"             (default: 0, buffers are written by the capability that",
+"             filled them)",
 #  endif
 #endif
 
@@ -523,11 +573,18 @@ usage_text[] = {
 "  -qn<n>     Use <n> threads for parallel GC (defaults to value of -N)",
 "  -qa        Use the OS to set thread affinity (experimental)",
 "  -qm        Don't automatically migrate threads between CPUs",
+"  -qs        Let idle CPUs steal runnable threads from busy ones",
+"             (experimental, has no effect with -qm)",
+"  -qc        Use the parallel GC threads to compact the oldest generation",
+"             (has no effect without -c)",
 "  -qi<n>     If a processor has been idle for the last <n> GCs, do not",
 "             wake it up for a non-load-balancing parallel GC.",
 "             (0 disables,  default: 0)",
 "  --numa[=<node_mask>]",
 "             Use NUMA, nodes given by <node_mask> (default: off)",
+"  --stm-version-clock",
+"             Commit STM transactions by comparing TVar versions against a",
+"             global version clock rather than the values read",
 #if defined(DEBUG)
 "  --debug-numa[=<num_nodes>]",
 "             Pretend NUMA: like --numa, but without the system calls.",
@@ -553,6 +610,10 @@ usage_text[] = {
 "             The I/O manager to use.",
 "             Options available: auto" IOMGRS_ENABLED_STR
               " (default: " IOMGR_DEFAULT_STR ")",
+"  --io-timer-wheel",
+"             Keep the timeouts of the poll, epoll and io_uring I/O managers",
+"             in a timer wheel rather than a heap: faster with many timeouts,",
+"             but rounds delays up to about a millisecond",
 #if defined(THREADED_RTS)
 #if defined(mingw32_HOST_OS)
 "  --io-manager-threads=<num>",
@@ -560,6 +621,10 @@ usage_text[] = {
 "             handle completion events. (default: num cores)",
 #endif
 "  -e<n>      Maximum number of outstanding local sparks (default: 4096)",
+"  --spark-throttle[=<fraction>]",
+"             Drop most new sparks of a capability when less than <fraction>",
+"             of its recent sparks were converted (default: off, 0.2 if",
+"             <fraction> is omitted)",
 #endif
 #if defined(x86_64_HOST_ARCH)
 #if !DEFAULT_LINKER_ALWAYS_PIC
@@ -570,6 +635,17 @@ usage_text[] = {
 "  -xm        Base address to mmap memory in the GHCi linker",
 "             (hex; must be <80000000)",
 #endif
+"  --linker-lazy-archives",
+"             Load archive members in the GHCi linker only when one of their",
+"             symbols is needed",
+#if defined(THREADED_RTS)
+"  --linker-threads=<n>",
+"             Relocate object files in the GHCi linker using <n> threads",
+"             (default: 1)",
+"  --compact-fixup-threads=<n>",
+"             Adjust the pointers of imported compact regions using <n>",
+"             threads (default: 1)",
+#endif
 "  -xq        The allocation limit given to a thread after it receives",
 "             an AllocationLimitExceeded exception. (default: 100k)",
 "",
@@ -1019,6 +1095,75 @@ error = true;
                        OPTION_UNSAFE;
                        RtsFlags.MiscFlags.linkerOptimistic = true;
                   }
+                  else if (strequal("linker-lazy-archives",
+                              &rts_argv[arg][2])) {
+                       OPTION_UNSAFE;
+                       RtsFlags.MiscFlags.linkerLazyArchives = true;
+                  }
+                  else if (!strncmp("linker-threads=",
+                               &rts_argv[arg][2], 15)) {
+                      OPTION_UNSAFE;
+                      THREADED_BUILD_ONLY(
+                        int32_t threads = strtol(rts_argv[arg]+17, (char **) NULL, 10);
+                        if (threads < 1) {
+                          errorBelch("bad value for --linker-threads");
+                          error = true;
+                        } else {
+                          RtsFlags.MiscFlags.linkerThreads = threads;
+                        }
+                      ) break;
+                  }
+                  else if (!strncmp("compact-fixup-threads=",
+                               &rts_argv[arg][2], 22)) {
+                      OPTION_UNSAFE;
+                      THREADED_BUILD_ONLY(
+                        int32_t threads = strtol(rts_argv[arg]+24, (char **) NULL, 10);
+                        if (threads < 1) {
+                          errorBelch("bad value for --compact-fixup-threads");
+                          error = true;
+                        } else {
+                          RtsFlags.MiscFlags.compactFixupThreads = threads;
+                        }
+                      ) break;
+                  }
+                  else if (strequal("stm-version-clock",
+                                    &rts_argv[arg][2])) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                        // TVar versions would wrap around too quickly with
+                        // 32-bit words.
+                        if (sizeof(StgWord) < 8) {
+                          errorBelch("the flag %s requires a 64-bit platform",
+                                     rts_argv[arg]);
+                          error = true;
+                        } else {
+                          RtsFlags.MiscFlags.stmVersionClock = true;
+                        }
+                      ) break;
+                  }
+                  else if (strequal("spark-throttle",
+                                    &rts_argv[arg][2])) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                        RtsFlags.ParFlags.sparkThrottle =
+                            SPARK_THROTTLE_DEFAULT;
+                      ) break;
+                  }
+                  else if (!strncmp("spark-throttle=",
+                                    &rts_argv[arg][2], 15)) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                        double fraction =
+                            parseDouble(rts_argv[arg]+17, &error);
+                        if (error || fraction <= 0 || fraction > 1) {
+                          errorBelch("bad value for --spark-throttle "
+                                     "(expected a fraction, e.g. 0.2)");
+                          error = true;
+                        } else {
+                          RtsFlags.ParFlags.sparkThrottle = fraction;
+                        }
+                      ) break;
+                  }
                   else if (strequal("null-eventlog-writer",
                                &rts_argv[arg][2])) {
                       OPTION_UNSAFE;
@@ -1039,6 +1184,16 @@ error = true;
                       OPTION_SAFE;
                       RtsFlags.MiscFlags.internalCounters = true;
                   }
+                  else if (strequal("thread-accounting",
+                                    &rts_argv[arg][2])) {
+                      OPTION_SAFE;
+                      RtsFlags.MiscFlags.threadAccounting = true;
+                  }
+                  else if (strequal("io-timer-wheel",
+                                    &rts_argv[arg][2])) {
+                      OPTION_SAFE;
+                      RtsFlags.MiscFlags.ioTimerWheel = true;
+                  }
                   else if (!strncmp("io-manager=",
                                &rts_argv[arg][2], 11)) {
                       OPTION_UNSAFE;
@@ -1075,6 +1230,62 @@ error = true;
                           fsecondsToTime(intervalSeconds);
                       ) break;
                   }
+                  else if (!strncmp("eventlog-socket-policy=",
+                               &rts_argv[arg][2], 23)) {
+                      OPTION_SAFE;
+                      TRACING_BUILD_ONLY(
+                      if (strequal("block", &rts_argv[arg][25])) {
+                          RtsFlags.TraceFlags.eventlogSocketBlock = true;
+                      } else if (strequal("drop", &rts_argv[arg][25])) {
+                          RtsFlags.TraceFlags.eventlogSocketBlock = false;
+                      } else {
+                          errorBelch("bad value for --eventlog-socket-policy "
+                                     "(expected block or drop)");
+                          error = true;
+                      }
+                      ) break;
+                  }
+                  else if (strequal("stack-samples",
+                               &rts_argv[arg][2])) {
+                      OPTION_SAFE;
+                      TRACING_BUILD_ONLY(
+                      RtsFlags.TraceFlags.stackSampleDepth =
+                          STACK_SAMPLE_DEFAULT_DEPTH;
+                      ) break;
+                  }
+                  else if (!strncmp("stack-samples=",
+                               &rts_argv[arg][2], 14)) {
+                      OPTION_SAFE;
+                      TRACING_BUILD_ONLY(
+                      long depth = strtol(rts_argv[arg]+16, (char **) NULL, 10);
+                      if (depth < 1 || depth > STACK_SAMPLE_MAX_DEPTH) {
+                          errorBelch("bad value for --stack-samples "
+                                     "(expected 1 to %d frames)",
+                                     STACK_SAMPLE_MAX_DEPTH);
+                          error = true;
+                      } else {
+                          RtsFlags.TraceFlags.stackSampleDepth = depth;
+                      }
+                      ) break;
+                  }
+                  else if (!strncmp("eventlog-async-buffers=",
+                               &rts_argv[arg][2], 23)) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                      char *end;
+                      errno = 0;
+                      long n = strtol(rts_argv[arg]+25, &end, 10);
+                      if (errno != 0 || end == rts_argv[arg]+25 || *end != '\0'
+                          || n < 0 || n > EVENTLOG_ASYNC_BUFFERS_MAX) {
+                          errorBelch("bad value for --eventlog-async-buffers "
+                                     "(expected 0 to %d buffers)",
+                                     EVENTLOG_ASYNC_BUFFERS_MAX);
+                          error = true;
+                      } else {
+                          RtsFlags.TraceFlags.eventlogAsyncBuffers = (uint32_t)n;
+                      }
+                      ) break;
+                  }
                   else if (strequal("copying-gc",
                                &rts_argv[arg][2])) {
                       OPTION_SAFE;
@@ -1096,6 +1307,32 @@ error = true;
                         RtsFlags.GcFlags.nonmovingDenseAllocatorCount = threshold;
                       }
                   }
+                  else if (!strncmp("nonmoving-mark-threads=",
+                               &rts_argv[arg][2], 23)) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                        int32_t threads = strtol(rts_argv[arg]+25, (char **) NULL, 10);
+                        if (threads < 1) {
+                          errorBelch("bad value for --nonmoving-mark-threads");
+                          error = true;
+                        } else {
+                          RtsFlags.GcFlags.nonmovingMarkThreads = threads;
+                        }
+                      ) break;
+                  }
+                  else if (!strncmp("nonmoving-sweep-threads=",
+                               &rts_argv[arg][2], 24)) {
+                      OPTION_SAFE;
+                      THREADED_BUILD_ONLY(
+                        int32_t threads = strtol(rts_argv[arg]+26, (char **) NULL, 10);
+                        if (threads < 1) {
+                          errorBelch("bad value for --nonmoving-sweep-threads");
+                          error = true;
+                        } else {
+                          RtsFlags.GcFlags.nonmovingSweepThreads = threads;
+                        }
+                      ) break;
+                  }
                   else if (strequal("read-tix-file=yes",
                               &rts_argv[arg][2])) {
                        OPTION_UNSAFE;
@@ -1199,6 +1436,48 @@ error = true;
                       }
                   }
 #endif
+                  else if (!strncmp("huge-pages", &rts_argv[arg][2], 10)) {
+                      OPTION_SAFE;
+                      const char *mode = &rts_argv[arg][12];
+                      if (*mode == '\0' || strequal("=thp", mode)) {
+                          RtsFlags.GcFlags.hugePages = HUGE_PAGES_THP;
+                      } else if (strequal("=hugetlb", mode)) {
+                          RtsFlags.GcFlags.hugePages = HUGE_PAGES_HUGETLB;
+                      } else if (strequal("=off", mode)) {
+                          RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+                      } else {
+                          errorBelch("%s: expected --huge-pages, --huge-pages=thp,"
+                                     " --huge-pages=hugetlb or --huge-pages=off",
+                                     rts_argv[arg]);
+                          error = true;
+                      }
+                  }
+                  else if (!strncmp("gc-pause-target=",
+                               &rts_argv[arg][2], 16)) {
+                      OPTION_SAFE;
+                      double seconds = parseDouble(rts_argv[arg]+18, &error);
+                      if (error || seconds < 0) {
+                          errorBelch("bad value for --gc-pause-target");
+                          error = true;
+                      } else {
+                          RtsFlags.GcFlags.gcPauseTarget =
+                              fsecondsToTime(seconds);
+                      }
+                      break;
+                  }
+                  else if (!strncmp("gc-cpu-target=",
+                               &rts_argv[arg][2], 14)) {
+                      OPTION_SAFE;
+                      double fraction = parseDouble(rts_argv[arg]+16, &error);
+                      if (error || fraction < 0 || fraction >= 1) {
+                          errorBelch("bad value for --gc-cpu-target "
+                                     "(expected a fraction, e.g. 0.05)");
+                          error = true;
+                      } else {
+                          RtsFlags.GcFlags.gcCpuTarget = fraction;
+                      }
+                      break;
+                  }
                   else if (!strncmp("long-gc-sync=", &rts_argv[arg][2], 13)) {
                       OPTION_SAFE;
                       if (rts_argv[arg][2] == '\0') {
@@ -1695,6 +1974,12 @@ error = true;
                     case 'm':
                         RtsFlags.ParFlags.migrate = false;
                         break;
+                    case 's':
+                        RtsFlags.ParFlags.stealThreads = true;
+                        break;
+                    case 'c':
+                        RtsFlags.ParFlags.parCompact = true;
+                        break;
                     case 'w':
                         // -qw was removed; accepted for backwards compat
                         break;
@@ -1749,6 +2034,14 @@ error = true;
                           if (strlen(&rts_argv[arg][3]) == 0) {
                               errorBelch("-ol expects filename");
                               error = true;
+                          } else if (!strcmp(&rts_argv[arg][3], "unix:")) {
+                              errorBelch("-olunix: expects a socket path");
+                              error = true;
+#if defined(mingw32_HOST_OS)
+                          } else if (!strncmp(&rts_argv[arg][3], "unix:", 5)) {
+                              errorBelch("-olunix: is not supported on this platform");
+                              error = true;
+#endif
                           } else {
                               RtsFlags.TraceFlags.trace_output =
                                   strdup(&rts_argv[arg][3]);
@@ -493,6 +493,10 @@ hs_exit_(bool wait_foreign)
 
     stopIOManager();
 
+    /* The timer worker may flush the eventlog, which needs the scheduler.
+     * See Note [Timer worker] in Timer.c. */
+    exitTimerWorker();
+
     /* stop all running tasks. This is also where we stop concurrent non-moving
      * collection if it's running */
     exitScheduler(wait_foreign);
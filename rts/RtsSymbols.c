@@ -700,6 +700,8 @@ extern char **environ;
       SymI_HasProto(updateRemembSetPushClosure_)                          \
       SymI_HasProto(performGC)                                          \
       SymI_HasProto(performMajorGC)                                     \
+      SymI_HasProto(compactWriteFd)                                     \
+      SymI_HasProto(compactReadFd)                                      \
       SymI_HasProto(performBlockingMajorGC)                             \
       SymI_HasProto(prog_argc)                                          \
       SymI_HasProto(prog_argv)                                          \
@@ -742,6 +744,8 @@ extern char **environ;
       SymI_HasProto(rts_getFunPtr)                                      \
       SymI_HasProto(rts_getStablePtr)                                   \
       SymI_HasProto(rts_getThreadId)                                    \
+      SymI_HasProto(rts_getThreadAllocated)                             \
+      SymI_HasProto(rts_getThreadCPUTime)                               \
       SymI_HasProto(rts_getWord)                                        \
       SymI_HasProto(rts_getWord8)                                       \
       SymI_HasProto(rts_getWord16)                                      \
@@ -933,6 +937,9 @@ extern char **environ;
       SymI_HasProto(freezeExecPage)                                     \
       SymI_HasProto(freeExecPage)                                       \
       SymI_HasProto(getAllocations)                                     \
+      SymI_HasProto(getSTMStats)                                        \
+      SymI_HasProto(getCapabilitySTMStats)                              \
+      SymI_HasProto(getCapabilitySparkPoolStats)                        \
       SymI_HasProto(revertCAFs)                                         \
       SymI_HasDataProto(RtsFlags)                                           \
       SymI_NeedsDataProto(rts_breakpoint_io_action)                     \
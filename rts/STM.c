@@ -260,6 +260,87 @@ static StgBool cond_lock_tvar(Capability *cap,
 
 /*......................................................................*/
 
+/*
+Note [STM version clock]
+~~~~~~~~~~~~~~~~~~~~~~~~
+By default a transaction is validated by comparing the value it expected to
+find in each TVar with the value the TVar holds (see Note [STM Validation]).
+Committing therefore locks the TVars which are written and then checks every
+TVar which was only read, so a transaction with a large read set is expensive
+to commit and likely to be aborted by unrelated updates.
+
+With +RTS --stm-version-clock the threaded RTS uses a commit protocol in the
+style of TL2 (Dice, Shalev and Shavit, "Transactional Locking II") instead:
+
+  - stm_version_clock is a global counter, incremented by every commit which
+    updates a TVar. While the clock is in use, the num_updates field of a TVar
+    holds its version: the value of the clock at the last commit which
+    updated it.
+
+  - When a top-level transaction starts, it records the clock in the
+    read_version of its TRec (nested TRecs share the read_version of the
+    outermost one). Every TVar is read together with its version (see
+    read_versioned), and a version newer than read_version means that the
+    TVar has been updated since the transaction started. We then try to move
+    the read_version of the whole nest forward to the current clock, which is
+    possible if nothing the transaction has read so far has changed
+    (extend_read_version); otherwise the transaction is condemned. So a
+    transaction which isn't condemned has seen a consistent snapshot of the
+    TVars as of its read_version.
+
+  - To commit (commit_with_version_clock), a transaction locks the TVars it
+    updates, as usual, then increments the clock to get its write version.
+    The TVars which were only read are valid if their version is still no
+    newer than read_version; if the write version is read_version + 1, no
+    other transaction has committed since we started and there is nothing to
+    check. Finally the updated TVars get their new values and the write
+    version. A transaction which updates nothing is valid as of its
+    read_version, so it commits without taking any lock or checking any TVar.
+
+So checking a read is a comparison of versions, read-only transactions never
+fail to commit, and long-running transactions which read a lot are no longer
+aborted whenever one of the TVars they read earlier is updated.
+
+A committing transaction locks the TVars it updates before getting its write
+version and only releases them once the versions are updated, so a reader
+which finds a TVar unlocked with a version no newer than its read_version
+cannot be overtaken by a commit that would be serialised before it.
+Validating against the clock never waits for a locked TVar while holding
+other locks (it considers the transaction invalid instead), so it can't
+deadlock.
+
+Since the transactions are now checked as they run, the validation done by
+the scheduler (stmValidateNestOfTransactions) only needs to check whether the
+transaction has been condemned, and nested transactions commit without any
+check. Waiting in retry# still validates values, as before.
+
+The protocol is selected for the whole run of the program: the two ways of
+using num_updates can't be mixed. It needs a 64-bit word so that versions
+don't wrap around.
+*/
+
+#if defined(STM_FG_LOCKS)
+static volatile StgWord stm_version_clock = 0;
+#define USE_VERSION_CLOCK (RtsFlags.MiscFlags.stmVersionClock)
+#else
+#define USE_VERSION_CLOCK false
+#endif
+
+// The read_version of a new TRec nested in enclosing_trec.
+static StgWord start_read_version(StgTRecHeader *enclosing_trec) {
+  if (enclosing_trec != NO_TREC) {
+    return enclosing_trec -> read_version;
+  }
+#if defined(STM_FG_LOCKS)
+  if (USE_VERSION_CLOCK) {
+    return SEQ_CST_LOAD(&stm_version_clock);
+  }
+#endif
+  return 0;
+}
+
+/*......................................................................*/
+
 // Helper functions for thread blocking and unblocking
 
 static void park_tso(StgTSO *tso) {
@@ -342,6 +423,7 @@ static StgTRecHeader *new_stg_trec_header(Capability *cap,
 
   result -> enclosing_trec = enclosing_trec;
   result -> current_chunk = new_stg_trec_chunk(cap);
+  result -> read_version = start_read_version(enclosing_trec);
 
   if (enclosing_trec == NO_TREC) {
     result -> state = TREC_ACTIVE;
@@ -413,6 +495,7 @@ static StgTRecHeader *alloc_stg_trec_header(Capability *cap,
     cap -> free_trec_headers = result -> enclosing_trec;
     result -> enclosing_trec = enclosing_trec;
     result -> current_chunk -> next_entry_idx = 0;
+    result -> read_version = start_read_version(enclosing_trec);
     if (enclosing_trec == NO_TREC) {
       result -> state = TREC_ACTIVE;
     } else {
@@ -683,6 +766,253 @@ static void revert_ownership(Capability *cap STG_UNUSED,
 
 /*......................................................................*/
 
+/*
+Note [STM statistics]
+~~~~~~~~~~~~~~~~~~~~~
+Each capability counts, in cap->stm_stats, what happens to the transactions
+it runs:
+
+  - starts: top-level transactions started, including every re-execution;
+  - commits and aborts: top-level transactions which committed, and those
+    which were rolled back instead, either because they failed to commit or
+    because they were abandoned (they became invalid while running, see
+    stmValidateNestOfTransactions, or an exception escaped from them);
+  - retries: transactions which executed retry#;
+  - validation_failures: validations which found a TVar which no longer held
+    the value the transaction had seen, or which was locked by another
+    transaction;
+  - trec_entries, max_trec_entries and trec_chunks: the size of the TRecs of
+    transactions when they try to commit.
+
+Only the owner of the capability updates the counters, with plain increments,
+so they cost next to nothing. getSTMStats and getCapabilitySTMStats read them
+without synchronisation, so figures read while transactions are running may be
+slightly out of date. The counters are also posted, for every capability that
+has run a transaction, in an EVENT_STM_STATS after each major GC.
+
+To find out which TVars are contended, every validation failure on a
+particular TVar also posts an EVENT_STM_CONFLICT, with the address of the TVar,
+the info pointer of the value found in it (which identifies the type of the
+value, or is stg_TREC_HEADER_info if the TVar was locked) and whether the
+transaction had written or only read the TVar. Both events are in the
+scheduler class (+RTS -ls), so none of this costs more than a test of a flag
+unless it is enabled. The addresses of TVars change when they are moved by the
+GC, so conflicts should be attributed to TVars between two GCs; the info
+pointer can be resolved with the symbol table or IPE information of the
+program.
+*/
+
+// A validation of trec failed because tvar held value.
+static void stm_conflict(Capability *cap, StgTVar *tvar, StgClosure *value,
+                         StgWord16 kind) {
+  cap->stm_stats.validation_failures++;
+  traceSTMConflict(cap, tvar, UNTAG_CLOSURE(value), kind);
+}
+
+// Account for the size of a top-level trec which is about to commit.
+static void stm_count_trec(Capability *cap, StgTRecHeader *trec) {
+  StgWord entries = 0, chunks = 0;
+  for (StgTRecChunk *c = trec -> current_chunk;
+       c != END_STM_CHUNK_LIST;
+       c = c -> prev_chunk) {
+    entries += c -> next_entry_idx;
+    chunks++;
+  }
+  STMStats *s = &cap->stm_stats;
+  s->trec_entries += entries;
+  s->trec_chunks += chunks;
+  if (entries > s->max_trec_entries) {
+    s->max_trec_entries = entries;
+  }
+}
+
+void getCapabilitySTMStats(uint32_t cap_no, STMStats *s) {
+  if (cap_no >= getNumCapabilities()) {
+    memset(s, 0, sizeof(*s));
+    return;
+  }
+  *s = getCapability(cap_no)->stm_stats;
+}
+
+void getSTMStats(STMStats *s) {
+  memset(s, 0, sizeof(*s));
+  for (uint32_t i = 0; i < getNumCapabilities(); i++) {
+    const STMStats *c = &getCapability(i)->stm_stats;
+    s->starts += c->starts;
+    s->commits += c->commits;
+    s->aborts += c->aborts;
+    s->retries += c->retries;
+    s->validation_failures += c->validation_failures;
+    s->trec_entries += c->trec_entries;
+    if (c->max_trec_entries > s->max_trec_entries) {
+      s->max_trec_entries = c->max_trec_entries;
+    }
+    s->trec_chunks += c->trec_chunks;
+  }
+}
+
+void traceAllSTMStats(Capability *cap) {
+  for (uint32_t i = 0; i < getNumCapabilities(); i++) {
+    Capability *c = getCapability(i);
+    if (c->stm_stats.starts != 0) {
+      traceSTMStats(cap, c);
+    }
+  }
+}
+
+/*......................................................................*/
+
+// Helper functions for the version clock, see Note [STM version clock]
+
+#if defined(STM_FG_LOCKS)
+
+// Read the value of tvar together with its version, waiting for it to be
+// unlocked.
+static StgClosure *read_versioned(StgTVar *tvar, StgWord *version) {
+  while (true) {
+    StgClosure *value = ACQUIRE_LOAD(&tvar->current_value);
+    if (GET_INFO(UNTAG_CLOSURE(value)) == &stg_TREC_HEADER_info) {
+      continue;
+    }
+    *version = (StgWord) SEQ_CST_LOAD(&tvar->num_updates);
+    if (ACQUIRE_LOAD(&tvar->current_value) == value) {
+      return value;
+    }
+  }
+}
+
+// Move the read_version of the nest of trec forward to the current clock if
+// none of the TVars it has read has been updated since its read_version.
+static StgBool extend_read_version(Capability *cap, StgTRecHeader *trec) {
+  const StgWord now = SEQ_CST_LOAD(&stm_version_clock);
+  StgTRecHeader *t;
+
+  for (t = trec; t != NO_TREC; t = t -> enclosing_trec) {
+    StgBool valid = true;
+    FOR_EACH_ENTRY(t, e, {
+      StgWord version;
+      StgClosure *value = read_versioned(e -> tvar, &version);
+      if (version > trec -> read_version || value != e -> expected_value) {
+        TRACE("%p : can't extend read version, %p has changed", trec, e -> tvar);
+        stm_conflict(cap, e -> tvar, value, STM_CONFLICT_INFLIGHT);
+        valid = false;
+        BREAK_FOR_EACH;
+      }
+    });
+    if (!valid) {
+      return false;
+    }
+  }
+
+  TRACE("%p : read version %" FMT_Word " -> %" FMT_Word,
+        trec, trec -> read_version, now);
+  for (t = trec; t != NO_TREC; t = t -> enclosing_trec) {
+    t -> read_version = now;
+  }
+  return true;
+}
+
+static void condemn_nest(StgTRecHeader *trec) {
+  for (StgTRecHeader *t = trec; t != NO_TREC; t = t -> enclosing_trec) {
+    t -> state = TREC_CONDEMNED;
+  }
+}
+
+// Lock the TVars updated by trec, checking that they still hold the values it
+// read from them. Sets *updates if there are any.
+static StgBool lock_updated_tvars(Capability *cap, StgTRecHeader *trec,
+                                  StgBool *updates) {
+  StgBool result = true;
+  FOR_EACH_ENTRY(trec, e, {
+    if (entry_is_update(e)) {
+      StgTVar *s = e -> tvar;
+      *updates = true;
+      if (!cond_lock_tvar(cap, trec, s, e -> expected_value)) {
+        TRACE("%p : failed to acquire %p", trec, s);
+        stm_conflict(cap, s, RELAXED_LOAD(&s->current_value),
+                     STM_CONFLICT_UPDATE);
+        result = false;
+        BREAK_FOR_EACH;
+      }
+    }
+  });
+  return result;
+}
+
+// Check that the TVars only read by trec haven't been updated since its
+// read_version. Locked TVars count as updated: we mustn't wait for them while
+// we hold locks ourselves.
+static StgBool check_read_versions(Capability *cap, StgTRecHeader *trec) {
+  StgBool result = true;
+  FOR_EACH_ENTRY(trec, e, {
+    if (!entry_is_update(e)) {
+      StgTVar *s = e -> tvar;
+      StgClosure *value = ACQUIRE_LOAD(&s->current_value);
+      StgWord version = (StgWord) SEQ_CST_LOAD(&s->num_updates);
+      if (value != e -> expected_value
+          || version > trec -> read_version
+          || ACQUIRE_LOAD(&s->current_value) != value) {
+        TRACE("%p : %p has changed", trec, s);
+        stm_conflict(cap, s, value, STM_CONFLICT_READ);
+        result = false;
+        BREAK_FOR_EACH;
+      }
+    }
+  });
+  return result;
+}
+
+// Write the updates of trec, which holds the locks of the TVars it updates.
+static void write_updated_tvars(Capability *cap, StgTRecHeader *trec,
+                                StgWord write_version) {
+  FOR_EACH_ENTRY(trec, e, {
+    if (entry_is_update(e)) {
+      StgTVar *s = e -> tvar;
+      ACQ_ASSERT(tvar_is_locked(s, trec));
+      TRACE("%p : writing %p to %p, waking waiters", trec, e -> new_value, s);
+      unpark_waiters_on(cap, s);
+      // Published by the release in unlock_tvar.
+      RELAXED_STORE(&s->num_updates, (StgInt) write_version);
+      unlock_tvar(cap, trec, s, e -> new_value, true);
+    }
+  });
+}
+
+static StgBool commit_with_version_clock(Capability *cap, StgTRecHeader *trec) {
+  StgBool updates = false;
+
+  if (trec -> state == TREC_CONDEMNED || shake()) {
+    return false;
+  }
+
+  if (!lock_updated_tvars(cap, trec, &updates)) {
+    revert_ownership(cap, trec, false);
+    return false;
+  }
+
+  if (!updates) {
+    // Valid as of read_version.
+    return true;
+  }
+
+  const StgWord write_version = atomic_inc(&stm_version_clock, 1);
+
+  // If nobody committed since we started there is nothing to check.
+  if (write_version != trec -> read_version + 1
+      && !check_read_versions(cap, trec)) {
+    revert_ownership(cap, trec, false);
+    return false;
+  }
+
+  // The commit is serialised at write_version.
+  write_updated_tvars(cap, trec, write_version);
+  return true;
+}
+
+#endif
+
+/*......................................................................*/
+
 // validate_optimistic()
 StgBool validate_trec_optimistic (Capability *cap, StgTRecHeader *trec);
 
@@ -709,6 +1039,7 @@ StgBool validate_trec_optimistic (Capability *cap, StgTRecHeader *trec) {
           //If the trec is locked we optimistically assume our trec will still be valid after it's unlocked.
          (GET_INFO(UNTAG_CLOSURE(current)) != &stg_TREC_HEADER_info))
       {   TRACE("%p : failed optimistic validate %p", trec, s);
+          stm_conflict(cap, s, current, STM_CONFLICT_INFLIGHT);
           result = false;
           BREAK_FOR_EACH;
       }
@@ -759,6 +1090,9 @@ static StgBool validate_and_acquire_ownership (Capability *cap,
         TRACE("%p : trying to acquire %p", trec, s);
         if (!cond_lock_tvar(cap, trec, s, e -> expected_value)) {
           TRACE("%p : failed to acquire %p", trec, s);
+          stm_conflict(cap, s, RELAXED_LOAD(&s->current_value),
+                       entry_is_update(e) ? STM_CONFLICT_UPDATE
+                                          : STM_CONFLICT_READ);
           result = false;
           BREAK_FOR_EACH;
         }
@@ -769,14 +1103,18 @@ static StgBool validate_and_acquire_ownership (Capability *cap,
           // The memory ordering here must ensure that we have two distinct
           // reads to current_value, with the read from num_updates between
           // them.
-          if (ACQUIRE_LOAD(&s->current_value) != e -> expected_value) {
+          StgClosure *current = ACQUIRE_LOAD(&s->current_value);
+          if (current != e -> expected_value) {
             TRACE("%p : doesn't match", trec);
+            stm_conflict(cap, s, current, STM_CONFLICT_READ);
             result = false;
             BREAK_FOR_EACH;
           }
           e->num_updates = SEQ_CST_LOAD(&s->num_updates);
-          if (ACQUIRE_LOAD(&s->current_value) != e -> expected_value) {
+          current = ACQUIRE_LOAD(&s->current_value);
+          if (current != e -> expected_value) {
             TRACE("%p : doesn't match (race)", trec);
+            stm_conflict(cap, s, current, STM_CONFLICT_READ);
             result = false;
             BREAK_FOR_EACH;
           } else {
@@ -806,7 +1144,8 @@ static StgBool validate_and_acquire_ownership (Capability *cap,
 // Keir Fraser's PhD dissertation "Practical lock-free programming" discuss
 // this kind of algorithm.
 
-static StgBool check_read_only(StgTRecHeader *trec STG_UNUSED) {
+static StgBool check_read_only(Capability *cap STG_UNUSED,
+                               StgTRecHeader *trec STG_UNUSED) {
   StgBool result = true;
 
   ASSERT(config_use_read_phase);
@@ -828,6 +1167,7 @@ static StgBool check_read_only(StgTRecHeader *trec STG_UNUSED) {
         if (current_value != e->expected_value ||
             num_updates != e->num_updates) {
           TRACE("%p : mismatch", trec);
+          stm_conflict(cap, s, current_value, STM_CONFLICT_READ);
           result = false;
           BREAK_FOR_EACH;
         }
@@ -904,6 +1244,9 @@ StgTRecHeader *stmStartTransaction(Capability *cap,
         cap -> transaction_tokens);
 
   getToken(cap);
+  if (outer == NO_TREC) {
+    cap->stm_stats.starts++;
+  }
 
   t = alloc_stg_trec_header(cap, outer);
   TRACE("%p : stmStartTransaction()=%p", outer, t);
@@ -926,6 +1269,7 @@ void stmAbortTransaction(Capability *cap,
     // We're a top-level transaction: remove any watch queue entries that
     // we may have.
     TRACE("%p : aborting top-level transaction", trec);
+    cap->stm_stats.aborts++;
 
     if (trec -> state == TREC_WAITING) {
       ASSERT(trec -> enclosing_trec == NO_TREC);
@@ -1207,15 +1551,23 @@ StgBool stmValidateNestOfTransactions(Capability *cap, StgTRecHeader *trec, StgB
 
   t = trec;
   StgBool result = true;
-  while (t != NO_TREC) {
-    if(optimistically) {
-      result &= validate_trec_optimistic(cap, t);
+  if (USE_VERSION_CLOCK && trec -> state != TREC_WAITING) {
+    // The transaction has seen a consistent snapshot unless it has been
+    // condemned. See Note [STM version clock].
+    for (; t != NO_TREC; t = t -> enclosing_trec) {
+      result &= t -> state != TREC_CONDEMNED;
+    }
+  } else {
+    while (t != NO_TREC) {
+      if(optimistically) {
+        result &= validate_trec_optimistic(cap, t);
 
-    } else {
-      // TODO: I don't think there is a need to lock all tvars here.
-      result &= validate_and_acquire_ownership(cap, t, true, false);
+      } else {
+        // TODO: I don't think there is a need to lock all tvars here.
+        result &= validate_and_acquire_ownership(cap, t, true, false);
+      }
+      t = t -> enclosing_trec;
     }
-    t = t -> enclosing_trec;
   }
 
   if (!result && trec -> state != TREC_WAITING) {
@@ -1261,61 +1613,78 @@ StgBool stmCommitTransaction(Capability *cap, StgTRecHeader *trec) {
   ASSERT((trec -> state == TREC_ACTIVE) ||
          (trec -> state == TREC_CONDEMNED));
 
-  // Use a read-phase (i.e. don't lock TVars we've read but not updated) if
-  // the configuration lets us use a read phase.
+  stm_count_trec(cap, trec);
 
-  bool result = validate_and_acquire_ownership(cap, trec, (!config_use_read_phase), true);
-  if (result) {
-    // We now know that all the updated locations hold their expected values.
-    ASSERT(trec -> state == TREC_ACTIVE);
-
-    if (config_use_read_phase) {
-      StgInt64 max_commits_at_end;
-      StgInt64 max_concurrent_commits;
-      TRACE("%p : doing read check", trec);
-      result = check_read_only(trec);
-      TRACE("%p : read-check %s", trec, result ? "succeeded" : "failed");
-
-      max_commits_at_end = getMaxCommits();
-      max_concurrent_commits = ((max_commits_at_end - max_commits_at_start) +
-                                (getNumCapabilities() * TOKEN_BATCH_SIZE));
-      if (((max_concurrent_commits >> 32) > 0) || shake()) {
-        TRACE("STM - Max commit number exceeded");
-        result = false;
-      }
-    }
+  bool result;
+#if defined(STM_FG_LOCKS)
+  if (USE_VERSION_CLOCK) {
+    // See Note [STM version clock]
+    result = commit_with_version_clock(cap, trec);
+  } else
+#endif
+  {
+    // Use a read-phase (i.e. don't lock TVars we've read but not updated) if
+    // the configuration lets us use a read phase.
 
+    result = validate_and_acquire_ownership(cap, trec, (!config_use_read_phase), true);
     if (result) {
-      // We now know that all of the read-only locations held their expected values
-      // at the end of the call to validate_and_acquire_ownership.  This forms the
-      // linearization point of the commit.
-
-      // Make the updates required by the transaction.
-      FOR_EACH_ENTRY(trec, e, {
-        StgTVar *s;
-        s = e -> tvar;
-        if ((!config_use_read_phase) || (e -> new_value != e -> expected_value)) {
-          // Either the entry is an update or we're not using a read phase:
-          // write the value back to the TVar, unlocking it if necessary.
-
-          ACQ_ASSERT(tvar_is_locked(s, trec));
-          TRACE("%p : writing %p to %p, waking waiters", trec, e -> new_value, s);
-          unpark_waiters_on(cap,s);
-          IF_STM_FG_LOCKS({
-            // We have locked the TVar therefore nonatomic addition is sufficient
-            NONATOMIC_ADD(&s->num_updates, 1);
-          });
-          unlock_tvar(cap, trec, s, e -> new_value, true);
+      // We now know that all the updated locations hold their expected values.
+      ASSERT(trec -> state == TREC_ACTIVE);
+
+      if (config_use_read_phase) {
+        StgInt64 max_commits_at_end;
+        StgInt64 max_concurrent_commits;
+        TRACE("%p : doing read check", trec);
+        result = check_read_only(cap, trec);
+        TRACE("%p : read-check %s", trec, result ? "succeeded" : "failed");
+
+        max_commits_at_end = getMaxCommits();
+        max_concurrent_commits = ((max_commits_at_end - max_commits_at_start) +
+                                  (getNumCapabilities() * TOKEN_BATCH_SIZE));
+        if (((max_concurrent_commits >> 32) > 0) || shake()) {
+          TRACE("STM - Max commit number exceeded");
+          result = false;
         }
-        ACQ_ASSERT(!tvar_is_locked(s, trec));
-      });
-    } else {
-        revert_ownership(cap, trec, false);
+      }
+
+      if (result) {
+        // We now know that all of the read-only locations held their expected values
+        // at the end of the call to validate_and_acquire_ownership.  This forms the
+        // linearization point of the commit.
+
+        // Make the updates required by the transaction.
+        FOR_EACH_ENTRY(trec, e, {
+          StgTVar *s;
+          s = e -> tvar;
+          if ((!config_use_read_phase) || (e -> new_value != e -> expected_value)) {
+            // Either the entry is an update or we're not using a read phase:
+            // write the value back to the TVar, unlocking it if necessary.
+
+            ACQ_ASSERT(tvar_is_locked(s, trec));
+            TRACE("%p : writing %p to %p, waking waiters", trec, e -> new_value, s);
+            unpark_waiters_on(cap,s);
+            IF_STM_FG_LOCKS({
+              // We have locked the TVar therefore nonatomic addition is sufficient
+              NONATOMIC_ADD(&s->num_updates, 1);
+            });
+            unlock_tvar(cap, trec, s, e -> new_value, true);
+          }
+          ACQ_ASSERT(!tvar_is_locked(s, trec));
+        });
+      } else {
+          revert_ownership(cap, trec, false);
+      }
     }
   }
 
   free_stg_trec_header(cap, trec);
 
+  if (result) {
+    cap->stm_stats.commits++;
+  } else {
+    cap->stm_stats.aborts++;
+  }
+
   TRACE("%p : stmCommitTransaction()=%d", trec, result);
 
   return result;
@@ -1323,6 +1692,22 @@ StgBool stmCommitTransaction(Capability *cap, StgTRecHeader *trec) {
 
 /*......................................................................*/
 
+// Everything a transaction has read is consistent with the read version of
+// its nest unless it has been condemned, so there is nothing to check.
+static StgBool commit_nested_with_version_clock(Capability *cap,
+                                                StgTRecHeader *trec) {
+  StgTRecHeader *et = trec -> enclosing_trec;
+  StgBool result = trec -> state != TREC_CONDEMNED;
+  if (result) {
+    FOR_EACH_ENTRY(trec, e, {
+      merge_update_into(cap, et, e -> tvar, e -> expected_value, e -> new_value);
+    });
+  }
+  free_stg_trec_header(cap, trec);
+  TRACE("%p : commit_nested_with_version_clock()=%d", trec, result);
+  return result;
+}
+
 StgBool stmCommitNestedTransaction(Capability *cap, StgTRecHeader *trec) {
   StgTRecHeader *et;
   ASSERT(trec != NO_TREC && trec -> enclosing_trec != NO_TREC);
@@ -1330,13 +1715,19 @@ StgBool stmCommitNestedTransaction(Capability *cap, StgTRecHeader *trec) {
   ASSERT((trec -> state == TREC_ACTIVE) || (trec -> state == TREC_CONDEMNED));
 
   et = trec -> enclosing_trec;
+
+  if (USE_VERSION_CLOCK) {
+    // See Note [STM version clock]
+    return commit_nested_with_version_clock(cap, trec);
+  }
+
   bool result = validate_and_acquire_ownership(cap, trec, (!config_use_read_phase), true);
   if (result) {
     // We now know that all the updated locations hold their expected values.
 
     if (config_use_read_phase) {
       TRACE("%p : doing read check", trec);
-      result = check_read_only(trec);
+      result = check_read_only(cap, trec);
     }
     if (result) {
       // We now know that all of the read-only locations held their expected values
@@ -1377,6 +1768,8 @@ StgBool stmWait(Capability *cap, StgTSO *tso, StgTRecHeader *trec) {
   ASSERT((trec -> state == TREC_ACTIVE) ||
          (trec -> state == TREC_CONDEMNED));
 
+  cap->stm_stats.retries++;
+
   bool result = validate_and_acquire_ownership(cap, trec, true, true);
   if (result) {
     // The transaction is valid so far so we can actually start waiting.
@@ -1446,8 +1839,30 @@ StgBool stmReWait(Capability *cap, StgTSO *tso) {
 
 /*......................................................................*/
 
-static StgClosure *read_current_value(StgTRecHeader *trec STG_UNUSED, StgTVar *tvar) {
+static StgClosure *read_current_value(Capability *cap STG_UNUSED,
+                                      StgTRecHeader *trec STG_UNUSED,
+                                      StgTVar *tvar) {
   StgClosure *result;
+
+#if defined(STM_FG_LOCKS)
+  if (USE_VERSION_CLOCK) {
+    // See Note [STM version clock]
+    StgWord version;
+    result = read_versioned(tvar, &version);
+    if (version > trec -> read_version && trec -> state != TREC_CONDEMNED) {
+      if (extend_read_version(cap, trec)) {
+        result = read_versioned(tvar, &version);
+      }
+      if (version > trec -> read_version) {
+        TRACE("%p : %p is newer than the read version, condemned", trec, tvar);
+        condemn_nest(trec);
+      }
+    }
+    TRACE("%p : read_current_value(%p)=%p", trec, tvar, result);
+    return result;
+  }
+#endif
+
   result = ACQUIRE_LOAD(&tvar->current_value);
 
 #if defined(STM_FG_LOCKS)
@@ -1490,7 +1905,7 @@ StgClosure *stmReadTVar(Capability *cap,
     }
   } else {
     // No entry found
-    StgClosure *current_value = read_current_value(trec, tvar);
+    StgClosure *current_value = read_current_value(cap, trec, tvar);
     TRecEntry *new_entry = get_new_entry(cap, trec);
     new_entry -> tvar = tvar;
     new_entry -> expected_value = current_value;
@@ -1534,7 +1949,7 @@ void stmWriteTVar(Capability *cap,
     }
   } else {
     // No entry found
-    StgClosure *current_value = read_current_value(trec, tvar);
+    StgClosure *current_value = read_current_value(cap, trec, tvar);
     TRecEntry *new_entry = get_new_entry(cap, trec);
     new_entry -> tvar = tvar;
     new_entry -> expected_value = current_value;
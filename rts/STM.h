@@ -46,6 +46,12 @@
 
 void stmPreGCHook(Capability *cap);
 
+/*
+ * Post the STM statistics of every capability which has run a transaction,
+ * see Note [STM statistics] in STM.c.
+ */
+void traceAllSTMStats(Capability *cap);
+
 /*----------------------------------------------------------------------
 
    Transaction context management
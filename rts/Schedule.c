@@ -153,6 +153,9 @@ static void scheduleDetectDeadlock (Capability **pcap, Task *task);
 static void schedulePushWork(Capability *cap, Task *task);
 #if defined(THREADED_RTS)
 static void scheduleActivateSpark(Capability *cap);
+static void scheduleStealThread(Capability *cap);
+static bool exposeStealableThread(Capability *cap, StgTSO *tso);
+static void reclaimAllStealableThreads(void);
 #endif
 static void schedulePostRunThread(Capability *cap, StgTSO *t);
 static bool scheduleHandleHeapOverflow( Capability *cap, StgTSO *t );
@@ -205,6 +208,7 @@ schedule (Capability *initialCapability, Task *task)
   StgThreadReturnCode ret;
   uint32_t prev_what_next;
   bool ready_to_gc;
+  ThreadSlice slice;
 
   cap = initialCapability;
   t = NULL;
@@ -480,6 +484,11 @@ run_thread:
 
     traceEventRunThread(cap, t);
 
+    // See Note [Thread accounting] in Threads.c.
+    if (RtsFlags.MiscFlags.threadAccounting) {
+        accountThreadSliceBegin(t, &slice);
+    }
+
     switch (prev_what_next) {
 
     case ThreadKilled:
@@ -517,6 +526,10 @@ run_thread:
     // happened.  So find the new location:
     t = cap->r.rCurrentTSO;
 
+    if (RtsFlags.MiscFlags.threadAccounting) {
+        accountThreadSliceEnd(t, &slice);
+    }
+
     // cap->r.rCurrentTSO is charged for calls to allocate(), so we
     // don't want it set when not running a Haskell thread.
     cap->r.rCurrentTSO = NULL;
@@ -530,6 +543,14 @@ run_thread:
     t->saved_winerror = GetLastError();
 #endif
 
+    // See Note [Stack sampling] in Proftimer.c
+    if (RTS_UNLIKELY(RELAXED_LOAD_ALWAYS(&cap->stack_sample_pending))) {
+        RELAXED_STORE_ALWAYS(&cap->stack_sample_pending, false);
+        if (ret != ThreadFinished) {
+            traceStackSample(cap, t);
+        }
+    }
+
     if (ret == ThreadBlocked) {
         StgThreadWhyBlocked why_blocked = ACQUIRE_LOAD(&t->why_blocked);
         EventThreadStatus status = eventlogThreadStatusBlocked(why_blocked);
@@ -613,6 +634,10 @@ scheduleFindWork (Capability **pcap)
 #if defined(mingw32_HOST_OS) && !defined(THREADED_RTS)
     queueIOThread();
 #endif
+#if defined(THREADED_RTS)
+    // Take back any threads that nobody stole since we last offered them.
+    reclaimStealableThreads(*pcap);
+#endif
 #if defined(RTS_USER_SIGNALS)
     startPendingSignalHandlers(*pcap);
 #endif
@@ -622,6 +647,7 @@ scheduleFindWork (Capability **pcap)
     scheduleCheckBlockedThreads(*pcap);
 
 #if defined(THREADED_RTS)
+    if (emptyRunQueue(*pcap)) { scheduleStealThread(*pcap); }
     if (emptyRunQueue(*pcap)) { scheduleActivateSpark(*pcap); }
 #endif
 }
@@ -770,6 +796,7 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
 
     if (n_free_caps > 0) {
         StgTSO *prev, *t, *next;
+        uint32_t n_exposed = 0;
 
         debugTrace(DEBUG_sched,
                    "cap %d: %d threads, %d sparks, and %d free capabilities, sharing...",
@@ -817,6 +844,15 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
                 if (keep_threads > 0) keep_threads--;
             }
 
+            // Or offer it to be stolen by whichever Capability gets there
+            // first?  See Note [Thread stealing].
+            else if (cap->stealable_threads != NULL
+                     && t->bound == NULL
+                     && exposeStealableThread(cap, t)) {
+                n_exposed++;
+                n--;
+            }
+
             // Or migrate it?
             else {
                 appendToRunQueue(free_caps[i],t);
@@ -852,9 +888,9 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
         // release the capabilities
         for (i = 0; i < n_free_caps; i++) {
             task->cap = free_caps[i];
-            if (sparkPoolSizeCap(cap) > 0) {
-                // If we have sparks to steal, wake up a worker on the
-                // capability, even if it has no threads to run.
+            if (sparkPoolSizeCap(cap) > 0 || n_exposed > 0) {
+                // If we have sparks or threads to steal, wake up a worker
+                // on the capability, even if it has no threads to run.
                 releaseAndWakeupCapability(free_caps[i]);
             } else {
                 releaseCapability(free_caps[i]);
@@ -1057,6 +1093,165 @@ scheduleActivateSpark(Capability *cap)
 }
 #endif // THREADED_RTS
 
+/* ----------------------------------------------------------------------------
+ * Thread stealing (THREADED_RTS, +RTS -qs)
+ *
+ * Note [Thread stealing]
+ * ~~~~~~~~~~~~~~~~~~~~~~
+ * Normally a Capability with surplus threads pushes them to the free
+ * Capabilities it managed to grab in schedulePushWork(), committing each
+ * thread to a particular destination up front.  With +RTS -qs it instead
+ * offers the surplus threads in cap->stealable_threads, a WSDeque (the same
+ * structure used for the spark pool), and wakes up the free Capabilities.
+ * Any Capability that finds its run queue empty in scheduleFindWork() may
+ * then steal one of the offered threads, so the thread ends up on whichever
+ * Capability is ready for it first, rather than on one that may have found
+ * other work in the meantime.
+ *
+ * Only the run queue proper is manipulated without synchronisation, so we
+ * never let other Capabilities near it: offering a thread takes it off the
+ * run queue and puts it in the deque.  Each offered thread has the
+ * TSO_STEALABLE flag set, and it is claimed by exactly one of
+ *
+ *   - a thief, via stealWSDeque(): it sets tso->cap to itself *before*
+ *     clearing TSO_STEALABLE (with release ordering), and appends the
+ *     thread to its own run queue;
+ *
+ *   - the owner, via popWSDeque() in reclaimStealableThreads(): it clears
+ *     TSO_STEALABLE and pushes the thread back on the front of its run queue,
+ *     where it came from.  The owner does this at the start of every
+ *     scheduleFindWork(), so a thread is on offer for at most one iteration
+ *     of the scheduler loop.
+ *
+ * In both cases TSO_STEALABLE is cleared with an atomic and, see
+ * clearStealableFlag(): the owner may be updating other bits of tso->flags
+ * at the same time as a thief claims the thread, and a plain
+ * read-modify-write could lose either update.
+ *
+ * While a thread is on offer its owner must not act on the assumption that
+ * tso->cap == cap, since a thief might be in the middle of claiming it.
+ * Hence the places that decide between handling a thread locally and
+ * sending a message to tso->cap (throwToMsg(), tryWakeupThread() and
+ * messageBlackHole()), as well as the handlers for MSG_SET_TSO_FLAG and
+ * MSG_UNSET_TSO_FLAG, call settleStealableThread() first: the owner
+ * reclaims its offered threads, and if the thread in question was not among
+ * them it waits for the thief to publish the new tso->cap, which takes a
+ * handful of instructions.  Other Capabilities only ever send messages to a
+ * thread on offer, and the owner forwards them just as for any other
+ * migrated thread.
+ *
+ * The GC, forkProcess() and setNumCapabilities() assume that every runnable
+ * thread is on a run queue, so they put all offered threads back with
+ * reclaimAllStealableThreads() once they own every Capability.
+ *
+ * Bound threads and threads with TSO_LOCKED are never offered.  Steals are
+ * reported in the eventlog with the THREAD_STEAL event.
+ * ------------------------------------------------------------------------- */
+
+#if defined(THREADED_RTS)
+static bool
+exposeStealableThread (Capability *cap, StgTSO *tso)
+{
+    ASSERT(tso->_link == END_TSO_QUEUE);
+    ASSERT(tso->bound == NULL && !tsoLocked(tso));
+    ASSERT(tso->cap == cap);
+
+    // pushWSDeque() publishes the flag to thieves
+    tso->flags |= TSO_STEALABLE;
+    if (!pushWSDeque(cap->stealable_threads, tso)) {
+        tso->flags &= ~TSO_STEALABLE;
+        return false;
+    }
+    return true;
+}
+
+// Clear TSO_STEALABLE, publishing any earlier stores (in particular the
+// thief's tso->cap) to settleStealableThread_().
+STATIC_INLINE void
+clearStealableFlag (StgTSO *tso)
+{
+    RELEASE_AND(&tso->flags, (StgWord32) ~TSO_STEALABLE);
+}
+
+void
+reclaimStealableThreads (Capability *cap)
+{
+    StgTSO *tso;
+
+    if (cap->stealable_threads == NULL) return;
+
+    // Threads were offered in run queue order, so pushing them back on the
+    // front of the run queue in LIFO order restores the original order.
+    while ((tso = popWSDeque(cap->stealable_threads)) != NULL) {
+        ASSERT(tso->cap == cap);
+        clearStealableFlag(tso);
+        pushOnRunQueue(cap, tso);
+    }
+}
+
+void
+settleStealableThread_ (Capability *cap, StgTSO *tso)
+{
+    if (RELAXED_LOAD(&tso->cap) != cap) {
+        // Either offered by some other Capability, or already claimed by a
+        // thief that has published its tso->cap.  Either way the caller will
+        // send a message, which gets forwarded if necessary.
+        return;
+    }
+
+    reclaimStealableThreads(cap);
+
+    // If tso was not among the threads we took back then a thief has won the
+    // race for it, and is about to update tso->cap.
+    while (ACQUIRE_LOAD(&tso->flags) & TSO_STEALABLE) {
+        busy_wait_nop();
+    }
+}
+
+static void
+scheduleStealThread (Capability *cap)
+{
+    uint32_t i, n;
+    Capability *victim;
+    StgTSO *tso;
+
+    if (cap->stealable_threads == NULL || cap->disabled) return;
+
+    n = getNumCapabilities();
+    for (i = (cap->no + 1) % n; i != cap->no; i = (i + 1) % n) {
+        victim = getCapability(i);
+        if (victim->stealable_threads == NULL
+            || looksEmptyWSDeque(victim->stealable_threads)) {
+            continue;
+        }
+        tso = stealWSDeque(victim->stealable_threads);
+        if (tso == NULL) continue;
+
+        ASSERT(tso->cap == victim);
+        // See Note [Thread stealing] for why the order here matters.
+        RELAXED_STORE(&tso->cap, cap);
+        clearStealableFlag(tso);
+        appendToRunQueue(cap, tso);
+
+        debugTrace(DEBUG_sched, "cap %d: stole thread %" FMT_StgThreadID
+                   " from cap %d", cap->no, tso->id, victim->no);
+        traceEventStealThread(cap, tso, victim->no);
+        return;
+    }
+}
+
+static void
+reclaimAllStealableThreads (void)
+{
+    // NOTE: only safe to call if we own all capabilities.
+    uint32_t i;
+
+    for (i = 0; i < getNumCapabilities(); i++) {
+        reclaimStealableThreads(getCapability(i));
+    }
+}
+#endif // THREADED_RTS
+
 /* ----------------------------------------------------------------------------
  * After running a thread...
  * ------------------------------------------------------------------------- */
@@ -1301,6 +1496,10 @@ scheduleHandleThreadFinished (Capability *cap, Task *task, StgTSO *t)
     // blocked mode (see #2910).
     awakenBlockedExceptionQueue (cap, t);
 
+    if (RtsFlags.MiscFlags.threadAccounting) {
+        traceThreadAccounting(cap, t);
+    }
+
       //
       // Check whether the thread that just completed was a bound
       // thread, and if so return with the result.
@@ -1824,6 +2023,12 @@ scheduleDoGC (Capability **pcap, Task *task USED_IF_THREADS,
     IF_DEBUG(scheduler, printAllThreads());
 
 delete_threads_and_gc:
+#if defined(THREADED_RTS)
+    // Offered threads must be back on their run queues before we
+    // delete or collect anything. See Note [Thread stealing].
+    reclaimAllStealableThreads();
+#endif
+
     /*
      * We now have all the capabilities; if we're in an interrupting
      * state, then we should take the opportunity to delete all the
@@ -1904,6 +2109,16 @@ delete_threads_and_gc:
 
     traceSparkCounters(cap);
 
+    // See Note [Thread accounting] in Threads.c.
+    if (major_gc && RtsFlags.MiscFlags.threadAccounting) {
+        traceAllThreadAccounting(cap);
+    }
+
+    // See Note [STM statistics] in STM.c.
+    if (major_gc && TRACE_sched) {
+        traceAllSTMStats(cap);
+    }
+
     switch (getRecentActivity()) {
     case ACTIVITY_INACTIVE:
         if (force_major) {
@@ -2056,6 +2271,9 @@ forkProcess(HsStablePtr *entry
 
 #if defined(THREADED_RTS)
     stopAllCapabilities(&cap, task);
+    // so that neither parent nor child has threads in a stealable_threads
+    // deque. See Note [Thread stealing].
+    reclaimAllStealableThreads();
 #endif
 
     // no funny business: hold locks while we fork, otherwise if some
@@ -2064,7 +2282,7 @@ forkProcess(HsStablePtr *entry
     // inconsistent state in the child.  See also #1391.
     ACQUIRE_LOCK(&sched_mutex);
     ACQUIRE_LOCK(&sm_mutex);
-    ACQUIRE_LOCK(&stable_ptr_mutex);
+    stablePtrLock();
     ACQUIRE_LOCK(&stable_name_mutex);
 
     for (i=0; i < n_capabilities; i++) {
@@ -2079,6 +2297,9 @@ forkProcess(HsStablePtr *entry
 #endif
 
 #if defined(TRACING)
+    // The child mustn't inherit the eventlog flusher thread in the middle of
+    // a write, see Note [Eventlog flusher thread].
+    stopEventLogFlusherForFork();
 #if defined(HAVE_PREEMPTION)
     // We must hold the eventlog global mutex over the fork to prevent the
     // timer thread from trying to post events. While holding the mutex we need
@@ -2089,19 +2310,26 @@ forkProcess(HsStablePtr *entry
     flushAllCapsEventsBufs_();
 #endif
 
+    // See Note [Timer worker] in Timer.c
+    lockTimerWorkerForFork();
+
     pid = fork();
 
     if (pid) { // parent
 
         RELEASE_LOCK(&sched_mutex);
         RELEASE_LOCK(&sm_mutex);
-        RELEASE_LOCK(&stable_ptr_mutex);
+        stablePtrUnlock();
         RELEASE_LOCK(&stable_name_mutex);
         RELEASE_LOCK(&task->lock);
+        unlockTimerWorkerAfterFork();
 
-#if defined(TRACING) && defined(HAVE_PREEMPTION)
+#if defined(TRACING)
+#if defined(HAVE_PREEMPTION)
         RELEASE_LOCK_ALWAYS(&eventBufMutex);
 #endif
+        resumeEventLogFlusherAfterFork();
+#endif
 
 #if defined(THREADED_RTS)
         /* N.B. releaseCapability_ below may need to take all_tasks_mutex */
@@ -2127,7 +2355,7 @@ forkProcess(HsStablePtr *entry
 #if defined(THREADED_RTS)
         initMutex(&sched_mutex);
         initMutex(&sm_mutex);
-        initMutex(&stable_ptr_mutex);
+        initStablePtrLocks();
         initMutex(&stable_name_mutex);
         initMutex(&task->lock);
 
@@ -2298,6 +2526,9 @@ setNumCapabilities (uint32_t new_n_capabilities USED_IF_THREADS)
 
     stopAllCapabilities(&cap, task);
 
+    // See Note [Thread stealing].
+    reclaimAllStealableThreads();
+
     if (new_n_capabilities < enabled_capabilities)
     {
         // Reducing the number of capabilities: we do not actually
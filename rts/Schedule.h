@@ -59,6 +59,16 @@ void scheduleWorker (Capability *cap, Task *task);
 void stopAllCapabilitiesWith (Capability **pCap, Task *task, SyncType sync_type);
 void stopAllCapabilities (Capability **pCap, Task *task);
 void releaseAllCapabilities(uint32_t n, Capability *keep_cap, Task *task);
+
+/* Thread stealing (+RTS -qs), see Note [Thread stealing] in Schedule.c.
+ *
+ * reclaimStealableThreads() moves every thread the Capability has offered
+ * for stealing back onto its run queue.
+ *
+ * Locks assumed: we own cap
+ */
+void reclaimStealableThreads (Capability *cap);
+void settleStealableThread_ (Capability *cap, StgTSO *tso);
 #endif
 
 /* The state of the scheduler.  This is used to control the sequence
@@ -172,6 +182,23 @@ peekRunQueue (Capability *cap)
 
 void promoteInRunQueue (Capability *cap, StgTSO *tso);
 
+/* Make sure tso is not sitting in our stealable_threads deque before we
+ * inspect tso->cap: if we find tso->cap == cap afterwards, the thread
+ * stays ours until we release the Capability.
+ * See Note [Thread stealing] in Schedule.c.
+ * ASSUMES: cap->running_task is the current task.
+ */
+INLINE_HEADER void
+settleStealableThread (Capability *cap USED_IF_THREADS,
+                       StgTSO *tso USED_IF_THREADS)
+{
+#if defined(THREADED_RTS)
+    if (ACQUIRE_LOAD(&tso->flags) & TSO_STEALABLE) {
+        settleStealableThread_(cap, tso);
+    }
+#endif
+}
+
 INLINE_HEADER bool
 emptyRunQueue(Capability *cap)
 {
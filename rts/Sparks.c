@@ -18,6 +18,8 @@
 #include "sm/NonMovingMark.h"
 #include "rts/storage/HeapAlloc.h"
 
+#include <string.h>
+
 #if defined(THREADED_RTS)
 
 SparkPool *
@@ -51,6 +53,83 @@ createSparkThread (Capability *cap)
     appendToRunQueue(cap,tso);
 }
 
+/* Note [Spark throttling]
+   ~~~~~~~~~~~~~~~~~~~~~~~~
+   A program which sparks much more than it can use, such as a parallel
+   strategy applied to a long list of cheap elements, fills the spark pools
+   with sparks which the main computation evaluates before any idle
+   capability gets to them. They fizzle, or become garbage, and are only
+   removed by pruneSparkQueue at the next GC; until then they keep their
+   thunks alive and cost the GC time to traverse.
+
+   So each capability keeps track of what happens to the sparks of its own
+   pool, in cap->spark_throttle: how many were converted (run by findSpark,
+   on this capability or a thief) and how many were wasted (found fizzled by
+   findSpark, or fizzled or GC'd in pruneSparkQueue). Note that these are
+   attributed to the pool the spark was made in, unlike the converted and
+   fizzled counts of spark_stats which go to the capability which took the
+   spark.
+
+   Every SPARK_THROTTLE_INTERVAL sparks, newSpark folds the outcomes since the
+   last update into a moving average of the fraction of sparks converted,
+   provided there were at least SPARK_THROTTLE_MIN_OUTCOMES of them (after a
+   burst of sparks most outcomes are only known at the next GC). With
+   +RTS --spark-throttle[=<fraction>], when the average is below the given
+   fraction the capability is throttled: newSpark drops all but one in
+   SPARK_THROTTLE_PROBE new sparks, as if the pool were full. The sparks it
+   still keeps measure the conversion ratio, so the capability is released
+   once sparks become useful again.
+
+   Dropped sparks count as overflowed in spark_stats and post the same
+   events, since from the point of view of the program it is as if the pool
+   were full; they are also counted in spark_throttle.dropped. The ratio,
+   whether the capability is throttled and the number of sparks dropped are
+   posted in an EVENT_SPARK_THROTTLE on every update (with the sampled spark
+   events, +RTS -lp), and can be read with getCapabilitySparkPoolStats.
+*/
+
+#define SPARK_THROTTLE_INTERVAL     256
+#define SPARK_THROTTLE_MIN_OUTCOMES 64
+#define SPARK_THROTTLE_PROBE        8
+
+void
+initSparkThrottle (SparkThrottle *t)
+{
+    t->converted      = 0;
+    t->wasted         = 0;
+    t->last_converted = 0;
+    t->last_wasted    = 0;
+    t->ratio          = 1000;
+    t->countdown      = SPARK_THROTTLE_INTERVAL;
+    t->dropped        = 0;
+    t->throttled      = false;
+}
+
+static void
+updateSparkThrottle (Capability *cap)
+{
+    SparkThrottle *t = &cap->spark_throttle;
+    const StgWord converted = RELAXED_LOAD(&t->converted);
+    const StgWord wasted = RELAXED_LOAD(&t->wasted);
+    const StgWord new_converted = converted - t->last_converted;
+    const StgWord outcomes = new_converted + (wasted - t->last_wasted);
+
+    t->countdown = SPARK_THROTTLE_INTERVAL;
+    if (outcomes < SPARK_THROTTLE_MIN_OUTCOMES) {
+        return;
+    }
+    t->last_converted = converted;
+    t->last_wasted = wasted;
+    t->ratio = (3 * t->ratio + new_converted * 1000 / outcomes) / 4;
+    t->throttled = RtsFlags.ParFlags.sparkThrottle > 0 &&
+        t->ratio < RtsFlags.ParFlags.sparkThrottle * 1000;
+
+    debugTrace(DEBUG_sparks,
+               "cap %d: spark conversion %" FMT_Word "/1000%s",
+               cap->no, t->ratio, t->throttled ? ", throttled" : "");
+    traceSparkThrottle(cap, t->ratio, t->throttled, t->dropped);
+}
+
 /* --------------------------------------------------------------------------
  * newSpark: create a new spark, as a result of calling "par"
  * Called directly from STG.
@@ -61,9 +140,18 @@ newSpark (StgRegTable *reg, StgClosure *p)
 {
     Capability *cap = regTableToCapability(reg);
     SparkPool *pool = cap->sparks;
+    SparkThrottle *t = &cap->spark_throttle;
 
     if (!fizzledSpark(p)) {
-        if (pushWSDeque(pool,p)) {
+        if (--t->countdown == 0) {
+            updateSparkThrottle(cap);
+        }
+        if (t->throttled && t->countdown % SPARK_THROTTLE_PROBE != 0) {
+            /* dropped, see Note [Spark throttling] */
+            t->dropped++;
+            cap->spark_stats.overflowed++;
+            traceEventSparkOverflow(cap);
+        } else if (pushWSDeque(pool,p)) {
             cap->spark_stats.created++;
             traceEventSparkCreate(cap);
         } else {
@@ -124,6 +212,7 @@ pruneSparkQueue (bool nonmovingMarkFinished, Capability *cap)
     const StgInfoTable *info;
 
     pruned_sparks = 0;
+    const StgWord wasted = cap->spark_stats.fizzled + cap->spark_stats.gcd;
 
     pool = cap->sparks;
 
@@ -285,6 +374,10 @@ pruneSparkQueue (bool nonmovingMarkFinished, Capability *cap)
     pool->bottom = (oldBotInd <= botInd) ? botInd : (botInd + pool->size);
     // first free place we did not use (corrected by wraparound)
 
+    // No thief can update this during GC. See Note [Spark throttling].
+    cap->spark_throttle.wasted +=
+        cap->spark_stats.fizzled + cap->spark_stats.gcd - wasted;
+
     debugTrace(DEBUG_sparks, "pruned %d sparks", pruned_sparks);
 
     debugTrace(DEBUG_sparks,
@@ -326,6 +419,21 @@ traverseSparkQueue (evac_fn evac, void *user, Capability *cap)
                sparkPoolSize(pool), pool->bottom, pool->top);
 }
 
+void
+getCapabilitySparkPoolStats (uint32_t cap_no, SparkPoolStats *s)
+{
+    if (cap_no >= getNumCapabilities()) {
+        memset(s, 0, sizeof(*s));
+        return;
+    }
+    const SparkThrottle *t = &getCapability(cap_no)->spark_throttle;
+    s->converted = RELAXED_LOAD(&t->converted);
+    s->wasted    = RELAXED_LOAD(&t->wasted);
+    s->ratio     = t->ratio;
+    s->throttled = t->throttled;
+    s->dropped   = t->dropped;
+}
+
 #else
 
 StgInt
@@ -335,4 +443,10 @@ newSpark (StgRegTable *reg STG_UNUSED, StgClosure *p STG_UNUSED)
     return 1;
 }
 
+void
+getCapabilitySparkPoolStats (uint32_t cap_no STG_UNUSED, SparkPoolStats *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
 #endif /* THREADED_RTS */
@@ -24,6 +24,39 @@ typedef struct {
     StgWord fizzled;
 } SparkCounters;
 
+/* The fraction of sparks converted below which +RTS --spark-throttle drops
+ * new sparks, if no fraction is given.
+ */
+#define SPARK_THROTTLE_DEFAULT 0.2
+
+/* The recent fate of the sparks of one spark pool, for throttling. See
+ * Note [Spark throttling] in Sparks.c.
+ */
+typedef struct {
+    /* Sparks of this pool which were run, and which fizzled or were GC'd.
+     * Other capabilities update these when they steal from the pool, so they
+     * are updated with atomic_inc.
+     */
+    StgWord converted;
+    StgWord wasted;
+
+    /* converted and wasted at the last update of ratio */
+    StgWord last_converted;
+    StgWord last_wasted;
+
+    /* Moving average of the fraction of the sparks converted, per mille */
+    StgWord ratio;
+
+    /* New sparks until the next update of ratio */
+    StgWord countdown;
+
+    /* Sparks dropped by newSpark because the ratio was too low */
+    StgWord dropped;
+
+    /* Whether newSpark is dropping sparks */
+    bool throttled;
+} SparkThrottle;
+
 #if defined(THREADED_RTS)
 
 typedef WSDeque SparkPool;
@@ -46,6 +79,7 @@ void         freeSparkPool     (SparkPool *pool);
 void         createSparkThread (Capability *cap);
 void         traverseSparkQueue(evac_fn evac, void *user, Capability *cap);
 void         pruneSparkQueue   (bool nonmovingMarkFinished, Capability *cap);
+void         initSparkThrottle (SparkThrottle *t);
 
 INLINE_HEADER void discardSparks  (SparkPool *pool);
 INLINE_HEADER long sparkPoolSize  (SparkPool *pool);
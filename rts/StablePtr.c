@@ -16,6 +16,8 @@
 #include "RtsUtils.h"
 #include "Trace.h"
 #include "StablePtr.h"
+#include "Capability.h"
+#include "Task.h"
 
 #include <string.h>
 
@@ -98,16 +100,78 @@
  */
 
 
+/* Note [Sharded stable pointer free lists]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Programs which make heavy use of the FFI can create and free millions of
+ * stable pointers per second, on every capability. So that they don't all
+ * contend for one lock, the free entries of the table are spread over
+ * SPT_N_SHARDS free lists, each with its own lock, besides the global free
+ * list protected by stable_ptr_mutex:
+ *
+ *  - getStablePtr and freeStablePtr use the shard of the capability of the
+ *    calling Task (shard 0 for threads which have never had one), and only
+ *    take that shard's lock. A stable pointer freed on another capability
+ *    than the one which created it simply moves to the other shard.
+ *
+ *  - An empty shard takes SPT_BATCH entries from the global free list, and a
+ *    shard which has collected more than 2 * SPT_BATCH free entries gives
+ *    SPT_BATCH of them back, so that no shard hoards free entries.
+ *
+ *  - Only when the global free list is empty as well do we take all of the
+ *    locks, gather the free entries of every shard, and enlarge the table if
+ *    there still are none. The free lists are linked through the table, so
+ *    the table may only be copied when they are all empty.
+ *
+ * stablePtrLock takes the lock of every shard, in order, and then
+ * stable_ptr_mutex. Code holding a shard lock may take stable_ptr_mutex but
+ * never another shard lock. The GC and hs_lock_stable_ptr_table thus still
+ * exclude every other user of the table, and freeStablePtrUnsafe, which runs
+ * with all of the locks held, returns entries to the global free list.
+ *
+ * Stable pointers remain indices into a single table, since deRefStablePtr
+ * is inlined into foreign code and into deRefStablePtr#, and it still never
+ * takes a lock.
+ *
+ * For the GC the table is divided into regions of SPT_REGION_SIZE entries,
+ * and we count the entries in use in each region (atomically, since the
+ * shards update the counts concurrently). markStablePtrTable and
+ * threadStablePtrTable skip the regions with no entries in use, which after
+ * a burst of stable pointers has been freed is most of the table.
+ */
+
 // the global stable pointer entry table
 spEntry *stable_ptr_table = NULL;
 
-// the next free stable ptr, the free entries form a linked list where spEntry.addr points to the next after
+// the next free stable ptr on the global free list, the free entries form a
+// linked list where spEntry.addr points to the next after
 static spEntry *stable_ptr_free = NULL;
 
 // current stable pointer table size
 static unsigned int SPT_size = 0;
 #define INIT_SPT_SIZE 64
 
+// See Note [Sharded stable pointer free lists]
+#if defined(THREADED_RTS)
+#define SPT_N_SHARDS 64
+#else
+#define SPT_N_SHARDS 1
+#endif
+#define SPT_BATCH 64
+
+typedef struct ATTRIBUTE_ALIGNED(CACHELINE_SIZE) {
+#if defined(THREADED_RTS)
+    Mutex lock;
+#endif
+    spEntry *free;        // linked like stable_ptr_free
+    uint32_t n_free;
+} spShard;
+
+static spShard sp_shards[SPT_N_SHARDS];
+
+// the number of entries in use in each region of the table
+#define SPT_REGION_SIZE INIT_SPT_SIZE
+static StgWord *spt_region_used = NULL;
+
 /* Each time the stable pointer table is enlarged, we temporarily retain the old
  * version to ensure dereferences are thread-safe (see Note [Enlarging the
  * stable pointer table]).  Since we double the size of the table each time, we
@@ -127,7 +191,7 @@ static spEntry *old_SPTs[MAX_N_OLD_SPTS];
 static uint32_t n_old_SPTs = 0;
 
 #if defined(THREADED_RTS)
-Mutex stable_ptr_mutex;
+static Mutex stable_ptr_mutex;
 #endif
 
 static void enlargeStablePtrTable(void);
@@ -141,6 +205,11 @@ void
 stablePtrLock(void)
 {
     initStablePtrTable();
+#if defined(THREADED_RTS)
+    for (uint32_t i = 0; i < SPT_N_SHARDS; i++) {
+        ACQUIRE_LOCK(&sp_shards[i].lock);
+    }
+#endif
     ACQUIRE_LOCK(&stable_ptr_mutex);
 }
 
@@ -148,6 +217,23 @@ void
 stablePtrUnlock(void)
 {
     RELEASE_LOCK(&stable_ptr_mutex);
+#if defined(THREADED_RTS)
+    for (uint32_t i = SPT_N_SHARDS; i > 0; i--) {
+        RELEASE_LOCK(&sp_shards[i-1].lock);
+    }
+#endif
+}
+
+// Also used by forkProcess() in the child, where the locks are all held.
+void
+initStablePtrLocks(void)
+{
+#if defined(THREADED_RTS)
+    for (uint32_t i = 0; i < SPT_N_SHARDS; i++) {
+        initMutex(&sp_shards[i].lock);
+    }
+    initMutex(&stable_ptr_mutex);
+#endif
 }
 
 /* -----------------------------------------------------------------------------
@@ -174,21 +260,27 @@ initStablePtrTable(void)
     stable_ptr_table = stgMallocBytes(SPT_size * sizeof(spEntry),
                                       "initStablePtrTable");
     initSpEntryFreeList(stable_ptr_table,INIT_SPT_SIZE);
+    spt_region_used = stgCallocBytes(SPT_size / SPT_REGION_SIZE,
+                                     sizeof(StgWord), "initStablePtrTable");
 
-#if defined(THREADED_RTS)
-    initMutex(&stable_ptr_mutex);
-#endif
+    for (uint32_t i = 0; i < SPT_N_SHARDS; i++) {
+        sp_shards[i].free = NULL;
+        sp_shards[i].n_free = 0;
+    }
+    initStablePtrLocks();
 }
 
 /* -----------------------------------------------------------------------------
  * Enlarging the table
  * -------------------------------------------------------------------------- */
 
-// Must be holding stable_ptr_mutex
+// Must be holding all of the locks (stablePtrLock), with all of the free lists
+// empty
 static void
 enlargeStablePtrTable(void)
 {
     ASSERT_LOCK_HELD(&stable_ptr_mutex);
+    ASSERT(stable_ptr_free == NULL);
 
     uint32_t old_SPT_size = SPT_size;
     spEntry *new_stable_ptr_table;
@@ -215,6 +307,14 @@ enlargeStablePtrTable(void)
      */
     RELEASE_STORE(&stable_ptr_table, new_stable_ptr_table);
 
+    // nobody else can be counting entries while we hold the locks
+    spt_region_used =
+        stgReallocBytes(spt_region_used,
+                        SPT_size / SPT_REGION_SIZE * sizeof(StgWord),
+                        "enlargeStablePtrTable");
+    memset(spt_region_used + old_SPT_size / SPT_REGION_SIZE, 0,
+           old_SPT_size / SPT_REGION_SIZE * sizeof(StgWord));
+
     // add the new entries to the free list
     initSpEntryFreeList(stable_ptr_table + old_SPT_size, old_SPT_size);
 }
@@ -234,6 +334,80 @@ enlargeStablePtrTable(void)
  * than that required to hold the current version.
  */
 
+/* -----------------------------------------------------------------------------
+ * The free lists of the shards
+ * -------------------------------------------------------------------------- */
+
+STATIC_INLINE spShard *
+mySpShard(void)
+{
+#if defined(THREADED_RTS)
+    Task *task = myTask();
+    if (task != NULL && task->cap != NULL) {
+        return &sp_shards[task->cap->no % SPT_N_SHARDS];
+    }
+#endif
+    return &sp_shards[0];
+}
+
+// Must be holding the lock of the shard. Takes up to SPT_BATCH entries from
+// the global free list, returning false if there were none.
+static bool
+refillSpShard(spShard *shard)
+{
+    uint32_t n = 0;
+
+    ACQUIRE_LOCK(&stable_ptr_mutex);
+    while (stable_ptr_free != NULL && n < SPT_BATCH) {
+        spEntry *p = stable_ptr_free;
+        stable_ptr_free = (spEntry *)p->addr;
+        RELAXED_STORE(&p->addr, (P_)shard->free);
+        shard->free = p;
+        n++;
+    }
+    RELEASE_LOCK(&stable_ptr_mutex);
+
+    shard->n_free += n;
+    return n > 0;
+}
+
+// Must be holding the lock of the shard. Gives SPT_BATCH entries back to the
+// global free list.
+static void
+spillSpShard(spShard *shard)
+{
+    ASSERT(shard->n_free >= SPT_BATCH);
+
+    ACQUIRE_LOCK(&stable_ptr_mutex);
+    for (uint32_t n = 0; n < SPT_BATCH; n++) {
+        spEntry *p = shard->free;
+        shard->free = (spEntry *)p->addr;
+        RELAXED_STORE(&p->addr, (P_)stable_ptr_free);
+        stable_ptr_free = p;
+    }
+    RELEASE_LOCK(&stable_ptr_mutex);
+
+    shard->n_free -= SPT_BATCH;
+}
+
+// Must be holding all of the locks. Moves the free entries of every shard to
+// the global free list.
+static void
+gatherSpShards(void)
+{
+    ASSERT_LOCK_HELD(&stable_ptr_mutex);
+
+    for (uint32_t i = 0; i < SPT_N_SHARDS; i++) {
+        spShard *shard = &sp_shards[i];
+        while (shard->free != NULL) {
+            spEntry *p = shard->free;
+            shard->free = (spEntry *)p->addr;
+            RELAXED_STORE(&p->addr, (P_)stable_ptr_free);
+            stable_ptr_free = p;
+        }
+        shard->n_free = 0;
+    }
+}
 
 /* -----------------------------------------------------------------------------
  * Freeing entries and tables
@@ -259,9 +433,16 @@ exitStablePtrTable(void)
     stable_ptr_table = NULL;
     SPT_size = 0;
 
+    if (spt_region_used)
+        stgFree(spt_region_used);
+    spt_region_used = NULL;
+
     freeOldSPTs();
 
 #if defined(THREADED_RTS)
+    for (uint32_t i = 0; i < SPT_N_SHARDS; i++) {
+        closeMutex(&sp_shards[i].lock);
+    }
     closeMutex(&stable_ptr_mutex);
 #endif
 }
@@ -287,17 +468,34 @@ freeStablePtrUnsafe(StgStablePtr sp)
 
     ASSERT(spw < SPT_size);
 
+    atomic_dec(&spt_region_used[spw / SPT_REGION_SIZE], 1);
     freeSpEntry(&stable_ptr_table[spw]);
 }
 
 void
 freeStablePtr(StgStablePtr sp)
 {
-    stablePtrLock();
+    // see Note [NULL StgStablePtr]
+    if (sp == NULL) {
+        return;
+    }
+
+    StgWord spw = (StgWord)sp - 1;
+    spShard *shard = mySpShard();
+
+    ACQUIRE_LOCK(&shard->lock);
+
+    ASSERT(spw < SPT_size);
 
-    freeStablePtrUnsafe(sp);
+    atomic_dec(&spt_region_used[spw / SPT_REGION_SIZE], 1);
+    spEntry *entry = &stable_ptr_table[spw];
+    RELAXED_STORE(&entry->addr, (P_)shard->free);
+    shard->free = entry;
+    if (++shard->n_free > 2 * SPT_BATCH) {
+        spillSpShard(shard);
+    }
 
-    stablePtrUnlock();
+    RELEASE_LOCK(&shard->lock);
 }
 
 /* -----------------------------------------------------------------------------
@@ -307,21 +505,40 @@ freeStablePtr(StgStablePtr sp)
 StgStablePtr
 getStablePtr(StgPtr p)
 {
-  stablePtrLock();
-
-  if (!stable_ptr_free)
-      enlargeStablePtrTable();
+  initStablePtrTable();
+
+  spShard *shard = mySpShard();
+
+  ACQUIRE_LOCK(&shard->lock);
+
+  while (shard->free == NULL && !refillSpShard(shard)) {
+      // The global free list is empty as well: take every lock, then gather
+      // the free entries of the other shards or enlarge the table.
+      RELEASE_LOCK(&shard->lock);
+      stablePtrLock();
+      if (stable_ptr_free == NULL) {
+          gatherSpShards();
+          if (stable_ptr_free == NULL) {
+              enlargeStablePtrTable();
+          }
+      }
+      stablePtrUnlock();
+      ACQUIRE_LOCK(&shard->lock);
+  }
 
   // find the index of free stable ptr
-  StgWord sp = stable_ptr_free - stable_ptr_table;
+  StgWord sp = shard->free - stable_ptr_table;
 
   // unlink the table entry we grabbed from the free list
-  stable_ptr_free = (spEntry*)(stable_ptr_free->addr);
+  shard->free = (spEntry*)(shard->free->addr);
+  shard->n_free--;
 
   // release store to pair with acquire load in deRefStablePtr
   RELEASE_STORE(&stable_ptr_table[sp].addr, p);
 
-  stablePtrUnlock();
+  atomic_inc(&spt_region_used[sp / SPT_REGION_SIZE], 1);
+
+  RELEASE_LOCK(&shard->lock);
 
   // see Note [NULL StgStablePtr]
   sp = sp + 1;
@@ -336,13 +553,21 @@ getStablePtr(StgPtr p)
     do {                                                                \
         spEntry *p;                                                     \
         spEntry *__end_ptr = &stable_ptr_table[SPT_size];               \
-        for (p = stable_ptr_table; p < __end_ptr; p++) {                \
-            /* Internal pointers are free slots. NULL is last in free */ \
-            /* list. */                                                 \
-            if (p->addr &&                                              \
-                (p->addr < (P_)stable_ptr_table || p->addr >= (P_)__end_ptr)) \
-            {                                                           \
-                do { CODE } while(0);                                   \
+        for (uint32_t __r = 0; __r < SPT_size / SPT_REGION_SIZE; __r++) { \
+            /* Skip the regions with no entries in use */              \
+            if (spt_region_used[__r] == 0) continue;                    \
+            spEntry *__region_end =                                     \
+                &stable_ptr_table[(__r + 1) * SPT_REGION_SIZE];         \
+            for (p = &stable_ptr_table[__r * SPT_REGION_SIZE];          \
+                 p < __region_end; p++) {                               \
+                /* Internal pointers are free slots. NULL is last in */ \
+                /* free list. */                                        \
+                if (p->addr &&                                          \
+                    (p->addr < (P_)stable_ptr_table ||                  \
+                     p->addr >= (P_)__end_ptr))                         \
+                {                                                       \
+                    do { CODE } while(0);                               \
+                }                                                       \
             }                                                           \
         }                                                               \
     } while(0)
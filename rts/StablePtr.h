@@ -38,9 +38,7 @@ void    threadStablePtrTable  ( evac_fn evac, void *user );
 void    stablePtrLock         ( void );
 void    stablePtrUnlock       ( void );
 
-#if defined(THREADED_RTS)
 // needed by Schedule.c:forkProcess()
-extern Mutex stable_ptr_mutex;
-#endif
+void    initStablePtrLocks    ( void );
 
 #include "EndPrivate.h"
@@ -45,7 +45,8 @@ void hs_spt_insert_stableptr(StgWord64 key[2], StgStablePtr *entry) {
   }
 
   ACQUIRE_LOCK(&spt_lock);
-  insertHashTable_(spt, (StgWord)key, entry, hashFingerprint);
+  insertHashTable_(spt, (StgWord)key, entry, hashFingerprint,
+                   compareFingerprint);
   RELEASE_LOCK(&spt_lock);
 }
 
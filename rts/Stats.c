@@ -21,6 +21,7 @@
 
 // for spin/yield counters
 #include "sm/GC.h"
+#include "sm/GCTuning.h"
 #include "ThreadPaused.h"
 #include "Messages.h"
 
@@ -69,6 +70,10 @@ static Time *GC_coll_cpu = NULL;
 static Time *GC_coll_elapsed = NULL;
 static Time *GC_coll_max_pause = NULL;
 
+// See Note [NUMA-local evacuation] in sm/GCUtils.c
+static StgWord64 numa_copied_bytes[MAX_NUMA_NODES];
+static StgWord64 numa_remote_steals = 0;
+
 static int statsPrintf( char *s, ... ) STG_PRINTF_ATTR(1, 2);
 static void statsFlush( void );
 static void statsClose( void );
@@ -140,6 +145,9 @@ initStats0(void)
 
     GC_end_faults = 0;
 
+    memset(numa_copied_bytes, 0, sizeof(numa_copied_bytes));
+    numa_remote_steals = 0;
+
     stats = (RTSStats) {
         .gcs = 0,
         .major_gcs = 0,
@@ -554,6 +562,19 @@ stat_endGC (Capability *cap, gc_thread *initiating_gct, W_ live, W_ copied, W_ s
         stats.scav_find_work += scav_find_work;
         stats.max_n_todo_overflow += stg_max(max_n_todo_overflow, stats.max_n_todo_overflow);
     }
+    if (n_numa_nodes > 1) {
+        // Idle GC threads keep their counters, so we look at all of them and
+        // reset what we have added.
+        for (uint32_t i = 0; i < getNumCapabilities(); i++) {
+            gc_thread *gct = gc_threads[i];
+            for (uint32_t node = 0; node < n_numa_nodes; node++) {
+                numa_copied_bytes[node] += gct->numa_copied[node] * sizeof(W_);
+                gct->numa_copied[node] = 0;
+            }
+            numa_remote_steals += gct->numa_remote_steals;
+            gct->numa_remote_steals = 0;
+        }
+    }
     stats.gc_cpu_ns += stats.gc.cpu_ns;
     stats.gc_elapsed_ns += stats.gc.elapsed_ns;
     stats.gc_sync_elapsed_ns += stats.gc.sync_elapsed_ns;
@@ -891,6 +912,14 @@ static void report_summary(const RTSSummaryStats* sum)
 
     statsPrintf("\n");
 
+    if (gc_tuning) {
+        // See Note [Adaptive GC sizing]
+        showStgWord64((StgWord64)gcTunedNurseryBlocks() * BLOCK_SIZE
+                      / getNumCapabilities(), temp, true/*commas*/);
+        statsPrintf("  Adaptive GC sizing: -A%s bytes, "
+                    "-F%.2f\n\n", temp, RtsFlags.GcFlags.oldGenFactor);
+    }
+
 #if defined(THREADED_RTS)
     if (RtsFlags.ParFlags.parGcEnabled && sum->work_balance > 0) {
         // See Note [Work Balance]
@@ -899,6 +928,16 @@ static void report_summary(const RTSSummaryStats* sum)
                     sum->work_balance * 100);
     }
 
+    if (n_numa_nodes > 1) {
+        for (uint32_t node = 0; node < n_numa_nodes; node++) {
+            showStgWord64(numa_copied_bytes[node], temp, true/*commas*/);
+            statsPrintf("  NUMA node %d: %16s bytes copied by GC threads "
+                        "on other nodes\n", node, temp);
+        }
+        statsPrintf("  NUMA remote steals: %" FMT_Word64 " blocks\n\n",
+                    numa_remote_steals);
+    }
+
     statsPrintf("  TASKS: %d "
                 "(%d bound, %d peak workers (%d total), using -N%d)\n\n",
                 taskCount, sum->bound_task_count,
@@ -26,6 +26,7 @@
 #include "sm/Sanity.h"
 #include "sm/Storage.h"
 #include "AllocArray.h"
+#include "GetTime.h"
 
 #include <string.h>
 
@@ -113,6 +114,8 @@ createThread(Capability *cap, W_ size)
     tso->tot_stack_size = stack->stack_size;
 
     ASSIGN_Int64((W_*)&(tso->alloc_limit), 0);
+    ASSIGN_Word64((W_*)&(tso->acct_allocated), 0);
+    ASSIGN_Word64((W_*)&(tso->acct_cpu_time), 0);
 
     tso->ctoi_tuple_spill_words = 0;
 
@@ -202,6 +205,80 @@ void rts_disableThreadAllocationLimit(StgPtr tso)
     ((StgTSO *)tso)->flags &= ~TSO_ALLOC_LIMIT;
 }
 
+/* ---------------------------------------------------------------------------
+ * Per-thread accounting
+ *
+ * Note [Thread accounting]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~
+ * With +RTS --thread-accounting the scheduler keeps two counters in each
+ * TSO: the number of bytes the thread has allocated (acct_allocated) and
+ * the CPU time it has used (acct_cpu_time). They are updated at the end of
+ * every run slice by accountThreadSliceEnd, and are therefore cheap enough
+ * to leave enabled in production: a slice costs two reads of the OS thread's
+ * CPU clock and a few arithmetic operations, regardless of how much work is
+ * done in it.
+ *
+ *  - Allocation is derived from alloc_limit, which compiled code and
+ *    allocate() decrement for every allocation whether or not an allocation
+ *    limit is enabled. If the thread changes its own allocation counter
+ *    (setAllocationCounter) during the slice, the difference for that slice
+ *    is meaningless; we drop it if it is negative.
+ *
+ *  - CPU time is the CPU time of the OS thread running the slice. This
+ *    includes safe foreign calls made by the thread (during which the OS
+ *    thread runs nothing else), but not the time the thread spends blocked
+ *    or waiting for a capability, nor time spent in the garbage collector.
+ *
+ * The counters can be read with rts_getThreadAllocated and
+ * rts_getThreadCPUTime, and are posted to the eventlog (with -ls) as
+ * THREAD_ACCOUNTING events when a thread finishes and, for every live
+ * thread, after each major GC. Counters of a running thread lag behind by
+ * at most one slice.
+ * ------------------------------------------------------------------------ */
+
+StgWord64 rts_getThreadAllocated(StgPtr tso)
+{
+    return PK_Word64((W_*)&(((StgTSO *)tso)->acct_allocated));
+}
+
+StgWord64 rts_getThreadCPUTime(StgPtr tso)
+{
+    return TimeToNS(PK_Word64((W_*)&(((StgTSO *)tso)->acct_cpu_time)));
+}
+
+void accountThreadSliceBegin(StgTSO *tso, ThreadSlice *slice)
+{
+    slice->alloc_limit = PK_Int64((W_*)&(tso->alloc_limit));
+    slice->cpu_time = getCurrentThreadCPUTime();
+}
+
+void accountThreadSliceEnd(StgTSO *tso, const ThreadSlice *slice)
+{
+    const StgInt64 allocated =
+        slice->alloc_limit - PK_Int64((W_*)&(tso->alloc_limit));
+    if (allocated > 0) {
+        ASSIGN_Word64((W_*)&(tso->acct_allocated),
+                      PK_Word64((W_*)&(tso->acct_allocated)) + allocated);
+    }
+
+    const Time cpu_time = getCurrentThreadCPUTime() - slice->cpu_time;
+    if (cpu_time > 0) {
+        ASSIGN_Word64((W_*)&(tso->acct_cpu_time),
+                      PK_Word64((W_*)&(tso->acct_cpu_time)) + cpu_time);
+    }
+}
+
+// Post the counters of every thread to the eventlog. The caller must own all
+// capabilities (e.g. after a GC).
+void traceAllThreadAccounting(Capability *cap)
+{
+    for (uint32_t g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        for (StgTSO *t = generations[g].threads; t != END_TSO_QUEUE; t = t->global_link) {
+            traceThreadAccounting(cap, t);
+        }
+    }
+}
+
 /* -----------------------------------------------------------------------------
    Remove a thread from a queue.
    Fails fatally if the TSO is not on the queue.
@@ -277,6 +354,7 @@ tryWakeupThread (Capability *cap, StgTSO *tso)
     traceEventThreadWakeup (cap, tso, tso->cap->no);
 
 #if defined(THREADED_RTS)
+    settleStealableThread(cap, tso);
     Capability *tso_owner = RELAXED_LOAD(&tso->cap);
     if (tso_owner != cap)
     {
@@ -41,6 +41,16 @@ bool removeThreadFromDeQueue   (Capability *cap, StgTSO **head, StgTSO **tail, S
 
 StgBool isThreadBound (StgTSO* tso);
 
+// Per-thread accounting. See Note [Thread accounting] in Threads.c.
+typedef struct {
+    StgInt64 alloc_limit; // tso->alloc_limit at the start of the slice
+    Time     cpu_time;    // CPU time of the OS thread at the start of the slice
+} ThreadSlice;
+
+void accountThreadSliceBegin  (StgTSO *tso, ThreadSlice *slice);
+void accountThreadSliceEnd    (StgTSO *tso, const ThreadSlice *slice);
+void traceAllThreadAccounting (Capability *cap);
+
 // Overflow/underflow
 void threadStackOverflow  (Capability *cap, StgTSO *tso);
 W_   threadStackUnderflow (Capability *cap, StgTSO *tso);
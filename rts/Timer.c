@@ -11,7 +11,8 @@
  *
  * This file defines the platform-independent view of interval timing, relying
  * on platform-specific services to install and run the timers. See
- * posix/Ticker.c and win32/Ticker.c for the platform specific parts.
+ * posix/Ticker.c and win32/Ticker.c for the platform specific parts. It also
+ * runs the timer worker thread, see Note [Timer worker].
  *
  * If you are looking for Itimer.c then you either file or one of the
  * platform-specific Ticker.c files.
@@ -27,13 +28,62 @@
 #include "Capability.h"
 #include "RtsSignals.h"
 #include "rts/EventLogWriter.h"
+#include "eventlog/EventLog.h"
+#include "GetTime.h"
 
 /* ticks left before next pre-emptive context switch */
 static int ticks_to_ctxt_switch = 0;
 
-#if defined(THREADED_RTS)
-/* ticks left before next next forced eventlog flush */
-static int ticks_to_eventlog_flush = 0;
+/*
+ Note [Timer worker]
+ ~~~~~~~~~~~~~~~~~~~
+ The ticker calls handle_tick on every tick, and everything it does delays
+ the next tick and hence the next context switch of every capability. So
+ handle_tick only does what is cheap: counting down to context switches and
+ idle GCs, and setting flags. The rest is done by the timer worker, a
+ separate OS thread which sleeps on worker_cond:
+
+  - The profiling work of a tick (handleProfTick: cost-centre samples,
+    heap profile and ticky requests, stack sample requests) can post events,
+    and posting an event into a full buffer writes it out. handle_tick just
+    counts the tick in worker_prof_ticks and signals the worker, which then
+    calls handleProfTick once per tick counted. Samples are taken a little
+    after the tick, but none are lost if the worker falls behind.
+
+  - Periodic eventlog flushing (--eventlog-flush-interval) has to stop every
+    capability and then write the buffers out, which may take arbitrarily
+    long. The worker does it on its own schedule, every eventlogFlushTime,
+    independent of the ticks: it carries on while the ticker is paused, and
+    works with -V0.
+
+  - In the threaded RTS, reposting the init events when the eventlog writer
+    asks for it (see Note [Eventlog socket writer]). handle_tick notices the
+    request and wakes the worker.
+
+ The worker is only started if one of these can happen: there is profiling
+ work to do, a flush interval is set, or (in the threaded RTS) the eventlog
+ goes to a socket. worker_lock protects the worker_* variables.
+
+ hs_exit stops the worker with exitTimerWorker before it shuts down the
+ scheduler, since flushing the eventlog stops all capabilities and posting
+ events needs them to still be there. The ticker keeps running until
+ exitTimer, but without a worker handle_tick has nothing to hand over.
+ forkProcess holds worker_lock over the fork, so that the child, which
+ starts its own worker, doesn't inherit it locked by a thread that is gone.
+*/
+
+#if defined(HAVE_PREEMPTION)
+static Mutex      worker_lock;
+static Condition  worker_cond;
+static OSThreadId worker_id;
+static bool       worker_started = false;
+static bool       worker_running;
+static bool       worker_exit;
+static bool       worker_wakeup;
+static uint32_t   worker_prof_ticks;
+
+/* Does handleProfTick have anything to do? */
+static bool       want_prof_ticks = false;
 #endif
 
 
@@ -98,7 +148,23 @@ static
 void
 handle_tick(int unused STG_UNUSED)
 {
-  handleProfTick(); // Bad or worse: see issue #27250.
+#if defined(HAVE_PREEMPTION)
+  // Hand the expensive work over to the timer worker. See Note [Timer worker].
+  bool repost = false;
+#if defined(THREADED_RTS)
+  repost = eventLogStatus() == EVENTLOG_RUNNING
+        && repostInitEventsRequested();
+#endif
+  if (RELAXED_LOAD_ALWAYS(&worker_started) && (want_prof_ticks || repost)) {
+      ACQUIRE_LOCK_ALWAYS(&worker_lock);
+      if (want_prof_ticks) {
+          worker_prof_ticks++;
+      }
+      worker_wakeup = true;
+      signalCondition(&worker_cond);
+      RELEASE_LOCK_ALWAYS(&worker_lock);
+  }
+#endif
 
   if (RtsFlags.ConcFlags.ctxtSwitchTicks > 0)
   {
@@ -108,16 +174,6 @@ handle_tick(int unused STG_UNUSED)
           contextSwitchAllCapabilities(); /* schedule a context switch */
       }
   }
-#if defined(THREADED_RTS)
-  if (eventLogStatus() == EVENTLOG_RUNNING
-      && RtsFlags.TraceFlags.eventlogFlushTicks > 0) {
-      ticks_to_eventlog_flush--;
-      if (ticks_to_eventlog_flush <= 0) {
-          ticks_to_eventlog_flush = RtsFlags.TraceFlags.eventlogFlushTicks;
-          flushEventLog(NULL);  // Bad or worse: see issue #27250.
-      }
-  }
-#endif
 
   /*
    * If we've been inactive for idleGCDelayTime (set by +RTS
@@ -167,10 +223,182 @@ handle_tick(int unused STG_UNUSED)
   }
 }
 
+#if defined(HAVE_PREEMPTION)
+/* How long the worker may sleep, or TIME_MAX if it may sleep until woken. */
+static Time
+worker_sleep_time(Time next_flush)
+{
+    if (next_flush == TIME_MAX) {
+        return TIME_MAX;
+    }
+    Time now = getProcessElapsedTime();
+    return next_flush > now ? next_flush - now : 0;
+}
+
+static void *
+timer_worker(void *unused STG_UNUSED)
+{
+    const Time flush_interval =
+#if defined(THREADED_RTS)
+        RtsFlags.TraceFlags.eventlogFlushTime;
+#else
+        0;
+#endif
+    Time next_flush = TIME_MAX;
+    if (flush_interval > 0) {
+        next_flush = getProcessElapsedTime() + flush_interval;
+    }
+
+    ACQUIRE_LOCK_ALWAYS(&worker_lock);
+    while (!worker_exit) {
+        if (worker_prof_ticks > 0 || worker_wakeup) {
+            uint32_t ticks = worker_prof_ticks;
+            worker_prof_ticks = 0;
+            worker_wakeup = false;
+            RELEASE_LOCK_ALWAYS(&worker_lock);
+            for (; ticks > 0; ticks--) {
+                handleProfTick();
+            }
+#if defined(THREADED_RTS)
+            if (eventLogStatus() == EVENTLOG_RUNNING) {
+                repostInitEventsIfRequested();
+            }
+#endif
+            ACQUIRE_LOCK_ALWAYS(&worker_lock);
+            continue;
+        }
+
+        Time sleep = worker_sleep_time(next_flush);
+        if (sleep == 0) {
+            // Keep to the schedule, unless we are so far behind that we
+            // would flush twice in a row.
+            next_flush += flush_interval;
+            Time now = getProcessElapsedTime();
+            if (next_flush <= now) {
+                next_flush = now + flush_interval;
+            }
+            RELEASE_LOCK_ALWAYS(&worker_lock);
+            if (eventLogStatus() == EVENTLOG_RUNNING) {
+                flushEventLog(NULL);
+            }
+            ACQUIRE_LOCK_ALWAYS(&worker_lock);
+        } else if (sleep == TIME_MAX) {
+            waitCondition(&worker_cond, &worker_lock);
+        } else {
+            timedWaitCondition(&worker_cond, &worker_lock, sleep);
+        }
+    }
+    worker_running = false;
+    broadcastCondition(&worker_cond);
+    RELEASE_LOCK_ALWAYS(&worker_lock);
+    return NULL;
+}
+
+/* Is there anything for the worker to do? See Note [Timer worker]. */
+static bool
+timerWorkerNeeded(void)
+{
+    if (want_prof_ticks) {
+        return true;
+    }
+#if defined(THREADED_RTS)
+    if (RtsFlags.TraceFlags.eventlogFlushTime > 0) {
+        return true;
+    }
+#if defined(TRACING) && !defined(mingw32_HOST_OS)
+    if (RtsFlags.TraceFlags.tracing == TRACE_EVENTLOG
+            && isEventLogSocketOutput(RtsFlags.TraceFlags.trace_output)) {
+        return true;
+    }
+#endif
+#endif
+    return false;
+}
+
+static void
+startTimerWorker(void)
+{
+    want_prof_ticks = RtsFlags.MiscFlags.tickInterval != 0 &&
+        (
+#if defined(PROFILING)
+         true ||
+#endif
+         RtsFlags.ProfFlags.doHeapProfile != NO_HEAP_PROFILING ||
+         RtsFlags.TraceFlags.ticky ||
+         RtsFlags.TraceFlags.stackSampleDepth > 0);
+    if (!timerWorkerNeeded()) {
+        RELAXED_STORE_ALWAYS(&worker_started, false);
+        return;
+    }
+
+    // After a fork the worker is gone and these are re-initialised.
+    initMutex(&worker_lock);
+    initCondition(&worker_cond);
+    worker_running    = true;
+    worker_exit       = false;
+    worker_wakeup     = false;
+    worker_prof_ticks = 0;
+    // Attached, so that exitTimerWorker can join it
+#if defined(mingw32_HOST_OS)
+    if (createOSThread(&worker_id, "ghc_timer_worker", timer_worker, NULL) != 0) {
+#else
+    if (createAttachedOSThread(&worker_id, "ghc_timer_worker",
+                               timer_worker, NULL) != 0) {
+#endif
+        barf("Timer: Failed to spawn worker thread: %s", strerror(errno));
+    }
+    RELAXED_STORE_ALWAYS(&worker_started, true);
+}
+#endif
+
+/* Synchronous: the worker doesn't touch the RTS after this returns. Called
+ * by hs_exit before exitScheduler, see Note [Timer worker]. */
+void
+exitTimerWorker(void)
+{
+#if defined(HAVE_PREEMPTION)
+    if (!RELAXED_LOAD_ALWAYS(&worker_started)) {
+        return;
+    }
+    ACQUIRE_LOCK_ALWAYS(&worker_lock);
+    worker_exit = true;
+    signalCondition(&worker_cond);
+    while (worker_running) {
+        waitCondition(&worker_cond, &worker_lock);
+    }
+    RELEASE_LOCK_ALWAYS(&worker_lock);
+    joinOSThread(worker_id);
+    RELAXED_STORE_ALWAYS(&worker_started, false);
+#endif
+}
+
+/* Hold worker_lock over a fork, see Note [Timer worker]. */
+void
+lockTimerWorkerForFork(void)
+{
+#if defined(HAVE_PREEMPTION)
+    if (RELAXED_LOAD_ALWAYS(&worker_started)) {
+        ACQUIRE_LOCK_ALWAYS(&worker_lock);
+    }
+#endif
+}
+
+/* In the parent; the child re-initialises worker_lock in initTimer. */
+void
+unlockTimerWorkerAfterFork(void)
+{
+#if defined(HAVE_PREEMPTION)
+    if (RELAXED_LOAD_ALWAYS(&worker_started)) {
+        RELEASE_LOCK_ALWAYS(&worker_lock);
+    }
+#endif
+}
+
 void initTimer(void)
 {
 #if defined(HAVE_PREEMPTION)
     initProfTimer();
+    startTimerWorker();
     if (RtsFlags.MiscFlags.tickInterval != 0) {
         initTicker(RtsFlags.MiscFlags.tickInterval, handle_tick);
     }
@@ -212,4 +440,5 @@ void exitTimer (void)
         exitTicker();
     }
 #endif
+    exitTimerWorker();
 }
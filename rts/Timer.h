@@ -12,6 +12,10 @@
 
 void initTimer(void);
 void exitTimer(void);
+void exitTimerWorker(void);
+
+void lockTimerWorkerForFork(void);
+void unlockTimerWorkerAfterFork(void);
 
 void pauseTimer(void);
 void unpauseTimer(void);
@@ -0,0 +1,298 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * A hierarchical timing wheel for timeouts. See TimerWheel.h for the
+ * interface.
+ *
+ * ---------------------------------------------------------------------------*/
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "TimerWheel.h"
+
+#include <string.h>
+
+/* Note [Timer wheel]
+   ~~~~~~~~~~~~~~~~~~
+   Time is divided into ticks of 2^TIMER_WHEEL_TICK_SHIFT ns, and a waketime
+   is rounded up to a tick. The wheel has TIMER_WHEEL_LEVELS levels of 64
+   slots, and w->now is the tick the wheel has been advanced to. A timeout
+   expiring at tick t is kept at the level of the most significant 6-bit digit
+   in which t differs from w->now (level 0 if they are in the same block of 64
+   ticks), in the slot given by the value of that digit of t. So
+
+    - level 0 holds the timeouts expiring in the current block of 64 ticks,
+      one slot per tick;
+    - level 1 holds those expiring in a later block of 64 ticks of the current
+      block of 64^2 ticks, one slot per block of 64 ticks;
+    - and so on.
+
+   Every timeout at level l expires before every timeout at level l+1, and
+   within a level the slots are in order of expiry (all the slots in use come
+   after the digit of w->now, since every timeout expires at or after w->now).
+   Hence the earliest timeouts are in the first slot in use of the lowest
+   level in use, which we find with a count-trailing-zeros of the bitmap of
+   the slots in use of each level.
+
+   Inserting a timeout is a matter of computing its slot and pushing it on the
+   slot's list, and deleting one of unlinking it (its level and slot are kept
+   in its rank field, which the leftist heap uses for something else). No
+   allocation is needed: the lists are linked through the a and b fields of
+   the timeouts themselves.
+
+   expireTimerWheel(w, now) advances w->now to the tick of now. While doing so
+   it takes every slot of level 0 it passes, and whenever it reaches the start
+   of a slot of a higher level, it moves that slot's timeouts to the lower
+   levels ("cascading"): they now agree with w->now in that digit. Empty
+   stretches of time are skipped using the bitmaps, so advancing over a long
+   idle period costs no more than over a short one. A timeout cascades at
+   most once per level, so expiring n timeouts costs O(n) overall.
+
+   findMinWaketimeTimerWheel only gives the start of the first slot in use,
+   which for a slot of level 1 or more may be well before the timeout in it
+   expires. The I/O managers use it to decide how long to wait; waking up at
+   the start of the slot lets expireTimerWheel cascade it, after which the
+   next answer is more precise. Waking up early like this happens at most
+   once per level for any given timeout.
+
+   The slots are C data rather than GC heap objects, so they are GC roots and
+   markTimerWheel must be called for the wheel. The timeouts themselves are
+   MUT_PRIM objects like all StgTimeouts, so the GC follows and updates their
+   a and b fields without needing a write barrier.
+*/
+
+#define EMPTY ((StgTimeoutQueue *) &stg_TIMEOUT_QUEUE_EMPTY_closure)
+
+#define SLOT_MASK ((StgWord64)TIMER_WHEEL_SLOTS - 1)
+#define TICK_MASK (((StgWord64)1 << TIMER_WHEEL_TICK_SHIFT) - 1)
+
+// See rts/prim/ctz.c for why we avoid __builtin_ctzll() on 32-bit platforms.
+STATIC_INLINE uint32_t
+lowestSlot(StgWord64 occupied)
+{
+#if WORD_SIZE_IN_BITS == 64
+    return __builtin_ctzll(occupied);
+#else
+    return (uint32_t) occupied ? __builtin_ctz((uint32_t) occupied)
+                               : __builtin_ctz((uint32_t) (occupied >> 32)) + 32;
+#endif
+}
+
+// The tick of a waketime, rounded up so that timeouts never expire early
+STATIC_INLINE StgWord64
+waketimeTick(Time waketime)
+{
+    if (waketime <= 0) {
+        return 0;
+    }
+    return ((StgWord64) waketime >> TIMER_WHEEL_TICK_SHIFT)
+        + (((StgWord64) waketime & TICK_MASK) != 0);
+}
+
+STATIC_INLINE Time
+tickTime(StgWord64 tick)
+{
+    if (tick > ((StgWord64) TIME_MAX >> TIMER_WHEEL_TICK_SHIFT)) {
+        return TIME_MAX;
+    }
+    return (Time) (tick << TIMER_WHEEL_TICK_SHIFT);
+}
+
+// The first tick of the given slot, with respect to the current tick
+STATIC_INLINE StgWord64
+slotStart(StgWord64 now, uint32_t level, uint32_t slot)
+{
+    const uint32_t shift = level * TIMER_WHEEL_LEVEL_BITS;
+    return (now >> shift >> TIMER_WHEEL_LEVEL_BITS
+                 << TIMER_WHEEL_LEVEL_BITS << shift)
+         | ((StgWord64) slot << shift);
+}
+
+static void
+linkTimeout(TimerWheel *w, StgTimeout *t)
+{
+    // A timeout which is already due goes in the current slot of level 0.
+    StgWord64 tick = waketimeTick(t->waketime);
+    if (tick < w->now) {
+        tick = w->now;
+    }
+
+    uint32_t level = 0;
+    for (StgWord64 diff = (tick ^ w->now) >> TIMER_WHEEL_LEVEL_BITS;
+         diff != 0;
+         diff >>= TIMER_WHEEL_LEVEL_BITS) {
+        level++;
+    }
+    ASSERT(level < TIMER_WHEEL_LEVELS);
+    const uint32_t slot =
+        (tick >> (level * TIMER_WHEEL_LEVEL_BITS)) & SLOT_MASK;
+
+    StgTimeout *head = w->slots[level][slot];
+    t->a = head;
+    t->b = EMPTY;
+    if (head != EMPTY) {
+        head->b = t;
+    }
+    w->slots[level][slot] = t;
+    w->occupied[level] |= (StgWord64) 1 << slot;
+    t->rank = level * TIMER_WHEEL_SLOTS + slot;
+}
+
+static void
+unlinkTimeout(TimerWheel *w, StgTimeout *t)
+{
+    const uint32_t level = t->rank / TIMER_WHEEL_SLOTS;
+    const uint32_t slot  = t->rank % TIMER_WHEEL_SLOTS;
+
+    if (t->b != EMPTY) {
+        t->b->a = t->a;
+    } else {
+        ASSERT(w->slots[level][slot] == t);
+        w->slots[level][slot] = t->a;
+        if (t->a == EMPTY) {
+            w->occupied[level] &= ~((StgWord64) 1 << slot);
+        }
+    }
+    if (t->a != EMPTY) {
+        t->a->b = t->b;
+    }
+    t->a = EMPTY;
+    t->b = EMPTY;
+}
+
+// Detach the list of timeouts of a slot
+static StgTimeout *
+takeSlot(TimerWheel *w, uint32_t level, uint32_t slot)
+{
+    StgTimeout *t = w->slots[level][slot];
+    w->slots[level][slot] = EMPTY;
+    w->occupied[level] &= ~((StgWord64) 1 << slot);
+    return t;
+}
+
+void
+initTimerWheel(TimerWheel *w)
+{
+    w->now  = 0;
+    w->size = 0;
+    memset(w->occupied, 0, sizeof(w->occupied));
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint32_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            w->slots[level][slot] = EMPTY;
+        }
+    }
+}
+
+Time
+findMinWaketimeTimerWheel(TimerWheel *w)
+{
+    ASSERT(!isEmptyTimerWheel(w));
+
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (w->occupied[level] != 0) {
+            const uint32_t slot = lowestSlot(w->occupied[level]);
+            return tickTime(slotStart(w->now, level, slot));
+        }
+    }
+    barf("findMinWaketimeTimerWheel: empty wheel");
+}
+
+void
+insertTimerWheel(TimerWheel *w, StgTimeout *t, Time waketime)
+{
+    ASSERT(t->parent == EMPTY && t->a == EMPTY && t->b == EMPTY);
+
+    t->waketime = waketime;
+    linkTimeout(w, t);
+    w->size++;
+}
+
+void
+deleteTimerWheel(TimerWheel *w, StgTimeout *t)
+{
+    ASSERT(w->size > 0);
+
+    unlinkTimeout(w, t);
+    t->rank = 1; // as for a timeout deleted from a leftist heap
+    w->size--;
+}
+
+StgTimeout *
+expireTimerWheel(TimerWheel *w, Time now)
+{
+    // Round down, unlike waketimes
+    const StgWord64 target =
+        now <= 0 ? 0 : (StgWord64) now >> TIMER_WHEEL_TICK_SHIFT;
+    StgTimeout *expired = EMPTY;
+    StgTimeout **expired_tail = &expired;
+
+    while (target >= w->now) {
+        // Take the slots of level 0 up to the target, or all of them if the
+        // target is in a later block.
+        const bool same_block =
+            (target >> TIMER_WHEEL_LEVEL_BITS) == (w->now >> TIMER_WHEEL_LEVEL_BITS);
+        StgWord64 due = w->occupied[0];
+        if (same_block && (target & SLOT_MASK) != SLOT_MASK) {
+            due &= ((StgWord64) 1 << ((target & SLOT_MASK) + 1)) - 1;
+        }
+        while (due != 0) {
+            const uint32_t slot = lowestSlot(due);
+            due &= due - 1;
+            for (StgTimeout *t = takeSlot(w, 0, slot); t != EMPTY; ) {
+                StgTimeout *next = t->a;
+                t->a = EMPTY;
+                t->b = EMPTY;
+                t->rank = 1;
+                *expired_tail = t;
+                expired_tail = &t->a;
+                w->size--;
+                t = next;
+            }
+        }
+        if (same_block) {
+            w->now = target;
+            break;
+        }
+
+        // Level 0 is empty now. Move the wheel to the start of the first slot
+        // in use of the lowest level in use, unless that is past the target,
+        // and spread its timeouts over the lower levels.
+        uint32_t level = 1;
+        while (level < TIMER_WHEEL_LEVELS && w->occupied[level] == 0) {
+            level++;
+        }
+        if (level == TIMER_WHEEL_LEVELS) {
+            w->now = target;
+            break;
+        }
+        const uint32_t slot = lowestSlot(w->occupied[level]);
+        const StgWord64 start = slotStart(w->now, level, slot);
+        if (start > target) {
+            w->now = target;
+            break;
+        }
+        w->now = start;
+        for (StgTimeout *t = takeSlot(w, level, slot); t != EMPTY; ) {
+            StgTimeout *next = t->a;
+            linkTimeout(w, t);
+            t = next;
+        }
+    }
+
+    return expired;
+}
+
+void
+markTimerWheel(evac_fn evac, void *user, TimerWheel *w)
+{
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (StgWord64 occupied = w->occupied[level];
+             occupied != 0;
+             occupied &= occupied - 1) {
+            const uint32_t slot = lowestSlot(occupied);
+            evac(user, (StgClosure **)(void *)&w->slots[level][slot]);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * Prototypes for functions in TimerWheel.c
+ *
+ * A hierarchical timing wheel: an alternative to the leftist heap of
+ * TimeoutQueue.h for managing a large collection of timeouts.
+ *
+ * It provides the same operations on the same StgTimeout elements (which are
+ * initialised with initElemTimeoutQueue), but insert and delete are O(1), and
+ * expired timeouts are removed in a batch rather than one deleteMin at a time.
+ * Each timeout moves down the levels of the wheel at most a constant number of
+ * times before it expires, so the cost of expiry is amortised O(1) per timeout
+ * too.
+ *
+ * The price is resolution: waketimes are rounded up to the next tick of the
+ * wheel (TIMER_WHEEL_TICK_SHIFT), so a timeout may expire up to a tick late,
+ * but never early. See Note [Timer wheel] in TimerWheel.c.
+ *
+ * Unlike the leftist heap the wheel is not itself on the GC heap: it is a C
+ * structure, typically embedded in another, and its slots are GC roots that
+ * must be marked with markTimerWheel.
+ *
+ * -------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "TimeoutQueue.h"
+#include "sm/GC.h" // for evac_fn below
+
+#include "BeginPrivate.h"
+
+/* A tick is 2^20 ns, just over a millisecond. */
+#define TIMER_WHEEL_TICK_SHIFT 20
+
+/* Each level has 64 slots, so that a level's slots in use fit in a word. With
+ * 8 levels the wheel spans 2^48 ticks, more than the range of Time.
+ */
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS     8
+
+typedef struct {
+    /* The tick the wheel has been advanced to. Every timeout in the wheel
+     * expires at or after this tick.
+     */
+    StgWord64 now;
+
+    /* The number of timeouts in the wheel */
+    StgWord size;
+
+    /* Bit i of occupied[l] is set iff slots[l][i] is not empty. */
+    StgWord64 occupied[TIMER_WHEEL_LEVELS];
+
+    /* Doubly-linked lists of timeouts, linked through their a (next) and b
+     * (previous) fields and terminated by the empty timeout queue. These are
+     * GC roots.
+     */
+    StgTimeout *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+/* Initialise an empty wheel. Nothing needs to be freed afterwards. */
+void initTimerWheel(TimerWheel *w);
+
+/* Is the wheel empty?
+ */
+INLINE_HEADER
+bool isEmptyTimerWheel(TimerWheel *w);
+
+/* A lower bound on the earliest waketime in the wheel, which must not be
+ * empty. It is never earlier than the tick the wheel has been advanced to, so
+ * after expireTimerWheel(w, now) it is later than now. It is exact (up to the
+ * rounding to ticks) unless the earliest timeout is more than a few dozen
+ * ticks away; waiting until then and calling expireTimerWheel again gives a
+ * more accurate answer.
+ */
+Time findMinWaketimeTimerWheel(TimerWheel *w);
+
+/* Insert a timeout which is not in any queue, to expire at waketime.
+ *
+ * This is O(1).
+ */
+void insertTimerWheel(TimerWheel *w, StgTimeout *t, Time waketime);
+
+/* Delete the given timeout from the wheel.
+ *
+ * This is O(1). As for deleteTimeoutQueue, the timeout remains the caller's
+ * responsibility (in particular for GC).
+ */
+void deleteTimerWheel(TimerWheel *w, StgTimeout *t);
+
+/* Remove every timeout whose waketime (rounded up to a tick) is at or before
+ * now, and return them as a list linked through their a fields and
+ * terminated by the empty timeout queue. The caller must reset the a field of
+ * each of them to the empty timeout queue before inserting it again.
+ *
+ * The returned timeouts become the caller's responsibility, as for
+ * deleteMinTimeoutQueue.
+ */
+StgTimeout *expireTimerWheel(TimerWheel *w, Time now);
+
+/* Mark the slots of the wheel as GC roots. */
+void markTimerWheel(evac_fn evac, void *user, TimerWheel *w);
+
+/* -----------------------------------------------------------------------------
+ * Private from here on down.
+ * -----------------------------------------------------------------------------
+ */
+
+INLINE_HEADER
+bool isEmptyTimerWheel(TimerWheel *w)
+{
+    return w->size == 0;
+}
+
+#include "EndPrivate.h"
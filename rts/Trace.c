@@ -24,6 +24,8 @@
 #include "Printer.h"
 #include "RtsFlags.h"
 #include "ThreadLabels.h"
+#include "CloneStack.h"
+#include "Proftimer.h"
 
 #if defined(HAVE_UNISTD_H)
 #include <unistd.h>
@@ -129,6 +131,11 @@ static void updateTraceFlagCache(void) {
       RtsFlags.TraceFlags.ipe ||
       RtsFlags.DebugFlags.ipe;
 
+  // --stack-samples only does anything with -l (or -v)
+  RuntimeTraceFlagCache.stack_samples =
+      RtsFlags.TraceFlags.stackSampleDepth > 0 &&
+      RtsFlags.TraceFlags.tracing != TRACE_NONE;
+
   // We trace cap events if we're tracing anything else
   RuntimeTraceFlagCache.cap =
     TRACE_sched ||
@@ -136,7 +143,8 @@ static void updateTraceFlagCache(void) {
     TRACE_spark_sampled ||
     TRACE_spark_full ||
     TRACE_user ||
-    TRACE_ipe;
+    TRACE_ipe ||
+    TRACE_stack_samples;
 }
 
 void initTracing (void)
@@ -160,6 +168,12 @@ void initTracing (void)
             && RtsFlags.TraceFlags.nullWriter) {
         startEventLogging(&NullEventLogWriter);
     }
+#if !defined(mingw32_HOST_OS)
+    else if (RtsFlags.TraceFlags.tracing == TRACE_EVENTLOG
+            && isEventLogSocketOutput(RtsFlags.TraceFlags.trace_output)) {
+        startEventLogging(&SocketEventLogWriter);
+    }
+#endif
     else if (RtsFlags.TraceFlags.tracing == TRACE_EVENTLOG
             && rtsConfig.eventlog_writer != NULL) {
         startEventLogging(rtsConfig.eventlog_writer);
@@ -269,6 +283,10 @@ static void traceSchedEvent_stderr (Capability *cap, EventTypeNum tag,
         debugBelch("cap %d: thread %" FMT_Word "[\"%.*s\"]" " migrating to cap %d\n",
                    cap->no, (W_)tso->id, threadLabelLen, threadLabel, (int)info1);
         break;
+    case EVENT_THREAD_STEAL:    // (cap, thread, victim_cap)
+        debugBelch("cap %d: stole thread %" FMT_Word "[\"%.*s\"]" " from cap %d\n",
+                   cap->no, (W_)tso->id, threadLabelLen, threadLabel, (int)info1);
+        break;
     case EVENT_THREAD_WAKEUP:   // (cap, thread, info1_cap)
         debugBelch("cap %d: waking up thread %" FMT_Word "[\"%.*s\"]" " on cap %d\n",
                    cap->no, (W_)tso->id, threadLabelLen, threadLabel, (int)info1);
@@ -926,6 +944,107 @@ void traceThreadLabel_(Capability *cap,
     }
 }
 
+void traceThreadAccounting_(Capability *cap, StgTSO *tso)
+{
+    const StgWord64 allocated = rts_getThreadAllocated((StgPtr) tso);
+    const StgWord64 cpu_time = rts_getThreadCPUTime((StgPtr) tso);
+#if defined(DEBUG)
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("cap %d: thread %" FMT_Word " allocated %" FMT_Word64
+                   " bytes in %" FMT_Word64 "ns\n",
+                   cap->no, (W_)tso->id, allocated, cpu_time);
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    {
+        postThreadAccounting(cap, tso->id, allocated, cpu_time);
+    }
+}
+
+void traceSparkThrottle_(Capability *cap, StgWord ratio, bool throttled,
+                         StgWord dropped)
+{
+#if defined(DEBUG)
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("cap %d: spark conversion %" FMT_Word "/1000%s, %"
+                   FMT_Word " sparks dropped\n",
+                   cap->no, ratio, throttled ? " (throttled)" : "", dropped);
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    {
+        postSparkThrottle(cap, (StgWord16)ratio, throttled, dropped);
+    }
+}
+
+void traceSTMStats_(Capability *cap, Capability *for_cap)
+{
+#if defined(DEBUG)
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        const STMStats *s = &for_cap->stm_stats;
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("cap %d: STM %" FMT_Word64 " starts, %" FMT_Word64
+                   " commits, %" FMT_Word64 " aborts, %" FMT_Word64
+                   " retries, %" FMT_Word64 " validation failures\n",
+                   for_cap->no, s->starts, s->commits, s->aborts, s->retries,
+                   s->validation_failures);
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    {
+        postSTMStats(cap, for_cap);
+    }
+}
+
+void traceSTMConflict_(Capability *cap, StgTVar *tvar, StgClosure *value,
+                       StgWord16 kind)
+{
+    // value may be a TRec if the TVar is locked; either way it's only its
+    // info pointer we report.
+    const StgWord64 info = (StgWord64)(W_)RELAXED_LOAD(&value->header.info);
+#if defined(DEBUG)
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("cap %d: STM conflict (%d) on TVar %p, value info %p\n",
+                   cap->no, kind, tvar, (void *)(W_)info);
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    {
+        postSTMConflict(cap, (StgWord64)(W_)tvar, info, kind);
+    }
+}
+
+void traceStackSample_(Capability *cap, StgTSO *tso)
+{
+    StgWord64 frames[STACK_SAMPLE_MAX_DEPTH];
+    const uint32_t n =
+        stackFrameInfoPointers(tso->stackobj, frames,
+                               RtsFlags.TraceFlags.stackSampleDepth);
+#if defined(DEBUG)
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("cap %d: stack sample of thread %" FMT_Word ":",
+                   cap->no, (W_)tso->id);
+        for (uint32_t i = 0; i < n; i++) {
+            debugBelch(" %p", (void *)(W_)frames[i]);
+        }
+        debugBelch("\n");
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    {
+        postStackSample(cap, tso->id, frames, n);
+    }
+}
+
 void traceNonmovingGcEvent_ (EventTypeNum tag)
 {
 #if defined(DEBUG)
@@ -80,6 +80,7 @@ enum CapsetType { CapsetTypeCustom = CAPSET_TYPE_CUSTOM,
 #define TRACE_user          ((const bool)RuntimeTraceFlagCache.user)
 #define TRACE_cap           ((const bool)RuntimeTraceFlagCache.cap)
 #define TRACE_ipe           ((const bool)RuntimeTraceFlagCache.ipe)
+#define TRACE_stack_samples ((const bool)RuntimeTraceFlagCache.stack_samples)
 
 /*
  * Runtime trace flags.
@@ -93,6 +94,7 @@ typedef struct {
   bool user;
   bool cap;
   bool ipe;
+  bool stack_samples;
 } RUNTIME_TRACE_FLAG_CACHE;
 
 /*
@@ -303,6 +305,33 @@ void traceThreadLabel_(Capability *cap,
                        char       *label,
                        size_t      len);
 
+/*
+ * An event to record the allocation and CPU time of a Haskell thread.
+ * See Note [Thread accounting] in Threads.c.
+ */
+void traceThreadAccounting_(Capability *cap, StgTSO *tso);
+
+/*
+ * An event with the spark conversion ratio of a capability, see
+ * Note [Spark throttling] in Sparks.c.
+ */
+void traceSparkThrottle_(Capability *cap, StgWord ratio, bool throttled,
+                         StgWord dropped);
+
+/*
+ * Events for the STM statistics of capability for_cap, and for a TVar which
+ * made a transaction fail to validate. See Note [STM statistics] in STM.c.
+ */
+void traceSTMStats_(Capability *cap, Capability *for_cap);
+void traceSTMConflict_(Capability *cap, StgTVar *tvar, StgClosure *value,
+                       StgWord16 kind);
+
+/*
+ * An event with the topmost stack frames of a thread which has just stopped.
+ * See Note [Stack sampling] in Proftimer.c.
+ */
+void traceStackSample_(Capability *cap, StgTSO *tso);
+
 
 #if defined(DEBUG)
 #define DEBUG_RTS 1
@@ -415,6 +444,11 @@ void flushTrace(void);
 #define debugTraceCap(class, cap, str, ...) /* nothing */
 #define traceThreadStatus(class, tso) /* nothing */
 #define traceThreadLabel_(cap, tso, label, len) /* nothing */
+#define traceThreadAccounting_(cap, tso) /* nothing */
+#define traceSparkThrottle_(cap, ratio, throttled, dropped) /* nothing */
+#define traceSTMStats_(cap, for_cap) /* nothing */
+#define traceSTMConflict_(cap, tvar, value, kind) /* nothing */
+#define traceStackSample_(cap, tso) /* nothing */
 #define traceCapEvent(cap, tag) /* nothing */
 #define traceCapsetEvent(tag, capset, info) /* nothing */
 #define traceWallClockTime_() /* nothing */
@@ -472,6 +506,8 @@ void dtraceUserMarkerWrapper(Capability *cap, char *msg);
     HASKELLEVENT_THREAD_RUNNABLE(cap, tid)
 #define dtraceMigrateThread(cap, tid, new_cap)          \
     HASKELLEVENT_MIGRATE_THREAD(cap, tid, new_cap)
+#define dtraceThreadSteal(cap, tid, victim_cap)         \
+    HASKELLEVENT_THREAD_STEAL(cap, tid, victim_cap)
 #define dtraceThreadWakeup(cap, tid, other_cap)         \
     HASKELLEVENT_THREAD_WAKEUP(cap, tid, other_cap)
 #define dtraceGcStart(cap)                              \
@@ -574,6 +610,7 @@ void dtraceUserMarkerWrapper(Capability *cap, char *msg);
 #define dtraceStopThread(cap, tid, status, info)        /* nothing */
 #define dtraceThreadRunnable(cap, tid)                  /* nothing */
 #define dtraceMigrateThread(cap, tid, new_cap)          /* nothing */
+#define dtraceThreadSteal(cap, tid, victim_cap)         /* nothing */
 #define dtraceThreadWakeup(cap, tid, other_cap)         /* nothing */
 #define dtraceGcStart(cap)                              /* nothing */
 #define dtraceGcEnd(cap)                                /* nothing */
@@ -674,6 +711,15 @@ INLINE_HEADER void traceEventMigrateThread(Capability *cap     STG_UNUSED,
                         (EventCapNo)new_cap);
 }
 
+INLINE_HEADER void traceEventStealThread(Capability *cap        STG_UNUSED,
+                                         StgTSO     *tso        STG_UNUSED,
+                                         uint32_t    victim_cap STG_UNUSED)
+{
+    traceSchedEvent(cap, EVENT_THREAD_STEAL, tso, victim_cap);
+    dtraceThreadSteal((EventCapNo)cap->no, (EventThreadID)tso->id,
+                      (EventCapNo)victim_cap);
+}
+
 INLINE_HEADER void traceCapCreate(Capability *cap STG_UNUSED)
 {
     traceCapEvent(cap, EVENT_CAP_CREATE);
@@ -730,6 +776,50 @@ INLINE_HEADER void traceThreadLabel(Capability *cap   STG_UNUSED,
     dtraceThreadLabel((EventCapNo)cap->no, (EventThreadID)tso->id, label, len);
 }
 
+INLINE_HEADER void traceThreadAccounting(Capability *cap STG_UNUSED,
+                                         StgTSO     *tso STG_UNUSED)
+{
+    if (RTS_UNLIKELY(TRACE_sched)) {
+        traceThreadAccounting_(cap, tso);
+    }
+}
+
+INLINE_HEADER void traceSparkThrottle(Capability *cap       STG_UNUSED,
+                                      StgWord     ratio     STG_UNUSED,
+                                      bool        throttled STG_UNUSED,
+                                      StgWord     dropped   STG_UNUSED)
+{
+    if (RTS_UNLIKELY(TRACE_spark_sampled)) {
+        traceSparkThrottle_(cap, ratio, throttled, dropped);
+    }
+}
+
+INLINE_HEADER void traceSTMStats(Capability *cap     STG_UNUSED,
+                                 Capability *for_cap STG_UNUSED)
+{
+    if (RTS_UNLIKELY(TRACE_sched)) {
+        traceSTMStats_(cap, for_cap);
+    }
+}
+
+INLINE_HEADER void traceSTMConflict(Capability *cap   STG_UNUSED,
+                                    StgTVar    *tvar  STG_UNUSED,
+                                    StgClosure *value STG_UNUSED,
+                                    StgWord16   kind  STG_UNUSED)
+{
+    if (RTS_UNLIKELY(TRACE_sched)) {
+        traceSTMConflict_(cap, tvar, value, kind);
+    }
+}
+
+INLINE_HEADER void traceStackSample(Capability *cap STG_UNUSED,
+                                    StgTSO     *tso STG_UNUSED)
+{
+    if (RTS_UNLIKELY(TRACE_stack_samples)) {
+        traceStackSample_(cap, tso);
+    }
+}
+
 INLINE_HEADER void traceEventGcStart(Capability *cap STG_UNUSED)
 {
     traceGcEvent(cap, EVENT_GC_START);
@@ -115,6 +115,82 @@ static eventlog_init_func_t *eventlog_header_funcs = NULL;
 
 static int flushCount = 0;
 
+#if defined(THREADED_RTS)
+/* Note [Eventlog flusher thread]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * By default a capability which fills its event buffer writes it out itself
+ * in printAndClearEventBuf. With a slow writer, or with many capabilities
+ * contending for the writer's lock, this stalls the mutator for as long as
+ * the write takes. With +RTS --eventlog-async-buffers=<n> full capability
+ * buffers are instead handed to a dedicated flusher thread:
+ *
+ *  - Each capability owns n+1 buffers: the one it is currently posting to
+ *    (capEventBuf[c]) and n spares. They are tracked by an EventsRing, which
+ *    consists of two single-producer/single-consumer queues: `full`, from the
+ *    capability to the flusher, and `spare`, from the flusher back to the
+ *    capability. One end of each queue is always whoever owns the capability
+ *    (or holds all capabilities), the other is always the flusher thread, so
+ *    neither needs a lock.
+ *
+ *  - When the current buffer fills, the capability takes a spare buffer,
+ *    pushes the full one onto `full` and carries on posting. If there is no
+ *    spare then all n buffers are still waiting to be written. Rather than
+ *    wait for the writer we discard the current buffer's contents and bump
+ *    the ring's `dropped` counter. Since every buffer is a self-contained
+ *    block (see Note [Eventlog concurrency]) the eventlog remains
+ *    well-formed; it merely has a gap. The number of dropped buffers is
+ *    reported when eventlogging stops.
+ *
+ *  - The flusher sleeps on flusher_cond when there is nothing to write. To
+ *    avoid taking flusher_mutex on every hand-off, the flusher announces that
+ *    it is about to sleep in flusher_idle and re-checks the queues before
+ *    waiting, while a capability only takes the lock to wake it if it sees
+ *    flusher_idle after pushing. Both sides use sequentially consistent
+ *    accesses, so at least one of them observes the other and no wake-up is
+ *    lost.
+ *
+ *  - A buffer is only removed from `full` once it has been written. Explicit
+ *    flushes (flushLocalEventsBuf and friends) must guarantee that the
+ *    capability's events have reached the writer, in order; they wait for
+ *    `full` to become empty (flusher_drained_cond) and then write the current
+ *    buffer synchronously, as in the default mode.
+ *
+ * The global eventBuf is always written synchronously since it only carries
+ * infrequent administrative events.
+ *
+ * forkProcess stops the flusher before forking and restarts it in the parent
+ * afterwards (stopEventLogFlusherForFork, resumeEventLogFlusherAfterFork).
+ * Otherwise the child could inherit flusher_mutex, or the writer's state,
+ * in the middle of a write by a thread which doesn't exist in the child.
+ */
+
+typedef struct _EventsBlock {
+  StgInt8 *begin;
+  StgWord64 size;   // bytes of event data starting at begin
+} EventsBlock;
+
+typedef struct _EventsRing {
+  uint32_t capacity;       // number of spare buffers
+  StgWord full_head;       // advanced by the flusher
+  StgWord full_tail;       // advanced by the capability
+  StgWord spare_head;      // advanced by the capability
+  StgWord spare_tail;      // advanced by the flusher
+  EventsBlock *full;       // capacity entries
+  StgInt8 **spare;         // capacity entries
+  StgWord dropped;         // buffers discarded since the flusher started
+} EventsRing;
+
+// Protects capEventRings, n_cap_event_rings and the flusher_* state below.
+static Mutex flusher_mutex;
+static Condition flusher_cond;          // wakes the flusher
+static Condition flusher_drained_cond;  // signalled after every flusher pass
+static EventsRing **capEventRings = NULL;
+static uint32_t n_cap_event_rings = 0;
+static bool flusher_running = false;
+static bool flusher_stop = false;
+static bool flusher_idle = false;  // see Note [Eventlog flusher thread]
+#endif
+
 // Struct for record keeping of buffer to store event types and events.
 //
 // Invariant: The event buffer will always begin with a block-start marker.
@@ -124,6 +200,11 @@ typedef struct _EventsBuf {
   StgInt8 *marker;
   StgWord64 size;
   EventCapNo capno; // which capability this buffer belongs to, or -1
+#if defined(THREADED_RTS)
+  // where full buffers are handed off to, or NULL if they are written
+  // synchronously. See Note [Eventlog flusher thread].
+  EventsRing *ring;
+#endif
 } EventsBuf;
 
 static EventsBuf *capEventBuf; // one EventsBuf for each Capability
@@ -165,6 +246,15 @@ static void ensureRoomForEvent(EventsBuf *eb, EventTypeNum tag);
 static int ensureRoomForVariableEvent(EventsBuf *eb, StgWord size);
 
 static void flushEventLog_(Capability **cap USED_IF_THREADS);
+static void writeAndClearEventBuf(EventsBuf *ebuf);
+
+#if defined(THREADED_RTS)
+static void startEventLogFlusher(void);
+static StgWord haltEventLogFlusher(void);
+static void stopEventLogFlusher(void);
+static void moreEventsRings(uint32_t to);
+static void freeEventsRings(void);
+#endif
 
 static inline void postWord8(EventsBuf *eb, StgWord8 i)
 {
@@ -353,6 +443,41 @@ static void repostInitEvents(void){
     return;
 }
 
+// Set by requestRepostInitEvents.
+static bool repost_init_events_requested = false;
+
+void requestRepostInitEvents(void)
+{
+    SEQ_CST_STORE_ALWAYS(&repost_init_events_requested, true);
+}
+
+bool repostInitEventsRequested(void)
+{
+    return RELAXED_LOAD_ALWAYS(&repost_init_events_requested);
+}
+
+// Post the init events again if the writer asked for it. This must not be
+// called with eventBufMutex held.
+void repostInitEventsIfRequested(void)
+{
+    if (!RELAXED_LOAD_ALWAYS(&repost_init_events_requested)) {
+        return;
+    }
+    // Don't wait if eventlogging is being started or stopped; we will be
+    // called again.
+    if (TRY_ACQUIRE_LOCK(&state_change_mutex) != 0) {
+        return;
+    }
+    if (eventlog_enabled) {
+        bool requested =
+            SEQ_CST_XCHG_ALWAYS(&repost_init_events_requested, false);
+        if (requested) {
+            repostInitEvents();
+        }
+    }
+    RELEASE_LOCK(&state_change_mutex);
+}
+
 // Clear the eventlog_header_funcs list and free the memory
 void resetInitEvents(void){
     eventlog_init_func_t * tmp;
@@ -393,6 +518,11 @@ initEventLogging(void)
      * Use a single buffer to store the header with event types, then flush
      * the buffer so all buffers are empty for writing events.
      */
+#if defined(THREADED_RTS)
+    initMutex(&flusher_mutex);
+    initCondition(&flusher_cond);
+    initCondition(&flusher_drained_cond);
+#endif
     moreCapEventBufs(0, get_n_capabilities());
 
     initEventsBuf(&eventBuf, EVENT_LOG_SIZE, (EventCapNo)(-1));
@@ -432,6 +562,10 @@ startEventLogging_(void)
 
     RELEASE_LOCK_ALWAYS(&eventBufMutex);
 
+#if defined(THREADED_RTS)
+    startEventLogFlusher();
+#endif
+
     return true;
 }
 
@@ -452,6 +586,8 @@ startEventLogging(const EventLogWriter *ev_writer)
     event_log_writer = ev_writer;
     bool ret = startEventLogging_();
     eventlog_enabled = true;
+    // We are about to post them anyway.
+    RELAXED_STORE_ALWAYS(&repost_init_events_requested, false);
     repostInitEvents();
     RELEASE_LOCK(&state_change_mutex);
     return ret;
@@ -461,6 +597,15 @@ startEventLogging(const EventLogWriter *ev_writer)
 void
 restartEventLogging(void)
 {
+#if defined(THREADED_RTS)
+    // forkProcess stopped the flusher thread before forking, so nothing holds
+    // or waits on its mutex and conditions, and we can start afresh. See
+    // Note [Eventlog flusher thread].
+    ASSERT(!flusher_running);
+    closeCondition(&flusher_drained_cond);
+    closeCondition(&flusher_cond);
+    closeMutex(&flusher_mutex);
+#endif
     freeEventLoggingBuffer();
     stopEventLogWriter();
     initEventLogging();  // allocate new per-capability buffers
@@ -475,6 +620,11 @@ void
 finishCapEventLogging(void)
 {
     if (eventlog_enabled) {
+#if defined(THREADED_RTS)
+        // Write out everything handed to the flusher thread first, so that
+        // the buffers below are written synchronously.
+        stopEventLogFlusher();
+#endif
         // Flush all events remaining in the capabilities' buffers and free them.
         // N.B. at this point we hold all capabilities.
         for (uint32_t c = 0; c < getNumCapabilities(); ++c) {
@@ -500,6 +650,11 @@ endEventLogging(void)
 
     flushEventLog_(NULL);
 
+#if defined(THREADED_RTS)
+    // The end of data marker must be the last thing written.
+    stopEventLogFlusher();
+#endif
+
     ACQUIRE_LOCK_ALWAYS(&eventBufMutex);
 
     // Mark end of events (data).
@@ -540,6 +695,19 @@ moreCapEventBufs (uint32_t from, uint32_t to)
            postBlockMarker(&capEventBuf[c]);
         }
     }
+
+#if defined(THREADED_RTS)
+    // New capabilities hand off their buffers too if the flusher is running.
+    ACQUIRE_LOCK(&flusher_mutex);
+    bool running = flusher_running;
+    RELEASE_LOCK(&flusher_mutex);
+    if (running) {
+        moreEventsRings(to);
+        for (uint32_t c = from; c < to; ++c) {
+            capEventBuf[c].ring = capEventRings[c];
+        }
+    }
+#endif
 }
 
 static void
@@ -549,6 +717,9 @@ freeEventLoggingBuffer(void)
         stgFree(capEventBuf);
         capEventBuf = NULL;
     }
+#if defined(THREADED_RTS)
+    freeEventsRings();
+#endif
 }
 
 void
@@ -590,6 +761,7 @@ postSchedEvent (Capability *cap,
     }
 
     case EVENT_MIGRATE_THREAD:  // (cap, thread, new_cap)
+    case EVENT_THREAD_STEAL:    // (cap, thread, victim_cap)
     case EVENT_THREAD_WAKEUP:   // (cap, thread, other_cap)
     {
         postThreadID(eb,thread);
@@ -1133,6 +1305,93 @@ void postThreadLabel(Capability    *cap,
     postBuf(eb, (StgWord8*) label, strsize);
 }
 
+void postThreadAccounting(Capability    *cap,
+                          EventThreadID  id,
+                          StgWord64      allocated,
+                          StgWord64      cpu_time)
+{
+    EventsBuf *eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_THREAD_ACCOUNTING);
+    postEventHeader(eb, EVENT_THREAD_ACCOUNTING);
+    postThreadID(eb, id);
+    postWord64(eb, allocated);
+    postWord64(eb, cpu_time);
+}
+
+void postSparkThrottle(Capability *cap,
+                       StgWord16   ratio,
+                       StgWord16   throttled,
+                       StgWord64   dropped)
+{
+    EventsBuf *eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_SPARK_THROTTLE);
+    postEventHeader(eb, EVENT_SPARK_THROTTLE);
+    postWord16(eb, ratio);
+    postWord16(eb, throttled);
+    postWord64(eb, dropped);
+}
+
+void postSTMStats(Capability *cap, Capability *for_cap)
+{
+    const STMStats *s = &for_cap->stm_stats;
+    EventsBuf *eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_STM_STATS);
+    postEventHeader(eb, EVENT_STM_STATS);
+    postCapNo(eb, for_cap->no);
+    postWord64(eb, s->starts);
+    postWord64(eb, s->commits);
+    postWord64(eb, s->aborts);
+    postWord64(eb, s->retries);
+    postWord64(eb, s->validation_failures);
+    postWord64(eb, s->trec_entries);
+    postWord64(eb, s->max_trec_entries);
+    postWord64(eb, s->trec_chunks);
+}
+
+void postSTMConflict(Capability *cap,
+                     StgWord64   tvar,
+                     StgWord64   info,
+                     StgWord16   kind)
+{
+    EventsBuf *eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_STM_CONFLICT);
+    postEventHeader(eb, EVENT_STM_CONFLICT);
+    postWord64(eb, tvar);
+    postWord64(eb, info);
+    postWord16(eb, kind);
+}
+
+void postStackSample(Capability    *cap,
+                     EventThreadID  id,
+                     StgWord64     *frames,
+                     uint32_t       n_frames)
+{
+    const int size = sizeof(EventThreadID) + sizeof(StgWord16)
+        + n_frames * sizeof(StgWord64);
+    if (size > EVENT_PAYLOAD_SIZE_MAX) {
+        errorBelch("Event size exceeds EVENT_PAYLOAD_SIZE_MAX, bail out");
+        return;
+    }
+
+    EventsBuf *eb = &capEventBuf[cap->no];
+    if (!hasRoomForVariableEvent(eb, size)){
+        printAndClearEventBuf(eb);
+
+        if (!hasRoomForVariableEvent(eb, size)){
+            errorBelch("Event size exceeds buffer size, bail out");
+            return;
+        }
+    }
+
+    postEventHeader(eb, EVENT_STACK_SAMPLE);
+    postPayloadSize(eb, size);
+    postThreadID(eb, id);
+    postWord16(eb, (StgWord16) n_frames);
+    for (uint32_t i = 0; i < n_frames; i++) {
+        postWord64(eb, frames[i]);
+    }
+}
+
 void postConcUpdRemSetFlush(Capability *cap)
 {
     EventsBuf *eb = &capEventBuf[cap->no];
@@ -1497,7 +1756,318 @@ void postIPE(const InfoProvEnt *ipe)
     RELEASE_LOCK_ALWAYS(&eventBufMutex);
 }
 
+#if defined(THREADED_RTS)
+
+/* -----------------------------------------------------------------------------
+ * The eventlog flusher thread
+ *
+ * See Note [Eventlog flusher thread].
+ * -------------------------------------------------------------------------- */
+
+static EventsRing *
+newEventsRing(uint32_t capacity)
+{
+    EventsRing *r = stgMallocBytes(sizeof(EventsRing), "newEventsRing");
+    r->capacity = capacity;
+    r->full_head = r->full_tail = 0;
+    r->full = stgMallocBytes(capacity * sizeof(EventsBlock), "newEventsRing");
+    r->spare = stgMallocBytes(capacity * sizeof(StgInt8 *), "newEventsRing");
+    for (uint32_t i = 0; i < capacity; i++) {
+        r->spare[i] = stgMallocBytes(EVENT_LOG_SIZE, "newEventsRing");
+    }
+    r->spare_head = 0;
+    r->spare_tail = capacity;
+    r->dropped = 0;
+    return r;
+}
+
+// N.B. the ring must be drained, i.e. all of its buffers must be spares.
+static void
+freeEventsRing(EventsRing *r)
+{
+    ASSERT(r->full_head == r->full_tail);
+    for (StgWord i = r->spare_head; i != r->spare_tail; i++) {
+        stgFree(r->spare[i % r->capacity]);
+    }
+    stgFree(r->spare);
+    stgFree(r->full);
+    stgFree(r);
+}
+
+// Make sure that capabilities [0, to) have a ring.
+static void
+moreEventsRings(uint32_t to)
+{
+    ACQUIRE_LOCK(&flusher_mutex);
+    if (to > n_cap_event_rings) {
+        capEventRings = stgReallocBytes(capEventRings,
+                                        to * sizeof(EventsRing *),
+                                        "moreEventsRings");
+        for (uint32_t c = n_cap_event_rings; c < to; c++) {
+            capEventRings[c] =
+                newEventsRing(RtsFlags.TraceFlags.eventlogAsyncBuffers);
+        }
+        n_cap_event_rings = to;
+    }
+    RELEASE_LOCK(&flusher_mutex);
+}
+
+// N.B. the flusher thread must not be running.
+static void
+freeEventsRings(void)
+{
+    ASSERT(!flusher_running);
+    for (uint32_t c = 0; c < n_cap_event_rings; c++) {
+        freeEventsRing(capEventRings[c]);
+    }
+    stgFree(capEventRings);
+    capEventRings = NULL;
+    n_cap_event_rings = 0;
+}
+
+static bool
+eventsRingEmpty(EventsRing *r)
+{
+    return SEQ_CST_LOAD(&r->full_tail) == ACQUIRE_LOAD(&r->full_head);
+}
+
+static bool
+anyEventsRingFull(void)
+{
+    for (uint32_t c = 0; c < n_cap_event_rings; c++) {
+        if (!eventsRingEmpty(capEventRings[c])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+wakeEventLogFlusher(void)
+{
+    if (SEQ_CST_LOAD(&flusher_idle)) {
+        ACQUIRE_LOCK(&flusher_mutex);
+        signalCondition(&flusher_cond);
+        RELEASE_LOCK(&flusher_mutex);
+    }
+}
+
+// Called by the owner of the capability when its buffer is full. Returns
+// false if the buffer's contents had to be dropped.
+static bool
+handOffEventBuf(EventsBuf *ebuf)
+{
+    EventsRing *r = ebuf->ring;
+    const StgWord spare_head = RELAXED_LOAD(&r->spare_head);
+    if (spare_head == ACQUIRE_LOAD(&r->spare_tail)) {
+        // The writer has fallen behind.
+        NONATOMIC_ADD(&r->dropped, 1);
+        resetEventsBuf(ebuf);
+        return false;
+    }
+    StgInt8 *spare = r->spare[spare_head % r->capacity];
+    RELEASE_STORE(&r->spare_head, spare_head + 1);
+
+    // There are only capacity+1 buffers, one of which is current, hence the
+    // full queue cannot overflow.
+    const StgWord full_tail = RELAXED_LOAD(&r->full_tail);
+    ASSERT(full_tail - ACQUIRE_LOAD(&r->full_head) < r->capacity);
+    EventsBlock *blk = &r->full[full_tail % r->capacity];
+    blk->begin = ebuf->begin;
+    blk->size = ebuf->pos - ebuf->begin;
+    SEQ_CST_STORE(&r->full_tail, full_tail + 1);
+
+    ebuf->begin = spare;
+    resetEventsBuf(ebuf);
+    wakeEventLogFlusher();
+    return true;
+}
+
+// Wait until the flusher has written everything handed to it by the given
+// ring's capability.
+static void
+waitEventsRingDrained(EventsRing *r)
+{
+    ACQUIRE_LOCK(&flusher_mutex);
+    while (!eventsRingEmpty(r) && flusher_running) {
+        signalCondition(&flusher_cond);
+        waitCondition(&flusher_drained_cond, &flusher_mutex);
+    }
+    RELEASE_LOCK(&flusher_mutex);
+}
+
+// Write out the buffers queued on a ring, returning them to its spare
+// queue. Called by the flusher with flusher_mutex held, which is released
+// around the writes.
+static bool
+flushEventsRing(EventsRing *r)
+{
+    bool did_work = false;
+    StgWord full_head = RELAXED_LOAD(&r->full_head);
+    while (full_head != ACQUIRE_LOAD(&r->full_tail)) {
+        EventsBlock blk = r->full[full_head % r->capacity];
+        RELEASE_LOCK(&flusher_mutex);
+
+        if (!writeEventLog(blk.begin, blk.size)) {
+            debugBelch("eventLogFlusher: could not flush event log\n");
+            flushEventLogWriter();
+        } else {
+            RELAXED_ADD(&flushCount, 1);
+        }
+
+        // Return the buffer before retiring it from the full queue: the
+        // capability may only have capacity+1 buffers in total.
+        const StgWord spare_tail = RELAXED_LOAD(&r->spare_tail);
+        r->spare[spare_tail % r->capacity] = blk.begin;
+        RELEASE_STORE(&r->spare_tail, spare_tail + 1);
+        full_head++;
+        RELEASE_STORE(&r->full_head, full_head);
+
+        ACQUIRE_LOCK(&flusher_mutex);
+        did_work = true;
+    }
+    return did_work;
+}
+
+static void *
+eventLogFlusherThread(void *arg STG_UNUSED)
+{
+    ACQUIRE_LOCK(&flusher_mutex);
+    while (true) {
+        bool did_work = false;
+        // N.B. capEventRings may be reallocated while we are writing; only
+        // the rings themselves are stable.
+        for (uint32_t c = 0; c < n_cap_event_rings; c++) {
+            did_work |= flushEventsRing(capEventRings[c]);
+        }
+        if (did_work) {
+            flushEventLogWriter();
+            broadcastCondition(&flusher_drained_cond);
+            continue;
+        }
+        if (flusher_stop) {
+            break;
+        }
+        SEQ_CST_STORE(&flusher_idle, true);
+        if (!anyEventsRingFull()) {
+            waitCondition(&flusher_cond, &flusher_mutex);
+        }
+        SEQ_CST_STORE(&flusher_idle, false);
+    }
+    flusher_running = false;
+    broadcastCondition(&flusher_drained_cond);
+    RELEASE_LOCK(&flusher_mutex);
+    return NULL;
+}
+
+static void
+startEventLogFlusher(void)
+{
+    if (RtsFlags.TraceFlags.eventlogAsyncBuffers == 0) {
+        return;
+    }
+
+    // N.B. eventlog_enabled isn't yet set so no capability is posting events.
+    const uint32_t n = get_n_capabilities();
+    moreEventsRings(n);
+    for (uint32_t c = 0; c < n; c++) {
+        capEventBuf[c].ring = capEventRings[c];
+    }
+
+    ACQUIRE_LOCK(&flusher_mutex);
+    flusher_stop = false;
+    flusher_idle = false;
+    flusher_running = true;
+    RELEASE_LOCK(&flusher_mutex);
+
+    OSThreadId tid;
+    if (createOSThread(&tid, "ghc_eventlog", eventLogFlusherThread, NULL) != 0) {
+        barf("startEventLogFlusher: failed to create eventlog flusher thread");
+    }
+}
+
+// Write out all buffers handed to the flusher thread and stop it, returning
+// the number of buffers dropped so far. Capabilities must not be posting
+// events.
+static StgWord
+haltEventLogFlusher(void)
+{
+    ACQUIRE_LOCK(&flusher_mutex);
+    if (!flusher_running) {
+        RELEASE_LOCK(&flusher_mutex);
+        return 0;
+    }
+    flusher_stop = true;
+    signalCondition(&flusher_cond);
+    while (flusher_running) {
+        waitCondition(&flusher_drained_cond, &flusher_mutex);
+    }
+
+    StgWord dropped = 0;
+    for (uint32_t c = 0; c < n_cap_event_rings; c++) {
+        dropped += capEventRings[c]->dropped;
+    }
+    RELEASE_LOCK(&flusher_mutex);
+
+    for (uint32_t c = 0; c < getNumCapabilities(); c++) {
+        capEventBuf[c].ring = NULL;
+    }
+    return dropped;
+}
+
+static void
+stopEventLogFlusher(void)
+{
+    const StgWord dropped = haltEventLogFlusher();
+    for (uint32_t c = 0; c < n_cap_event_rings; c++) {
+        capEventRings[c]->dropped = 0;
+    }
+    if (dropped > 0) {
+        errorBelch("dropped %" FMT_Word " eventlog buffers because the "
+                   "eventlog writer fell behind (see --eventlog-async-buffers)",
+                   dropped);
+    }
+}
+
+#endif /* THREADED_RTS */
+
+void
+stopEventLogFlusherForFork(void)
+{
+#if defined(THREADED_RTS)
+    if (eventlog_enabled) {
+        haltEventLogFlusher();
+    }
+#endif
+}
+
+void
+resumeEventLogFlusherAfterFork(void)
+{
+#if defined(THREADED_RTS)
+    if (eventlog_enabled) {
+        startEventLogFlusher();
+    }
+#endif
+}
+
 void printAndClearEventBuf (EventsBuf *ebuf)
+{
+#if defined(THREADED_RTS)
+    if (ebuf->ring != NULL) {
+        closeBlockMarker(ebuf);
+        if (ebuf->begin != NULL && ebuf->pos != ebuf->begin) {
+            handOffEventBuf(ebuf);
+            postBlockMarker(ebuf);
+        }
+        return;
+    }
+#endif
+    writeAndClearEventBuf(ebuf);
+}
+
+// Write the buffer out on the calling thread.
+static void writeAndClearEventBuf (EventsBuf *ebuf)
 {
     closeBlockMarker(ebuf);
 
@@ -1514,7 +2084,7 @@ void printAndClearEventBuf (EventsBuf *ebuf)
         }
 
         resetEventsBuf(ebuf);
-        flushCount++;
+        RELAXED_ADD(&flushCount, 1);
 
         postBlockMarker(ebuf);
     }
@@ -1526,6 +2096,9 @@ void initEventsBuf(EventsBuf* eb, StgWord64 size, EventCapNo capno)
     eb->size = size;
     eb->marker = NULL;
     eb->capno = capno;
+#if defined(THREADED_RTS)
+    eb->ring = NULL;
+#endif
     postBlockMarker(eb);
 }
 
@@ -1600,7 +2173,14 @@ void postEventType(EventsBuf *eb, EventType *et)
 void flushLocalEventsBuf(Capability *cap)
 {
     EventsBuf *eb = &capEventBuf[cap->no];
-    printAndClearEventBuf(eb);
+#if defined(THREADED_RTS)
+    // Preserve ordering with the buffers already handed to the flusher.
+    // See Note [Eventlog flusher thread].
+    if (eb->ring != NULL) {
+        waitEventsRingDrained(eb->ring);
+    }
+#endif
+    writeAndClearEventBuf(eb);
 }
 
 // Flush all capabilities' event buffers when we already hold all capabilities.
@@ -1633,6 +2213,7 @@ void flushEventLog(Capability **cap USED_IF_THREADS)
   ACQUIRE_LOCK(&state_change_mutex);
   flushEventLog_(cap);
   RELEASE_LOCK(&state_change_mutex);
+  repostInitEventsIfRequested();
 }
 
 // This is an unsafe version of flushEventLog that does not acquire/release the
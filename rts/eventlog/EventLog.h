@@ -15,6 +15,10 @@
 
 #include "BeginPrivate.h"
 
+// The largest value of +RTS --eventlog-async-buffers. Every capability has
+// that many eventlog buffers of 2MB on top of its current one.
+#define EVENTLOG_ASYNC_BUFFERS_MAX 256
+
 #if defined(TRACING)
 
 extern bool eventlog_enabled;
@@ -28,6 +32,12 @@ extern Mutex eventBufMutex;
 
 void initEventLogging(void);
 void restartEventLogging(void);
+
+// Stop the thread writing --eventlog-async-buffers before forkProcess forks,
+// and start it again in the parent. See Note [Eventlog flusher thread].
+void stopEventLogFlusherForFork(void);
+void resumeEventLogFlusherAfterFork(void);
+
 void finishCapEventLogging(void);
 void freeEventLogging(void);
 void abortEventLogging(void); // #4512 - after fork child needs to abort
@@ -47,6 +57,21 @@ void postInitEvent(EventlogInitPost post_init);
 // Clear the init events buffer on program exit
 void resetInitEvents(void);
 
+// Ask for the events registered with postInitEvent to be posted again, e.g.
+// because the writer has started a new output stream. This is safe to call
+// from within an EventLogWriter; the events are posted later, by
+// repostInitEventsIfRequested.
+void requestRepostInitEvents(void);
+bool repostInitEventsRequested(void);
+void repostInitEventsIfRequested(void);
+
+#if !defined(mingw32_HOST_OS)
+// The writer used for +RTS -ol unix:<path>.
+// See Note [Eventlog socket writer] in EventLogSocketWriter.c.
+extern const EventLogWriter SocketEventLogWriter;
+bool isEventLogSocketOutput(const char *output);
+#endif
+
 typedef struct eventlog_init_func {
     EventlogInitPost init_func;
     struct eventlog_init_func * next;
@@ -128,6 +153,44 @@ void postThreadLabel(Capability    *cap,
                      char          *label,
                      size_t         len);
 
+/*
+ * Post the allocation (in bytes) and CPU time (in nanoseconds) of a thread
+ */
+void postThreadAccounting(Capability    *cap,
+                          EventThreadID  id,
+                          StgWord64      allocated,
+                          StgWord64      cpu_time);
+
+/*
+ * Post the spark conversion ratio of a capability, see
+ * Note [Spark throttling]
+ */
+void postSparkThrottle(Capability *cap,
+                       StgWord16   ratio,
+                       StgWord16   throttled,
+                       StgWord64   dropped);
+
+/*
+ * Post the STM statistics of capability for_cap, see Note [STM statistics]
+ */
+void postSTMStats(Capability *cap, Capability *for_cap);
+
+/*
+ * Post a TVar which made a transaction fail to validate
+ */
+void postSTMConflict(Capability *cap,
+                     StgWord64   tvar,
+                     StgWord64   info,
+                     StgWord16   kind);
+
+/*
+ * Post the info pointers of the topmost n_frames frames of thread id
+ */
+void postStackSample(Capability    *cap,
+                     EventThreadID  id,
+                     StgWord64     *frames,
+                     uint32_t       n_frames);
+
 /*
  * Various GC and heap events
  */
@@ -252,6 +315,34 @@ INLINE_HEADER void postThreadLabel(Capability    *cap   STG_UNUSED,
                                    char          *label STG_UNUSED)
 { /* nothing */ }
 
+INLINE_HEADER void postThreadAccounting(Capability    *cap       STG_UNUSED,
+                                        EventThreadID  id        STG_UNUSED,
+                                        StgWord64      allocated STG_UNUSED,
+                                        StgWord64      cpu_time  STG_UNUSED)
+{ /* nothing */ }
+
+INLINE_HEADER void postSparkThrottle(Capability *cap       STG_UNUSED,
+                                     StgWord16   ratio     STG_UNUSED,
+                                     StgWord16   throttled STG_UNUSED,
+                                     StgWord64   dropped   STG_UNUSED)
+{ /* nothing */ }
+
+INLINE_HEADER void postSTMStats(Capability *cap     STG_UNUSED,
+                                Capability *for_cap STG_UNUSED)
+{ /* nothing */ }
+
+INLINE_HEADER void postSTMConflict(Capability *cap  STG_UNUSED,
+                                   StgWord64   tvar STG_UNUSED,
+                                   StgWord64   info STG_UNUSED,
+                                   StgWord16   kind STG_UNUSED)
+{ /* nothing */ }
+
+INLINE_HEADER void postStackSample(Capability    *cap      STG_UNUSED,
+                                   EventThreadID  id       STG_UNUSED,
+                                   StgWord64     *frames   STG_UNUSED,
+                                   uint32_t       n_frames STG_UNUSED)
+{ /* nothing */ }
+
 #endif
 
 #include "EndPrivate.h"
@@ -0,0 +1,368 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2026
+ *
+ * An EventLogWriter which streams the eventlog to a Unix domain socket.
+ *
+ * ---------------------------------------------------------------------------*/
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "RtsUtils.h"
+#include "rts/EventLogWriter.h"
+
+#if defined(TRACING) && !defined(mingw32_HOST_OS)
+
+#include "eventlog/EventLog.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
+/* Note [Eventlog socket writer]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * With +RTS -ol unix:<path> the eventlog is streamed to a collector listening
+ * on the Unix domain socket <path>. This is meant for live monitoring of
+ * long-running processes, so it must cope with the collector being slow,
+ * absent or restarted:
+ *
+ *  - The socket is non-blocking. If the collector doesn't keep up, what
+ *    happens depends on --eventlog-socket-policy: with `block` (the default)
+ *    we wait for the socket to drain, as the file writer would; with `drop`
+ *    we discard the buffer instead so that the thread posting events is
+ *    never stalled. A buffer is only ever dropped as a whole (the RTS hands
+ *    us self-contained blocks of events, see Note [Eventlog concurrency]) so
+ *    that the stream remains well-formed; once we have started sending a
+ *    buffer we always finish it. With `drop` we never wait for that either:
+ *    the part of a buffer the socket didn't take is kept in `pending`, and
+ *    sent before anything else by the following writes. Until it has all
+ *    been sent, new buffers are dropped.
+ *
+ *  - If the collector is absent or goes away, buffers are dropped and we try
+ *    to (re)connect at most once per EVENTLOG_SOCKET_RETRY.
+ *
+ *  - A new connection needs to see the eventlog header before any events. The
+ *    first thing written after initEventLogWriter is the header (see
+ *    startEventLogging_) so we keep a copy of it and replay it whenever we
+ *    connect. The events posted by postInitEvent (e.g. IPE and cost-centre
+ *    definitions) are also needed to make sense of the stream, but these can
+ *    only be produced by the RTS, so we ask it to post them again with
+ *    requestRepostInitEvents.
+ *
+ * All of this is protected by socket_mutex since the RTS may call the writer
+ * from several threads at once.
+ */
+
+// Minimum time between connection attempts, in nanoseconds.
+#define EVENTLOG_SOCKET_RETRY 1000000000
+
+static int event_log_socket = -1;
+
+// The path of the socket, from -ol unix:<path>.
+static const char *event_log_socket_path = NULL;
+
+// A copy of the eventlog header, replayed on every new connection.
+static void *header_copy = NULL;
+static size_t header_copy_size = 0;
+
+static StgWord64 last_connect_attempt = 0;
+
+// With --eventlog-socket-policy=drop, the part of a buffer which the socket
+// didn't take yet.
+static char *pending = NULL;
+static size_t pending_size = 0;
+
+// Buffers dropped because the collector was absent or too slow.
+static StgWord dropped_buffers = 0;
+
+#if defined(THREADED_RTS)
+static Mutex socket_mutex;
+#endif
+
+static void initEventLogSocketWriter(void);
+static bool writeEventLogSocket(void *eventlog, size_t eventlog_size);
+static void stopEventLogSocketWriter(void);
+
+bool
+isEventLogSocketOutput(const char *output)
+{
+    return output != NULL && strncmp(output, "unix:", 5) == 0;
+}
+
+static void
+discardPending(void)
+{
+    if (pending != NULL) {
+        stgFree(pending);
+        pending = NULL;
+        pending_size = 0;
+    }
+}
+
+static void
+closeEventLogSocket(void)
+{
+    if (event_log_socket != -1) {
+        close(event_log_socket);
+        event_log_socket = -1;
+    }
+    // A new connection starts again with the header.
+    discardPending();
+}
+
+// Send as much of buf as the socket takes without blocking. Returns the
+// number of bytes sent, or -1 if the connection was lost.
+static ssize_t
+sendSome(const char *buf, size_t size)
+{
+    size_t sent = 0;
+    while (sent < size) {
+#if defined(MSG_NOSIGNAL)
+        ssize_t r = send(event_log_socket, buf + sent, size - sent,
+                         MSG_NOSIGNAL);
+#else
+        ssize_t r = send(event_log_socket, buf + sent, size - sent, 0);
+#endif
+        if (r >= 0) {
+            sent += r;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return sent;
+}
+
+// Write all of buf, waiting for the socket to become writable if necessary,
+// for at most timeout milliseconds at a time (-1 for no limit). Returns false
+// if the connection was lost or timed out.
+static bool
+sendAll(const char *buf, size_t size, int timeout)
+{
+    while (true) {
+        ssize_t r = sendSome(buf, size);
+        if (r < 0) {
+            return false;
+        }
+        buf += r;
+        size -= r;
+        if (size == 0) {
+            return true;
+        }
+        struct pollfd pfd = { .fd = event_log_socket, .events = POLLOUT };
+        int n = poll(&pfd, 1, timeout);
+        if (n == 0 || (n < 0 && errno != EINTR)) {
+            return false;
+        }
+    }
+}
+
+// Send what we can of buf without blocking, and keep the rest in pending.
+// Returns false if the connection was lost.
+static bool
+sendOrKeep(const char *buf, size_t size)
+{
+    ASSERT(pending == NULL);
+    ssize_t r = sendSome(buf, size);
+    if (r < 0) {
+        return false;
+    }
+    if ((size_t) r < size) {
+        pending_size = size - r;
+        pending = stgMallocBytes(pending_size, "sendOrKeep");
+        memcpy(pending, buf + r, pending_size);
+    }
+    return true;
+}
+
+// Send what we can of pending without blocking. Returns false if the
+// connection was lost.
+static bool
+sendPending(void)
+{
+    ssize_t r = sendSome(pending, pending_size);
+    if (r < 0) {
+        return false;
+    }
+    if ((size_t) r == pending_size) {
+        discardPending();
+    } else if (r > 0) {
+        memmove(pending, pending + r, pending_size - r);
+        pending_size -= r;
+    }
+    return true;
+}
+
+// Send a whole buffer on the connection, according to the policy. Returns
+// false if the connection was lost.
+static bool
+sendBuffer(const char *buf, size_t size)
+{
+    if (RtsFlags.TraceFlags.eventlogSocketBlock) {
+        return sendAll(buf, size, -1);
+    } else {
+        return sendOrKeep(buf, size);
+    }
+}
+
+// Try to connect to the collector and send it the header. Returns true if we
+// are now connected.
+static bool
+connectEventLogSocket(void)
+{
+    const StgWord64 now = getMonotonicNSec();
+    if (last_connect_attempt != 0
+        && now - last_connect_attempt < EVENTLOG_SOCKET_RETRY) {
+        return false;
+    }
+    last_connect_attempt = now;
+
+    struct sockaddr_un addr;
+    if (strlen(event_log_socket_path) >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, event_log_socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return false;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#if defined(SO_NOSIGPIPE)
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    event_log_socket = fd;
+
+    if (header_copy != NULL) {
+        if (!sendBuffer(header_copy, header_copy_size)) {
+            closeEventLogSocket();
+            return false;
+        }
+        requestRepostInitEvents();
+    }
+    return true;
+}
+
+static void
+initEventLogSocketWriter(void)
+{
+    event_log_socket_path = RtsFlags.TraceFlags.trace_output + 5;
+    if (strlen(event_log_socket_path) >= sizeof(((struct sockaddr_un *) 0)->sun_path)) {
+        errorBelch("initEventLogSocketWriter: socket path too long: %s",
+                   event_log_socket_path);
+        stg_exit(EXIT_FAILURE);
+    }
+#if defined(THREADED_RTS)
+    initMutex(&socket_mutex);
+#endif
+    last_connect_attempt = 0;
+    dropped_buffers = 0;
+    // We don't have the header yet; the first write delivers it.
+    if (!connectEventLogSocket()) {
+        errorBelch("eventlog: could not connect to %s, will keep retrying",
+                   event_log_socket_path);
+    }
+}
+
+static bool
+writeEventLogSocket(void *eventlog, size_t eventlog_size)
+{
+    ACQUIRE_LOCK(&socket_mutex);
+
+    // See Note [Eventlog socket writer].
+    if (header_copy == NULL) {
+        const StgWord8 *p = eventlog;
+        ASSERT(eventlog_size >= 4);
+        ASSERT(((StgWord32) p[0] << 24 | (StgWord32) p[1] << 16 |
+                (StgWord32) p[2] << 8 | p[3]) == EVENT_HEADER_BEGIN);
+        header_copy = stgMallocBytes(eventlog_size, "writeEventLogSocket");
+        memcpy(header_copy, eventlog, eventlog_size);
+        header_copy_size = eventlog_size;
+        if (event_log_socket != -1 && !sendBuffer(eventlog, eventlog_size)) {
+            closeEventLogSocket();
+        }
+        RELEASE_LOCK(&socket_mutex);
+        return true;
+    }
+
+    if (event_log_socket == -1 && !connectEventLogSocket()) {
+        dropped_buffers++;
+        RELEASE_LOCK(&socket_mutex);
+        return true;
+    }
+
+    // Finish the buffer we have started sending first, see
+    // Note [Eventlog socket writer].
+    if (pending != NULL) {
+        if (!sendPending()) {
+            closeEventLogSocket();
+            dropped_buffers++;
+            RELEASE_LOCK(&socket_mutex);
+            return true;
+        }
+        if (pending != NULL) {
+            dropped_buffers++;
+            RELEASE_LOCK(&socket_mutex);
+            return true;
+        }
+    }
+
+    if (!sendBuffer(eventlog, eventlog_size)) {
+        // The collector went away; the rest of this buffer is lost.
+        closeEventLogSocket();
+        dropped_buffers++;
+    }
+
+    RELEASE_LOCK(&socket_mutex);
+    // Failures are accounted for in dropped_buffers; reporting them to the
+    // RTS would only produce a message per buffer.
+    return true;
+}
+
+static void
+stopEventLogSocketWriter(void)
+{
+    // Give the collector a little while to take the rest of the last buffer
+    // we started sending, rather than leave it with half an event.
+    if (pending != NULL
+        && !sendAll(pending, pending_size, EVENTLOG_SOCKET_RETRY / 1000000)) {
+        dropped_buffers++;
+    }
+    closeEventLogSocket();
+    if (header_copy != NULL) {
+        stgFree(header_copy);
+        header_copy = NULL;
+    }
+    if (dropped_buffers > 0) {
+        errorBelch("eventlog: dropped %" FMT_Word " buffers that could not be "
+                   "sent to %s", dropped_buffers, event_log_socket_path);
+    }
+#if defined(THREADED_RTS)
+    closeMutex(&socket_mutex);
+#endif
+}
+
+const EventLogWriter SocketEventLogWriter = {
+    .initEventLogWriter = initEventLogSocketWriter,
+    .writeEventLog = writeEventLogSocket,
+    .flushEventLog = NULL,
+    .stopEventLogWriter = stopEventLogSocketWriter
+};
+
+#endif /* TRACING && !mingw32_HOST_OS */
@@ -102,6 +102,12 @@ event_types = [
 
     EventType(90, 'MEM_RETURN',       [CapsetId, Word32, Word32, Word32],    'The RTS attempted to return heap memory to the OS'),
     EventType(91, 'BLOCKS_SIZE',      [CapsetId, Word64],                 'Report the size of the heap in blocks'),
+    EventType(92, 'THREAD_STEAL',     [ThreadId, CapNo],                  'Steal thread'),
+    EventType(93, 'THREAD_ACCOUNTING', [ThreadId, Word64, Word64],        'Thread allocation and CPU time'),
+    EventType(94, 'STM_STATS',        [CapNo] + 8*[Word64],               'STM statistics of a capability'),
+    EventType(95, 'STM_CONFLICT',     [Word64, Word64, Word16],           'A transaction failed to validate'),
+    EventType(96, 'STACK_SAMPLE',     VariableLength,                     'Topmost stack frames of a thread'),
+    EventType(97, 'SPARK_THROTTLE',   [Word16, Word16, Word64],           'Spark conversion ratio of a capability'),
 
     # Range 100 - 139 is reserved for Mercury.
 
@@ -289,6 +289,53 @@ int getRTSStatsEnabled (void);
 // TODO: can we remove this?
 uint64_t getAllocations (void);
 
+//
+// Statistics of the STM implementation, see Note [STM statistics] in STM.c
+//
+typedef struct _STMStats {
+    // Top-level transactions started, including re-executions
+  uint64_t starts;
+    // Transactions committed
+  uint64_t commits;
+    // Transactions rolled back: failed commits, and transactions abandoned
+    // because they became invalid while running or raised an exception
+  uint64_t aborts;
+    // Transactions which executed retry#
+  uint64_t retries;
+    // Validations which found a TVar changed or locked by another transaction
+  uint64_t validation_failures;
+    // Total and maximum number of TRec entries of transactions at commit
+  uint64_t trec_entries;
+  uint64_t max_trec_entries;
+    // Total number of TRec chunks of transactions at commit
+  uint64_t trec_chunks;
+} STMStats;
+
+// The statistics of all capabilities added up
+void getSTMStats (STMStats *s);
+// The statistics of one capability (all zero if there is no such capability)
+void getCapabilitySTMStats (uint32_t cap_no, STMStats *s);
+
+//
+// The recent fate of the sparks of a capability's spark pool, see
+// Note [Spark throttling] in Sparks.c. All zero in the non-threaded RTS.
+//
+typedef struct _SparkPoolStats {
+    // Sparks of the pool which were run, by this or another capability
+  uint64_t converted;
+    // Sparks of the pool which fizzled or were garbage collected
+  uint64_t wasted;
+    // Recent fraction of the sparks converted, per mille
+  uint64_t ratio;
+    // 1 if new sparks are being dropped (+RTS --spark-throttle), 0 otherwise
+  uint64_t throttled;
+    // Sparks dropped so far
+  uint64_t dropped;
+} SparkPoolStats;
+
+// The statistics of one capability (all zero if there is no such capability)
+void getCapabilitySparkPoolStats (uint32_t cap_no, SparkPoolStats *s);
+
 /* ----------------------------------------------------------------------------
    Starting up and shutting down the Haskell RTS.
    ------------------------------------------------------------------------- */
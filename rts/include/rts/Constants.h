@@ -394,6 +394,13 @@
  */
 #define TSO_STOP_AFTER_RETURN 1024
 
+/*
+ * TSO_STEALABLE is set while a runnable thread sits in its Capability's
+ * stealable_threads deque (+RTS -qs), where it may be claimed by another
+ * Capability. See Note [Thread stealing] in rts/Schedule.c.
+ */
+#define TSO_STEALABLE 2048
+
 /*
  * The number of times we spin in a spin lock before yielding (see
  * #3758).  To tune this value, use the benchmark in #3758: run the
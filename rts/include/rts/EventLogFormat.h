@@ -113,6 +113,13 @@
 #define CAPSET_TYPE_OSPROCESS   2  /* caps belong to the same OS process */
 #define CAPSET_TYPE_CLOCKDOMAIN 3  /* caps share a local clock/time      */
 
+/*
+ * The role of the TVar in the transaction, for EVENT_STM_CONFLICT
+ */
+#define STM_CONFLICT_UPDATE     1  /* written by the transaction         */
+#define STM_CONFLICT_READ       2  /* only read by the transaction       */
+#define STM_CONFLICT_INFLIGHT   3  /* found while the transaction ran    */
+
 /*
  * Heap profile breakdown types. See EVENT_HEAP_PROF_BEGIN.
  */
@@ -27,6 +27,11 @@
  * The API should be updated whenever RTS flags are modified.
  */
 
+/* Values of GcFlags.hugePages */
+#define HUGE_PAGES_NONE     0
+#define HUGE_PAGES_THP      1  /* transparent huge pages, via madvise() */
+#define HUGE_PAGES_HUGETLB  2  /* explicit huge pages, via MAP_HUGETLB */
+
 /* See Note [Synchronization of flags and base APIs] */
 typedef struct _GC_FLAGS {
     FILE   *statsFile;
@@ -91,6 +96,16 @@ typedef struct _GC_FLAGS {
     StgWord numaMask;
 
     StgWord64 addressSpaceSize;  /* large address space size in bytes */
+    uint32_t hugePages;          /* back the heap with huge pages (HUGE_PAGES_*) */
+
+    uint32_t nonmovingSweepThreads; /* threads sweeping the nonmoving heap,
+                                     * see Note [Parallel nonmoving sweep] */
+    uint32_t nonmovingMarkThreads;  /* threads marking the nonmoving heap,
+                                     * see Note [Parallel nonmoving mark] */
+
+    Time    gcPauseTarget;      /* units: TIME_RESOLUTION, 0 == off */
+    double  gcCpuTarget;        /* fraction of CPU time, 0 == off
+                                 * see Note [Adaptive GC sizing] */
 } GC_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -196,9 +211,15 @@ typedef struct _TRACE_FLAGS {
     /* Time between force eventlog flushes (or 0 if disabled) */
     Time eventlogFlushTime;
     int eventlogFlushTicks;
+    /* Spare eventlog buffers per capability for the background flusher
+     * thread (or 0 if full buffers are written synchronously) */
+    uint32_t eventlogAsyncBuffers;
 #endif
     char *trace_output;  /* output filename for eventlog */
     bool nullWriter; /* use null writer instead of file writer */
+    bool eventlogSocketBlock; /* wait for a slow -ol unix: consumer rather
+                                 than dropping buffers */
+    uint32_t stackSampleDepth; /* frames per stack sample (or 0 if disabled) */
 } TRACE_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -256,12 +277,17 @@ typedef enum _IO_MANAGER_FLAG {
      */
     IO_MNGR_FLAG_AUTO,
 
-    /* All other choices pick only the requested one, with no fallback. */
+    /* All other choices pick only the requested one, with no fallback, except
+     * for IO_MNGR_FLAG_IO_URING. That falls back to epoll (or the default)
+     * if the kernel turns out not to support io_uring, or it is disabled.
+     */
     IO_MNGR_FLAG_SELECT,          /* Unix only,    non-threaded RTS only */
     IO_MNGR_FLAG_POLL,            /* Unix only,    non-threaded RTS only */
     IO_MNGR_FLAG_MIO,             /* cross-platform,   threaded RTS only */
     IO_MNGR_FLAG_WINIO,           /* Windows only                        */
     IO_MNGR_FLAG_WIN32_LEGACY,    /* Windows only, non-threaded RTS only */
+    IO_MNGR_FLAG_EPOLL,           /* Linux only,   non-threaded RTS only */
+    IO_MNGR_FLAG_IO_URING,        /* Linux only,   non-threaded RTS only */
   } IO_MANAGER_FLAG;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -285,6 +311,12 @@ typedef struct _MISC_FLAGS {
                                   * for the linker, NULL ==> off */
     IO_MANAGER_FLAG ioManager;   /* The I/O manager to use.  */
     uint32_t numIoWorkerThreads; /* Number of I/O worker threads to use.  */
+    bool threadAccounting;       /* See Note [Thread accounting] */
+    bool linkerLazyArchives;     /* See Note [Lazy archive loading] */
+    uint32_t linkerThreads;      /* See Note [Parallel object resolution] */
+    uint32_t compactFixupThreads; /* See Note [Compact fixup table] */
+    bool stmVersionClock;        /* See Note [STM version clock] */
+    bool ioTimerWheel;           /* See Note [I/O manager timer wheel] */
 } MISC_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -314,6 +346,18 @@ typedef struct _PAR_FLAGS {
                                   * GC (default: use all nNodes). */
 
   bool           setAffinity;    /* force thread affinity with CPUs */
+
+  bool           stealThreads;   /* let idle capabilities steal runnable
+                                  * threads (+RTS -qs) */
+
+  bool           parCompact;     /* share the compaction of the oldest
+                                  * generation between the GC threads
+                                  * (+RTS -qc) */
+
+  double         sparkThrottle;  /* drop new sparks when less than this
+                                  * fraction of them are converted
+                                  * (0 == off). See Note [Spark
+                                  * throttling] */
 } PAR_FLAGS;
 
 /* Corresponds to the RTS flag `--read-tix-file=<yes|no>`.
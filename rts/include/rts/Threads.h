@@ -53,6 +53,11 @@ StgThreadID rts_getThreadId                  (StgPtr tso);
 void        rts_enableThreadAllocationLimit  (StgPtr tso);
 void        rts_disableThreadAllocationLimit (StgPtr tso);
 
+// Per-thread accounting, maintained with +RTS --thread-accounting (both
+// return 0 otherwise). The counters cover the thread's completed run slices.
+StgWord64   rts_getThreadAllocated           (StgPtr tso); // in bytes
+StgWord64   rts_getThreadCPUTime             (StgPtr tso); // in nanoseconds
+
 // Forward declarations, defined in Closures.h
 struct _StgMutArrPtrs;
 struct _StgMutArrPtrs *listThreads               (Capability *cap);
@@ -178,6 +178,9 @@ typedef struct bdescr_ {
  * onto nonmoving_large_objects. The mark phase ignores objects which aren't
  * so-flagged */
 #define BF_NONMOVING_SWEEPING 2048
+/* The first block of a compact block whose memory is mapped from a file (see
+ * Note [Compact region files] in rts/sm/CNF.c) */
+#define BF_COMPACT_FILE 4096
 /* Maximum flag value (do not define anything higher than this!) */
 #define BF_FLAG_MAX  (1 << 15)
 
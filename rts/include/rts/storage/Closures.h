@@ -557,6 +557,7 @@ struct StgTRecHeader_ {
   struct StgTRecHeader_     *enclosing_trec;
   StgTRecChunk              *current_chunk MUT_FIELD;
   TRecState                  state;
+  StgWord                    read_version; /* See Note [STM version clock] */
 };
 
 /* A stack frame delimiting an STM transaction */
@@ -308,6 +308,20 @@ void setKeepCAFs (void);
 // to be retained. Useful in conjunction with loadNativeObj
 void setHighMemDynamic (void);
 
+/* -----------------------------------------------------------------------------
+   Compact regions in files, see Note [Compact region files] in rts/sm/CNF.c
+   -------------------------------------------------------------------------- */
+
+// Write the compact starting with first, and its root, to fd. Returns 0 on
+// success and -1, with errno set, on error.
+int compactWriteFd (StgCompactNFDataBlock *first, StgPtr root, int fd);
+
+// Read a compact written by compactWriteFd from fd. Returns its first block
+// and sets *root, which must then be passed to compactFixupPointers# along
+// with the block. Returns NULL, with errno set, on error. Must be called by
+// the Haskell thread owning the current capability (an unsafe foreign call).
+StgCompactNFDataBlock *compactReadFd (int fd, StgPtr *root);
+
 /* -----------------------------------------------------------------------------
    This is the write barrier for MUT_VARs, a.k.a. IORefs.  A
    MUT_VAR_CLEAN object is not on the mutable list; a MUT_VAR_DIRTY
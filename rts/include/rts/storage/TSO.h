@@ -232,6 +232,16 @@ typedef struct StgTSO_ {
      */
     StgWord    ctoi_tuple_spill_words;
 
+    /*
+     * Bytes allocated and CPU time (in Time units) used by this thread so
+     * far, maintained by the scheduler with +RTS --thread-accounting. See
+     * Note [Thread accounting] in rts/Threads.c.
+     *
+     * Like alloc_limit, use only PK_Word64/ASSIGN_Word64 to access these.
+     */
+    StgWord64  acct_allocated;
+    StgWord64  acct_cpu_time;
+
 #if defined(TICKY_TICKY)
     /* TICKY-specific stuff would go here. */
 #endif
@@ -520,6 +520,7 @@ busy_wait_nop(void)
 // Acquire/release atomic operations
 #define ACQUIRE_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
 #define RELEASE_STORE(ptr,val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define RELEASE_AND(ptr,val) __atomic_and_fetch(ptr, val, __ATOMIC_RELEASE)
 
 // Sequentially consistent atomic operations
 #define SEQ_CST_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
@@ -572,6 +573,7 @@ busy_wait_nop(void)
 // Acquire/release atomic operations
 #define ACQUIRE_LOAD(ptr) *ptr
 #define RELEASE_STORE(ptr,val) *ptr = val
+#define RELEASE_AND(ptr,val) *ptr &= val
 
 // Sequentially consistent atomic operations
 #define SEQ_CST_LOAD(ptr) *ptr
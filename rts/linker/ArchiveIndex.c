@@ -0,0 +1,546 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2026
+ *
+ * Lazy loading of archive members through the archive's symbol index.
+ *
+ * ---------------------------------------------------------------------------*/
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "RtsUtils.h"
+#include "Hash.h"
+#include "PathUtils.h"
+#include "LinkerInternals.h"
+#include "CheckUnload.h" // loaded_objects, insertOCSectionIndices
+#include "linker/ArchiveIndex.h"
+
+#if defined(OBJFORMAT_ELF)
+
+#include "linker/Elf.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
+#define DEBUG_LOG(...) IF_DEBUG(linker, debugBelch("archiveIndex: " __VA_ARGS__))
+
+/* Note [Lazy archive loading]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * loadArchive normally reads every object file in an archive, parses its
+ * symbol table and inserts all of its symbols into symhash, even though
+ * typically only a few members are ever needed (see Note [runtime-linker-
+ * phases]). For large archives, such as those of the boot packages, this
+ * dominates the time GHCi and Template Haskell spend loading packages.
+ *
+ * With +RTS --linker-lazy-archives, loadArchive instead maps the archive
+ * and reads only its symbol index: the "/" (or "/SYM64/") member which ar and
+ * ranlib put at the start of an archive, listing each defined symbol together
+ * with the offset of the member defining it. The names are inserted into
+ * lazy_symhash, pointing into the mapping, so this costs one hash insertion
+ * per symbol and touches only the pages of the index.
+ *
+ * lookupDependentSymbol consults lazy_symhash when a name isn't in symhash and
+ * before falling back to dlsym, which is the order in which it would have
+ * found the symbol had the archive been loaded eagerly. The member is then
+ * copied out of the mapping and loaded exactly as loadArchive would have
+ * loaded it, after which its symbols are in symhash and the lookup is
+ * retried. Members are loaded at most once.
+ *
+ * The differences from eager loading are:
+ *
+ *  - If several indexed archives define a symbol, the first archive to be
+ *    loaded wins, rather than the duplicate being reported when the second
+ *    archive is loaded. Likewise a symbol which is already in symhash hides
+ *    the archive's definition.
+ *
+ *  - Members which define no symbols are never loaded. Such members have no
+ *    effect other than running their initializers, which is also what
+ *    happens with the system linker.
+ *
+ * Thin archives and archives without an index are loaded eagerly.
+ */
+
+struct ArchiveIndex_;
+
+typedef struct ArchiveMember_ {
+    struct ArchiveIndex_ *index;
+    // Offset of the member's header in the archive
+    StgWord offset;
+    // Position of the member in the archive, as counted by loadArchive_.
+    // Only valid once the index is numbered; see numberMembers.
+    int number;
+    bool loaded;
+} ArchiveMember;
+
+typedef struct ArchiveIndex_ {
+    pathchar *path;
+    const char *image;
+    size_t size;
+    // The GNU long file name table ("//" member), if any
+    const char *long_names;
+    size_t long_names_size;
+    // Members named by the index, keyed by offset
+    HashTable *members;
+    // Have the members been numbered yet?
+    bool numbered;
+    struct ArchiveIndex_ *next;
+} ArchiveIndex;
+
+// Symbol name (pointing into an archive's mapping) -> ArchiveMember *
+static StrHashTable *lazy_symhash = NULL;
+
+static ArchiveIndex *archive_indices = NULL;
+
+#define AR_MAGIC      "!<arch>\n"
+#define AR_MAGIC_SIZE 8
+#define AR_HDR_SIZE   60
+
+static uint64_t readBigEndian(const unsigned char *p, int n)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < n; i++) {
+        r = (r << 8) | p[i];
+    }
+    return r;
+}
+
+// Parse the decimal size field of the member header at hdr. Returns false if
+// it is malformed.
+static bool memberSize(const char *hdr, size_t *size)
+{
+    size_t r = 0;
+    int i = 48;
+    for (; i < 58 && hdr[i] >= '0' && hdr[i] <= '9'; i++) {
+        r = r * 10 + (hdr[i] - '0');
+    }
+    for (; i < 58 && hdr[i] == ' '; i++) {}
+    if (i != 58 || hdr[58] != '`' || hdr[59] != '\n') {
+        return false;
+    }
+    *size = r;
+    return true;
+}
+
+static ArchiveIndex *findArchiveIndex(pathchar *path)
+{
+    for (ArchiveIndex *idx = archive_indices; idx; idx = idx->next) {
+        if (pathcmp(idx->path, path) == 0) {
+            return idx;
+        }
+    }
+    return NULL;
+}
+
+bool isArchiveIndexed(pathchar *path)
+{
+    return findArchiveIndex(path) != NULL;
+}
+
+// Find the symbol index and the long name table, which precede the first
+// object file. On success *symtab points to the index (NULL if there is none)
+// and *word is the width of its fields.
+static bool findSymbolTable(ArchiveIndex *idx, const unsigned char **symtab,
+                            size_t *symtab_size, int *word)
+{
+    size_t off = AR_MAGIC_SIZE;
+    *symtab = NULL;
+    while (off + AR_HDR_SIZE <= idx->size) {
+        const char *hdr = idx->image + off;
+        size_t size;
+        if (!memberSize(hdr, &size) || size > idx->size - off - AR_HDR_SIZE) {
+            errorBelch("loadArchive: malformed member header at offset %zu "
+                       "in `%" PATH_FMT "'", off, idx->path);
+            return false;
+        }
+        const char *data = hdr + AR_HDR_SIZE;
+        if (memcmp(hdr, "/               ", 16) == 0) {
+            *symtab = (const unsigned char *) data;
+            *symtab_size = size;
+            *word = 4;
+        } else if (memcmp(hdr, "/SYM64/         ", 16) == 0) {
+            *symtab = (const unsigned char *) data;
+            *symtab_size = size;
+            *word = 8;
+        } else if (memcmp(hdr, "//              ", 16) == 0) {
+            idx->long_names = data;
+            idx->long_names_size = size;
+        } else {
+            break;
+        }
+        off += AR_HDR_SIZE + size + (size & 1);
+    }
+    return true;
+}
+
+static bool addSymbols(ArchiveIndex *idx, const unsigned char *symtab,
+                       size_t symtab_size, int word)
+{
+    if (symtab_size < (size_t) word) {
+        goto malformed;
+    }
+    uint64_t n = readBigEndian(symtab, word);
+    if (n > (symtab_size - word) / word) {
+        goto malformed;
+    }
+    const unsigned char *offsets = symtab + word;
+    const char *name = (const char *) offsets + n * word;
+    const char *end = (const char *) symtab + symtab_size;
+
+    for (uint64_t i = 0; i < n; i++) {
+        const char *name_end = memchr(name, '\0', end - name);
+        if (name_end == NULL) {
+            goto malformed;
+        }
+        uint64_t offset = readBigEndian(offsets + i * word, word);
+        if (offset < AR_MAGIC_SIZE || offset > idx->size - AR_HDR_SIZE) {
+            goto malformed;
+        }
+
+        ArchiveMember *member = lookupHashTable(idx->members, offset);
+        if (member == NULL) {
+            member = stgMallocBytes(sizeof(ArchiveMember), "addSymbols");
+            member->index = idx;
+            member->offset = offset;
+            member->number = -1;
+            member->loaded = false;
+            insertHashTable(idx->members, offset, member);
+        }
+        if (lookupStrHashTable(lazy_symhash, name) == NULL) {
+            insertStrHashTable(lazy_symhash, name, member);
+        }
+        name = name_end + 1;
+    }
+    DEBUG_LOG("indexed %" FMT_Word64 " symbols in %d members of `%" PATH_FMT "'\n",
+              (StgWord64) n, keyCountHashTable(idx->members), idx->path);
+    return true;
+
+malformed:
+    errorBelch("loadArchive: malformed symbol index in `%" PATH_FMT "'",
+               idx->path);
+    return false;
+}
+
+static void freeArchiveIndex(ArchiveIndex *idx)
+{
+    freeHashTable(idx->members, stgFree);
+    munmap((void *) idx->image, idx->size);
+    stgFree(idx->path);
+    stgFree(idx);
+}
+
+HsInt indexArchive(pathchar *path)
+{
+    ASSERT_LOCK_HELD(&linker_mutex);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        errorBelch("loadArchive: can't open `%" PATH_FMT "'", path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        errorBelch("loadArchive: can't stat `%" PATH_FMT "'", path);
+        close(fd);
+        return 0;
+    }
+    size_t size = st.st_size;
+    if (size < AR_MAGIC_SIZE + AR_HDR_SIZE) {
+        // Too small to have an index; let loadArchive deal with it.
+        close(fd);
+        return -1;
+    }
+    // We only ever copy members out of this mapping, so unlike object images
+    // it needn't be placed near the other code (see Note [MAP_LOW_MEM]).
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        errorBelch("loadArchive: can't map `%" PATH_FMT "'", path);
+        return 0;
+    }
+    if (memcmp(image, AR_MAGIC, AR_MAGIC_SIZE) != 0) {
+        // Thin archives, and anything else, are loaded eagerly.
+        munmap(image, size);
+        return -1;
+    }
+
+    ArchiveIndex *idx = stgMallocBytes(sizeof(ArchiveIndex), "indexArchive");
+    idx->path = pathdup(path);
+    idx->image = image;
+    idx->size = size;
+    idx->long_names = NULL;
+    idx->long_names_size = 0;
+    idx->members = allocHashTable();
+    idx->numbered = false;
+
+    const unsigned char *symtab;
+    size_t symtab_size;
+    int word;
+    if (!findSymbolTable(idx, &symtab, &symtab_size, &word)) {
+        freeArchiveIndex(idx);
+        return 0;
+    }
+    if (symtab == NULL) {
+        DEBUG_LOG("`%" PATH_FMT "' has no symbol index\n", path);
+        freeArchiveIndex(idx);
+        return -1;
+    }
+
+    if (lazy_symhash == NULL) {
+        lazy_symhash = allocStrHashTable();
+    }
+    if (!addSymbols(idx, symtab, symtab_size, word)) {
+        // Some of the names may already have been inserted.
+        idx->next = archive_indices;
+        archive_indices = idx;
+        unloadArchiveIndex(path);
+        return 0;
+    }
+
+    idx->next = archive_indices;
+    archive_indices = idx;
+    return 1;
+}
+
+// Work out the name of the member whose header is at hdr, for diagnostics.
+// Also adjusts *data and *size for BSD-style names, which precede the data.
+static void memberName(ArchiveIndex *idx, const char *hdr, const char **name,
+                       int *name_len, const char **data, size_t *size)
+{
+    *name = hdr;
+    if (hdr[0] == '/' && hdr[1] >= '0' && hdr[1] <= '9' && idx->long_names) {
+        size_t off = 0;
+        for (int i = 1; i < 16 && hdr[i] >= '0' && hdr[i] <= '9'; i++) {
+            off = off * 10 + (hdr[i] - '0');
+        }
+        if (off < idx->long_names_size) {
+            *name = idx->long_names + off;
+            const char *end = memchr(*name, '\n', idx->long_names_size - off);
+            *name_len = end ? end - *name : 0;
+        } else {
+            *name_len = 16;
+        }
+    } else if (strncmp(hdr, "#1/", 3) == 0) {
+        size_t len = 0;
+        for (int i = 3; i < 16 && hdr[i] >= '0' && hdr[i] <= '9'; i++) {
+            len = len * 10 + (hdr[i] - '0');
+        }
+        len = stg_min(len, *size);
+        *name = *data;
+        *name_len = len;
+        *data += len;
+        *size -= len;
+        return;
+    } else {
+        *name_len = 16;
+    }
+    // Strip the terminating '/' and padding
+    while (*name_len > 0 && ((*name)[*name_len - 1] == ' ' ||
+                             (*name)[*name_len - 1] == '/')) {
+        (*name_len)--;
+    }
+}
+
+// Work out the position of each indexed member in the archive, counting every
+// member (including the symbol index and long name table) as loadArchive_
+// does. The loaded object is named after its position, and it must get the
+// same name however it was loaded. This reads every member header, so we only
+// do it when the first member of the archive is loaded.
+static bool numberMembers(ArchiveIndex *idx)
+{
+    size_t off = AR_MAGIC_SIZE;
+    int n = 0;
+    while (off + AR_HDR_SIZE <= idx->size) {
+        size_t size;
+        if (!memberSize(idx->image + off, &size)
+            || size > idx->size - off - AR_HDR_SIZE) {
+            errorBelch("loadArchive: malformed member header at offset %zu "
+                       "in `%" PATH_FMT "'", off, idx->path);
+            return false;
+        }
+        ArchiveMember *member = lookupHashTable(idx->members, off);
+        if (member != NULL) {
+            member->number = n;
+        }
+        n++;
+        off += AR_HDR_SIZE + size + (size & 1);
+    }
+    idx->numbered = true;
+    return true;
+}
+
+bool loadArchiveMemberForSymbol(SymbolName *lbl)
+{
+    ASSERT_LOCK_HELD(&linker_mutex);
+
+    if (lazy_symhash == NULL) {
+        return false;
+    }
+    ArchiveMember *member = lookupStrHashTable(lazy_symhash, lbl);
+    if (member == NULL || member->loaded) {
+        return false;
+    }
+    // Whatever happens below, don't try again.
+    member->loaded = true;
+
+    ArchiveIndex *idx = member->index;
+    if (!idx->numbered && !numberMembers(idx)) {
+        return false;
+    }
+    const char *hdr = idx->image + member->offset;
+    size_t size;
+    if (!memberSize(hdr, &size)
+        || size > idx->size - member->offset - AR_HDR_SIZE) {
+        errorBelch("loadArchive: malformed member header at offset %"
+                   FMT_Word " in `%" PATH_FMT "'", member->offset, idx->path);
+        return false;
+    }
+    const char *data = hdr + AR_HDR_SIZE;
+    const char *name;
+    int name_len;
+    memberName(idx, hdr, &name, &name_len, &data, &size);
+
+    DEBUG_LOG("loading `%.*s' from `%" PATH_FMT "' for symbol %s\n",
+              name_len, name, idx->path, lbl);
+
+    if (size < 4 || memcmp(data, "\177ELF", 4) != 0) {
+        errorBelch("loadArchive: `%.*s' in `%" PATH_FMT "' is not an object "
+                   "file", name_len, name, idx->path);
+        return false;
+    }
+
+    char *image = stgMallocBytes(size, "loadArchiveMemberForSymbol(image)");
+    memcpy(image, data, size);
+
+    // The same name as loadArchive_ gives the member
+    int len = pathprintf(NULL, 0, WSTR("%" PATH_FMT "(#%d:%.*s)"),
+                         idx->path, member->number, name_len, name);
+    pathchar *archiveMemberName =
+        stgMallocBytes((len + 1) * sizeof(pathchar), "loadArchiveMemberForSymbol");
+    pathprintf(archiveMemberName, len + 1, WSTR("%" PATH_FMT "(#%d:%.*s)"),
+               idx->path, member->number, name_len, name);
+
+    ObjectCode *oc = mkOc(STATIC_OBJECT, idx->path, image, size, false,
+                          archiveMemberName, 0);
+    ocInit_ELF(oc);
+    stgFree(archiveMemberName);
+
+    if (0 == loadOc(oc)) {
+        return false;
+    }
+    insertOCSectionIndices(oc); // also adds the object to `objects` list
+    oc->next_loaded_object = loaded_objects;
+    loaded_objects = oc;
+    return true;
+}
+
+void loadArchiveMembersForObject(ObjectCode *oc)
+{
+    if (archive_indices == NULL) {
+        return;
+    }
+    for (ElfSymbolTable *symTab = oc->info->symbolTables;
+         symTab != NULL; symTab = symTab->next) {
+        for (size_t i = 0; i < symTab->n_symbols; i++) {
+            ElfSymbol *symbol = &symTab->symbols[i];
+            if (symbol->elf_sym->st_shndx == SHN_UNDEF
+                && symbol->name != NULL && symbol->name[0] != '\0'
+                && lookupStrHashTable(symhash, symbol->name) == NULL) {
+                loadArchiveMemberForSymbol(symbol->name);
+            }
+        }
+    }
+}
+
+bool unloadArchiveIndex(pathchar *path)
+{
+    ArchiveIndex *prev = NULL, *idx;
+    for (idx = archive_indices; idx; prev = idx, idx = idx->next) {
+        if (pathcmp(idx->path, path) == 0) {
+            break;
+        }
+    }
+    if (idx == NULL) {
+        return false;
+    }
+    if (prev == NULL) {
+        archive_indices = idx->next;
+    } else {
+        prev->next = idx->next;
+    }
+
+    // Remove the names this archive contributed, which point into its mapping.
+    const unsigned char *symtab;
+    size_t symtab_size;
+    int word;
+    if (findSymbolTable(idx, &symtab, &symtab_size, &word) && symtab != NULL
+        && symtab_size >= (size_t) word) {
+        uint64_t n = readBigEndian(symtab, word);
+        const char *name = (const char *) symtab + word + n * word;
+        const char *end = (const char *) symtab + symtab_size;
+        for (uint64_t i = 0; i < n && name < end; i++) {
+            const char *name_end = memchr(name, '\0', end - name);
+            if (name_end == NULL) {
+                break;
+            }
+            ArchiveMember *member = lookupStrHashTable(lazy_symhash, name);
+            if (member != NULL && member->index == idx) {
+                removeStrHashTable(lazy_symhash, name, NULL);
+            }
+            name = name_end + 1;
+        }
+    }
+
+    freeArchiveIndex(idx);
+    return true;
+}
+
+void exitArchiveIndices(void)
+{
+    while (archive_indices) {
+        ArchiveIndex *idx = archive_indices;
+        archive_indices = idx->next;
+        freeArchiveIndex(idx);
+    }
+    if (lazy_symhash != NULL) {
+        freeStrHashTable(lazy_symhash, NULL);
+        lazy_symhash = NULL;
+    }
+}
+
+#else /* !OBJFORMAT_ELF */
+
+HsInt indexArchive(pathchar *path STG_UNUSED)
+{
+    return -1;
+}
+
+bool isArchiveIndexed(pathchar *path STG_UNUSED)
+{
+    return false;
+}
+
+bool loadArchiveMemberForSymbol(SymbolName *lbl STG_UNUSED)
+{
+    return false;
+}
+
+void loadArchiveMembersForObject(ObjectCode *oc STG_UNUSED)
+{
+}
+
+bool unloadArchiveIndex(pathchar *path STG_UNUSED)
+{
+    return false;
+}
+
+void exitArchiveIndices(void)
+{
+}
+
+#endif /* OBJFORMAT_ELF */
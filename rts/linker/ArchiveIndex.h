@@ -0,0 +1,46 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2026
+ *
+ * Lazy loading of archive members through the archive's symbol index.
+ *
+ * ---------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Rts.h"
+#include "LinkerInternals.h"
+
+#include "BeginPrivate.h"
+
+/* Map the archive at path and register the symbols of its symbol index
+ * (see Note [Lazy archive loading]). Returns 1 on success and 0 on error. If
+ * the archive has no usable index (e.g. it is a thin archive) returns -1 and
+ * the caller should load it eagerly instead.
+ */
+HsInt indexArchive(pathchar *path);
+
+/* Has indexArchive been called on path (and not undone by unloadObj)? */
+bool isArchiveIndexed(pathchar *path);
+
+/* If lbl is defined by a member of an indexed archive which hasn't been loaded
+ * yet, load that member. Returns true if a member was loaded; lbl should then
+ * be looked up in symhash again.
+ */
+bool loadArchiveMemberForSymbol(SymbolName *lbl);
+
+/* Load the members defining the symbols which oc refers to but which are not
+ * in symhash yet, so that oc can be relocated without loading anything. Used
+ * by resolveObjs when relocating objects in parallel.
+ */
+void loadArchiveMembersForObject(ObjectCode *oc);
+
+/* Forget the index of the archive at path. Members which were loaded from it
+ * are unloaded in the usual way by unloadObj. Returns false if the archive
+ * wasn't indexed.
+ */
+bool unloadArchiveIndex(pathchar *path);
+
+void exitArchiveIndices(void);
+
+#include "EndPrivate.h"
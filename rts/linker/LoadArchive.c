@@ -8,6 +8,7 @@
 #include "CheckUnload.h" // loaded_objects, insertOCSectionIndices
 #include "linker/M32Alloc.h"
 #include "linker/MMap.h"
+#include "linker/ArchiveIndex.h"
 
 /* Platform specific headers */
 #if defined(OBJFORMAT_PEi386)
@@ -386,12 +387,20 @@ HsInt loadArchive_ (pathchar *path)
 
     /* Check that we haven't already loaded this archive.
        Ignore requests to load multiple times */
-    if (isAlreadyLoaded(path)) {
+    if (isAlreadyLoaded(path) || isArchiveIndexed(path)) {
         IF_DEBUG(linker,
                  debugBelch("ignoring repeated load of %" PATH_FMT "\n", path));
         return 1; /* success */
     }
 
+    /* See Note [Lazy archive loading] */
+    if (RtsFlags.MiscFlags.linkerLazyArchives) {
+        HsInt r = indexArchive(path);
+        if (r >= 0) {
+            return r;
+        }
+    }
+
     char *gnuFileIndex = NULL;
     int gnuFileIndexSize = 0;
 
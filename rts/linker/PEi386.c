@@ -557,7 +557,8 @@ static void addLoadedDll(LoadedDllCache *cache, const pathchar *dll_name, HINSTA
     size_t size = wcslen(dll_name) + 1;
     pathchar* dll_name_copy = stgMallocBytes(size * sizeof(pathchar), "addLoadedDll");
     wcsncpy(dll_name_copy, dll_name, size);
-    insertHashTable_(cache->hash, (StgWord) dll_name_copy, instance, hash_path);
+    insertHashTable_(cache->hash, (StgWord) dll_name_copy, instance, hash_path,
+                     compare_path);
 }
 
 static HINSTANCE isDllLoaded(const LoadedDllCache *cache, const pathchar *dll_name)
@@ -0,0 +1,726 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * An I/O manager based on the Linux epoll() API.
+ *
+ * ---------------------------------------------------------------------------*/
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+#include "RtsFlags.h" // needed by SET_HDR macro
+
+#include "IOManager.h" // defines IOMGR_ENABLED_EPOLL
+
+#if defined(IOMGR_ENABLED_EPOLL)
+
+#include "Capability.h"
+#include "Threads.h"
+#include "Schedule.h"
+#include "Prelude.h"
+#include "RtsUtils.h"
+#include "rts/Time.h"
+#include "RaiseAsync.h"
+#include "Trace.h"
+
+#include "Epoll.h"
+#include "RtsSignals.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "IOManagerInternals.h"
+#include "Timeout.h"
+#include "FdWakeup.h"
+
+/******************************************************************************
+
+This I/O manager is based on the Linux epoll() API.
+
+    int epoll_create1(int flags);
+    int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+    int epoll_wait(int epfd, struct epoll_event *events,
+                   int maxevents, int timeout);
+
+The essential difference with the poll() I/O manager is where the set of fds
+of interest lives. With poll() we pass the whole set to the kernel on every
+call, so each call costs O(n) in the number of threads waiting on I/O, even if
+only one fd is ready. With epoll the interest set is kept persistently within
+the kernel (in the epoll instance), and is updated incrementally using
+epoll_ctl(). Each epoll_wait() then costs O(k) in the number of fds that are
+actually ready, independently of the number of fds being waited on.
+
+The consequence of this is that we have to change how we organise things. The
+poll I/O manager keeps one poll table entry per I/O operation, and does not
+group operations by fd. The kernel epoll interest set however has (at most) one
+entry per fd, and we cannot register the same fd twice. So we have to group the
+I/O operations by fd, and by direction (read or write).
+
+We use two auxiliary tables, both on the C heap:
+
+ * The aiop_epoll_table, with indexes matching the aiop_table. The aiop_table
+   is a ClosureTable of AsyncIOOps, used in non-compact mode, so that the
+   index of each operation is stable. Each entry records the fd and direction
+   of the operation, and links the operation into a list of operations
+   waiting on the same (fd, direction). The lists use table indexes, not
+   pointers, with AIOP_IX_NULL as the end marker.
+
+ * The fd_table, indexed by fd number. Each entry holds the heads of the two
+   lists of waiting operations (one for read and one for write), and the state
+   of the fd in the kernel interest set. Fds are small dense integers so this
+   direct indexing works well. We enlarge the table by doubling as needed.
+
+We register fds with EPOLLONESHOT. This means that after epoll_wait() reports
+an event for an fd, the fd is disarmed: it stays in the interest set, but
+will not report further events until we re-arm it using EPOLL_CTL_MOD. We arm
+an fd when a thread starts waiting on it (and thus after it has consumed any
+previous readiness). We re-arm an fd after an event if there are remaining
+waiters in the other direction. Using level-triggered one-shot events gives us
+exactly the semantics of poll(): a thread waiting on an fd that is already
+ready is notified immediately, and we never spin on fds that are ready but
+where no-one is waiting. This approach is the same as used by the MIO I/O
+manager's epoll backend in the threaded RTS.
+
+It costs one epoll_ctl() syscall to start each wait. There is no syscall on
+completion or on cancellation. For a cancelled wait, the fd may remain armed,
+which will cause at most one spurious event later, which is simply ignored.
+
+There are a couple of differences from poll() in the error cases:
+
+ * Regular files do not support epoll, and epoll_ctl() returns EPERM. Regular
+   files are always ready for I/O, and poll() reports them as such, so we do
+   the same: we complete the operation immediately with success.
+
+ * Invalid fds are reported by epoll_ctl() at the time we register the fd,
+   rather than by the wait (poll reports them with POLLNVAL). We complete
+   such operations immediately with the EBADF error. This results in an
+   exception being raised in the waiting thread, just as for the poll I/O
+   manager.
+
+ * The kernel drops an fd from the interest set when the fd is closed. Unlike
+   with poll(), closing an fd while threads are waiting on it will not wake
+   those threads. This is the same as for the MIO I/O manager. (The MIO
+   manager avoids the problem by having closeFdWith notify the I/O manager,
+   but this is not done in the non-threaded RTS.)
+
+Operations that are completed immediately at the time they are started are
+put onto the completed list (which uses the same list links as the per-fd
+lists). They are notified the next time the scheduler polls or waits for I/O.
+We cannot notify them immediately because we are still in the context of the
+primop that is blocking the thread.
+
+We use the shared StgTimeoutQueue to track timeouts, and use the delay to the
+next timeout (if any) as the epoll_wait() timeout parameter. The epoll_wait()
+timeout only has millisecond resolution, so that is the timer resolution for
+this I/O manager.
+
+We support waking the I/O manager when it is blocked in epoll_wait() by adding
+the interrupt_fd_r to the interest set (level triggered, not one-shot). Events
+for the interrupt fd are distinguished by their fd number.
+
+The CapIOManager structure for this I/O manager contains:
+
+    ClosureTable          aiop_table;
+    StgTimeoutQueue      *timeout_queue;
+    TimerWheel           *timer_wheel;
+    int                   epoll_fd;
+    struct EpollAIOPInfo *aiop_epoll_table;
+    struct EpollFdInfo   *fd_table;
+    int                   fd_table_size;
+    struct epoll_event   *event_buffer;
+    int                   event_buffer_size;
+    int                   completed_hd;
+    int interrupt_fd_r, interrupt_fd_w;
+
+******************************************************************************/
+
+/* List end marker, for the lists of aiop_table indexes */
+#define AIOP_IX_NULL (-1)
+
+/* The initial and maximum number of events collected per epoll_wait() call.
+ * The buffer is doubled when a call returns a full buffer. Any events beyond
+ * the maximum are simply collected by the next call.
+ */
+#define EVENT_BUFFER_INIT_SIZE 64
+#define EVENT_BUFFER_MAX_SIZE  4096
+
+/* Auxiliary info for each entry in the aiop_table */
+typedef struct EpollAIOPInfo {
+    int fd;
+    int next;            /* next aiop index in the same list, or AIOP_IX_NULL */
+    IOReadOrWrite rw;
+    bool completed;      /* on the completed list rather than an fd list */
+} EpollAIOPInfo;
+
+/* Info for each fd, indexed by fd number */
+typedef struct EpollFdInfo {
+    int  waiters[2];     /* aiop index list heads, indexed by IOReadOrWrite */
+    bool registered;     /* is the fd (believed to be) in the interest set */
+} EpollFdInfo;
+
+/* Forward declarations */
+static bool enlargeTables(CapIOManager *iomgr);
+static void enlargeFdTable(CapIOManager *iomgr, int fd);
+static int  armFd(CapIOManager *iomgr, int fd);
+static void completeAtSubmission(CapIOManager *iomgr, int ix,
+                                 enum IOOpOutcome outcome, int error);
+static void completeWaiters(CapIOManager *iomgr, int *hd,
+                            enum IOOpOutcome outcome, int error);
+static void notifyIOCompletion(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+static void ioCancel(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+static void reportEpollError(const char *what, int res) STG_NORETURN;
+
+
+void initCapabilityIOManagerEpoll(CapIOManager *iomgr)
+{
+    initClosureTable(&iomgr->aiop_table, ClosureTableNonCompact);
+    initTimeouts(iomgr);
+
+    iomgr->aiop_epoll_table = NULL;
+    iomgr->fd_table         = NULL;
+    iomgr->fd_table_size    = 0;
+    iomgr->completed_hd     = AIOP_IX_NULL;
+
+    iomgr->event_buffer_size = EVENT_BUFFER_INIT_SIZE;
+    iomgr->event_buffer =
+        stgMallocBytes(sizeof(struct epoll_event) * EVENT_BUFFER_INIT_SIZE,
+                       "initCapabilityIOManagerEpoll");
+
+    iomgr->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (RTS_UNLIKELY(iomgr->epoll_fd < 0)) {
+        reportEpollError("epoll_create1", iomgr->epoll_fd);
+    }
+
+#if defined(HAVE_PREEMPTION)
+    newFdWakeup(&iomgr->interrupt_fd_r, &iomgr->interrupt_fd_w);
+
+    /* The interrupt fd is level triggered, and permanently armed. */
+    struct epoll_event ev = {
+                              .events = EPOLLIN,
+                              .data   = { .fd = iomgr->interrupt_fd_r }
+                            };
+    int res = epoll_ctl(iomgr->epoll_fd, EPOLL_CTL_ADD,
+                        iomgr->interrupt_fd_r, &ev);
+    if (RTS_UNLIKELY(res < 0)) {
+        reportEpollError("epoll_ctl", res);
+    }
+#endif
+}
+
+
+void freeCapabilityIOManagerEpoll(CapIOManager *iomgr)
+{
+    /* This is also used after forkProcess, in the child. The child inherits
+     * the epoll fd but shares the underlying epoll instance with the parent,
+     * so we close it here and initCapabilityIOManagerEpoll will create a
+     * fresh one.
+     */
+    close(iomgr->epoll_fd);
+    stgFree(iomgr->event_buffer);
+    stgFree(iomgr->fd_table);
+    stgFree(iomgr->aiop_epoll_table);
+    freeTimeouts(iomgr);
+#if defined(HAVE_PREEMPTION)
+    closeFdWakeup(iomgr->interrupt_fd_r, iomgr->interrupt_fd_w);
+#endif
+}
+
+
+/* Used to implement syncIOWaitReady.
+ * Result is true on success, or false on allocation failure. */
+bool syncIOWaitReadyEpoll(CapIOManager *iomgr, StgTSO *tso,
+                          IOReadOrWrite rw, HsInt fd)
+{
+    StgAsyncIOOp *aiop;
+    aiop = (StgAsyncIOOp *)allocateMightFail(iomgr->cap, sizeofW(StgAsyncIOOp));
+    if (RTS_UNLIKELY(aiop == NULL)) return false;
+    SET_HDR(aiop, &stg_ASYNCIOOP_info, iomgr->cap->r.rCCCS);
+    aiop->notify.tso     = tso;
+    aiop->notify_type    = NotifyTSO;
+    aiop->live           = &stg_ASYNCIO_LIVE0_closure;
+    tso->block_info.aiop = aiop;
+    RELEASE_STORE(&tso->why_blocked, rw == IORead ? BlockedOnRead
+                                                  : BlockedOnWrite);
+    return asyncIOWaitReadyEpoll(iomgr, aiop, rw, fd);
+}
+
+/* Result is true on success, or false on allocation failure. */
+bool asyncIOWaitReadyEpoll(CapIOManager *iomgr, StgAsyncIOOp *aiop,
+                           IOReadOrWrite rw, int fd)
+{
+    if (RTS_UNLIKELY(isFullClosureTable(&iomgr->aiop_table))) {
+        bool ok = enlargeTables(iomgr);
+        if (RTS_UNLIKELY(!ok)) return false;
+    }
+
+    int ix = insertClosureTable(iomgr->cap, &iomgr->aiop_table, aiop);
+
+    /* The syncIO wrapper or CMM primop filled in the notify and live fields,
+     * we fill the rest.
+     */
+    aiop->capno   = iomgr->cap->no;
+    aiop->index   = ix;
+    aiop->outcome = IOOpOutcomeInFlight;
+
+    EpollAIOPInfo *info = &iomgr->aiop_epoll_table[ix];
+    info->fd        = fd;
+    info->rw        = rw;
+    info->completed = false;
+
+    if (RTS_UNLIKELY(fd < 0)) {
+        completeAtSubmission(iomgr, ix, IOOpOutcomeFailed, EBADF);
+        return true;
+    }
+
+    if (fd >= iomgr->fd_table_size) {
+        enlargeFdTable(iomgr, fd);
+    }
+
+    /* Add to the list of waiters for this fd and direction, and (re)arm the
+     * fd to include this direction.
+     */
+    EpollFdInfo *fdinfo = &iomgr->fd_table[fd];
+    info->next = fdinfo->waiters[rw];
+    fdinfo->waiters[rw] = ix;
+
+    int err = armFd(iomgr, fd);
+    if (RTS_UNLIKELY(err != 0)) {
+        /* We've just pushed it on the front of the list, so unlink it again */
+        fdinfo->waiters[rw] = info->next;
+
+        if (err == EPERM) {
+            /* The fd does not support epoll, e.g. it is a regular file.
+             * These are always ready for I/O.
+             */
+            completeAtSubmission(iomgr, ix, IOOpOutcomeSuccess, 0);
+        } else {
+            /* Most likely EBADF. Any other threads waiting on the same fd are
+             * not going to get a notification either, so fail them too.
+             */
+            completeAtSubmission(iomgr, ix, IOOpOutcomeFailed, err);
+            completeWaiters(iomgr, &fdinfo->waiters[IORead],
+                            IOOpOutcomeFailed, err);
+            completeWaiters(iomgr, &fdinfo->waiters[IOWrite],
+                            IOOpOutcomeFailed, err);
+        }
+    }
+    return true;
+}
+
+
+/* Arm the fd in the kernel interest set, for the directions that have waiters.
+ * Returns 0 on success or the errno value on failure.
+ */
+static int armFd(CapIOManager *iomgr, int fd)
+{
+    EpollFdInfo *fdinfo = &iomgr->fd_table[fd];
+    uint32_t events = (fdinfo->waiters[IORead]  != AIOP_IX_NULL ? EPOLLIN  : 0)
+                    | (fdinfo->waiters[IOWrite] != AIOP_IX_NULL ? EPOLLOUT : 0);
+    if (events == 0) return 0;
+
+    struct epoll_event ev = {
+                              .events = events | EPOLLONESHOT,
+                              .data   = { .fd = fd }
+                            };
+
+    /* Our idea of whether the fd is registered can be out of date: the kernel
+     * drops an fd from the interest set when it is closed, and the fd number
+     * may then be reused. So we fall back from MOD to ADD and vice versa.
+     */
+    int op  = fdinfo->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    int res = epoll_ctl(iomgr->epoll_fd, op, fd, &ev);
+    if (res < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+        op  = EPOLL_CTL_ADD;
+        res = epoll_ctl(iomgr->epoll_fd, op, fd, &ev);
+    } else if (res < 0 && op == EPOLL_CTL_ADD && errno == EEXIST) {
+        op  = EPOLL_CTL_MOD;
+        res = epoll_ctl(iomgr->epoll_fd, op, fd, &ev);
+    }
+
+    debugTrace(DEBUG_iomanager,
+               "epoll_ctl(%s, fd = %d, events = 0x%x) = %d",
+               op == EPOLL_CTL_ADD ? "ADD" : "MOD", fd, events, res);
+
+    if (RTS_UNLIKELY(res < 0)) {
+        fdinfo->registered = false;
+        return errno;
+    }
+    fdinfo->registered = true;
+    return 0;
+}
+
+
+/* Put an operation on the completed list, to be notified on the next poll */
+static void completeAtSubmission(CapIOManager *iomgr, int ix,
+                                 enum IOOpOutcome outcome, int error)
+{
+    StgAsyncIOOp  *aiop = indexClosureTable(&iomgr->aiop_table, ix);
+    EpollAIOPInfo *info = &iomgr->aiop_epoll_table[ix];
+    aiop->outcome = outcome;
+    if (outcome == IOOpOutcomeFailed) {
+        aiop->error  = error;
+    } else {
+        aiop->result = 0;
+    }
+    info->completed = true;
+    info->next = iomgr->completed_hd;
+    iomgr->completed_hd = ix;
+}
+
+
+/* Move all the waiters on a list to the completed list, with the given
+ * outcome. They will be notified on the next poll.
+ */
+static void completeWaiters(CapIOManager *iomgr, int *hd,
+                            enum IOOpOutcome outcome, int error)
+{
+    int ix = *hd;
+    while (ix != AIOP_IX_NULL) {
+        int next = iomgr->aiop_epoll_table[ix].next;
+        completeAtSubmission(iomgr, ix, outcome, error);
+        ix = next;
+    }
+    *hd = AIOP_IX_NULL;
+}
+
+
+void syncIOCancelEpoll(CapIOManager *iomgr, StgTSO *tso)
+{
+    StgAsyncIOOp *aiop  = tso->block_info.aiop;
+    ASSERT(aiop->notify_type == NotifyTSO);
+    ASSERT(indexClosureTable(&iomgr->aiop_table, aiop->index) == aiop);
+    ioCancel(iomgr, aiop);
+    /* We cannot use the normal notifyIOCompletion here. We are in the context
+     * of throwTo, interrupting a thread blocked on IO via an async exception.
+     * We don't put the TSO back on the run queue or change the why_blocked
+     * status, as that is done by removeFromQueues (in the throwTo* functions).
+     */
+
+    /* We are in the TSO case, where the aiop was only reachable from the TSO
+     * itself, and thus it is now no longer be reachable at all.
+     */
+    IF_NONMOVING_WRITE_BARRIER_ENABLED {
+        updateRemembSetPushClosure(iomgr->cap, (StgClosure *)aiop);
+    }
+}
+
+
+void asyncIOCancelEpoll(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    /* As for the poll I/O manager, we can reliably determine if the aiop is
+     * still in progress by checking if the aiop_table still points to it.
+     */
+    ASSERT(aiop->notify_type != NotifyTSO);
+    if (indexClosureTable(&iomgr->aiop_table, aiop->index) == aiop) {
+        ioCancel(iomgr, aiop);
+        notifyIOCompletion(iomgr, aiop);
+    }
+}
+
+
+static void ioCancel(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    int ix = aiop->index;
+    EpollAIOPInfo *info = &iomgr->aiop_epoll_table[ix];
+
+    /* Unlink from whichever list it is on. The per-fd lists are typically
+     * very short (one or two entries), so a linear search is fine. We do not
+     * disarm the fd: at worst we will get one spurious event later.
+     */
+    int *p = info->completed ? &iomgr->completed_hd
+                             : &iomgr->fd_table[info->fd].waiters[info->rw];
+    while (*p != ix) {
+        ASSERT(*p != AIOP_IX_NULL);
+        p = &iomgr->aiop_epoll_table[*p].next;
+    }
+    *p = info->next;
+
+    removeClosureTable(iomgr->cap, &iomgr->aiop_table, ix);
+    aiop->outcome = IOOpOutcomeCancelled;
+}
+
+
+bool anyPendingTimeoutsOrIOEpoll(CapIOManager *iomgr)
+{
+    return anyPendingTimeouts(iomgr)
+        || !isEmptyClosureTable(&iomgr->aiop_table);
+}
+
+
+static void notifyIOCompletion(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    ASSERT(aiop->outcome != IOOpOutcomeInFlight);
+    switch (aiop->notify_type) {
+        case NotifyTSO:
+        {
+            StgTSO *tso = aiop->notify.tso;
+            if (aiop->outcome == IOOpOutcomeFailed && aiop->error == EBADF) {
+                /* The fd is invalid: raise an IOError exception in the blocked
+                 * thread. (See bug #4934 for what happens without this.)
+                 */
+                debugTrace(DEBUG_iomanager,
+                           "Raising exception in thread %" FMT_StgThreadID
+                           " blocked on an invalid fd", tso->id);
+                raiseAsync(iomgr->cap, tso,
+                           (StgClosure *)blockedOnBadFD_closure,
+                           false, NULL);
+            } else {
+                /* Any other failure is reported as readiness: the thread
+                 * will discover the error when it tries to do the I/O.
+                 */
+                pushOnRunQueue(iomgr->cap, tso);
+                RELEASE_STORE(&tso->why_blocked, NotBlocked);
+            }
+            /* For the TSO case, the aiop was only reachable from the TSO
+             * itself, and thus it is now no longer be reachable at all.
+             */
+            IF_NONMOVING_WRITE_BARRIER_ENABLED {
+                updateRemembSetPushClosure(iomgr->cap, (StgClosure *)aiop);
+            }
+            break;
+        }
+        case NotifyMVar:
+            barf("epoll iomgr: MVar notification not yet supported");
+            break;
+
+        case NotifyTVar:
+            barf("epoll iomgr: TVar notification not yet supported");
+            break;
+    }
+}
+
+
+/* Notify all the operations on the completed list. These are either ones that
+ * completed at submission, or ones moved there by processEpollEvents.
+ */
+static void processCompletedList(CapIOManager *iomgr)
+{
+    while (iomgr->completed_hd != AIOP_IX_NULL) {
+        int ix = iomgr->completed_hd;
+        EpollAIOPInfo *info = &iomgr->aiop_epoll_table[ix];
+        ASSERT(info->completed);
+        iomgr->completed_hd = info->next;
+
+        StgAsyncIOOp *aiop = indexClosureTable(&iomgr->aiop_table, ix);
+        removeClosureTable(iomgr->cap, &iomgr->aiop_table, ix);
+        notifyIOCompletion(iomgr, aiop);
+    }
+}
+
+
+/* Process the events returned by epoll_wait(). Returns true if one of the
+ * events was for the interrupt fd.
+ */
+static bool processEpollEvents(CapIOManager *iomgr, int nevents)
+{
+    debugTrace(DEBUG_iomanager, "processEpollEvents(nevents = %d)", nevents);
+
+    bool interrupt = false;
+    for (int i = 0; i < nevents; i++) {
+        struct epoll_event *ev = &iomgr->event_buffer[i];
+        int fd = ev->data.fd;
+
+#if defined(HAVE_PREEMPTION)
+        if (fd == iomgr->interrupt_fd_r) {
+            collectFdWakeup(iomgr->interrupt_fd_r);
+            interrupt = true;
+            debugTrace(DEBUG_iomanager, "Received interrupt in epoll I/O manager");
+            continue;
+        }
+#endif
+        ASSERT(fd >= 0 && fd < iomgr->fd_table_size);
+        EpollFdInfo *fdinfo = &iomgr->fd_table[fd];
+
+        /* As with poll, we do not need to do anything special for EPOLLERR or
+         * EPOLLHUP: the thread will discover the error (if any) when it does
+         * the I/O. These events are reported irrespective of the requested
+         * events, so they wake waiters in both directions.
+         */
+        uint32_t events = ev->events;
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+            completeWaiters(iomgr, &fdinfo->waiters[IORead],
+                            IOOpOutcomeSuccess, 0);
+        }
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            completeWaiters(iomgr, &fdinfo->waiters[IOWrite],
+                            IOOpOutcomeSuccess, 0);
+        }
+
+        /* The fd is now disarmed (EPOLLONESHOT). If there are threads still
+         * waiting in the other direction then re-arm it for them.
+         */
+        int err = armFd(iomgr, fd);
+        if (RTS_UNLIKELY(err != 0)) {
+            completeWaiters(iomgr, &fdinfo->waiters[IORead],
+                            IOOpOutcomeFailed, err);
+            completeWaiters(iomgr, &fdinfo->waiters[IOWrite],
+                            IOOpOutcomeFailed, err);
+        }
+    }
+
+    processCompletedList(iomgr);
+
+    /* If we filled the event buffer, there may be more events ready. We will
+     * get them next time, but make the buffer bigger to reduce the number of
+     * calls needed in future.
+     */
+    if (nevents == iomgr->event_buffer_size
+        && iomgr->event_buffer_size < EVENT_BUFFER_MAX_SIZE) {
+        iomgr->event_buffer_size *= 2;
+        iomgr->event_buffer =
+            stgReallocBytes(iomgr->event_buffer,
+                            sizeof(struct epoll_event) * iomgr->event_buffer_size,
+                            "Epoll.c: processEpollEvents");
+    }
+    return interrupt;
+}
+
+
+void pollCompletedTimeoutsOrIOEpoll(CapIOManager *iomgr)
+{
+    if (anyPendingTimeouts(iomgr)) {
+        Time now = getProcessElapsedTime();
+        processTimeoutCompletions(iomgr, now);
+    }
+
+    processCompletedList(iomgr);
+
+    if (!isEmptyClosureTable(&iomgr->aiop_table)) {
+
+        /* Check for I/O readiness, without waiting. */
+        int res = epoll_wait(iomgr->epoll_fd, iomgr->event_buffer,
+                             iomgr->event_buffer_size, 0);
+
+        debugTrace(DEBUG_iomanager,
+                   "epoll_wait(maxevents = %d, timeout_ms = 0) = %d",
+                   iomgr->event_buffer_size, res);
+
+        if (res > 0) {
+            processEpollEvents(iomgr, res);
+
+        } else if (res < 0 && errno != EINTR) {
+            reportEpollError("epoll_wait", res);
+        }
+        /* Otherwise, either no I/O is ready or we got interrupted by a signal
+         * (unlikely since we asked not to wait). Either way we'll return to
+         * the scheduler.
+         */
+    }
+}
+
+
+bool awaitCompletedTimeoutsOrIOEpoll(CapIOManager *iomgr)
+{
+    bool interrupt = false; /* got woken up via interruptIOManager */
+
+    /* Loop until we've woken up some threads. See the corresponding comment
+     * in awaitCompletedTimeoutsOrIOPoll for why this is needed.
+     */
+    do {
+        /* There is either pending I/O or pending timers. */
+        ASSERT(anyPendingTimeouts(iomgr) ||
+               !isEmptyClosureTable(&iomgr->aiop_table));
+
+        Time now = getProcessElapsedTime();
+        processTimeoutCompletions(iomgr, now);
+        processCompletedList(iomgr);
+
+        /* Even if we did wake some threads, we'll still check (but not wait)
+         * for I/O. This is to ensure we avoid starving threads blocked on I/O.
+         */
+        bool wait = emptyRunQueue(iomgr->cap);
+        int timeout_ms = timeoutInMilliseconds(iomgr, wait, now);
+
+        int res = epoll_wait(iomgr->epoll_fd, iomgr->event_buffer,
+                             iomgr->event_buffer_size, timeout_ms);
+
+        debugTrace(DEBUG_iomanager,
+                   "epoll_wait(maxevents = %d, timeout_ms = %d) = %d",
+                   iomgr->event_buffer_size, timeout_ms, res);
+
+        if (res == 0) {
+            /* Success but there is no I/O ready. This can happen either if we
+             * were not blocking or were in a timed wait and the timeout
+             * occurred before any I/O became ready. Either way, the do-while
+             * loop condition will handle it.
+             */
+            ASSERT(timeout_ms != -1);
+
+        } else if (res > 0) {
+            interrupt = processEpollEvents(iomgr, res);
+
+        } else if (errno == EINTR) {
+            /* We got interrupted by a signal. In the non-threaded RTS, if the
+             * signal is one of ours we need to return to the scheduler to let
+             * it handle it. See awaitCompletedTimeoutsOrIOPoll.
+             */
+#if defined(RTS_USER_SIGNALS)
+            if (startPendingSignalHandlers(iomgr->cap)) break;
+#endif
+
+        } else {
+            reportEpollError("epoll_wait", res);
+        }
+
+    } while (emptyRunQueue(iomgr->cap)
+         && !interrupt
+         && (getSchedState() == SCHED_RUNNING));
+    return !interrupt;
+}
+
+
+static void reportEpollError(const char *what, int res)
+{
+    sysErrorBelch("epoll iomgr: %s res = %d", what, res);
+    stg_exit(EXIT_FAILURE);
+}
+
+
+void interruptIOManagerEpoll(CapIOManager *iomgr)
+{
+#if defined(HAVE_PREEMPTION)
+    sendFdWakeup(iomgr->interrupt_fd_w);
+#endif
+}
+
+
+/* Helper function to double the size of the aiop_table and aiop_epoll_table.
+ */
+static bool enlargeTables(CapIOManager *iomgr)
+{
+    int oldcapacity = capacityClosureTable(&iomgr->aiop_table);
+    int newcapacity = (oldcapacity == 0) ? 1 : (oldcapacity * 2);
+
+    bool ok = enlargeClosureTable(iomgr->cap, &iomgr->aiop_table, newcapacity);
+    if (RTS_UNLIKELY(!ok)) return false;
+
+    /* The new entries are initialised when they get used. */
+    iomgr->aiop_epoll_table =
+        stgReallocBytes(iomgr->aiop_epoll_table,
+                        sizeof(EpollAIOPInfo) * newcapacity,
+                        "Epoll.c: enlargeTables");
+    return true;
+}
+
+
+/* Enlarge the fd_table so that it covers the given fd. */
+static void enlargeFdTable(CapIOManager *iomgr, int fd)
+{
+    int oldsize = iomgr->fd_table_size;
+    int newsize = (oldsize == 0) ? 64 : oldsize;
+    while (newsize <= fd) newsize *= 2;
+
+    iomgr->fd_table = stgReallocBytes(iomgr->fd_table,
+                                      sizeof(EpollFdInfo) * newsize,
+                                      "Epoll.c: enlargeFdTable");
+    for (int i = oldsize; i < newsize; i++) {
+        iomgr->fd_table[i] = (EpollFdInfo) {
+                               .waiters    = { AIOP_IX_NULL, AIOP_IX_NULL },
+                               .registered = false
+                             };
+    }
+    iomgr->fd_table_size = newsize;
+}
+
+#endif /* IOMGR_ENABLED_EPOLL */
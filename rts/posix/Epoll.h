@@ -0,0 +1,40 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * An I/O manager based on the Linux epoll() API.
+ *
+ * Prototypes for functions in Epoll.c
+ *
+ * -------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "IOManager.h"
+
+#include "BeginPrivate.h"
+
+#if defined(IOMGR_ENABLED_EPOLL)
+
+void initCapabilityIOManagerEpoll(CapIOManager *iomgr);
+void freeCapabilityIOManagerEpoll(CapIOManager *iomgr);
+
+/* Synchronous I/O and timer operations */
+bool syncIOWaitReadyEpoll(CapIOManager *iomgr, StgTSO *tso,
+                          IOReadOrWrite rw, HsInt fd);
+void syncIOCancelEpoll(CapIOManager *iomgr, StgTSO *tso);
+
+/* Asynchronous operations */
+bool asyncIOWaitReadyEpoll(CapIOManager *iomgr, StgAsyncIOOp *aiop,
+                           IOReadOrWrite rw, int fd);
+void asyncIOCancelEpoll(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+
+/* Scheduler operations */
+bool anyPendingTimeoutsOrIOEpoll(CapIOManager *iomgr);
+void pollCompletedTimeoutsOrIOEpoll(CapIOManager *iomgr);
+bool awaitCompletedTimeoutsOrIOEpoll(CapIOManager *iomgr);
+void interruptIOManagerEpoll(CapIOManager *iomgr);
+
+#endif /* IOMGR_ENABLED_EPOLL */
+
+#include "EndPrivate.h"
@@ -0,0 +1,833 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * An I/O manager based on the Linux io_uring API.
+ *
+ * ---------------------------------------------------------------------------*/
+
+/* For syscall() and MAP_POPULATE */
+#define _GNU_SOURCE
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+#include "RtsFlags.h" // needed by SET_HDR macro
+
+#include "IOManager.h" // defines IOMGR_ENABLED_IO_URING
+
+#if defined(IOMGR_ENABLED_IO_URING)
+
+#include "Capability.h"
+#include "Threads.h"
+#include "Schedule.h"
+#include "Prelude.h"
+#include "RtsUtils.h"
+#include "rts/Time.h"
+#include "RaiseAsync.h"
+#include "Trace.h"
+
+#include "IOUring.h"
+#include "RtsSignals.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "IOManagerInternals.h"
+#include "Timeout.h"
+#include "FdWakeup.h"
+
+/******************************************************************************
+
+This I/O manager is based on the Linux io_uring API.
+
+    int io_uring_setup(u32 entries, struct io_uring_params *p);
+    int io_uring_enter(unsigned int fd, unsigned int to_submit,
+                       unsigned int min_complete, unsigned int flags,
+                       const void *arg, size_t argsz);
+
+An io_uring instance is a pair of ring buffers shared between the kernel and
+user space: the submission queue (SQ) where we put requests (SQEs), and the
+completion queue (CQ) where the kernel puts the results (CQEs). A single
+io_uring_enter() call both submits all the queued requests and waits for
+completions, so however many threads start or cancel I/O waits between two
+scheduler iterations, it costs us one syscall per iteration. Collecting
+completions that are already available needs no syscall at all: we just read
+them from the CQ ring. We use the raw syscalls, rather than liburing, to avoid
+the RTS depending on another library.
+
+The I/O operations the RTS supports for the non-threaded I/O managers are
+waiting for an fd to be ready for reading or writing (waitRead# / waitWrite#),
+and delays. So this I/O manager implements fd waits using IORING_OP_POLL_ADD
+requests, which complete when the fd becomes ready. Unlike epoll there is no
+interest set to maintain, and there is no limitation to one registration per
+fd: each wait is an independent one-shot request. Timeouts are handled the
+same way as the poll I/O manager, using the shared StgTimeoutQueue, with the
+delay to the next timeout passed to io_uring_enter() (which has nanosecond
+resolution).
+
+Each in-flight I/O operation has an entry in the aiop_table. The aiop_table is
+a ClosureTable of AsyncIOOps, used in non-compact mode so that the index of
+each operation is stable. We use that index as the SQE user_data, so that we
+can find the operation again given the CQE. Since the request lives on in the
+kernel after we cancel it (until the kernel processes the cancellation), the
+index may get re-used before the CQE for the cancelled request arrives. So we
+also keep a generation number for each index, bumped on cancellation, and the
+user_data is the pair of the generation and the index. CQEs with a generation
+that does not match are stale, and are simply ignored. A couple of special
+user_data values are used for requests that do not correspond to operations
+(see IOURING_USER_DATA_*).
+
+Cancelling an operation submits an IORING_OP_POLL_REMOVE request for it. This
+ensures the kernel does not keep the request (and its reference to the fd)
+around indefinitely.
+
+We never write SQEs directly into the SQ ring at the point an operation is
+started or cancelled. Instead we queue them in the pending_sqes buffer on the
+C heap, and copy them to the ring just before the io_uring_enter() call. There
+are two reasons for this:
+
+ * The SQ ring has a fixed size, whereas the number of operations that can be
+   started between two scheduler iterations is unbounded. The buffer grows as
+   needed, and we copy as much of it into the ring as will fit.
+
+ * After forkProcess, the child inherits the ring mappings, which are shared
+   with the parent. Threads blocked on I/O are cancelled in the child before
+   the I/O manager is re-initialised. Writing their cancellations into the
+   ring would corrupt the parent's ring, whereas writing them into the buffer
+   (which is discarded) is harmless.
+
+A failed request (CQE res < 0) is treated in the same way as the poll I/O
+manager treats POLLERR: the thread is woken and will discover the error when
+it tries to do the I/O. The exception is EBADF, for which we raise an
+exception in the waiting thread. Regular files are always reported as ready.
+
+We support waking the I/O manager when it is blocked in io_uring_enter() by
+keeping a poll request on the interrupt_fd_r in flight at all times. We re-arm
+it each time it completes.
+
+The CapIOManager structure for this I/O manager contains:
+
+    ClosureTable          aiop_table;
+    StgTimeoutQueue      *timeout_queue;
+    TimerWheel           *timer_wheel;
+    struct IOUringState  *uring;
+    int interrupt_fd_r, interrupt_fd_w;
+
+******************************************************************************/
+
+/* Special user_data values. These can never be a (generation, index) pair
+ * because we keep the generation below 2^31.
+ */
+#define IOURING_USER_DATA_INTERRUPT UINT64_MAX       /* the interrupt_fd_r */
+#define IOURING_USER_DATA_IGNORE    (UINT64_MAX - 1) /* e.g. POLL_REMOVE */
+
+#define IOURING_GENERATION_MASK 0x7fffffff
+
+/* The number of SQ ring entries. The CQ ring is made larger, since the number
+ * of requests in flight is not limited by the SQ size. With the
+ * IORING_FEAT_NODROP feature, a full CQ does not lose completions anyway.
+ */
+#define IOURING_SQ_ENTRIES 256
+#define IOURING_CQ_ENTRIES (IOURING_SQ_ENTRIES * 16)
+
+/* The initial size of the pending_sqes buffer */
+#define PENDING_SQES_INIT_SIZE 64
+
+/* The kernel features we rely on: IORING_FEAT_NODROP so we never lose a
+ * completion, and IORING_FEAT_EXT_ARG so we can wait with a timeout without
+ * having to submit a timeout request.
+ */
+#define IOURING_REQUIRED_FEATURES (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)
+
+/* The state of the io_uring instance */
+typedef struct IOUringState {
+    int ring_fd;
+
+    /* The SQ ring. We own the tail, the kernel owns the head. */
+    unsigned int *sq_head, *sq_tail, *sq_flags, *sq_array;
+    unsigned int  sq_mask, sq_entries;
+    struct io_uring_sqe *sqes;
+
+    /* The CQ ring. We own the head, the kernel owns the tail. */
+    unsigned int *cq_head, *cq_tail;
+    unsigned int  cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* The mappings, for munmap */
+    void  *sq_ring_ptr, *cq_ring_ptr;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+
+    /* SQEs waiting to be copied into the SQ ring */
+    struct io_uring_sqe *pending_sqes;
+    uint32_t pending_sqes_count, pending_sqes_size;
+
+    /* Generation numbers, with size and indexes matching the aiop_table */
+    uint32_t *generations;
+} IOUringState;
+
+/* Forward declarations */
+static int  setupRing(IOUringState *ring);
+static void freeRing(IOUringState *ring);
+static bool enlargeTables(CapIOManager *iomgr);
+static struct io_uring_sqe *queueSQE(IOUringState *ring);
+static void queuePollAdd(IOUringState *ring, int fd, IOReadOrWrite rw,
+                         uint64_t user_data);
+#if defined(HAVE_PREEMPTION)
+static void queueInterruptPoll(CapIOManager *iomgr);
+#endif
+static int  enterRing(CapIOManager *iomgr, bool wait, Time now);
+static bool processCompletions(CapIOManager *iomgr);
+static void notifyIOCompletion(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+static void ioCancel(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+static void reportIOUringError(const char *what, int err) STG_NORETURN;
+
+
+static inline int sys_io_uring_setup(unsigned int entries,
+                                     struct io_uring_params *p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int sys_io_uring_enter(int fd, unsigned int to_submit,
+                                     unsigned int min_complete,
+                                     unsigned int flags,
+                                     const void *arg, size_t argsz)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                         flags, arg, argsz);
+}
+
+static inline uint64_t makeUserData(uint32_t generation, int ix)
+{
+    return ((uint64_t) generation << 32) | (uint32_t) ix;
+}
+
+
+bool isAvailableIOManagerIOUring(const char **reason)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(1, &params);
+    if (fd < 0) {
+        /* ENOSYS: the kernel is too old, or built without io_uring.
+         * EPERM: disabled via the kernel.io_uring_disabled sysctl.
+         * Or anything else a seccomp policy decides to return.
+         */
+        *reason = strerror(errno);
+        return false;
+    }
+    close(fd);
+    if ((params.features & IOURING_REQUIRED_FEATURES)
+          != IOURING_REQUIRED_FEATURES) {
+        debugTrace(DEBUG_iomanager,
+                   "io_uring lacks required features (features = 0x%x)",
+                   params.features);
+        *reason = "the kernel lacks required io_uring features";
+        return false;
+    }
+    return true;
+}
+
+
+void initCapabilityIOManagerIOUring(CapIOManager *iomgr)
+{
+    initClosureTable(&iomgr->aiop_table, ClosureTableNonCompact);
+    initTimeouts(iomgr);
+
+    IOUringState *ring = stgMallocBytes(sizeof(IOUringState),
+                                        "initCapabilityIOManagerIOUring");
+    memset(ring, 0, sizeof(IOUringState));
+    iomgr->uring = ring;
+
+    ring->pending_sqes_size = PENDING_SQES_INIT_SIZE;
+    ring->pending_sqes =
+        stgMallocBytes(sizeof(struct io_uring_sqe) * PENDING_SQES_INIT_SIZE,
+                       "initCapabilityIOManagerIOUring");
+
+    int err = setupRing(ring);
+    if (RTS_UNLIKELY(err != 0)) {
+        /* We checked in isAvailableIOManagerIOUring that this works, so any
+         * failure now is most likely running out of memory or fds.
+         */
+        reportIOUringError("io_uring_setup", err);
+    }
+
+#if defined(HAVE_PREEMPTION)
+    newFdWakeup(&iomgr->interrupt_fd_r, &iomgr->interrupt_fd_w);
+    queueInterruptPoll(iomgr);
+#endif
+}
+
+
+/* Create the io_uring instance and map its rings. Returns 0 on success or the
+ * errno value on failure.
+ */
+static int setupRing(IOUringState *ring)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags      = IORING_SETUP_CQSIZE;
+    params.cq_entries = IOURING_CQ_ENTRIES;
+
+    int fd = sys_io_uring_setup(IOURING_SQ_ENTRIES, &params);
+    if (fd < 0) return errno;
+    ring->ring_fd = fd;
+
+    ring->sq_ring_size = params.sq_off.array
+                       + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes
+                       + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size    = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    /* With IORING_FEAT_SINGLE_MMAP the SQ and CQ rings share one mapping */
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+
+    ring->sq_ring_ptr = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring_ptr == MAP_FAILED) goto fail;
+
+    if (single_mmap) {
+        ring->cq_ring_ptr = ring->sq_ring_ptr;
+    } else {
+        ring->cq_ring_ptr = mmap(NULL, ring->cq_ring_size,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd,
+                                 IORING_OFF_CQ_RING);
+        if (ring->cq_ring_ptr == MAP_FAILED) goto fail;
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    char *sq = ring->sq_ring_ptr;
+    ring->sq_head    = (unsigned int *) (sq + params.sq_off.head);
+    ring->sq_tail    = (unsigned int *) (sq + params.sq_off.tail);
+    ring->sq_flags   = (unsigned int *) (sq + params.sq_off.flags);
+    ring->sq_array   = (unsigned int *) (sq + params.sq_off.array);
+    ring->sq_mask    = *(unsigned int *) (sq + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned int *) (sq + params.sq_off.ring_entries);
+
+    char *cq = ring->cq_ring_ptr;
+    ring->cq_head    = (unsigned int *) (cq + params.cq_off.head);
+    ring->cq_tail    = (unsigned int *) (cq + params.cq_off.tail);
+    ring->cq_mask    = *(unsigned int *) (cq + params.cq_off.ring_mask);
+    ring->cqes       = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    /* We always fill SQE slot i for SQ ring position i, so the indirection
+     * array is the identity mapping, and we can set it up once.
+     */
+    for (unsigned int i = 0; i < ring->sq_entries; i++) {
+        ring->sq_array[i] = i;
+    }
+
+    debugTrace(DEBUG_iomanager,
+               "io_uring_setup: fd = %d, sq_entries = %u, cq_entries = %u, "
+               "features = 0x%x",
+               fd, params.sq_entries, params.cq_entries, params.features);
+    return 0;
+
+fail:
+    {
+        int err = errno;
+        freeRing(ring);
+        return err;
+    }
+}
+
+
+static void freeRing(IOUringState *ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring_ptr != NULL && ring->cq_ring_ptr != MAP_FAILED
+        && ring->cq_ring_ptr != ring->sq_ring_ptr) {
+        munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+    }
+    if (ring->sq_ring_ptr != NULL && ring->sq_ring_ptr != MAP_FAILED) {
+        munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+    }
+    close(ring->ring_fd);
+}
+
+
+void freeCapabilityIOManagerIOUring(CapIOManager *iomgr)
+{
+    /* This is also used after forkProcess, in the child. The child inherits
+     * the ring fd and the ring mappings, but they refer to the same io_uring
+     * instance as the parent. Unmapping and closing them here only drops the
+     * child's references, and initCapabilityIOManagerIOUring will create a
+     * fresh instance. Any SQEs still pending are discarded.
+     */
+    IOUringState *ring = iomgr->uring;
+    freeRing(ring);
+    stgFree(ring->pending_sqes);
+    stgFree(ring->generations);
+    stgFree(ring);
+    iomgr->uring = NULL;
+    freeTimeouts(iomgr);
+#if defined(HAVE_PREEMPTION)
+    closeFdWakeup(iomgr->interrupt_fd_r, iomgr->interrupt_fd_w);
+#endif
+}
+
+
+/* Used to implement syncIOWaitReady.
+ * Result is true on success, or false on allocation failure. */
+bool syncIOWaitReadyIOUring(CapIOManager *iomgr, StgTSO *tso,
+                            IOReadOrWrite rw, HsInt fd)
+{
+    StgAsyncIOOp *aiop;
+    aiop = (StgAsyncIOOp *)allocateMightFail(iomgr->cap, sizeofW(StgAsyncIOOp));
+    if (RTS_UNLIKELY(aiop == NULL)) return false;
+    SET_HDR(aiop, &stg_ASYNCIOOP_info, iomgr->cap->r.rCCCS);
+    aiop->notify.tso     = tso;
+    aiop->notify_type    = NotifyTSO;
+    aiop->live           = &stg_ASYNCIO_LIVE0_closure;
+    tso->block_info.aiop = aiop;
+    RELEASE_STORE(&tso->why_blocked, rw == IORead ? BlockedOnRead
+                                                  : BlockedOnWrite);
+    return asyncIOWaitReadyIOUring(iomgr, aiop, rw, fd);
+}
+
+/* Result is true on success, or false on allocation failure. */
+bool asyncIOWaitReadyIOUring(CapIOManager *iomgr, StgAsyncIOOp *aiop,
+                             IOReadOrWrite rw, int fd)
+{
+    if (RTS_UNLIKELY(isFullClosureTable(&iomgr->aiop_table))) {
+        bool ok = enlargeTables(iomgr);
+        if (RTS_UNLIKELY(!ok)) return false;
+    }
+
+    int ix = insertClosureTable(iomgr->cap, &iomgr->aiop_table, aiop);
+
+    /* The syncIO wrapper or CMM primop filled in the notify and live fields,
+     * we fill the rest.
+     */
+    aiop->capno   = iomgr->cap->no;
+    aiop->index   = ix;
+    aiop->outcome = IOOpOutcomeInFlight;
+
+    /* An invalid fd (including a negative one) is reported by the kernel in
+     * the CQE, so we do not need to check for it here.
+     */
+    IOUringState *ring = iomgr->uring;
+    queuePollAdd(ring, fd, rw, makeUserData(ring->generations[ix], ix));
+    return true;
+}
+
+
+/* Get an SQE to fill in, from the pending_sqes buffer. */
+static struct io_uring_sqe *queueSQE(IOUringState *ring)
+{
+    if (ring->pending_sqes_count == ring->pending_sqes_size) {
+        ring->pending_sqes_size *= 2;
+        ring->pending_sqes =
+            stgReallocBytes(ring->pending_sqes,
+                            sizeof(struct io_uring_sqe)
+                              * ring->pending_sqes_size,
+                            "IOUring.c: queueSQE");
+    }
+    struct io_uring_sqe *sqe = &ring->pending_sqes[ring->pending_sqes_count++];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+
+static void queuePollAdd(IOUringState *ring, int fd, IOReadOrWrite rw,
+                         uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = queueSQE(ring);
+    uint32_t events = rw == IORead ? POLLIN : POLLOUT;
+#if defined(WORDS_BIGENDIAN)
+    /* The kernel reads poll32_events as two swapped 16bit halves on big
+     * endian systems, for compatibility with the older 16bit field.
+     */
+    events = (events << 16) | (events >> 16);
+#endif
+    sqe->opcode        = IORING_OP_POLL_ADD;
+    sqe->fd            = fd;
+    sqe->poll32_events = events;
+    sqe->user_data     = user_data;
+}
+
+
+#if defined(HAVE_PREEMPTION)
+static void queueInterruptPoll(CapIOManager *iomgr)
+{
+    queuePollAdd(iomgr->uring, iomgr->interrupt_fd_r, IORead,
+                 IOURING_USER_DATA_INTERRUPT);
+}
+#endif
+
+
+void syncIOCancelIOUring(CapIOManager *iomgr, StgTSO *tso)
+{
+    StgAsyncIOOp *aiop  = tso->block_info.aiop;
+    ASSERT(aiop->notify_type == NotifyTSO);
+    ASSERT(indexClosureTable(&iomgr->aiop_table, aiop->index) == aiop);
+    ioCancel(iomgr, aiop);
+    /* We cannot use the normal notifyIOCompletion here. We are in the context
+     * of throwTo, interrupting a thread blocked on IO via an async exception.
+     * We don't put the TSO back on the run queue or change the why_blocked
+     * status, as that is done by removeFromQueues (in the throwTo* functions).
+     */
+
+    /* We are in the TSO case, where the aiop was only reachable from the TSO
+     * itself, and thus it is now no longer be reachable at all.
+     */
+    IF_NONMOVING_WRITE_BARRIER_ENABLED {
+        updateRemembSetPushClosure(iomgr->cap, (StgClosure *)aiop);
+    }
+}
+
+
+void asyncIOCancelIOUring(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    /* As for the poll I/O manager, we can reliably determine if the aiop is
+     * still in progress by checking if the aiop_table still points to it.
+     */
+    ASSERT(aiop->notify_type != NotifyTSO);
+    if (indexClosureTable(&iomgr->aiop_table, aiop->index) == aiop) {
+        ioCancel(iomgr, aiop);
+        notifyIOCompletion(iomgr, aiop);
+    }
+}
+
+
+static void ioCancel(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    IOUringState *ring = iomgr->uring;
+    int ix = aiop->index;
+
+    /* Ask the kernel to drop the poll request. We don't care about the result
+     * of the removal itself. The poll request may complete anyway, before the
+     * removal is processed, but bumping the generation means its CQE will not
+     * match any more, and will be ignored.
+     */
+    struct io_uring_sqe *sqe = queueSQE(ring);
+    sqe->opcode    = IORING_OP_POLL_REMOVE;
+    sqe->fd        = -1;
+    sqe->addr      = makeUserData(ring->generations[ix], ix);
+    sqe->user_data = IOURING_USER_DATA_IGNORE;
+
+    ring->generations[ix] = (ring->generations[ix] + 1)
+                          & IOURING_GENERATION_MASK;
+
+    removeClosureTable(iomgr->cap, &iomgr->aiop_table, ix);
+    aiop->outcome = IOOpOutcomeCancelled;
+}
+
+
+bool anyPendingTimeoutsOrIOIOUring(CapIOManager *iomgr)
+{
+    return anyPendingTimeouts(iomgr)
+        || !isEmptyClosureTable(&iomgr->aiop_table);
+}
+
+
+static void notifyIOCompletion(CapIOManager *iomgr, StgAsyncIOOp *aiop)
+{
+    ASSERT(aiop->outcome != IOOpOutcomeInFlight);
+    switch (aiop->notify_type) {
+        case NotifyTSO:
+        {
+            StgTSO *tso = aiop->notify.tso;
+            if (aiop->outcome == IOOpOutcomeFailed && aiop->error == EBADF) {
+                /* The fd is invalid: raise an IOError exception in the blocked
+                 * thread. (See bug #4934 for what happens without this.)
+                 */
+                debugTrace(DEBUG_iomanager,
+                           "Raising exception in thread %" FMT_StgThreadID
+                           " blocked on an invalid fd", tso->id);
+                raiseAsync(iomgr->cap, tso,
+                           (StgClosure *)blockedOnBadFD_closure,
+                           false, NULL);
+            } else {
+                /* Any other failure is reported as readiness: the thread
+                 * will discover the error when it tries to do the I/O.
+                 */
+                pushOnRunQueue(iomgr->cap, tso);
+                RELEASE_STORE(&tso->why_blocked, NotBlocked);
+            }
+            /* For the TSO case, the aiop was only reachable from the TSO
+             * itself, and thus it is now no longer be reachable at all.
+             */
+            IF_NONMOVING_WRITE_BARRIER_ENABLED {
+                updateRemembSetPushClosure(iomgr->cap, (StgClosure *)aiop);
+            }
+            break;
+        }
+        case NotifyMVar:
+            barf("io_uring iomgr: MVar notification not yet supported");
+            break;
+
+        case NotifyTVar:
+            barf("io_uring iomgr: TVar notification not yet supported");
+            break;
+    }
+}
+
+
+/* Collect and process all the CQEs available in the CQ ring. This needs no
+ * syscall. Returns true if one of the completions was for the interrupt fd.
+ */
+static bool processCompletions(CapIOManager *iomgr)
+{
+    IOUringState *ring = iomgr->uring;
+    bool interrupt = false;
+
+    /* We are the only writer of the CQ head. We need the acquire on the tail
+     * to see the contents of the CQEs the kernel has written.
+     */
+    unsigned int head = *ring->cq_head;
+    unsigned int tail = ACQUIRE_LOAD_ALWAYS(ring->cq_tail);
+    if (head == tail) return false;
+
+    debugTrace(DEBUG_iomanager, "io_uring completions: %u", tail - head);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int      res       = cqe->res;
+
+        if (user_data == IOURING_USER_DATA_IGNORE) {
+            continue;
+        }
+#if defined(HAVE_PREEMPTION)
+        if (user_data == IOURING_USER_DATA_INTERRUPT) {
+            collectFdWakeup(iomgr->interrupt_fd_r);
+            queueInterruptPoll(iomgr);
+            interrupt = true;
+            debugTrace(DEBUG_iomanager,
+                       "Received interrupt in io_uring I/O manager");
+            continue;
+        }
+#endif
+        int      ix         = (int) (uint32_t) user_data;
+        uint32_t generation = (uint32_t) (user_data >> 32);
+        if (generation != ring->generations[ix]) {
+            /* The completion of a cancelled request */
+            continue;
+        }
+
+        StgAsyncIOOp *aiop = indexClosureTable(&iomgr->aiop_table, ix);
+        ASSERT(aiop != NULL && aiop->index == ix);
+        if (res >= 0) {
+            aiop->outcome = IOOpOutcomeSuccess;
+            aiop->result  = 0;
+        } else {
+            aiop->outcome = IOOpOutcomeFailed;
+            aiop->error   = -res;
+        }
+        removeClosureTable(iomgr->cap, &iomgr->aiop_table, ix);
+        notifyIOCompletion(iomgr, aiop);
+    }
+
+    /* Hand the CQ slots back to the kernel */
+    RELEASE_STORE_ALWAYS(ring->cq_head, head);
+    return interrupt;
+}
+
+
+/* Copy pending SQEs into the SQ ring and call io_uring_enter() to submit them,
+ * and to wait for completions (if wait), up to the next timeout.
+ *
+ * Returns the io_uring_enter() result: the number of SQEs submitted, or -1
+ * with errno set on failure (including ETIME if the timeout was reached).
+ */
+static int enterRing(CapIOManager *iomgr, bool wait, Time now)
+{
+    IOUringState *ring = iomgr->uring;
+
+    /* Copy as many pending SQEs as will fit into the SQ ring. Any left over
+     * will be submitted next time.
+     */
+    unsigned int tail  = *ring->sq_tail;
+    unsigned int head  = ACQUIRE_LOAD_ALWAYS(ring->sq_head);
+    unsigned int space = ring->sq_entries - (tail - head);
+    unsigned int n     = ring->pending_sqes_count < space
+                       ? ring->pending_sqes_count : space;
+    for (unsigned int i = 0; i < n; i++) {
+        ring->sqes[(tail + i) & ring->sq_mask] = ring->pending_sqes[i];
+    }
+    if (n > 0) {
+        ring->pending_sqes_count -= n;
+        memmove(ring->pending_sqes, ring->pending_sqes + n,
+                sizeof(struct io_uring_sqe) * ring->pending_sqes_count);
+        /* Make the SQE contents visible to the kernel before the tail */
+        RELEASE_STORE_ALWAYS(ring->sq_tail, tail + n);
+    }
+    unsigned int to_submit = tail + n - head;
+
+    /* If we are not going to wait, we can skip the syscall altogether unless
+     * there's something to submit, or the kernel has completions it could not
+     * fit in the CQ ring. Overflowed completions are only flushed to the CQ
+     * ring by io_uring_enter().
+     */
+    bool cq_overflow = ACQUIRE_LOAD_ALWAYS(ring->sq_flags)
+                     & IORING_SQ_CQ_OVERFLOW;
+    if (!wait && to_submit == 0 && !cq_overflow) return 0;
+
+    struct timespec ts;
+    struct timespec *timeout = timeoutInNanoseconds(iomgr, wait, now, &ts);
+    struct __kernel_timespec kts;
+    struct io_uring_getevents_arg arg = {
+        .sigmask    = 0,
+        .sigmask_sz = _NSIG / 8,
+        .pad        = 0,
+        .ts         = 0
+    };
+    if (timeout != NULL) {
+        kts.tv_sec  = timeout->tv_sec;
+        kts.tv_nsec = timeout->tv_nsec;
+        arg.ts      = (uint64_t) (uintptr_t) &kts;
+    }
+
+    int res = sys_io_uring_enter(ring->ring_fd, to_submit, wait ? 1 : 0,
+                                 IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                 &arg, sizeof(arg));
+
+    debugTrace(DEBUG_iomanager,
+               "io_uring_enter(to_submit = %u, wait = %d, timeout_ns = %"
+               FMT_Int64 ") = %d",
+               to_submit, wait,
+               timeout == NULL ? (int64_t) -1
+                               : (int64_t) timeout->tv_sec * 1000000000
+                                 + timeout->tv_nsec,
+               res);
+    return res;
+}
+
+
+void pollCompletedTimeoutsOrIOIOUring(CapIOManager *iomgr)
+{
+    if (anyPendingTimeouts(iomgr)) {
+        Time now = getProcessElapsedTime();
+        processTimeoutCompletions(iomgr, now);
+    }
+
+    if (!isEmptyClosureTable(&iomgr->aiop_table)) {
+
+        /* Submit any new requests, without waiting. */
+        int res = enterRing(iomgr, false, 0);
+        if (res < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            reportIOUringError("io_uring_enter", errno);
+        }
+        /* Otherwise, we either submitted the requests or we'll try again next
+         * time. The kernel returns EBUSY or EAGAIN if it is short of CQ space
+         * or memory, which the processing below can help with.
+         */
+
+        processCompletions(iomgr);
+    }
+}
+
+
+bool awaitCompletedTimeoutsOrIOIOUring(CapIOManager *iomgr)
+{
+    bool interrupt = false; /* got woken up via interruptIOManager */
+
+    /* Loop until we've woken up some threads. See the corresponding comment
+     * in awaitCompletedTimeoutsOrIOPoll for why this is needed.
+     */
+    do {
+        /* There is either pending I/O or pending timers. */
+        ASSERT(anyPendingTimeouts(iomgr) ||
+               !isEmptyClosureTable(&iomgr->aiop_table));
+
+        Time now = getProcessElapsedTime();
+        processTimeoutCompletions(iomgr, now);
+        interrupt = processCompletions(iomgr) || interrupt;
+
+        /* Even if we did wake some threads, we'll still check (but not wait)
+         * for I/O. This is to ensure we avoid starving threads blocked on I/O.
+         */
+        bool wait = emptyRunQueue(iomgr->cap) && !interrupt;
+        int res = enterRing(iomgr, wait, now);
+
+        if (res >= 0) {
+            /* The requests were submitted and either some completions are now
+             * available, or we were not waiting.
+             */
+
+        } else if (errno == ETIME) {
+            /* The timeout occurred before any I/O completed. The do-while
+             * loop condition will handle it.
+             */
+
+        } else if (errno == EBUSY || errno == EAGAIN) {
+            /* The kernel could not accept more requests until we consume some
+             * completions, which we do next.
+             */
+
+        } else if (errno == EINTR) {
+            /* We got interrupted by a signal. In the non-threaded RTS, if the
+             * signal is one of ours we need to return to the scheduler to let
+             * it handle it. See awaitCompletedTimeoutsOrIOPoll.
+             */
+#if defined(RTS_USER_SIGNALS)
+            if (startPendingSignalHandlers(iomgr->cap)) break;
+#endif
+
+        } else {
+            reportIOUringError("io_uring_enter", errno);
+        }
+
+        interrupt = processCompletions(iomgr) || interrupt;
+
+    } while (emptyRunQueue(iomgr->cap)
+         && !interrupt
+         && (getSchedState() == SCHED_RUNNING));
+    return !interrupt;
+}
+
+
+static void reportIOUringError(const char *what, int err)
+{
+    errno = err;
+    sysErrorBelch("io_uring iomgr: %s", what);
+    stg_exit(EXIT_FAILURE);
+}
+
+
+void interruptIOManagerIOUring(CapIOManager *iomgr)
+{
+#if defined(HAVE_PREEMPTION)
+    sendFdWakeup(iomgr->interrupt_fd_w);
+#endif
+}
+
+
+/* Helper function to double the size of the aiop_table and generations.
+ */
+static bool enlargeTables(CapIOManager *iomgr)
+{
+    IOUringState *ring = iomgr->uring;
+    int oldcapacity = capacityClosureTable(&iomgr->aiop_table);
+    int newcapacity = (oldcapacity == 0) ? 1 : (oldcapacity * 2);
+
+    bool ok = enlargeClosureTable(iomgr->cap, &iomgr->aiop_table, newcapacity);
+    if (RTS_UNLIKELY(!ok)) return false;
+
+    ring->generations =
+        stgReallocBytes(ring->generations,
+                        sizeof(uint32_t) * newcapacity,
+                        "IOUring.c: enlargeTables");
+    for (int i = oldcapacity; i < newcapacity; i++) {
+        ring->generations[i] = 0;
+    }
+    return true;
+}
+
+#endif /* IOMGR_ENABLED_IO_URING */
@@ -0,0 +1,47 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * An I/O manager based on the Linux io_uring API.
+ *
+ * Prototypes for functions in IOUring.c
+ *
+ * -------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "IOManager.h"
+
+#include "BeginPrivate.h"
+
+#if defined(IOMGR_ENABLED_IO_URING)
+
+/* Check if the kernel supports io_uring with the features we need. It may not
+ * if the kernel is too old, or io_uring has been disabled (e.g. by sysctl or
+ * seccomp policy). Used by selectIOManager to fall back to another I/O
+ * manager; if it isn't available *reason is set to say why.
+ */
+bool isAvailableIOManagerIOUring(const char **reason);
+
+void initCapabilityIOManagerIOUring(CapIOManager *iomgr);
+void freeCapabilityIOManagerIOUring(CapIOManager *iomgr);
+
+/* Synchronous I/O and timer operations */
+bool syncIOWaitReadyIOUring(CapIOManager *iomgr, StgTSO *tso,
+                            IOReadOrWrite rw, HsInt fd);
+void syncIOCancelIOUring(CapIOManager *iomgr, StgTSO *tso);
+
+/* Asynchronous operations */
+bool asyncIOWaitReadyIOUring(CapIOManager *iomgr, StgAsyncIOOp *aiop,
+                             IOReadOrWrite rw, int fd);
+void asyncIOCancelIOUring(CapIOManager *iomgr, StgAsyncIOOp *aiop);
+
+/* Scheduler operations */
+bool anyPendingTimeoutsOrIOIOUring(CapIOManager *iomgr);
+void pollCompletedTimeoutsOrIOIOUring(CapIOManager *iomgr);
+bool awaitCompletedTimeoutsOrIOIOUring(CapIOManager *iomgr);
+void interruptIOManagerIOUring(CapIOManager *iomgr);
+
+#endif /* IOMGR_ENABLED_IO_URING */
+
+#include "EndPrivate.h"
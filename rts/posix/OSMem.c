@@ -75,9 +75,22 @@
 
 static void *next_request = 0;
 
+#if defined(USE_LARGE_ADDRESS_SPACE)
+static void initHugePages(void);
+#endif
+
 void osMemInit(void)
 {
     next_request = (void *)RtsFlags.GcFlags.heapBase;
+#if defined(USE_LARGE_ADDRESS_SPACE)
+    initHugePages();
+#else
+    if (RtsFlags.GcFlags.hugePages != HUGE_PAGES_NONE) {
+        errorBelch("warning: --huge-pages requires a large address space; "
+                   "ignoring");
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+    }
+#endif
 }
 
 /* -----------------------------------------------------------------------------
@@ -457,37 +470,256 @@ StgWord64 getPhysicalMemorySize (void)
 
 #if defined(USE_LARGE_ADDRESS_SPACE)
 
+/* Note [Huge pages for the heap]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Large heaps spend a good deal of time in TLB misses while scavenging and
+ * evacuating. With +RTS --huge-pages the heap is backed by huge pages (2MB
+ * on x86-64 and AArch64), of which there are two kinds on Linux:
+ *
+ *  - Transparent huge pages (--huge-pages=thp). We align the heap
+ *    reservation to the huge page size and madvise(MADV_HUGEPAGE) committed
+ *    memory, which lets the kernel back it with huge pages when it can (at
+ *    fault time, or later via khugepaged). Nothing else changes: commit and
+ *    decommit still work at megablock granularity, although decommitting
+ *    half of a huge page will split it.
+ *
+ *  - Explicit huge pages from the hugetlbfs pool (--huge-pages=hugetlb),
+ *    which the administrator must have reserved (vm.nr_hugepages). These are
+ *    guaranteed, but can only be mapped and unmapped in units of whole huge
+ *    pages, whereas the block allocator commits and decommits megablocks.
+ *    We therefore keep a count of committed megablocks per huge page of the
+ *    reservation (huge_page_refs): the first commit within a huge page maps
+ *    all of it with MAP_HUGETLB, and the last decommit returns it to the
+ *    pool by mapping fresh reserved address space over it.
+ *
+ *    If the pool is exhausted we warn once and from then on map huge pages
+ *    with ordinary pages plus MADV_HUGEPAGE, i.e. fall back to transparent
+ *    huge pages. Likewise, with --huge-pages=thp we give up on huge pages
+ *    if the kernel doesn't support MADV_HUGEPAGE.
+ *
+ * The number of huge pages mapped is reported by reportMemoryMap, along with
+ * the kernel's own accounting.
+ */
+
+static W_ huge_page_size = 0;   // 0 if we aren't using huge pages
+
+// Huge pages mapped from the hugetlbfs pool, and with ordinary pages instead.
+static W_ n_hugetlb_pages = 0;
+static W_ n_fallback_pages = 0;
+
+#if defined(MADV_HUGEPAGE) || defined(MAP_HUGETLB)
+static bool huge_pages_failed = false;
+#endif
+
+#if defined(MAP_HUGETLB)
+// See Note [Huge pages for the heap]. Only used with HUGE_PAGES_HUGETLB.
+static W_ huge_pages_base = 0;
+static uint8_t *huge_page_refs = NULL;
+#endif
+
+// The default huge page size, from /proc/meminfo.
+static W_
+readHugePageSize(void)
+{
+    W_ size = 0;
+#if defined(linux_HOST_OS)
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (f != NULL) {
+        char line[128];
+        unsigned long kb;
+        while (fgets(line, sizeof(line), f) != NULL) {
+            if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+                size = (W_)kb * 1024;
+                break;
+            }
+        }
+        fclose(f);
+    }
+#endif
+    return size;
+}
+
+static void
+initHugePages(void)
+{
+    if (RtsFlags.GcFlags.hugePages == HUGE_PAGES_NONE) {
+        return;
+    }
+#if !defined(MADV_HUGEPAGE)
+    if (RtsFlags.GcFlags.hugePages == HUGE_PAGES_THP) {
+        errorBelch("warning: transparent huge pages are not supported on "
+                   "this platform; ignoring --huge-pages");
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+        return;
+    }
+#endif
+#if !defined(MAP_HUGETLB)
+    if (RtsFlags.GcFlags.hugePages == HUGE_PAGES_HUGETLB) {
+        errorBelch("warning: MAP_HUGETLB is not supported on this platform; "
+                   "ignoring --huge-pages=hugetlb");
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+        return;
+    }
+#endif
+
+    huge_page_size = readHugePageSize();
+    // We need whole megablocks per huge page and a small refcount; anything
+    // else (e.g. 1GB default huge pages) would make the heap far too coarse.
+    if (huge_page_size == 0
+        || huge_page_size % MBLOCK_SIZE != 0
+        || huge_page_size / MBLOCK_SIZE > 64) {
+        errorBelch("warning: unsupported huge page size %" FMT_Word
+                   " bytes; ignoring --huge-pages", huge_page_size);
+        huge_page_size = 0;
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+    }
+}
+
+#if defined(MADV_HUGEPAGE) || defined(MAP_HUGETLB)
+// Called when the kernel refuses our huge pages.
+static void
+hugePagesUnavailable(const char *what)
+{
+    if (!huge_pages_failed) {
+        sysErrorBelch("warning: %s failed; falling back to ordinary pages",
+                      what);
+        huge_pages_failed = true;
+    }
+}
+#endif
+
+// Ask for transparent huge pages for committed memory.
+static void
+adviseHugePages(void *at STG_UNUSED, W_ size STG_UNUSED)
+{
+#if defined(MADV_HUGEPAGE)
+    if (madvise(at, size, MADV_HUGEPAGE) != 0
+        && RtsFlags.GcFlags.hugePages == HUGE_PAGES_THP) {
+        // The kernel was built without THP; don't bother again.
+        hugePagesUnavailable("madvise(MADV_HUGEPAGE)");
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+    }
+#endif
+}
+
+#if defined(MAP_HUGETLB)
+
+// huge_page_refs[i] holds the number of committed megablocks in the i'th
+// huge page, plus HUGE_PAGE_FROM_POOL if it was mapped with MAP_HUGETLB.
+#define HUGE_PAGE_FROM_POOL 0x80
+#define HUGE_PAGE_REFS_MASK 0x7f
+
+// Map the huge page at `at`, which must currently be reserved. Returns true
+// if it came from the hugetlbfs pool.
+static bool
+commitHugePage(void *at)
+{
+    if (!huge_pages_failed) {
+        void *r = mmap(at, huge_page_size, PROT_READ | PROT_WRITE,
+                       MAP_FIXED | MAP_ANON | MAP_PRIVATE | MAP_HUGETLB,
+                       -1, 0);
+        if (r != MAP_FAILED) {
+            n_hugetlb_pages++;
+            return true;
+        }
+        hugePagesUnavailable("mmap(MAP_HUGETLB)");
+    }
+    if (my_mmap(at, huge_page_size, MEM_COMMIT) == NULL) {
+        errorBelch("Unable to commit %" FMT_Word " bytes of memory",
+                   huge_page_size);
+        errorBelch("Exiting. The system might be out of memory.");
+        stg_exit(EXIT_FAILURE);
+    }
+    adviseHugePages(at, huge_page_size);
+    n_fallback_pages++;
+    return false;
+}
+
+// Return the huge page at `at` to the OS, leaving the address space reserved.
+static void
+decommitHugePage(void *at, bool from_pool)
+{
+    void *r = mmap(at, huge_page_size, PROT_NONE,
+                   MAP_FIXED | MAP_NORESERVE | MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (r == MAP_FAILED) {
+        sysErrorBelch("unable to decommit huge page");
+    }
+    if (from_pool) {
+        n_hugetlb_pages--;
+    } else {
+        n_fallback_pages--;
+    }
+}
+
+// Commit or decommit [at, at+size) with explicit huge pages. See
+// Note [Huge pages for the heap].
+static void
+commitHugeTlbMemory(void *at, W_ size, bool commit)
+{
+    ASSERT(((W_)at & MBLOCK_MASK) == 0 && (size & MBLOCK_MASK) == 0);
+    for (W_ mb = (W_)at; mb < (W_)at + size; mb += MBLOCK_SIZE) {
+        W_ i = (mb - huge_pages_base) / huge_page_size;
+        void *page = (void *)(huge_pages_base + i * huge_page_size);
+        uint8_t refs = huge_page_refs[i];
+        if (commit) {
+            if ((refs & HUGE_PAGE_REFS_MASK) == 0
+                && commitHugePage(page)) {
+                refs |= HUGE_PAGE_FROM_POOL;
+            }
+            refs++;
+        } else {
+            ASSERT((refs & HUGE_PAGE_REFS_MASK) > 0);
+            refs--;
+            if ((refs & HUGE_PAGE_REFS_MASK) == 0) {
+                decommitHugePage(page, refs & HUGE_PAGE_FROM_POOL);
+                refs = 0;
+            }
+        }
+        huge_page_refs[i] = refs;
+    }
+}
+
+#endif /* MAP_HUGETLB */
+
+void
+osGetHugePageStats(HugePageStats *stats)
+{
+    stats->mode = RtsFlags.GcFlags.hugePages;
+    stats->huge_page_size = huge_page_size;
+    stats->hugetlb_pages = n_hugetlb_pages;
+    stats->fallback_pages = n_fallback_pages;
+}
+
 static void *
 osTryReserveHeapMemory (W_ len, void *hint)
 {
     void *base, *top;
     void *start, *end;
+    // See Note [Huge pages for the heap].
+    const W_ align = huge_page_size > MBLOCK_SIZE ? huge_page_size : MBLOCK_SIZE;
 
-    ASSERT((len & ~MBLOCK_MASK) == len);
+    ASSERT(len % align == 0);
 
-    /* We try to allocate len + MBLOCK_SIZE,
-       because we need memory which is MBLOCK_SIZE aligned,
+    /* We try to allocate len + align,
+       because we need memory which is align-ed (normally to MBLOCK_SIZE),
        and then we discard what we don't need */
 
-    base = my_mmap(hint, len + MBLOCK_SIZE, MEM_RESERVE);
+    base = my_mmap(hint, len + align, MEM_RESERVE);
     if (base == NULL)
         return NULL;
 
-    top = (void*)((W_)base + len + MBLOCK_SIZE);
-
-    if (((W_)base & MBLOCK_MASK) != 0) {
-        start = MBLOCK_ROUND_UP(base);
-        end = MBLOCK_ROUND_DOWN(top);
-        ASSERT(((W_)end - (W_)start) == len);
+    top = (void*)((W_)base + len + align);
+    start = (void*)roundUpToAlign((W_)base, align);
+    end = (void*)((W_)start + len);
+    ASSERT((W_)end <= (W_)top);
 
-        if (munmap(base, (W_)start-(W_)base) < 0) {
-            sysErrorBelch("unable to release slop before heap");
-        }
-        if (munmap(end, (W_)top-(W_)end) < 0) {
-            sysErrorBelch("unable to release slop after heap");
-        }
-    } else {
-        start = base;
+    // Even if base is already aligned there are align bytes of slop after
+    // the heap.
+    if (start != base && munmap(base, (W_)start-(W_)base) < 0) {
+        sysErrorBelch("unable to release slop before heap");
+    }
+    if (end != top && munmap(end, (W_)top-(W_)end) < 0) {
+        sysErrorBelch("unable to release slop after heap");
     }
 
     return start;
@@ -594,6 +826,9 @@ void *osReserveHeapMemory(void *startAddressPtr, W_ *len)
     attempt = 0;
     while (attempt < MAX_ATTEMPTS) {
         *len &= ~MBLOCK_MASK;
+        if (huge_page_size > MBLOCK_SIZE) {
+            *len -= *len % huge_page_size;
+        }
 
         if (*len < MBLOCK_SIZE) {
             // Give up if the system won't even give us 16 blocks worth of heap
@@ -646,17 +881,37 @@ void *osReserveHeapMemory(void *startAddressPtr, W_ *len)
         sysErrorBelch("failed to reserve heap memory");
     }
 
+#if defined(MAP_HUGETLB)
+    if (at != NULL && RtsFlags.GcFlags.hugePages == HUGE_PAGES_HUGETLB) {
+        huge_pages_base = (W_)at;
+        huge_page_refs = stgCallocBytes(*len / huge_page_size, sizeof(uint8_t),
+                                        "osReserveHeapMemory");
+    }
+#endif
+
     return at;
 }
 
 void osCommitMemory(void *at, W_ size)
 {
+#if defined(MAP_HUGETLB)
+    if (huge_page_refs != NULL) {
+        commitHugeTlbMemory(at, size, true);
+        return;
+    }
+#endif
+
     void *r = my_mmap(at, size, MEM_COMMIT);
     if (r == NULL) {
         errorBelch("Unable to commit %" FMT_Word " bytes of memory", size);
         errorBelch("Exiting. The system might be out of memory.");
         stg_exit(EXIT_FAILURE);
     }
+
+    // See Note [Huge pages for the heap].
+    if (RtsFlags.GcFlags.hugePages == HUGE_PAGES_THP) {
+        adviseHugePages(at, size);
+    }
 }
 
 /* Note [MADV_FREE and MADV_DONTNEED]
@@ -683,6 +938,13 @@ void osDecommitMemory(void *at, W_ size)
 {
     int r;
 
+#if defined(MAP_HUGETLB)
+    if (huge_page_refs != NULL) {
+        commitHugeTlbMemory(at, size, false);
+        return;
+    }
+#endif
+
     // First make the memory unaccessible (so that we get a segfault
     // at the next attempt to touch it)
     // We only do this in DEBUG because it forces the OS to remove
@@ -730,10 +992,53 @@ void osReleaseHeapMemory(void)
                mblock_address_space.end - mblock_address_space.begin);
     if(r < 0)
         sysErrorBelch("unable to release address space");
+
+#if defined(MAP_HUGETLB)
+    if (huge_page_refs != NULL) {
+        stgFree(huge_page_refs);
+        huge_page_refs = NULL;
+    }
+#endif
 }
 
 #endif
 
+bool osMapFileOverMemory(void *at, W_ size, int fd, StgWord64 offset)
+{
+#if defined(USE_LARGE_ADDRESS_SPACE) && defined(MAP_HUGETLB)
+    // Part of a huge page can't be replaced by a file mapping.
+    if (huge_page_refs != NULL) {
+        return false;
+    }
+#endif
+
+    // mmap(MAP_FIXED) discards the memory at `at` before it checks that fd
+    // can be mapped at all, so check that first with a mapping of our own;
+    // after that MAP_FIXED can only fail if we run out of memory.
+    void *probe = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, (off_t)offset);
+    if (probe == MAP_FAILED) {
+        return false;
+    }
+    munmap(probe, size);
+
+    void *r = mmap(at, size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE,
+                   fd, (off_t)offset);
+    if (r == MAP_FAILED) {
+        barf("osMapFileOverMemory: mmap: %s", strerror(errno));
+    }
+    return true;
+}
+
+void osUnmapFileFromMemory(void *at, W_ size)
+{
+    void *r = mmap(at, size, PROT_READ | PROT_WRITE,
+                   MAP_FIXED | MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (r == MAP_FAILED) {
+        barf("osUnmapFileFromMemory: mmap: %s", strerror(errno));
+    }
+}
+
 bool osBuiltWithNumaSupport(void)
 {
 #if HAVE_LIBNUMA
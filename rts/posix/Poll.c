@@ -102,7 +102,8 @@ makes for slightly cheaper calls to poll() (which cost O(nfds)) and cheaper
 iteration over all active operations. We use a simple doubling strategy to
 enlarge the tables, and never shrink.
 
-We also use a StgTimeoutQueue to track timeouts, and use the delay to the next
+We also use a StgTimeoutQueue (or with --io-timer-wheel a TimerWheel, see
+Note [I/O manager timer wheel]) to track timeouts, and use the delay to the next
 timeout (if any) as the poll() timeout parameter.
 
 The CapIOManager structure for this I/O manager contains:
@@ -110,6 +111,7 @@ The CapIOManager structure for this I/O manager contains:
     ClosureTable     aiop_table;
     struct pollfd   *aiop_poll_table, *full_poll_table;
     StgTimeoutQueue *timeout_queue;
+    TimerWheel      *timer_wheel;
     int interrupt_fd_r, interrupt_fd_w;
 
 We also support the Linux-specific ppoll API which supports higher resolution
@@ -140,7 +142,7 @@ static void reportPollError(int res, nfds_t nfds) STG_NORETURN;
 void initCapabilityIOManagerPoll(CapIOManager *iomgr)
 {
     initClosureTable(&iomgr->aiop_table, ClosureTableCompact);
-    iomgr->timeout_queue = emptyTimeoutQueue();
+    initTimeouts(iomgr);
 
 #if defined(HAVE_PREEMPTION)
     newFdWakeup(&iomgr->interrupt_fd_r, &iomgr->interrupt_fd_w);
@@ -165,6 +167,7 @@ void initCapabilityIOManagerPoll(CapIOManager *iomgr)
 void freeCapabilityIOManagerPoll(CapIOManager *iomgr)
 {
     stgFree(iomgr->full_poll_table);
+    freeTimeouts(iomgr);
 #if defined(HAVE_PREEMPTION)
     closeFdWakeup(iomgr->interrupt_fd_r, iomgr->interrupt_fd_w);
 #endif
@@ -273,7 +276,7 @@ static void ioCancel(CapIOManager *iomgr, StgAsyncIOOp *aiop)
 
 bool anyPendingTimeoutsOrIOPoll(CapIOManager *iomgr)
 {
-    return !isEmptyTimeoutQueue(iomgr->timeout_queue)
+    return anyPendingTimeouts(iomgr)
         || !isEmptyClosureTable(&iomgr->aiop_table);
 }
 
@@ -406,7 +409,7 @@ void pollCompletedTimeoutsOrIOPoll(CapIOManager *iomgr)
 {
     ASSERT(iomgr->aiop_poll_table == iomgr->full_poll_table+1);
 
-    if (!isEmptyTimeoutQueue(iomgr->timeout_queue)) {
+    if (anyPendingTimeouts(iomgr)) {
         Time now = getProcessElapsedTime();
         processTimeoutCompletions(iomgr, now);
     }
@@ -474,7 +477,7 @@ bool awaitCompletedTimeoutsOrIOPoll(CapIOManager *iomgr)
      */
     do {
         /* There is either pending I/O or pending timers. */
-        ASSERT(!isEmptyTimeoutQueue(iomgr->timeout_queue) ||
+        ASSERT(anyPendingTimeouts(iomgr) ||
                !isEmptyClosureTable(&iomgr->aiop_table));
 
         Time now = getProcessElapsedTime();
@@ -15,13 +15,15 @@
  * using either the ppoll() or select() API. This lets it also block on a file
  * descriptor for early wakeup.
  *
- * The design uses a simple relative time delay with no catchup. That is, time
- * spent by the ticker thread itself (e.g. flushing eventlog buffers) is not
- * accounted for, and the next tick is delayed by that much (modulo wakeup
- * jitter). This is probably the right thing to do: generally in realtime
- * systems one does not want to try to catch up when behind, since that tends
- * towards oversubscribing resources. Graceful degredation is usually
- * preferable.
+ * Ticks are scheduled at absolute times, each one interval after the previous
+ * one was due, rather than one interval after the previous one happened. So
+ * wakeup latency, the time taken by the tick action and early wakeups to deal
+ * with requests don't accumulate into drift. There is no catchup however: if
+ * we are behind by a whole interval or more, we skip the missed ticks and
+ * start again from now. Generally in realtime systems one does not want to try
+ * to catch up when behind, since that tends towards oversubscribing resources.
+ * Graceful degredation is usually preferable. The tick action is meant to be
+ * cheap anyway: see Note [Timer worker] in rts/Timer.c.
  *
  * Experimental results (on Linux 6.18 on x86-64) to measure the typical
  * difference between the requested wakeup time and actual wakeup time for
@@ -62,6 +64,7 @@
 
 #include "Ticker.h"
 #include "RtsUtils.h"
+#include "GetTime.h"
 #include "Proftimer.h"
 #include "Schedule.h"
 #include "posix/Clock.h"
@@ -155,9 +158,11 @@ static void *ticker_thread_func(void *_handle_tick)
     bool exit    = false; // updated from atomic shared var exit_request
     // Note that we start paused.
 
+    // When the next tick is due, if we're not paused
+    Time next_tick = 0;
+
     timeout timeout;
     fdset fdset;
-    poll_init_timeout(&timeout, ticker_interval);
     poll_init_fdset(&fdset, notifyfd_r);
 
     while (!exit) {
@@ -166,6 +171,8 @@ static void *ticker_thread_func(void *_handle_tick)
         if (paused) {
             notify = poll_no_timeout(&fdset);
         } else {
+            Time now = getProcessElapsedTime();
+            poll_init_timeout(&timeout, next_tick > now ? next_tick - now : 0);
             notify = poll_with_timeout(&fdset, &timeout);
         }
 
@@ -173,6 +180,13 @@ static void *ticker_thread_func(void *_handle_tick)
             // The time expired, no state change notification.
             handle_tick(0);
 
+            next_tick += ticker_interval;
+            Time now = getProcessElapsedTime();
+            if (next_tick <= now) {
+                // We are a whole interval behind: skip the missed ticks.
+                next_tick = now + ticker_interval;
+            }
+
         } else if (notify > 0) {
             // State change notification, check the request variables.
 
@@ -182,8 +196,12 @@ static void *ticker_thread_func(void *_handle_tick)
             // read them here afterwards.
             collectFdWakeup(notifyfd_r);
 
+            bool was_paused = paused;
             paused = ACQUIRE_LOAD_ALWAYS(&pause_request);
             exit   = RELAXED_LOAD_ALWAYS(&exit_request);
+            if (was_paused && !paused) {
+                next_tick = getProcessElapsedTime() + ticker_interval;
+            }
 
 #if defined(THREADED_RTS)
             if (RELAXED_LOAD_ALWAYS(&interrupt_request)) {
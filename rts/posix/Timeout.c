@@ -13,18 +13,85 @@
 #include "Threads.h"
 #include "Schedule.h"
 #include "Prelude.h"
+#include "RtsFlags.h"
+#include "RtsUtils.h"
 
 #include "Timeout.h"
 #include "IOManagerInternals.h"
 #include "TimeoutQueue.h"
+#include "TimerWheel.h"
 
 #include <limits.h>
 
 
-/* Currently only used by the poll I/O manager, but in future may be used by
-   several in-RTS I/O managers.
+/* Used by the poll, epoll and io_uring I/O managers, but in future may be
+   used by other in-RTS I/O managers.
  */
-#if defined(IOMGR_ENABLED_POLL)
+#if defined(IOMGR_ENABLED_POLL) || defined(IOMGR_ENABLED_EPOLL) \
+ || defined(IOMGR_ENABLED_IO_URING)
+
+/* Note [I/O manager timer wheel]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   By default the timeouts of each capability are kept in a leftist heap (see
+   TimeoutQueue.h), which is O(log n) per insertion, deletion and expiry.
+   Programs with a very large number of concurrent timeouts (a server with a
+   timeout on every connection, say) can instead use a hierarchical timer
+   wheel (see TimerWheel.h) with the RTS flag --io-timer-wheel. The wheel is
+   O(1) per operation, but rounds waketimes up to its ticks of about a
+   millisecond, so a threadDelay may last up to a millisecond longer than with
+   the heap. The poll and epoll I/O managers only wait in units of a
+   millisecond anyway.
+
+   Both hold the same StgTimeout objects, and the I/O managers go through the
+   functions here rather than using either one directly.
+ */
+
+void initTimeouts(CapIOManager *iomgr)
+{
+    iomgr->timeout_queue = emptyTimeoutQueue();
+    iomgr->timer_wheel   = NULL;
+    if (RtsFlags.MiscFlags.ioTimerWheel) {
+        iomgr->timer_wheel = stgMallocBytes(sizeof(TimerWheel),
+                                            "initTimeouts");
+        initTimerWheel(iomgr->timer_wheel);
+    }
+}
+
+
+void freeTimeouts(CapIOManager *iomgr)
+{
+    stgFree(iomgr->timer_wheel);
+    iomgr->timer_wheel = NULL;
+}
+
+
+bool anyPendingTimeouts(CapIOManager *iomgr)
+{
+    if (iomgr->timer_wheel != NULL) {
+        return !isEmptyTimerWheel(iomgr->timer_wheel);
+    }
+    return !isEmptyTimeoutQueue(iomgr->timeout_queue);
+}
+
+
+void markTimeouts(evac_fn evac, void *user, CapIOManager *iomgr)
+{
+    evac(user, (StgClosure **)(void *)&iomgr->timeout_queue);
+    if (iomgr->timer_wheel != NULL) {
+        markTimerWheel(evac, user, iomgr->timer_wheel);
+    }
+}
+
+
+/* The earliest time at which a timeout may expire. */
+static Time nextTimeoutWaketime(CapIOManager *iomgr)
+{
+    if (iomgr->timer_wheel != NULL) {
+        return findMinWaketimeTimerWheel(iomgr->timer_wheel);
+    }
+    return findMinWaketimeTimeoutQueue(iomgr->timeout_queue);
+}
+
 
 bool syncDelayTimeout(CapIOManager *iomgr, StgTSO *tso, HsInt us_delay)
 {
@@ -51,7 +118,11 @@ bool syncDelayTimeout(CapIOManager *iomgr, StgTSO *tso, HsInt us_delay)
     tso->block_info.timeout = timeout;
     RELEASE_STORE(&tso->why_blocked, BlockedOnDelay);
 
-    insertTimeoutQueue(&iomgr->timeout_queue, timeout, target);
+    if (iomgr->timer_wheel != NULL) {
+        insertTimerWheel(iomgr->timer_wheel, timeout, target);
+    } else {
+        insertTimeoutQueue(&iomgr->timeout_queue, timeout, target);
+    }
 
     debugTrace(DEBUG_iomanager,
                "timer for delay of %lld usec installed at time %lld ns",
@@ -65,7 +136,11 @@ void syncDelayCancelTimeout(CapIOManager *iomgr, StgTSO *tso)
     ASSERT(tso->why_blocked == BlockedOnDelay);
     StgTimeoutQueue *timeout = tso->block_info.timeout;
 
-    deleteTimeoutQueue(&iomgr->timeout_queue, timeout);
+    if (iomgr->timer_wheel != NULL) {
+        deleteTimerWheel(iomgr->timer_wheel, timeout);
+    } else {
+        deleteTimeoutQueue(&iomgr->timeout_queue, timeout);
+    }
 
     /* the timeout is no longer accessible from anywhere (except here) */
     IF_NONMOVING_WRITE_BARRIER_ENABLED {
@@ -90,6 +165,24 @@ static void notifyTimeoutCompletion(CapIOManager *iomgr, StgTimeout *timeout);
  */
 void processTimeoutCompletions(CapIOManager *iomgr, Time now)
 {
+    if (iomgr->timer_wheel != NULL) {
+        /* The wheel gives us all the expired timeouts at once */
+        StgTimeout *timeout = expireTimerWheel(iomgr->timer_wheel, now);
+        while (timeout != (StgTimeout *) &stg_TIMEOUT_QUEUE_EMPTY_closure) {
+            StgTimeout *next = timeout->a;
+            timeout->a = emptyTimeoutQueue();
+            debugTrace(DEBUG_iomanager,"timer expired at %lld ns",
+                       timeout->waketime);
+            notifyTimeoutCompletion(iomgr, timeout);
+
+            IF_NONMOVING_WRITE_BARRIER_ENABLED {
+                updateRemembSetPushClosure(iomgr->cap, (StgClosure *)timeout);
+            }
+            timeout = next;
+        }
+        return;
+    }
+
     /* Pop entries from the front of the sleeping queue that are past their
      * wake time, and unblock the corresponding MVars.
      */
@@ -132,18 +225,19 @@ static void notifyTimeoutCompletion(CapIOManager *iomgr, StgTimeout *timeout)
 }
 
 
-/* poll() expect a timeout in milliseconds, with special
+/* poll() and epoll_wait() expect a timeout in milliseconds, with special
  * values of -1 for indefinite wait, and 0 for no waiting.
  */
-#if !(defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1)
+#if !(defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1) \
+ || defined(IOMGR_ENABLED_EPOLL)
 int timeoutInMilliseconds(CapIOManager *iomgr, bool wait, Time now)
 {
     if (!wait) {
         /* Don't wait, just poll. */
         return 0;
 
-    } else if (!isEmptyTimeoutQueue(iomgr->timeout_queue)) {
-        Time waketime = findMinWaketimeTimeoutQueue(iomgr->timeout_queue);
+    } else if (anyPendingTimeouts(iomgr)) {
+        Time waketime = nextTimeoutWaketime(iomgr);
         Time waittime = waketime - now;
 
         /* Any expired timeouts should have been cleared, so we must be waiting
@@ -174,11 +268,12 @@ int timeoutInMilliseconds(CapIOManager *iomgr, bool wait, Time now)
 #endif
 
 
-/* ppoll() expect a timeout in nanoseconds, using
+/* ppoll() and io_uring_enter() expect a timeout in nanoseconds, using
  * struct timespec * with special values of NULL for indefinite wait,
  * and 0 for no waiting.
  */
-#if (defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1)
+#if (defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1) \
+ || defined(IOMGR_ENABLED_IO_URING)
 struct timespec *timeoutInNanoseconds(CapIOManager *iomgr, bool wait,
                                       Time now, struct timespec *tv)
 {
@@ -187,8 +282,8 @@ struct timespec *timeoutInNanoseconds(CapIOManager *iomgr, bool wait,
         *tv = (struct timespec) { .tv_sec = 0, .tv_nsec = 0 };
         return tv;
 
-    } else if (!isEmptyTimeoutQueue(iomgr->timeout_queue)) {
-        Time waketime = findMinWaketimeTimeoutQueue(iomgr->timeout_queue);
+    } else if (anyPendingTimeouts(iomgr)) {
+        Time waketime = nextTimeoutWaketime(iomgr);
         Time waittime = waketime - now;
 
         /* Any expired timeouts should have been cleared, so we must be waiting
@@ -220,5 +315,5 @@ struct timespec *timeoutInNanoseconds(CapIOManager *iomgr, bool wait,
 }
 #endif
 
-#endif // defined(IOMGR_ENABLED_POLL)
+#endif /* POLL || EPOLL || IO_URING */
 
@@ -10,8 +10,24 @@
 
 #pragma once
 
+#include "IOManager.h"
+
+#include "sm/GC.h" // for evac_fn below
+
 #include "BeginPrivate.h"
 
+/* Set up and tear down the timeout collection of a capability's I/O manager,
+ * which is a leftist heap or, with --io-timer-wheel, a timer wheel. See
+ * Note [I/O manager timer wheel] in Timeout.c.
+ */
+void initTimeouts(CapIOManager *iomgr);
+void freeTimeouts(CapIOManager *iomgr);
+
+bool anyPendingTimeouts(CapIOManager *iomgr);
+
+/* Mark the timeouts as GC roots */
+void markTimeouts(evac_fn evac, void *user, CapIOManager *iomgr);
+
 bool syncDelayTimeout(CapIOManager *iomgr, StgTSO *tso, HsInt us_delay);
 
 void syncDelayCancelTimeout(CapIOManager *iomgr, StgTSO *tso);
@@ -29,19 +45,21 @@ void processTimeoutCompletions(CapIOManager *iomgr, Time now);
 /* Utility to compute the timeout wait time (in milliseconds) between now and
  * the next timer expiry (if any), or no waiting (if !wait).
  *
- * This is intended to be used with poll() which expect a
+ * This is intended to be used with poll() or epoll_wait() which expect a
  * timeout in milliseconds, with special values of -1 for indefinite wait,
  * and 0 for no waiting.
  */
-#if !(defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1)
+#if !(defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1) \
+ || defined(IOMGR_ENABLED_EPOLL)
 int timeoutInMilliseconds(CapIOManager *iomgr, bool wait, Time now);
 #endif
 
 /* As above, but a timeout in nanoseconds. This is intended to be used with
- * ppoll() which expect struct timespec *, with special
+ * ppoll() or io_uring_enter() which expect struct timespec *, with special
  * values of NULL for indefinite wait, and 0 for no waiting.
  */
-#if (defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1)
+#if (defined(HAVE_DECL_PPOLL) && HAVE_DECL_PPOLL == 1) \
+ || defined(IOMGR_ENABLED_IO_URING)
 struct timespec *timeoutInNanoseconds(CapIOManager *iomgr, bool wait,
                                       Time now, struct timespec *tv);
 #endif
@@ -24,8 +24,11 @@
 #include "BlockAlloc.h"
 #include "Trace.h"
 #include "sm/ShouldCompact.h"
+#include "sm/OSMem.h"
 
 #include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #if defined(HAVE_UNISTD_H)
 #include <unistd.h>
@@ -33,6 +36,9 @@
 #if defined(HAVE_LIMITS_H)
 #include <limits.h>
 #endif
+#if !defined(mingw32_HOST_OS)
+#include <sys/uio.h>
+#endif
 
 /*
   Note [Compact Normal Forms]
@@ -280,6 +286,10 @@ compactFree(StgCompactNFData *str)
             // When using the non-moving collector we leave compact object
             // evacuated to the oldset gen as BF_EVACUATED to avoid evacuating
             // objects in the non-moving heap.
+        if (bd->flags & BF_COMPACT_FILE) {
+            // See Note [Compact region files].
+            osUnmapFileFromMemory(bd->start, bd->blocks * BLOCK_SIZE);
+        }
         freeGroup(bd);
     }
 }
@@ -784,12 +794,56 @@ any_needs_fixup(StgCompactNFDataBlock *block)
     return false;
 }
 
+/*
+  Note [Compact fixup table]
+  ~~~~~~~~~~~~~~~~~~~~~~~~~~
+  To fix up a pointer into a compact imported at a different address we need
+  the block group which contained it in the old layout. Each block group
+  occupied [block->self, block->self + bd->blocks * BLOCK_SIZE) there, a range
+  of whole block allocator blocks, so we index the old layout the way the
+  block allocator indexes the heap: the fixup table maps each old megablock to
+  an array giving, for each block in it, the block group of the compact which
+  now holds that block (or NULL). Looking up a pointer is then a hash table
+  lookup and an array index, and the hash table lookup is skipped when the
+  pointer is in the same megablock as the previous one, which it usually is.
+
+  Large compacts are fixed up by several threads (+RTS
+  --compact-fixup-threads). Once built the table is only read, and each
+  pointer is written only by the thread fixing up the block containing it,
+  so the threads just claim blocks from a shared counter. The old addresses
+  (block->self) are only overwritten by fixup_late, once all threads are done.
+*/
+
+#define FIXUP_BLOCKS_PER_MBLOCK (MBLOCK_SIZE / BLOCK_SIZE)
+
+// Don't start threads to fix up compacts smaller than this (in bytes).
+#define FIXUP_PARALLEL_MIN_SIZE (16 * MBLOCK_SIZE)
+
+typedef struct {
+    StgCompactNFDataBlock *blocks[FIXUP_BLOCKS_PER_MBLOCK];
+} FixupMBlock;
+
+typedef struct {
+    HashTable *mblocks;                 // old megablock address -> FixupMBlock
+    StgCompactNFDataBlock **blocks;     // the blocks to fix up
+    StgWord n_blocks;
+    StgWord total_size;                 // bytes used in blocks
+    volatile StgWord next;              // the next block to be claimed
+    bool failed;
+} FixupTable;
+
+// What each thread fixing up a compact remembers of its last lookup.
+typedef struct {
+    FixupTable *table;
+    StgWord last_mblock;
+    FixupMBlock *last_map;
+} FixupCursor;
+
 #if defined(DEBUG)
 static void
-spew_failing_pointer(StgWord *fixup_table, uint32_t count, StgWord address)
+spew_failing_pointer(FixupTable *table, StgWord address)
 {
-    uint32_t i;
-    StgWord key, value;
+    StgWord i;
     StgCompactNFDataBlock *block;
     bdescr *bd;
     StgWord size;
@@ -797,70 +851,48 @@ spew_failing_pointer(StgWord *fixup_table, uint32_t count, StgWord address)
     debugBelch("Failed to adjust 0x%" FMT_HexWord ". Block dump follows...\n",
                address);
 
-    for (i  = 0; i < count; i++) {
-        key = fixup_table [2 * i];
-        value = fixup_table [2 * i + 1];
-
-        block = (StgCompactNFDataBlock*)value;
+    for (i  = 0; i < table->n_blocks; i++) {
+        block = table->blocks[i];
         bd = Bdescr((P_)block);
         size = (W_)bd->free - (W_)bd->start;
 
-        debugBelch("%" FMT_Word32 ": was 0x%" FMT_HexWord "-0x%" FMT_HexWord
-                   ", now 0x%" FMT_HexWord "-0x%" FMT_HexWord "\n", i, key,
-                   key+size, value, value+size);
+        debugBelch("%" FMT_Word ": was 0x%" FMT_HexWord "-0x%" FMT_HexWord
+                   ", now 0x%" FMT_HexWord "-0x%" FMT_HexWord "\n", i,
+                   (W_)block->self, (W_)block->self+size, (W_)block,
+                   (W_)block+size);
     }
 }
 #endif
 
 STATIC_INLINE StgCompactNFDataBlock *
-find_pointer(StgWord *fixup_table, uint32_t count, StgClosure *q)
+find_pointer(FixupCursor *cursor, StgClosure *q)
 {
     StgWord address = (W_)q;
-    uint32_t a, b, c;
-    StgWord key, value;
-    bdescr *bd;
-
-    a = 0;
-    b = count;
-    while (a < b-1) {
-        c = (a+b)/2;
-
-        key = fixup_table[c * 2];
-        value = fixup_table[c * 2 + 1];
+    StgWord mblock = address & ~MBLOCK_MASK;
+    StgCompactNFDataBlock *block;
 
-        if (key > address)
-            b = c;
-        else
-            a = c;
+    // See Note [Compact fixup table].
+    if (mblock != cursor->last_mblock) {
+        cursor->last_map = lookupHashTable(cursor->table->mblocks, mblock);
+        cursor->last_mblock = mblock;
     }
 
-    // three cases here: 0, 1 or 2 blocks to check
-    for ( ; a < b; a++) {
-        key = fixup_table[a * 2];
-        value = fixup_table[a * 2 + 1];
-
-        if (key > address)
-            goto fail;
-
-        bd = Bdescr((P_)value);
-
-        if (key + bd->blocks * BLOCK_SIZE <= address)
-            goto fail;
-
-        return (StgCompactNFDataBlock*)value;
+    if (cursor->last_map != NULL) {
+        block = cursor->last_map->blocks[(address & MBLOCK_MASK) >> BLOCK_SHIFT];
+        if (block != NULL)
+            return block;
     }
 
- fail:
     // We should never get here
 
 #if defined(DEBUG)
-    spew_failing_pointer(fixup_table, count, address);
+    spew_failing_pointer(cursor->table, address);
 #endif
     return NULL;
 }
 
 static bool
-fixup_one_pointer(StgWord *fixup_table, uint32_t count, StgClosure **p)
+fixup_one_pointer(FixupCursor *cursor, StgClosure **p)
 {
     StgWord tag;
     StgClosure *q;
@@ -877,7 +909,7 @@ fixup_one_pointer(StgWord *fixup_table, uint32_t count, StgClosure **p)
     if (!HEAP_ALLOCED(q))
         return true;
 
-    block = find_pointer(fixup_table, count, q);
+    block = find_pointer(cursor, q);
     if (block == NULL)
         return false;
     if (block == block->self)
@@ -890,8 +922,7 @@ fixup_one_pointer(StgWord *fixup_table, uint32_t count, StgClosure **p)
 }
 
 static bool
-fixup_mut_arr_ptrs (StgWord          *fixup_table,
-                    uint32_t               count,
+fixup_mut_arr_ptrs (FixupCursor      *cursor,
                     StgMutArrPtrs    *a)
 {
     StgPtr p, q;
@@ -899,7 +930,7 @@ fixup_mut_arr_ptrs (StgWord          *fixup_table,
     p = (StgPtr)&a->payload[0];
     q = (StgPtr)&a->payload[a->ptrs];
     for (; p < q; p++) {
-        if (!fixup_one_pointer(fixup_table, count, (StgClosure**)p))
+        if (!fixup_one_pointer(cursor, (StgClosure**)p))
             return false;
     }
 
@@ -907,7 +938,7 @@ fixup_mut_arr_ptrs (StgWord          *fixup_table,
 }
 
 static bool
-fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
+fixup_block(StgCompactNFDataBlock *block, FixupCursor *cursor)
 {
     const StgInfoTable *info;
     bdescr *bd;
@@ -921,7 +952,7 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
 
         switch (info->type) {
         case CONSTR_1_0:
-            if (!fixup_one_pointer(fixup_table, count,
+            if (!fixup_one_pointer(cursor,
                                    &((StgClosure*)p)->payload[0]))
                 return false;
             FALLTHROUGH;
@@ -930,12 +961,12 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
             break;
 
         case CONSTR_2_0:
-            if (!fixup_one_pointer(fixup_table, count,
+            if (!fixup_one_pointer(cursor,
                                    &((StgClosure*)p)->payload[1]))
                 return false;
             FALLTHROUGH;
         case CONSTR_1_1:
-            if (!fixup_one_pointer(fixup_table, count,
+            if (!fixup_one_pointer(cursor,
                                    &((StgClosure*)p)->payload[0]))
                 return false;
             FALLTHROUGH;
@@ -951,7 +982,7 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
 
             end = (P_)((StgClosure *)p)->payload + info->layout.payload.ptrs;
             for (p = (P_)((StgClosure *)p)->payload; p < end; p++) {
-                if (!fixup_one_pointer(fixup_table, count, (StgClosure **)p))
+                if (!fixup_one_pointer(cursor, (StgClosure **)p))
                     return false;
             }
             p += info->layout.payload.nptrs;
@@ -964,7 +995,7 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
 
         case MUT_ARR_PTRS_FROZEN_CLEAN:
         case MUT_ARR_PTRS_FROZEN_DIRTY:
-            fixup_mut_arr_ptrs(fixup_table, count, (StgMutArrPtrs*)p);
+            fixup_mut_arr_ptrs(cursor, (StgMutArrPtrs*)p);
             p += mut_arr_ptrs_sizeW((StgMutArrPtrs*)p);
             break;
 
@@ -975,7 +1006,7 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
             StgSmallMutArrPtrs *arr = (StgSmallMutArrPtrs*)p;
 
             for (i = 0; i < arr->ptrs; i++) {
-                if (!fixup_one_pointer(fixup_table, count,
+                if (!fixup_one_pointer(cursor,
                                        &arr->payload[i]))
                     return false;
             }
@@ -1004,22 +1035,11 @@ fixup_block(StgCompactNFDataBlock *block, StgWord *fixup_table, uint32_t count)
     return true;
 }
 
-static int
-cmp_fixup_table_item (const void *e1, const void *e2)
-{
-    const StgWord *w1 = e1;
-    const StgWord *w2 = e2;
-    if (*w1 > *w2) return +1;
-    else if (*w1 < *w2) return -1;
-    else return 0;
-}
-
-static StgWord *
-build_fixup_table (StgCompactNFDataBlock *block, uint32_t *pcount)
+static void
+build_fixup_table (FixupTable *table, StgCompactNFDataBlock *block)
 {
-    uint32_t count;
+    StgWord count;
     StgCompactNFDataBlock *tmp;
-    StgWord *table;
 
     count = 0;
     tmp = block;
@@ -1028,47 +1048,123 @@ build_fixup_table (StgCompactNFDataBlock *block, uint32_t *pcount)
         tmp = tmp->next;
     } while(tmp && tmp->owner);
 
-    table = stgMallocBytes(sizeof(StgWord) * 2 * count, "build_fixup_table");
+    table->mblocks = allocHashTable();
+    table->blocks = stgMallocBytes(sizeof(StgCompactNFDataBlock *) * count,
+                                   "build_fixup_table");
+    table->n_blocks = count;
+    table->total_size = 0;
+    table->next = 0;
+    table->failed = false;
 
     count = 0;
     do {
-        table[count * 2] = (W_)block->self;
-        table[count * 2 + 1] = (W_)block;
-        count++;
+        bdescr *bd = Bdescr((P_)block);
+        StgWord old = (W_)block->self;
+        StgWord old_end = old + bd->blocks * BLOCK_SIZE;
+        StgWord mblock = 0;
+        FixupMBlock *map = NULL;
+
+        for (StgWord p = old; p < old_end; p += BLOCK_SIZE) {
+            if ((p & ~MBLOCK_MASK) != mblock || map == NULL) {
+                mblock = p & ~MBLOCK_MASK;
+                map = lookupHashTable(table->mblocks, mblock);
+                if (map == NULL) {
+                    map = stgCallocBytes(1, sizeof(FixupMBlock),
+                                         "build_fixup_table");
+                    insertHashTable(table->mblocks, mblock, map);
+                }
+            }
+            map->blocks[(p & MBLOCK_MASK) >> BLOCK_SHIFT] = block;
+        }
+
+        table->blocks[count++] = block;
+        table->total_size += (W_)bd->free - (W_)bd->start;
         block = block->next;
     } while(block && block->owner);
+}
 
-    qsort(table, count, sizeof(StgWord) * 2, cmp_fixup_table_item);
+static void
+free_fixup_table (FixupTable *table)
+{
+    freeHashTable(table->mblocks, stgFree);
+    stgFree(table->blocks);
+}
 
-    *pcount = count;
-    return table;
+static void
+fixup_claimed_blocks (FixupTable *table)
+{
+    FixupCursor cursor = { .table = table, .last_mblock = 0, .last_map = NULL };
+
+    while (!RELAXED_LOAD(&table->failed)) {
+        const StgWord i = atomic_inc(&table->next, 1) - 1;
+        if (i >= table->n_blocks)
+            break;
+        if (!fixup_block(table->blocks[i], &cursor))
+            RELAXED_STORE(&table->failed, true);
+    }
 }
 
+#if defined(THREADED_RTS)
+static void *
+fixup_helper (void *table)
+{
+    fixup_claimed_blocks(table);
+    return NULL;
+}
+#endif
+
 static bool
 fixup_loop(StgCompactNFDataBlock *block, StgClosure **proot)
 {
-    StgWord *table;
+    FixupTable table;
     bool ok;
-    uint32_t count;
 
-    table = build_fixup_table (block, &count);
+    build_fixup_table(&table, block);
 
-    do {
-        if (!fixup_block(block, table, count)) {
-            ok = false;
-            goto out;
+#if defined(THREADED_RTS)
+    // See Note [Compact fixup table].
+    uint32_t n_helpers = 0;
+    uint32_t n_started = 0;
+    OSThreadId *helpers = NULL;
+    if (table.total_size >= FIXUP_PARALLEL_MIN_SIZE) {
+        n_helpers = stg_min((StgWord) RtsFlags.MiscFlags.compactFixupThreads,
+                            table.n_blocks) - 1;
+    }
+    if (n_helpers > 0) {
+        helpers = stgMallocBytes(n_helpers * sizeof(OSThreadId), "fixup_loop");
+        for (; n_started < n_helpers; n_started++) {
+            // Too many threads is not an error; we just use fewer.
+            if (createAttachedOSThread(&helpers[n_started], "ghc_cnf_fixup",
+                                       fixup_helper, &table) != 0) {
+                break;
+            }
         }
+    }
+#endif
 
-        block = block->next;
-    } while(block && block->owner);
+    fixup_claimed_blocks(&table);
+
+#if defined(THREADED_RTS)
+    for (uint32_t i = 0; i < n_started; i++) {
+        joinOSThread(helpers[i]);
+    }
+    if (helpers != NULL) {
+        stgFree(helpers);
+    }
+#endif
 
-    ok = fixup_one_pointer(table, count, proot);
+    ok = !table.failed;
+    if (ok) {
+        FixupCursor cursor = { .table = &table, .last_mblock = 0,
+                               .last_map = NULL };
+        ok = fixup_one_pointer(&cursor, proot);
+    }
 
- out:
-    stgFree(table);
+    free_fixup_table(&table);
     return ok;
 }
 
+
 static void
 fixup_early(StgCompactNFData *str, StgCompactNFDataBlock *block)
 {
@@ -1178,3 +1274,336 @@ compactFixupPointers(StgCompactNFData *str,
 
     return (StgPtr)root;
 }
+
+/*
+  Note [Compact region files]
+  ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  compactWriteFd and compactReadFd store a compact in a file (or any other
+  file descriptor) and load it back, without going through a Haskell-level
+  filler function for every block (see importCompact in
+  GHC.Compact.Serialized). The layout of what is written is
+
+      CompactFileHeader
+      StgWord64 block_size[n_blocks]   -- bytes used in each block
+      padding to header.align
+      block 0, padded to header.align
+      ...
+      block n_blocks-1, padded to header.align
+
+  where the blocks are written verbatim (with writev, so without copying
+  them), including their StgCompactNFDataBlock headers. Those still hold the
+  addresses the blocks had in the writer, which is what the usual fixup uses
+  to relocate pointers. header.align is the page size of the writer.
+
+  When reading we allocate the blocks as importCompact does, with
+  compactAllocateBlock, and then, if the block starts at a page-aligned
+  offset of a regular file, replace its memory with a private (copy-on-write)
+  mapping of the file instead of reading it. The data is then only paged in
+  when it is used. We don't get to choose the address of the blocks, which
+  belong to the block allocator, so we can't map them at the address they
+  had when they were written; if they do end up at the same address the
+  fixup is skipped, as it always is (see any_needs_fixup), and otherwise only
+  the pages containing pointers are copied.
+
+  A mapped block group is flagged with BF_COMPACT_FILE, and compactFree puts
+  ordinary memory back in place before returning it to the block allocator.
+  Since the mapping is private, writes to the compact never reach the file;
+  but as for any mapping, the file must not be truncated or modified while
+  the compact is alive.
+
+  When the file can't be mapped (it's a pipe or a socket, the RTS uses huge
+  pages, we are on Windows, ...) the blocks are read in the usual way.
+*/
+
+#define COMPACT_FILE_MAGIC   UINT64_C(0x43505448534b4331)  // "CPTHSKC1"
+#define COMPACT_FILE_VERSION 1
+
+typedef struct {
+    StgWord64 magic;        // COMPACT_FILE_MAGIC
+    StgWord32 version;      // COMPACT_FILE_VERSION
+    StgWord32 word_size;    // sizeof(StgWord) in the writer
+    StgWord64 align;        // alignment of the blocks in the file
+    StgWord64 n_blocks;
+    StgWord64 root;         // address of the root in the writer
+    StgWord64 size;         // bytes written, including the header
+} CompactFileHeader;
+
+#if defined(mingw32_HOST_OS)
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
+#if !defined(IOV_MAX)
+#define IOV_MAX 16
+#endif
+
+// Write all of iov to fd. Returns false, with errno set, on error.
+static bool
+writeIOVecs(int fd, struct iovec *iov, int n)
+{
+    while (n > 0) {
+#if defined(mingw32_HOST_OS)
+        ssize_t r = write(fd, iov->iov_base, iov->iov_len);
+#else
+        ssize_t r = writev(fd, iov, n < IOV_MAX ? n : IOV_MAX);
+#endif
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        while (n > 0 && (size_t)r >= iov->iov_len) {
+            r -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+    return true;
+}
+
+// Read exactly len bytes from fd. Returns false, with errno set, on error.
+static bool
+readAll(int fd, void *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t r = read(fd, buf, len);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (r == 0) {
+            errno = EINVAL;     // truncated
+            return false;
+        }
+        buf = (char *)buf + r;
+        len -= r;
+    }
+    return true;
+}
+
+// Advance fd by len bytes, which we don't need.
+static bool
+skipBytes(int fd, size_t len, bool seekable)
+{
+    if (seekable) {
+        return lseek(fd, len, SEEK_CUR) != (off_t)-1;
+    }
+    char buf[512];
+    while (len > 0) {
+        size_t n = len < sizeof(buf) ? len : sizeof(buf);
+        if (!readAll(fd, buf, n)) return false;
+        len -= n;
+    }
+    return true;
+}
+
+int
+compactWriteFd(StgCompactNFDataBlock *first, StgPtr root, int fd)
+{
+    StgWord n_blocks = 0;
+    for (StgCompactNFDataBlock *block = first; block; block = block->next) {
+        n_blocks++;
+    }
+
+    const StgWord align = getPageSize();
+    const StgWord header_size =
+        sizeof(CompactFileHeader) + n_blocks * sizeof(StgWord64);
+
+    // The header and block sizes, then for each block its data and padding.
+    StgWord64 *header_buf =
+        stgCallocBytes(roundUpToAlign(header_size, align), 1, "compactWriteFd");
+    void *padding = stgCallocBytes(align, 1, "compactWriteFd");
+    const int n_iov = 1 + 2 * n_blocks;
+    struct iovec *iov =
+        stgMallocBytes(n_iov * sizeof(struct iovec), "compactWriteFd");
+
+    CompactFileHeader *header = (CompactFileHeader *) header_buf;
+    StgWord64 *sizes = (StgWord64 *) (header + 1);
+    StgWord total = roundUpToAlign(header_size, align);
+    iov[0].iov_base = header_buf;
+    iov[0].iov_len = total;
+
+    int i = 1;
+    StgWord b = 0;
+    for (StgCompactNFDataBlock *block = first; block; block = block->next) {
+        bdescr *bd = Bdescr((P_)block);
+        StgWord size = (W_)bd->free - (W_)bd->start;
+        StgWord padded = roundUpToAlign(size, align);
+        sizes[b++] = size;
+        iov[i].iov_base = block;
+        iov[i].iov_len = size;
+        iov[i+1].iov_base = padding;
+        iov[i+1].iov_len = padded - size;
+        i += 2;
+        total += padded;
+    }
+
+    header->magic = COMPACT_FILE_MAGIC;
+    header->version = COMPACT_FILE_VERSION;
+    header->word_size = sizeof(StgWord);
+    header->align = align;
+    header->n_blocks = n_blocks;
+    header->root = (W_)root;
+    header->size = total;
+
+    bool ok = writeIOVecs(fd, iov, n_iov);
+    int saved_errno = errno;
+
+    stgFree(iov);
+    stgFree(padding);
+    stgFree(header_buf);
+
+    errno = saved_errno;
+    return ok ? 0 : -1;
+}
+
+// Free the blocks of an import that failed half-way.
+static void
+compactFreeImport(StgCompactNFDataBlock **blocks, StgWord n)
+{
+    ACQUIRE_SM_LOCK;
+    for (StgWord i = 0; i < n; i++) {
+        bdescr *bd = Bdescr((P_)blocks[i]);
+        if (i == 0) {
+            dbl_link_remove(bd, &g0->compact_blocks_in_import);
+        }
+        ASSERT(g0->n_compact_blocks_in_import >= bd->blocks);
+        g0->n_compact_blocks_in_import -= bd->blocks;
+        if (bd->flags & BF_COMPACT_FILE) {
+            osUnmapFileFromMemory(bd->start, bd->blocks * BLOCK_SIZE);
+        }
+        freeGroup(bd);
+    }
+    RELEASE_SM_LOCK;
+}
+
+StgCompactNFDataBlock *
+compactReadFd(int fd, StgPtr *root)
+{
+    Capability *cap = rts_unsafeGetMyCapability();
+    StgWord64 *sizes = NULL;
+    StgCompactNFDataBlock **blocks = NULL;
+    StgWord n_allocated = 0;
+
+    // For a regular file we know how much data there is, so a corrupt or
+    // truncated file fails here rather than after allocating its blocks.
+    struct stat st;
+    const off_t start = lseek(fd, 0, SEEK_CUR);
+    const bool regular = start != (off_t)-1 && fstat(fd, &st) == 0
+        && S_ISREG(st.st_mode);
+
+    CompactFileHeader header;
+    if (!readAll(fd, &header, sizeof(header))) {
+        return NULL;
+    }
+    if (header.magic != COMPACT_FILE_MAGIC
+        || header.version != COMPACT_FILE_VERSION
+        || header.word_size != sizeof(StgWord)
+        || header.align == 0 || (header.align & (header.align - 1)) != 0
+        || header.align > header.size
+        || header.n_blocks == 0
+        || header.n_blocks > header.size / sizeof(StgWord64)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (regular && (st.st_size < start
+                    || header.size > (StgWord64)(st.st_size - start))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // Otherwise at least don't try to allocate more than we may.
+    if (RtsFlags.GcFlags.maxHeapSize > 0
+        && header.size / BLOCK_SIZE > RtsFlags.GcFlags.maxHeapSize) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Check the block sizes before we allocate anything.
+    const StgWord header_size =
+        sizeof(CompactFileHeader) + header.n_blocks * sizeof(StgWord64);
+    sizes = stgMallocBytes(header.n_blocks * sizeof(StgWord64), "compactReadFd");
+    if (!readAll(fd, sizes, header.n_blocks * sizeof(StgWord64))) {
+        goto fail;
+    }
+    StgWord64 total = roundUpToAlign(header_size, header.align);
+    if (total > header.size) {
+        errno = EINVAL;
+        goto fail;
+    }
+    for (StgWord i = 0; i < header.n_blocks; i++) {
+        StgWord min_size = sizeof(StgCompactNFDataBlock);
+        if (i == 0) min_size += sizeof(StgCompactNFData);
+        const StgWord64 padded = roundUpToAlign(sizes[i], header.align);
+        // Written so that neither the padding nor the sum can overflow.
+        if (sizes[i] < min_size || padded < sizes[i]
+            || padded > header.size - total) {
+            errno = EINVAL;
+            goto fail;
+        }
+        total += padded;
+    }
+    if (total != header.size) {
+        errno = EINVAL;
+        goto fail;
+    }
+    if (!skipBytes(fd, roundUpToAlign(header_size, header.align) - header_size,
+                   false)) {
+        goto fail;
+    }
+
+    // Can we map the blocks from the file? See Note [Compact region files].
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    const bool seekable = pos != (off_t)-1;
+    const StgWord page_size = getPageSize();
+    const bool mappable = seekable && regular;
+
+    blocks = stgMallocBytes(header.n_blocks * sizeof(StgCompactNFDataBlock *),
+                            "compactReadFd");
+    StgCompactNFDataBlock *previous = NULL;
+    for (StgWord i = 0; i < header.n_blocks; i++) {
+        const StgWord size = sizes[i];
+        const StgWord padded = roundUpToAlign(size, header.align);
+        StgCompactNFDataBlock *block = compactAllocateBlock(cap, size, previous);
+        blocks[n_allocated++] = block;
+        previous = block;
+
+        bdescr *bd = Bdescr((P_)block);
+        const StgWord map_size = roundUpToAlign(size, page_size);
+        if (mappable
+            && pos % page_size == 0
+            && (W_)block % page_size == 0
+            && map_size <= bd->blocks * BLOCK_SIZE
+            && pos + map_size <= (StgWord64)st.st_size
+            && osMapFileOverMemory(block, map_size, fd, pos)) {
+            bd->flags |= BF_COMPACT_FILE;
+            if (!skipBytes(fd, padded, true)) goto fail;
+        } else {
+            if (!readAll(fd, block, size)) goto fail;
+            if (!skipBytes(fd, padded - size, seekable)) goto fail;
+        }
+        pos += padded;
+    }
+
+    StgCompactNFDataBlock *first = blocks[0];
+    stgFree(blocks);
+    stgFree(sizes);
+    *root = (StgPtr)(W_)header.root;
+    return first;
+
+fail:
+    {
+        int saved_errno = errno;
+        if (blocks != NULL) {
+            compactFreeImport(blocks, n_allocated);
+            stgFree(blocks);
+        }
+        stgFree(sizes);
+        errno = saved_errno;
+    }
+    return NULL;
+}
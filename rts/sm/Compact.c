@@ -850,15 +850,24 @@ update_fwd( bdescr *blocks )
     }
 }
 
+// If region_blocks is non-zero then each run of region_blocks blocks is
+// compacted into itself rather than into the start of the generation, see
+// Note [Parallel compaction].
 static void
-update_fwd_compact( bdescr *blocks )
+update_fwd_compact( bdescr *blocks, W_ region_blocks )
 {
     bdescr *bd = blocks;
     bdescr *free_bd = blocks;
     P_ free = free_bd->start;
+    W_ n = 0;
 
     // cycle through all the blocks in the step
-    for (; bd != NULL; bd = bd->link) {
+    for (; bd != NULL; bd = bd->link, n++) {
+        if (region_blocks != 0 && n != 0 && n % region_blocks == 0) {
+            free_bd = bd;
+            free = free_bd->start;
+        }
+
         P_ p = bd->start;
 
         while (p < bd->free ) {
@@ -985,11 +994,274 @@ update_bkwd_compact( generation *gen )
     return free_blocks;
 }
 
+/* ----------------------------------------------------------------------------
+   Note [Parallel compaction]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   With +RTS -qc, and when the GC is parallel, the backward pass of the
+   compacting collector (update_bkwd_compact) is shared between the GC
+   threads, which are otherwise idle at this point (see Note [Parallel tasks
+   after GC] in GC.c).
+
+   The old generation is divided into regions of COMPACT_REGION_BLOCKS blocks,
+   and each region is compacted into its own blocks instead of into the start
+   of the generation. The forward pass stays sequential (threading a field
+   modifies the info pointer of the object it points to, which may be
+   anywhere), but it resets its free pointer at the start of every region so
+   that the destination of an object only depends on the live objects
+   before it in the same region. Regions can then be processed independently,
+   in two phases separated by a barrier:
+
+     1. unthread: every live object is unthreaded, which writes its new
+        address into the fields that point to it. Those fields were threaded
+        after the object was visited by the forward pass, so they may be
+        anywhere in the old generation, but each field is on the chain of
+        exactly one object, so no two threads write the same word. The
+        objects don't move in this phase, so the addresses on the chains stay
+        valid.
+
+     2. move: every live object is slid down to its new address. Objects
+        only move within their region, and always to a lower address.
+
+   The GC threads claim regions one at a time until all are done, and
+   finally the leader links the compacted regions back together and frees
+   the blocks that were emptied. The cost is that up to one partially filled
+   block per region is retained, which is why regions are fairly large.
+   ------------------------------------------------------------------------- */
+
+#define COMPACT_REGION_BLOCKS 64
+
+typedef struct {
+    bdescr *first;      // first block of the region
+    bdescr *end;        // first block of the next region, or NULL
+    bdescr *last;       // after compaction: last block in use
+    bdescr *unused;     // after compaction: blocks emptied, to be freed
+    W_ n_blocks;        // after compaction: number of blocks in use
+} CompactRegion;
+
+typedef struct {
+    CompactRegion *regions;
+    StgWord n_regions;
+    StgWord next_region;
+} ParCompact;
+
+static void
+unthread_region( CompactRegion *r )
+{
+    bdescr *free_bd = r->first;
+    P_ free = free_bd->start;
+
+    for (bdescr *bd = r->first; bd != r->end; bd = bd->link) {
+        P_ p = bd->start;
+
+        while (p < bd->free) {
+
+            while (p < bd->free && !is_marked(p,bd)) {
+                p++;
+            }
+
+            if (p >= bd->free) {
+                break;
+            }
+
+            if (is_marked(p+1,bd)) {
+                free_bd = free_bd->link;
+                free = free_bd->start;
+            }
+
+            StgInfoTable *iptr = get_threaded_info(p);
+            StgWord iptr_tag = get_iptr_tag(iptr);
+            unthread(p, (W_)free, iptr_tag);
+            ASSERT(LOOKS_LIKE_INFO_PTR((W_)((StgClosure *)p)->header.info));
+            W_ size = closure_sizeW((StgClosure *)p);
+
+            free += size;
+            p += size;
+        }
+    }
+}
+
+static void
+move_region( CompactRegion *r )
+{
+    bdescr *free_bd = r->first;
+    P_ free = free_bd->start;
+    W_ free_blocks = 1;
+
+    for (bdescr *bd = r->first; bd != r->end; bd = bd->link) {
+        P_ p = bd->start;
+
+        while (p < bd->free) {
+
+            while (p < bd->free && !is_marked(p,bd)) {
+                p++;
+            }
+
+            if (p >= bd->free) {
+                break;
+            }
+
+            if (is_marked(p+1,bd)) {
+                free_bd->free = free;
+
+                IF_DEBUG(zero_on_gc, {
+                    memset(free_bd->free, 0xaa,
+                           BLOCK_SIZE - ((W_)(free_bd->free - free_bd->start) * sizeof(W_)));
+                });
+
+                free_bd = free_bd->link;
+                free = free_bd->start;
+                free_blocks++;
+            }
+
+            const StgInfoTable *info = get_itbl((StgClosure *)p);
+            W_ size = closure_sizeW_((StgClosure *)p,info);
+
+            if (free != p) {
+                move(free,p,size);
+            }
+
+            // relocate TSOs
+            if (info->type == STACK) {
+                move_STACK((StgStack *)p, (StgStack *)free);
+            }
+
+            free += size;
+            p += size;
+        }
+    }
+
+    free_bd->free = free;
+
+    IF_DEBUG(zero_on_gc, {
+        W_ block_size_bytes = free_bd->blocks * BLOCK_SIZE;
+        W_ block_in_use_bytes = (free_bd->free - free_bd->start) * sizeof(W_);
+        W_ block_free_bytes = block_size_bytes - block_in_use_bytes;
+        memset(free_bd->free, 0xaa, block_free_bytes);
+    });
+
+    // Detach the blocks we no longer need; the leader frees them, since
+    // freeing blocks isn't thread-safe.
+    r->last = free_bd;
+    r->n_blocks = free_blocks;
+    r->unused = NULL;
+    if (free_bd->link != r->end) {
+        bdescr *bd = free_bd->link;
+        r->unused = bd;
+        while (bd->link != r->end) {
+            bd = bd->link;
+        }
+        bd->link = NULL;
+    }
+}
+
+static void
+unthreadRegionsWorker (uint32_t thread_index STG_UNUSED, void *user)
+{
+    ParCompact *pc = user;
+    StgWord i;
+
+    while ((i = atomic_inc(&pc->next_region, 1) - 1) < pc->n_regions) {
+        unthread_region(&pc->regions[i]);
+    }
+}
+
+static void
+moveRegionsWorker (uint32_t thread_index STG_UNUSED, void *user)
+{
+    ParCompact *pc = user;
+    StgWord i;
+
+    while ((i = atomic_inc(&pc->next_region, 1) - 1) < pc->n_regions) {
+        move_region(&pc->regions[i]);
+    }
+}
+
+// Divide the blocks of the generation being compacted into regions of
+// COMPACT_REGION_BLOCKS blocks.
+static void
+init_compact_regions( ParCompact *pc, generation *gen )
+{
+    W_ n = 0;
+    for (bdescr *bd = gen->old_blocks; bd != NULL; bd = bd->link) {
+        n++;
+    }
+
+    pc->n_regions = (n + COMPACT_REGION_BLOCKS - 1) / COMPACT_REGION_BLOCKS;
+    pc->regions = stgMallocBytes(pc->n_regions * sizeof(CompactRegion),
+                                 "init_compact_regions");
+    pc->next_region = 0;
+
+    StgWord i = 0;
+    n = 0;
+    for (bdescr *bd = gen->old_blocks; bd != NULL; bd = bd->link, n++) {
+        if (n % COMPACT_REGION_BLOCKS == 0) {
+            ASSERT(i < pc->n_regions);
+            pc->regions[i].first = bd;
+            if (i > 0) {
+                pc->regions[i-1].end = bd;
+            }
+            i++;
+        }
+    }
+    ASSERT(i == pc->n_regions);
+    pc->regions[i-1].end = NULL;
+}
+
+static W_
+update_bkwd_compact_par( generation *gen, ParCompact *pc )
+{
+    uint32_t n_threads;
+
+    n_threads = runParallelGcTask(unthreadRegionsWorker, pc);
+    pc->next_region = 0;
+    runParallelGcTask(moveRegionsWorker, pc);
+    debugTrace(DEBUG_gc, "update_bkwd: %" FMT_Word " regions on %"
+               FMT_Word32 " threads", pc->n_regions, n_threads);
+
+    // Link the regions back together, dropping any that are now empty
+    // (except the first, the generation always keeps one block).
+    W_ free_blocks = 0;
+    bdescr *last = NULL;
+    for (StgWord i = 0; i < pc->n_regions; i++) {
+        CompactRegion *r = &pc->regions[i];
+        if (r->unused != NULL) {
+            freeChain(r->unused);
+        }
+        if (i > 0 && r->n_blocks == 1 && r->first->free == r->first->start) {
+            r->first->link = NULL;
+            freeChain(r->first);
+            continue;
+        }
+        if (last != NULL) {
+            last->link = r->first;
+        }
+        last = r->last;
+        free_blocks += r->n_blocks;
+    }
+    last->link = NULL;
+    ASSERT(gen->old_blocks == pc->regions[0].first);
+
+    stgFree(pc->regions);
+    pc->regions = NULL;
+    return free_blocks;
+}
+
 void
 compact(StgClosure *static_objects,
         StgWeak **dead_weak_ptr_list,
-        StgTSO **resurrected_threads)
+        StgTSO **resurrected_threads,
+        bool parallel)
 {
+    ParCompact pc = { .regions = NULL, .n_regions = 0, .next_region = 0 };
+
+    // See Note [Parallel compaction]. There's no point splitting up a small
+    // generation.
+    if (parallel && oldest_gen->old_blocks != NULL
+        && oldest_gen->n_old_blocks >= 2 * COMPACT_REGION_BLOCKS) {
+        init_compact_regions(&pc, oldest_gen);
+    }
+
     // 1. thread the roots
     markCapabilities((evac_fn)thread_root, NULL);
 
@@ -1060,14 +1332,17 @@ compact(StgClosure *static_objects,
         update_fwd_cnf(gen->live_compact_objects);
         if (g == RtsFlags.GcFlags.generations-1 && gen->old_blocks != NULL) {
             debugTrace(DEBUG_gc, "update_fwd:  %d (compact)", g);
-            update_fwd_compact(gen->old_blocks);
+            update_fwd_compact(gen->old_blocks,
+                               pc.regions != NULL ? COMPACT_REGION_BLOCKS : 0);
         }
     }
 
     // 3. update backward ptrs
     generation *gen = oldest_gen;
     if (gen->old_blocks != NULL) {
-        W_ blocks = update_bkwd_compact(gen);
+        W_ blocks = pc.regions != NULL
+            ? update_bkwd_compact_par(gen, &pc)
+            : update_bkwd_compact(gen);
         debugTrace(DEBUG_gc,
                    "update_bkwd: %d (compact, old: %d blocks, now %d blocks)",
                    gen->no, gen->n_old_blocks, blocks);
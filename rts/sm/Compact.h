@@ -76,6 +76,7 @@ is_marked(StgPtr p, bdescr *bd)
 
 void compact (StgClosure *static_objects,
               StgWeak **dead_weak_ptr_list,
-              StgTSO **resurrected_threads);
+              StgTSO **resurrected_threads,
+              bool parallel);
 
 #include "EndPrivate.h"
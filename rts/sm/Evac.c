@@ -149,7 +149,7 @@ alloc_for_copy_nonmoving (uint32_t size, uint32_t gen_no)
 
 /* size is in words */
 STATIC_INLINE StgPtr
-alloc_for_copy (uint32_t size, uint32_t gen_no)
+alloc_for_copy (StgClosure *src, uint32_t size, uint32_t gen_no)
 {
     ASSERT(gen_no < RtsFlags.GcFlags.generations);
 
@@ -170,6 +170,15 @@ alloc_for_copy (uint32_t size, uint32_t gen_no)
         }
     }
 
+    // Keep the object on its NUMA node, see Note [NUMA-local evacuation] in
+    // GCUtils.c
+    if (RTS_UNLIKELY(gct->node_todos != NULL)) {
+        uint32_t node = Bdescr((StgPtr)src)->node;
+        if (node != gct->node) {
+            return alloc_todo_on_node(gen_no, node, size);
+        }
+    }
+
     return alloc_in_moving_heap(size, gen_no);
 }
 
@@ -235,7 +244,7 @@ copy_tag(StgClosure **p, const StgInfoTable *info,
     StgPtr to, from;
     uint32_t i;
 
-    to = alloc_for_copy(size,gen_no);
+    to = alloc_for_copy(src,size,gen_no);
 
     from = (StgPtr)src;
     to[0] = (W_)info;
@@ -296,7 +305,7 @@ copy_tag_nolock(StgClosure **p, const StgInfoTable *info,
     StgPtr to, from;
     uint32_t i;
 
-    to = alloc_for_copy(size,gen_no);
+    to = alloc_for_copy(src,size,gen_no);
 
     from = (StgPtr)src;
     to[0] = (W_)info;
@@ -353,7 +362,7 @@ spin:
     info = (W_)src->header.info;
 #endif /* PARALLEL_GC */
 
-    to = alloc_for_copy(size_to_reserve, gen_no);
+    to = alloc_for_copy(src, size_to_reserve, gen_no);
 
     from = (StgPtr)src;
     to[0] = info;
@@ -23,6 +23,7 @@
 #include "Evac.h"
 #include "Scav.h"
 #include "GCUtils.h"
+#include "GCTuning.h"
 #include "MarkStack.h"
 #include "MarkWeak.h"
 #include "Sparks.h"
@@ -152,6 +153,13 @@ static StgInt n_gc_exited = 0;
 static Condition gc_exit_arrived_cv;
 static Condition gc_exit_leave_now_cv;
 
+// See Note [Parallel tasks after GC]
+static gc_par_task gc_exit_task = NULL;
+static void *gc_exit_task_user = NULL;
+static StgWord gc_exit_task_gen = 0;
+static StgInt n_gc_exit_task_done = 0;
+static Condition gc_exit_task_done_cv;
+
 #else // THREADED_RTS
 // Must match the alignment of gen_workspace.
 StgWord8 the_gc_thread[sizeof(gc_thread) + 64 * sizeof(gen_workspace)]
@@ -330,6 +338,10 @@ GarbageCollect (struct GcConfig config,
   // tell the stats department that we've started a GC
   stat_startGC(cap, gct);
 
+  if (gc_tuning) {
+      gcTuningStartGC();
+  }
+
   // Lock the StablePtr table. This prevents FFI calls manipulating
   // the table from occurring during GC.
   stablePtrLock();
@@ -607,7 +619,8 @@ GarbageCollect (struct GcConfig config,
       if (oldest_gen->compact)
           compact(gct->scavenged_static_objects,
                   &dead_weak_ptr_list,
-                  &resurrected_threads);
+                  &resurrected_threads,
+                  is_par_gc() && RtsFlags.ParFlags.parCompact);
       else
           sweep(oldest_gen);
   }
@@ -905,6 +918,11 @@ GarbageCollect (struct GcConfig config,
       nonmovingCollect(&dead_weak_ptr_list, &resurrected_threads, concurrent);
   }
 
+  // Adjust -A and -F to the targets, see Note [Adaptive GC sizing]
+  if (gc_tuning) {
+      gcTuningEndGC(N, copied);
+  }
+
   // Update the max size of older generations after a major GC:
   // We can't resize here in the case of the concurrent collector since we
   // don't yet know how much live data we have. This will be instead done
@@ -1183,8 +1201,11 @@ new_gc_thread (uint32_t n, gc_thread *t)
 #endif
 
     t->thread_index = n;
+    t->node = capNoToNumaNode(n);
     t->free_blocks = NULL;
     t->gc_count = 0;
+    memset(t->numa_copied, 0, sizeof(t->numa_copied));
+    t->numa_remote_steals = 0;
 
     init_gc_thread(t);
 
@@ -1225,6 +1246,14 @@ new_gc_thread (uint32_t n, gc_thread *t)
         ws->n_scavd_blocks = 0;
         ws->n_scavd_words = 0;
     }
+
+    // See Note [NUMA-local evacuation] in GCUtils.c
+    if (n_numa_nodes > 1) {
+        t->node_todos = stgCallocBytes(RtsFlags.GcFlags.generations * n_numa_nodes,
+                                       sizeof(node_todo), "new_gc_thread");
+    } else {
+        t->node_todos = NULL;
+    }
 }
 
 
@@ -1246,6 +1275,7 @@ initGcThreads (uint32_t from USED_IF_THREADS, uint32_t to USED_IF_THREADS)
         initMutex(&gc_exit_mutex);
         initCondition(&gc_exit_arrived_cv);
         initCondition(&gc_exit_leave_now_cv);
+        initCondition(&gc_exit_task_done_cv);
         initMutex(&gc_running_mutex);
         initCondition(&gc_running_cv);
     }
@@ -1279,10 +1309,14 @@ freeGcThreads (void)
             {
                 freeWSDeque(gc_threads[i]->gens[g].todo_q);
             }
+            if (gc_threads[i]->node_todos != NULL) {
+                stgFree(gc_threads[i]->node_todos);
+            }
             stgFreeAligned (gc_threads[i]);
         }
         closeCondition(&gc_running_cv);
         closeMutex(&gc_running_mutex);
+        closeCondition(&gc_exit_task_done_cv);
         closeCondition(&gc_exit_leave_now_cv);
         closeCondition(&gc_exit_arrived_cv);
         closeMutex(&gc_exit_mutex);
@@ -1482,7 +1516,21 @@ gcWorkerThread (Capability *cap)
     SEQ_CST_STORE(&gct->wakeup, GC_THREAD_WAITING_TO_CONTINUE);
     SEQ_CST_ADD(&n_gc_exited, 1);
     signalCondition(&gc_exit_arrived_cv);
+    StgWord task_gen = gc_exit_task_gen;
     while(SEQ_CST_LOAD(&n_gc_exited) != 0) {
+        // The leader may ask us to help with some work before letting us go,
+        // see Note [Parallel tasks after GC]
+        if (gc_exit_task_gen != task_gen) {
+            gc_par_task task = gc_exit_task;
+            void *user = gc_exit_task_user;
+            task_gen = gc_exit_task_gen;
+            RELEASE_LOCK(&gc_exit_mutex);
+            task(gct->thread_index, user);
+            ACQUIRE_LOCK(&gc_exit_mutex);
+            n_gc_exit_task_done++;
+            signalCondition(&gc_exit_task_done_cv);
+            continue;
+        }
         waitCondition(&gc_exit_leave_now_cv, &gc_exit_mutex);
     }
     RELEASE_LOCK(&gc_exit_mutex);
@@ -1617,6 +1665,57 @@ shutdown_gc_threads (uint32_t me USED_IF_THREADS USED_IF_DEBUG,
 #endif // THREADED_RTS
 }
 
+/* Note [Parallel tasks after GC]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+Some work that happens at the end of a GC, while the mutator is still stopped,
+is proportional to the size of the heap and benefits from being done in
+parallel, e.g. the heap census (see ProfHeap.c).  In a parallel GC the other
+GC threads are idle at this point: they are waiting on gc_exit_leave_now_cv in
+gcWorkerThread() for releaseGCThreads().  runParallelGcTask() lets the leader
+borrow them: it publishes a task and bumps gc_exit_task_gen, and each waiting
+worker notices the new generation, runs the task outside gc_exit_mutex and
+reports back via n_gc_exit_task_done.  The workers are still counted in
+n_gc_exited while they do so, and go back to waiting afterwards, so the
+shutdown_gc_threads()/releaseGCThreads() protocol is unaffected.
+
+The task must take care of dividing the work between the threads itself; it
+is told the index of the gc_thread it is running on.  In a sequential GC the
+leader just runs the task on its own.
+*/
+uint32_t
+runParallelGcTask (gc_par_task task, void *user)
+{
+#if defined(THREADED_RTS)
+    if (is_par_gc()) {
+        // shutdown_gc_threads() has already waited for these threads
+        StgInt n_threads = (StgInt)n_gc_threads - 1 - (StgInt)n_gc_idle_threads;
+
+        ACQUIRE_LOCK(&gc_exit_mutex);
+        ASSERT(SEQ_CST_LOAD(&n_gc_exited) == n_threads);
+        gc_exit_task = task;
+        gc_exit_task_user = user;
+        n_gc_exit_task_done = 0;
+        gc_exit_task_gen++;
+        broadcastCondition(&gc_exit_leave_now_cv);
+        RELEASE_LOCK(&gc_exit_mutex);
+
+        task(gct->thread_index, user);
+
+        ACQUIRE_LOCK(&gc_exit_mutex);
+        while (n_gc_exit_task_done != n_threads) {
+            waitCondition(&gc_exit_task_done_cv, &gc_exit_mutex);
+        }
+        gc_exit_task = NULL;
+        gc_exit_task_user = NULL;
+        RELEASE_LOCK(&gc_exit_mutex);
+
+        return n_threads + 1;
+    }
+#endif
+    task(gct->thread_index, user);
+    return 1;
+}
+
 #if defined(THREADED_RTS)
 void
 releaseGCThreads (Capability *cap USED_IF_THREADS, bool idle_cap[])
@@ -1866,6 +1965,8 @@ collect_gct_blocks (void)
             RELEASE_SPIN_LOCK(&ws->gen->sync);
         }
     }
+
+    free_node_todo_blocks();
 }
 
 /* -----------------------------------------------------------------------------
@@ -1939,6 +2040,7 @@ init_gc_thread (gc_thread *t)
     t->any_work = 0;
     t->scav_find_work = 0;
     t->max_n_todo_overflow = 0;
+    // numa_copied and numa_remote_steals are reset by stat_endGC
 }
 
 /* -----------------------------------------------------------------------------
@@ -2131,11 +2233,16 @@ resize_nursery (void)
     }
     else  // Generational collector
     {
+        if (gc_tuning)
+        {
+            // See Note [Adaptive GC sizing] in GCTuning.c
+            resizeNurseries(gcTunedNurseryBlocks());
+        }
         /*
          * If the user has given us a suggested heap size, adjust our
          * allocation area to make best use of the memory available.
          */
-        if (RtsFlags.GcFlags.heapSizeSuggestion)
+        else if (RtsFlags.GcFlags.heapSizeSuggestion)
         {
             long blocks;
             StgWord needed;
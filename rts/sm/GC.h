@@ -88,6 +88,13 @@ void freeGcThreads (void);
 
 void resizeGenerations (void);
 
+// Run a task on all of the GC threads taking part in the current GC,
+// including the caller, and wait for them all to finish. Only valid inside
+// GarbageCollect(), after the GC proper. Returns the number of threads used.
+// See Note [Parallel tasks after GC] in GC.c.
+typedef void (*gc_par_task)(uint32_t thread_index, void *user);
+uint32_t runParallelGcTask (gc_par_task task, void *user);
+
 #if defined(THREADED_RTS)
 void notifyTodoBlock (void);
 void waitForGcThreads (Capability *cap, bool idle_cap[]);
@@ -83,6 +83,15 @@
 // platforms.
 #define GEN_WORKSPACE_ALIGNMENT CACHELINE_SIZE
 
+// Where a GC thread copies objects that live on another NUMA node, see
+// Note [NUMA-local evacuation] in GCUtils.c.
+typedef struct node_todo_ {
+    bdescr *     bd;                // block being filled, or NULL
+    StgPtr       free;              // free ptr for bd
+    StgPtr       lim;               // lim for bd
+    bdescr *     free_blocks;       // free blocks on this node
+} node_todo;
+
 typedef struct ATTRIBUTE_ALIGNED(GEN_WORKSPACE_ALIGNMENT) gen_workspace_ {
     generation * gen;           // the gen for this workspace
     struct gc_thread_ * my_gct; // the gc_thread that contains this workspace
@@ -134,6 +143,11 @@ typedef struct gc_thread_ {
     volatile StgWord wakeup;       // NB not StgWord8; only StgWord is guaranteed atomic
 #endif
     uint32_t thread_index;         // a zero based index identifying the thread
+    uint32_t node;                 // the NUMA node of the thread
+
+    node_todo *node_todos;         // blocks for objects on other NUMA
+                                   // nodes, n_numa_nodes per generation;
+                                   // NULL unless n_numa_nodes > 1
 
     bdescr * free_blocks;          // a buffer of free blocks for this thread
                                    //  during GC without accessing the block
@@ -188,6 +202,8 @@ typedef struct gc_thread_ {
     W_ any_work;
     W_ scav_find_work;
     W_ max_n_todo_overflow;
+    W_ numa_copied[MAX_NUMA_NODES]; // words copied to other NUMA nodes
+    W_ numa_remote_steals;         // todo blocks stolen from other nodes
 
     Time gc_start_cpu;             // thread CPU time
     Time gc_end_cpu;               // thread CPU time
@@ -0,0 +1,249 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * Adaptive sizing of the allocation area and the old generations
+ *
+ * ---------------------------------------------------------------------------*/
+
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "GetTime.h"
+#include "RtsFlags.h"
+#include "Trace.h"
+#include "GCTuning.h"
+
+/* Note [Adaptive GC sizing]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~
+   Normally the size of the allocation area is fixed by -A (or derived from
+   -H), and the old generations are collected when they have grown by the
+   factor given by -F. Good values depend on the program and on the machine,
+   so services end up with hand-tuned flags for every deployment. With
+
+       --gc-pause-target=<secs>    the longest minor GC pause we would like
+       --gc-cpu-target=<fraction>  the share of CPU time we would like to
+                                   spend in the GC
+
+   the RTS instead adjusts the size of the allocation area after every minor
+   GC, and -F after every major GC, from what it has measured. -A and -F
+   give the initial values, and -A is also the smallest allocation area that
+   the CPU target on its own shrinks to. This needs at least two generations.
+
+   The model is deliberately simple:
+
+    - A minor GC costs roughly a fixed time per word copied, and the words
+      copied are the nursery size times the survival rate. We keep moving
+      averages of both (copy_ns_per_word, survival), so the largest nursery
+      which meets the pause target is
+
+          pause_target / copy_ns_per_word / survival
+
+      A larger nursery usually has a lower survival rate, so this is on the
+      safe side; it is corrected as the measurements come in.
+
+    - The GC work of a minor GC doesn't depend much on the size of the
+      nursery, whereas the mutator time between two GCs grows with it. If
+      minor GCs take a fraction f of the CPU time and the budget is b, then
+      scaling the nursery by (f/(1-f)) / (b/(1-b)) brings f to b.
+
+    - Likewise, the cost of a major GC is set by the live data, and a larger
+      -F makes major GCs less frequent. After a major GC we compare the CPU
+      time it took with the CPU time since the previous one, and grow -F if
+      that is over budget or shrink it (to save memory) if it is well under.
+
+   The CPU budget is shared between minor and major GCs: each gets whatever
+   the other one doesn't use, but at least half of --gc-cpu-target. When both
+   targets are given and disagree, the pause target wins since a larger
+   nursery would make every minor GC longer. The pause of a major GC is set by
+   the amount of live data and is not something sizing can change.
+
+   The nursery never changes by more than a factor of two per GC, and stays
+   between GC_TUNING_MIN_NURSERY and GC_TUNING_MAX_NURSERY blocks per
+   capability (and within a quarter of -M, if given). Times are process CPU
+   and elapsed times, taken at the start of GarbageCollect and just before
+   the generations are resized.
+*/
+
+// Bounds on the allocation area per capability, in blocks.
+#define GC_TUNING_MIN_NURSERY ((256 * 1024) / BLOCK_SIZE)
+#define GC_TUNING_MAX_NURSERY ((StgWord)(512 * 1024 * 1024) / BLOCK_SIZE)
+
+// Bounds on -F.
+#define GC_TUNING_MIN_FACTOR 1.5
+#define GC_TUNING_MAX_FACTOR 8.0
+
+// Weight of the newest sample in the moving averages.
+#define GC_TUNING_WEIGHT 0.3
+
+bool gc_tuning = false;
+
+// Size of the allocation area per capability, in blocks.
+static W_ nursery_blocks;
+
+static double copy_ns_per_word;
+static double survival;
+static double minor_cpu_fraction;
+static double major_cpu_fraction;
+
+static Time gc_start_cpu;
+static Time gc_start_elapsed;
+static Time last_gc_end_cpu;
+static Time last_major_end_cpu;
+
+static double
+moving_average (double avg, double sample)
+{
+    if (avg == 0) {
+        return sample;
+    }
+    return avg + GC_TUNING_WEIGHT * (sample - avg);
+}
+
+void
+initGCTuning (void)
+{
+    gc_tuning = RtsFlags.GcFlags.generations > 1 &&
+        (RtsFlags.GcFlags.gcPauseTarget > 0 ||
+         RtsFlags.GcFlags.gcCpuTarget > 0);
+    if (!gc_tuning) {
+        return;
+    }
+
+    nursery_blocks = stg_max(RtsFlags.GcFlags.minAllocAreaSize,
+                             (W_)GC_TUNING_MIN_NURSERY);
+    copy_ns_per_word = 0;
+    survival = 0;
+    minor_cpu_fraction = 0;
+    major_cpu_fraction = 0;
+    last_gc_end_cpu = getProcessCPUTime();
+    last_major_end_cpu = last_gc_end_cpu;
+}
+
+void
+gcTuningStartGC (void)
+{
+    gc_start_cpu = getProcessCPUTime();
+    gc_start_elapsed = getProcessElapsedTime();
+}
+
+// The CPU budget of minor GCs, or of major GCs if other_fraction is the one
+// of minor GCs.
+static double
+cpu_budget (double other_fraction)
+{
+    const double target = RtsFlags.GcFlags.gcCpuTarget;
+    return stg_max(target - other_fraction, target / 2);
+}
+
+static void
+tune_nursery (W_ copied, Time pause, double cpu_fraction)
+{
+    const W_ n_caps = getNumCapabilities();
+    const W_ nursery_words = nursery_blocks * n_caps * BLOCK_SIZE_W;
+    double want = nursery_blocks;
+
+    survival = moving_average(survival, (double)copied / nursery_words);
+    // With very few words copied the pause is all fixed costs and tells us
+    // nothing about the cost per word.
+    if (copied >= BLOCK_SIZE_W) {
+        copy_ns_per_word = moving_average(copy_ns_per_word,
+                                          (double)TimeToNS(pause) / copied);
+    }
+    minor_cpu_fraction = moving_average(minor_cpu_fraction, cpu_fraction);
+
+    if (RtsFlags.GcFlags.gcCpuTarget > 0 && minor_cpu_fraction > 0) {
+        const double f = stg_min(minor_cpu_fraction, 0.99);
+        const double b = cpu_budget(major_cpu_fraction);
+        want = nursery_blocks * (f / (1 - f)) / (b / (1 - b));
+        // Don't give back memory the user asked for just because we are
+        // under budget.
+        want = stg_max(want, (double)RtsFlags.GcFlags.minAllocAreaSize);
+    }
+
+    if (RtsFlags.GcFlags.gcPauseTarget > 0 &&
+        copy_ns_per_word > 0 && survival > 0) {
+        const double max_words =
+            TimeToNS(RtsFlags.GcFlags.gcPauseTarget) / copy_ns_per_word
+            / survival;
+        const double pause_want = max_words / n_caps / BLOCK_SIZE_W;
+        if (RtsFlags.GcFlags.gcCpuTarget > 0) {
+            want = stg_min(want, pause_want);
+        } else {
+            want = pause_want;
+        }
+    }
+
+    // Damp the changes, and keep within bounds.
+    want = stg_min(want, 2.0 * nursery_blocks);
+    want = stg_max(want, 0.5 * nursery_blocks);
+    W_ blocks = (W_)want;
+    blocks = stg_min(blocks, (W_)GC_TUNING_MAX_NURSERY);
+    if (RtsFlags.GcFlags.maxHeapSize > 0) {
+        blocks = stg_min(blocks, RtsFlags.GcFlags.maxHeapSize / 4 / n_caps);
+    }
+    blocks = stg_max(blocks, (W_)GC_TUNING_MIN_NURSERY);
+
+    debugTrace(DEBUG_gc,
+               "gc tuning: pause %" FMT_Word64 "ns, survival %.3f, "
+               "%.2fns/word, cpu %.3f: nursery %" FMT_Word " -> %" FMT_Word
+               " blocks",
+               (StgWord64)TimeToNS(pause), survival, copy_ns_per_word,
+               minor_cpu_fraction, nursery_blocks, blocks);
+    nursery_blocks = blocks;
+}
+
+static void
+tune_old_gen_factor (Time gc_cpu, Time now_cpu)
+{
+    const Time window = now_cpu - last_major_end_cpu;
+    last_major_end_cpu = now_cpu;
+    if (window <= 0 || RtsFlags.GcFlags.gcCpuTarget <= 0) {
+        return;
+    }
+
+    major_cpu_fraction = moving_average(major_cpu_fraction,
+                                        (double)gc_cpu / window);
+    const double b = cpu_budget(minor_cpu_fraction);
+    double factor = RtsFlags.GcFlags.oldGenFactor;
+    if (major_cpu_fraction > b) {
+        factor = stg_min(factor * 1.25, GC_TUNING_MAX_FACTOR);
+    } else if (major_cpu_fraction < b / 2) {
+        factor = stg_max(factor / 1.25, GC_TUNING_MIN_FACTOR);
+    }
+
+    debugTrace(DEBUG_gc, "gc tuning: major cpu %.3f: -F%.2f -> -F%.2f",
+               major_cpu_fraction, RtsFlags.GcFlags.oldGenFactor, factor);
+    RtsFlags.GcFlags.oldGenFactor = factor;
+}
+
+// Called at the end of a GC of generation gen, which copied the given number
+// of words, before the generations and the nursery are resized.
+void
+gcTuningEndGC (uint32_t gen, W_ copied)
+{
+    const Time now_cpu = getProcessCPUTime();
+    const Time pause = getProcessElapsedTime() - gc_start_elapsed;
+    const Time gc_cpu = now_cpu - gc_start_cpu;
+    const Time mut_cpu = gc_start_cpu - last_gc_end_cpu;
+    last_gc_end_cpu = now_cpu;
+
+    if (gen == 0) {
+        double cpu_fraction = 0;
+        if (gc_cpu + mut_cpu > 0) {
+            cpu_fraction = (double)gc_cpu / (gc_cpu + mut_cpu);
+        }
+        tune_nursery(copied, pause, cpu_fraction);
+    } else if (gen == RtsFlags.GcFlags.generations - 1) {
+        tune_old_gen_factor(gc_cpu, now_cpu);
+    }
+    // With -G3 or more, collections of the generations in between tell us
+    // nothing about either -A or -F, so we leave both alone.
+}
+
+// The total size of the allocation area, in blocks.
+W_
+gcTunedNurseryBlocks (void)
+{
+    return nursery_blocks * getNumCapabilities();
+}
@@ -0,0 +1,22 @@
+/* -----------------------------------------------------------------------------
+ *
+ * (c) The GHC Team 2026
+ *
+ * Adaptive sizing of the allocation area and the old generations
+ *
+ * ---------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "BeginPrivate.h"
+
+// True if --gc-pause-target or --gc-cpu-target is in effect, see
+// Note [Adaptive GC sizing].
+extern bool gc_tuning;
+
+void initGCTuning     ( void );
+void gcTuningStartGC  ( void );
+void gcTuningEndGC    ( uint32_t gen, W_ copied );
+W_   gcTunedNurseryBlocks ( void );
+
+#include "EndPrivate.h"
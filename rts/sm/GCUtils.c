@@ -52,11 +52,10 @@ bdescr* allocGroupOnNode_sync(uint32_t node, uint32_t n)
 }
 
 static uint32_t
-allocBlocks_sync(uint32_t n, bdescr **hd)
+allocBlocks_sync(uint32_t node, uint32_t n, bdescr **hd)
 {
     bdescr *bd;
     uint32_t i;
-    uint32_t node = capNoToNumaNode(gct->thread_index);
     ACQUIRE_ALLOC_BLOCK_SPIN_LOCK();
     bd = allocLargeChunkOnNode(node,1,n);
     // NB. allocLargeChunk, rather than allocGroup(n), to allocate in a
@@ -126,14 +125,25 @@ steal_todo_block (uint32_t g)
     uint32_t n;
     bdescr *bd;
 
-    // look for work to steal
+    // look for work to steal, from the threads on our own NUMA node first
+    // (see Note [NUMA-local evacuation])
     for (n = 0; n < n_gc_threads; n++) {
-        if (n == gct->thread_index) continue;
+        if (n == gct->thread_index || gc_threads[n]->node != gct->node) continue;
         bd = stealWSDeque(gc_threads[n]->gens[g].todo_q);
         if (bd) {
             return bd;
         }
     }
+    if (n_numa_nodes > 1) {
+        for (n = 0; n < n_gc_threads; n++) {
+            if (gc_threads[n]->node == gct->node) continue;
+            bd = stealWSDeque(gc_threads[n]->gens[g].todo_q);
+            if (bd) {
+                gct->numa_remote_steals++;
+                return bd;
+            }
+        }
+    }
     return NULL;
 }
 #endif
@@ -147,10 +157,12 @@ push_scanned_block (bdescr *bd, gen_workspace *ws)
     ASSERT(bd->u.scan == bd->free);
 
     if (bd->blocks == 1 &&
-        bd->start + BLOCK_SIZE_W - bd->free > WORK_UNIT_WORDS)
+        bd->start + BLOCK_SIZE_W - bd->free > WORK_UNIT_WORDS &&
+        bd->node == gct->node)
     {
         // A partially full block: put it on the part_list list.
         // Only for single objects - see Note [big objects]
+        // Only for blocks on our node - see Note [NUMA-local evacuation]
         bd->link = ws->part_list;
         ws->part_list = bd;
         ws->n_part_blocks += bd->blocks;
@@ -355,7 +367,7 @@ alloc_todo_block (gen_workspace *ws, uint32_t size)
                 // the rest on `gct->free_blocks` for future use.
                 StgWord chunk_size = 16;
                 StgWord n_blocks = stg_min(chunk_size, 1 << (MBLOCK_SHIFT - BLOCK_SHIFT - 1));
-                allocBlocks_sync(n_blocks, &bd);
+                allocBlocks_sync(gct->node, n_blocks, &bd);
                 gct->free_blocks = bd->link;
             }
         }
@@ -379,3 +391,150 @@ alloc_todo_block (gen_workspace *ws, uint32_t size)
 
     return ws->todo_free;
 }
+
+/* Note [NUMA-local evacuation]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   With +RTS --numa every capability, and hence every GC thread, belongs to a
+   NUMA node, and the blocks a GC thread allocates come from its own node (see
+   allocGroup_sync). If nothing else were done, an object would be copied to
+   the node of whichever GC thread happens to reach it first, which is often
+   not the node of the capability that allocated it and is going to use it
+   again. After a few GCs, every capability's data would be spread evenly over
+   all the nodes.
+
+   So when there is more than one node, a GC thread copies an object into a
+   block on the node the object is already on, given by the node field of its
+   block descriptor. Objects on the thread's own node go into the todo block
+   of the workspace as usual (Evac.c:alloc_for_copy). For each generation
+   and each of the other nodes the gc_thread has a node_todo, a block on that
+   node which is filled by alloc_todo_on_node but not scanned there. (They
+   are kept out of gen_workspace, which must stay small.) When it is full, or
+   when the thread runs out of other work (push_node_todo_blocks, called from
+   scavenge_find_work), the block is pushed on the thread's todo_q like any
+   other todo block, and scavenged by whichever thread takes it. These blocks
+   are not put on the part_list after they have been scanned, because a
+   thread's part_list is reused for objects on its own node.
+
+   To make it more likely that a block is scanned by a thread close to it,
+   steal_todo_block tries the GC threads on its own node before the others.
+   This is only a preference: a thread's todo_q also holds the blocks it
+   filled for other nodes, and a thread that would otherwise be idle still
+   takes work from any node.
+
+   The +RTS -s summary reports the words copied into each node by GC threads
+   on other nodes, and the number of blocks stolen across nodes (see
+   Stats.c).
+*/
+
+static void
+alloc_node_todo_block (gen_workspace *ws, node_todo *t, uint32_t node,
+                       uint32_t size)
+{
+    bdescr *bd;
+
+    if (size > BLOCK_SIZE_W) {
+        bd = allocGroupOnNode_sync(node, (W_)BLOCK_ROUND_UP(size*sizeof(W_))
+                                         / BLOCK_SIZE);
+    } else {
+        if (t->free_blocks == NULL) {
+            StgWord chunk_size = 16;
+            StgWord n_blocks = stg_min(chunk_size, 1 << (MBLOCK_SHIFT - BLOCK_SHIFT - 1));
+            allocBlocks_sync(node, n_blocks, &t->free_blocks);
+        }
+        bd = t->free_blocks;
+        t->free_blocks = bd->link;
+    }
+    initBdescr(bd, ws->gen, ws->gen->to);
+    RELAXED_STORE(&bd->u.scan, RELAXED_LOAD(&bd->start));
+    // RELEASE here to ensure that bd->gen is visible to other cores.
+    RELEASE_STORE(&bd->flags, BF_EVACUATED);
+    bd->link = NULL;
+
+    t->bd = bd;
+    t->free = bd->free;
+    // See Note [big objects]
+    t->lim = bd->free + stg_max(BLOCK_SIZE_W, size);
+}
+
+// Hand the block for node over to the scavenger.
+static void
+push_node_todo_block (gen_workspace *ws, node_todo *t, uint32_t node)
+{
+    bdescr *bd = t->bd;
+    W_ words = t->free - bd->start;
+
+    gct->copied += words;
+    gct->numa_copied[node] += words;
+    RELAXED_STORE(&bd->free, t->free);
+
+    if (words == 0) {
+        if (bd->blocks == 1) {
+            bd->link = t->free_blocks;
+            t->free_blocks = bd;
+        } else {
+            freeGroup_sync(bd);
+        }
+    } else {
+        push_todo_block(bd, ws);
+    }
+
+    t->bd = NULL;
+    t->free = NULL;
+    t->lim = NULL;
+}
+
+StgPtr
+node_todo_block_full (uint32_t gen_no, uint32_t node, uint32_t size)
+{
+    gen_workspace *ws = &gct->gens[gen_no];
+    node_todo *t = &gct->node_todos[gen_no * n_numa_nodes + node];
+    StgPtr p;
+
+    if (t->bd != NULL) {
+        push_node_todo_block(ws, t, node);
+    }
+    alloc_node_todo_block(ws, t, node, size);
+
+    p = t->free;
+    t->free += size;
+    return p;
+}
+
+bool
+push_node_todo_blocks (void)
+{
+    bool pushed = false;
+
+    if (gct->node_todos == NULL) {
+        return false;
+    }
+    for (uint32_t g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        gen_workspace *ws = &gct->gens[g];
+        for (uint32_t node = 0; node < n_numa_nodes; node++) {
+            node_todo *t = &gct->node_todos[g * n_numa_nodes + node];
+            if (t->bd != NULL) {
+                pushed |= t->free != t->bd->start;
+                push_node_todo_block(ws, t, node);
+            }
+        }
+    }
+    return pushed;
+}
+
+void
+free_node_todo_blocks (void)
+{
+    if (gct->node_todos == NULL) {
+        return;
+    }
+    for (uint32_t g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        for (uint32_t node = 0; node < n_numa_nodes; node++) {
+            node_todo *t = &gct->node_todos[g * n_numa_nodes + node];
+            ASSERT(t->bd == NULL);
+            if (t->free_blocks != NULL) {
+                freeChain_sync(t->free_blocks);
+                t->free_blocks = NULL;
+            }
+        }
+    }
+}
@@ -14,6 +14,7 @@
 #pragma once
 
 #include "GCTDecl.h"
+#include "Capability.h"
 
 #include "BeginPrivate.h"
 
@@ -40,11 +41,29 @@ void    push_scanned_block   (bdescr *bd, gen_workspace *ws);
 StgPtr  todo_block_full      (uint32_t size, gen_workspace *ws);
 StgPtr  alloc_todo_block     (gen_workspace *ws, uint32_t size);
 
+StgPtr  node_todo_block_full (uint32_t gen_no, uint32_t node, uint32_t size);
+bool    push_node_todo_blocks (void);
+void    free_node_todo_blocks (void);
+
 bdescr *grab_local_todo_block  (gen_workspace *ws);
 #if defined(THREADED_RTS)
 bdescr *steal_todo_block       (uint32_t s);
 #endif
 
+// Allocate size words on the given (other) NUMA node, see
+// Note [NUMA-local evacuation] in GCUtils.c.
+INLINE_HEADER StgPtr
+alloc_todo_on_node (uint32_t gen_no, uint32_t node, uint32_t size)
+{
+    node_todo *t = &gct->node_todos[gen_no * n_numa_nodes + node];
+    StgPtr p = t->free;
+    if (t->bd == NULL || p + size > t->lim) {
+        return node_todo_block_full(gen_no, node, size);
+    }
+    t->free = p + size;
+    return p;
+}
+
 // Returns true if a block is partially full.  This predicate is used to try
 // to re-use partial blocks wherever possible, and to reduce wastage.
 // We might need to tweak the actual value.
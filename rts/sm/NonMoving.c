@@ -751,6 +751,7 @@ void nonmovingInit(void)
     if (! RtsFlags.GcFlags.useNonmoving) return;
     nonmovingInitAllocators();
     nonmovingInitConcurrentWorker();
+    nonmovingInitSweepHelpers();
     nonmovingMarkInit();
 }
 
@@ -758,6 +759,8 @@ void nonmovingExit(void)
 {
     if (! RtsFlags.GcFlags.useNonmoving) return;
     nonmovingExitConcurrentWorker();
+    nonmovingExitSweepHelpers();
+    nonmovingMarkExit();
 }
 
 /* Prepare the heap bitmaps and snapshot metadata for a mark */
@@ -27,6 +27,9 @@
 #include "sm/Storage.h"
 #include "CNF.h"
 
+#include <string.h>
+#include <errno.h>
+
 #if defined(THREADED_RTS)
 static void nonmovingResetUpdRemSetQueue (MarkQueue *rset);
 static void nonmovingResetUpdRemSet (UpdRemSet *rset);
@@ -102,9 +105,9 @@ memcount n_nonmoving_marked_compact_blocks = 0;
  * move the same large object to nonmoving_marked_large_objects more than once.
  */
 static Mutex nonmoving_large_objects_mutex;
-// Note that we don't need a similar lock for compact objects because we never
-// mark a compact object eagerly in a write barrier; all compact objects are
-// marked by the mark thread, so there can't be any races here.
+// We never mark a compact object eagerly in a write barrier but we may have
+// several mark threads (see Note [Parallel nonmoving mark]), so this lock is
+// also taken when marking compact objects.
 #endif
 
 /*
@@ -247,6 +250,97 @@ static volatile StgWord upd_rem_set_flush_count = 0;
 
 /* Signaled by each capability when it has flushed its update remembered set */
 static Condition upd_rem_set_flushed_cond;
+
+/* Note [Parallel nonmoving mark]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * By default the concurrent mark is performed by a single thread draining a
+ * single MarkQueue. On machines with many cores this may not keep up with the
+ * mutators, in which case the heap grows until the next collection is forced
+ * and the sync phase has to do a lot of marking. With +RTS
+ * --nonmoving-mark-threads=<n> the marker is assisted by n-1 helper threads
+ * during every unlimited-budget mark pass (nonmovingMark with
+ * UNLIMITED_MARK_BUDGET). Budgeted passes, i.e. those in the sync phase (see
+ * Note [Sync phase marking budget] in NonMoving.c), remain serial since they
+ * must be able to stop after a given amount of work.
+ *
+ * Work is shared in units of whole MarkQueueBlocks:
+ *
+ *  - Each marker has a private MarkQueue, so pushing and popping remain
+ *    unsynchronised as before.
+ *
+ *  - When other markers are waiting for work (mark_pool_waiting > 0), a
+ *    marker donates the block below the top of its queue to the global
+ *    mark_pool. Blocks below the top are not popped from until the top one
+ *    is drained, but that doesn't make them full: a block taken by
+ *    getMarkWork is linked on top of the marker's own, usually empty, bottom
+ *    block, and blocks of update remembered sets may be partly filled. So a
+ *    marker only donates the block below the top if it has some entries and
+ *    isn't the bottom block of its queue, which it keeps (and which
+ *    markQueuePop_ never frees).
+ *
+ *  - A marker whose queue runs dry takes a block from mark_pool, refilling
+ *    the pool from upd_rem_set_block_list if necessary (this replaces the
+ *    NULL_ENTRY handling of the serial loop). If there is nothing to take it
+ *    waits on mark_pool_cond. The pass is over when all n_markers markers are
+ *    waiting, at which point there can be no work left anywhere except in
+ *    update remembered sets which have yet to be flushed, exactly as in the
+ *    serial loop.
+ *
+ * The update remembered set flush protocol is unaffected: capabilities still
+ * add their blocks to upd_rem_set_block_list under upd_rem_set_lock, and the
+ * sync phase which makes sure that all of them are marked before sweeping
+ * happens after the parallel pass has finished.
+ *
+ * mark_closure was written with a concurrently running mutator in mind and
+ * so already tolerates most of the races introduced by a second marker: two
+ * markers may both trace an object before either sets its mark bit, which
+ * duplicates the tracing work; stacks are claimed with a CAS on
+ * stack->marking; static objects are flagged under the SM lock; selector
+ * thunks are locked before being evaluated. What does need care is state
+ * which was previously only touched by the mark thread, and which both of
+ * those markers would otherwise update:
+ *
+ *  - the mark bit of a small object is set with a CAS while
+ *    parallel_marking is set, and only the marker whose CAS succeeds adds
+ *    the object to nonmoving_segment_live_words (atomically). Otherwise the
+ *    object would be counted twice, inflating the live estimate which sizes
+ *    the next collection;
+ *
+ *  - large objects and compact regions are moved to the marked lists under
+ *    nonmoving_large_objects_mutex, and their BF_MARKED flag is re-read
+ *    after taking the lock, since the flags read before it may be stale.
+ *
+ * The helpers are started by nonmovingMarkInit and sleep on
+ * mark_helpers_start_cond between passes.
+ */
+
+// Protects everything below.
+static Mutex mark_pool_lock;
+// Signalled when blocks are added to mark_pool or the current pass finishes.
+static Condition mark_pool_cond;
+// Stealable MarkQueueBlocks. See Note [Parallel nonmoving mark].
+static bdescr *mark_pool = NULL;
+// Number of markers waiting for work; read without the lock by donors.
+static volatile StgWord mark_pool_waiting = 0;
+// Number of markers taking part in the current pass.
+static uint32_t n_markers = 0;
+static bool mark_pass_done = false;
+// Set while a parallel pass is running.
+static bool parallel_marking = false;
+
+static Condition mark_helpers_start_cond;
+static Condition mark_helpers_done_cond;
+static uint32_t n_mark_helpers = 0;
+static uint32_t n_mark_helpers_running = 0;
+static bool stop_mark_helpers = false;
+// Bumped to start a pass.
+static StgWord mark_generation = 0;
+// Number of helpers which have finished the current pass, and the number of
+// entries they marked (for the eventlog).
+static uint32_t mark_helpers_done = 0;
+static uint64_t mark_helpers_count = 0;
+
+static void nonmovingInitMarkHelpers(void);
 #endif
 
 /* Indicates to mutators that the write barrier must be respected. Set while
@@ -265,6 +359,7 @@ void nonmovingMarkInit(void) {
     initMutex(&upd_rem_set_lock);
     initCondition(&upd_rem_set_flushed_cond);
     initMutex(&nonmoving_large_objects_mutex);
+    nonmovingInitMarkHelpers();
 #endif
 }
 
@@ -1385,12 +1480,17 @@ mark_closure (MarkQueue *queue, const StgClosure *p0, StgClosure **origin)
             }
 
             if (! (flags & BF_MARKED)) {
-                dbl_link_remove(bd, &nonmoving_compact_objects);
-                dbl_link_onto(bd, &nonmoving_marked_compact_objects);
-                StgWord blocks = str->totalW / BLOCK_SIZE_W;
-                n_nonmoving_compact_blocks -= blocks;
-                n_nonmoving_marked_compact_blocks += blocks;
-                block_set_flag(bd, BF_MARKED);
+                // See Note [Parallel nonmoving mark].
+                ACQUIRE_LOCK(&nonmoving_large_objects_mutex);
+                if (! (block_get_flags(bd) & BF_MARKED)) {
+                    dbl_link_remove(bd, &nonmoving_compact_objects);
+                    dbl_link_onto(bd, &nonmoving_marked_compact_objects);
+                    StgWord blocks = str->totalW / BLOCK_SIZE_W;
+                    n_nonmoving_compact_blocks -= blocks;
+                    n_nonmoving_marked_compact_blocks += blocks;
+                    block_set_flag(bd, BF_MARKED);
+                }
+                RELEASE_LOCK(&nonmoving_large_objects_mutex);
             }
 
             // N.B. the object being marked is in a compact region so by
@@ -1774,7 +1874,9 @@ mark_closure (MarkQueue *queue, const StgClosure *p0, StgClosure **origin)
          * nonmoving heap while holding nonmoving_large_objects_mutex
          */
         ACQUIRE_LOCK(&nonmoving_large_objects_mutex);
-        if (! (bd_flags & BF_MARKED)) {
+        // Re-read the flags: another marker may have marked the object since
+        // we read them above. See Note [Parallel nonmoving mark].
+        if (! (block_get_flags(bd) & BF_MARKED)) {
             // Remove the object from nonmoving_large_objects and link it to
             // nonmoving_marked_large_objects
             dbl_link_remove(bd, &nonmoving_large_objects);
@@ -1788,8 +1890,22 @@ mark_closure (MarkQueue *queue, const StgClosure *p0, StgClosure **origin)
         // TODO: Kill repetition
         struct NonmovingSegment *seg = nonmovingGetSegment((StgPtr) p);
         nonmoving_block_idx block_idx = nonmovingGetBlockIdx((StgPtr) p);
-        nonmovingSetMark(seg, block_idx);
-        nonmoving_segment_live_words += nonmovingSegmentBlockSize(seg) / sizeof(W_);
+        const memcount words = nonmovingSegmentBlockSize(seg) / sizeof(W_);
+#if defined(THREADED_RTS)
+        // Only the marker which sets the mark counts the block's words.
+        // See Note [Parallel nonmoving mark].
+        if (RELAXED_LOAD(&parallel_marking)) {
+            const uint8_t mark = nonmovingGetMark(seg, block_idx);
+            if (mark != nonmovingMarkEpoch
+                && cas_word8(&seg->bitmap[block_idx], mark, nonmovingMarkEpoch) == mark) {
+                atomic_inc((StgVolatilePtr) &nonmoving_segment_live_words, words);
+            }
+        } else
+#endif
+        {
+            nonmovingSetMark(seg, block_idx);
+            nonmoving_segment_live_words += words;
+        }
     }
 
     // If we found a indirection to shortcut keep going.
@@ -1808,6 +1924,262 @@ done:
     }
 }
 
+// Mark a single (non-NULL) entry popped from the mark queue.
+STATIC_INLINE void
+nonmovingMarkEntry (MarkQueue *queue, MarkQueueEnt *ent)
+{
+    switch (nonmovingMarkQueueEntryType(ent)) {
+    case MARK_CLOSURE:
+        mark_closure(queue, ent->mark_closure.p, ent->mark_closure.origin);
+        break;
+    case MARK_ARRAY: {
+        const StgMutArrPtrs *arr = (const StgMutArrPtrs *)
+            UNTAG_CLOSURE((StgClosure *) ent->mark_array.array);
+        StgWord start = ent->mark_array.start_index;
+        StgWord end = start + MARK_ARRAY_CHUNK_LENGTH;
+        if (end < arr->ptrs) {
+            // There is more to be marked after this chunk.
+            markQueuePushArray(queue, arr, end);
+        } else {
+            end = arr->ptrs;
+        }
+        for (StgWord i = start; i < end; i++) {
+            StgClosure *c = ACQUIRE_LOAD(&arr->payload[i]);
+            markQueuePushClosure_(queue, c);
+        }
+        break;
+    }
+    case NULL_ENTRY:
+        barf("nonmovingMarkEntry: NULL_ENTRY");
+    }
+}
+
+#if defined(THREADED_RTS)
+
+/* Is there a block in queue which we could give to a waiting marker? See
+ * Note [Parallel nonmoving mark].
+ */
+STATIC_INLINE bool
+canDonateMarkWork (MarkQueue *queue)
+{
+    const bdescr *bd = queue->blocks->link;
+    return bd != NULL
+        && bd->link != NULL
+        && ((MarkQueueBlock *) bd->start)->head != 0;
+}
+
+/* Give the block below the top of queue to mark_pool.
+ * See Note [Parallel nonmoving mark].
+ */
+static void
+donateMarkWork (MarkQueue *queue)
+{
+    ASSERT(canDonateMarkWork(queue));
+    ACQUIRE_LOCK(&mark_pool_lock);
+    bdescr *bd = queue->blocks->link;
+    queue->blocks->link = bd->link;
+    bd->link = mark_pool;
+    mark_pool = bd;
+    signalCondition(&mark_pool_cond);
+    RELEASE_LOCK(&mark_pool_lock);
+}
+
+/* Refill an empty queue from mark_pool or the update remembered set, waiting
+ * for other markers to donate work if necessary. Returns false when the
+ * current pass is over.
+ */
+static bool
+getMarkWork (MarkQueue *queue)
+{
+    ACQUIRE_LOCK(&mark_pool_lock);
+    while (true) {
+        // N.B. This must be atomic since we have not yet taken
+        // upd_rem_set_lock.
+        if (mark_pool == NULL && RELAXED_LOAD(&upd_rem_set_block_list) != NULL) {
+            ACQUIRE_LOCK(&upd_rem_set_lock);
+            mark_pool = upd_rem_set_block_list;
+            upd_rem_set_block_list = NULL;
+            RELEASE_LOCK(&upd_rem_set_lock);
+        }
+
+        if (mark_pool != NULL) {
+            bdescr *bd = mark_pool;
+            mark_pool = bd->link;
+            // The queue's own (empty) block stays at the bottom; the stolen
+            // block is freed by markQueuePop_ once it has been drained.
+            bd->link = queue->blocks;
+            queue->blocks = bd;
+            queue->top = (MarkQueueBlock *) bd->start;
+            if (mark_pool != NULL && mark_pool_waiting > 0) {
+                signalCondition(&mark_pool_cond);
+            }
+            RELEASE_LOCK(&mark_pool_lock);
+            return true;
+        }
+
+        if (mark_pass_done) {
+            RELEASE_LOCK(&mark_pool_lock);
+            return false;
+        }
+
+        RELAXED_STORE(&mark_pool_waiting, mark_pool_waiting + 1);
+        if (mark_pool_waiting == n_markers) {
+            // Everyone is out of work: the pass is finished.
+            mark_pass_done = true;
+            broadcastCondition(&mark_pool_cond);
+            RELEASE_LOCK(&mark_pool_lock);
+            return false;
+        }
+        waitCondition(&mark_pool_cond, &mark_pool_lock);
+        RELAXED_STORE(&mark_pool_waiting, mark_pool_waiting - 1);
+    }
+}
+
+// The mark loop run by each of the markers of a parallel pass. Returns the
+// number of entries marked.
+static uint64_t
+nonmovingMarkParallelLoop (MarkQueue *queue)
+{
+    uint64_t count = 0;
+    while (true) {
+        MarkQueueEnt ent = markQueuePop(queue);
+        if (nonmovingMarkQueueEntryType(&ent) == NULL_ENTRY) {
+            if (!getMarkWork(queue)) {
+                return count;
+            }
+            continue;
+        }
+
+        count++;
+        nonmovingMarkEntry(queue, &ent);
+
+        if (RELAXED_LOAD(&mark_pool_waiting) > 0 && canDonateMarkWork(queue)) {
+            donateMarkWork(queue);
+        }
+    }
+}
+
+static void *
+nonmovingMarkHelper (void *data STG_UNUSED)
+{
+    StgWord seen_generation = 0;
+    MarkQueue queue;
+
+    ACQUIRE_LOCK(&mark_pool_lock);
+    while (true) {
+        while (mark_generation == seen_generation && !stop_mark_helpers) {
+            waitCondition(&mark_helpers_start_cond, &mark_pool_lock);
+        }
+        if (stop_mark_helpers) {
+            n_mark_helpers_running--;
+            broadcastCondition(&mark_helpers_done_cond);
+            RELEASE_LOCK(&mark_pool_lock);
+            return NULL;
+        }
+        seen_generation = mark_generation;
+        RELEASE_LOCK(&mark_pool_lock);
+
+        memset(&queue, 0, sizeof(queue));
+        ACQUIRE_SM_LOCK;
+        initMarkQueue(&queue);
+        RELEASE_SM_LOCK;
+
+        uint64_t count = nonmovingMarkParallelLoop(&queue);
+
+        ASSERT(markQueueIsEmpty(&queue));
+        freeMarkQueue(&queue);
+
+        ACQUIRE_LOCK(&mark_pool_lock);
+        mark_helpers_count += count;
+        mark_helpers_done++;
+        signalCondition(&mark_helpers_done_cond);
+    }
+}
+
+static void
+nonmovingInitMarkHelpers (void)
+{
+    const uint32_t n = RtsFlags.GcFlags.nonmovingMarkThreads;
+    initMutex(&mark_pool_lock);
+    initCondition(&mark_pool_cond);
+    initCondition(&mark_helpers_start_cond);
+    initCondition(&mark_helpers_done_cond);
+    stop_mark_helpers = false;
+    mark_generation = 0;
+    n_mark_helpers = 0;
+    n_mark_helpers_running = 0;
+    if (n <= 1) {
+        return;
+    }
+
+    debugTrace(DEBUG_nonmoving_gc, "Starting %" FMT_Word32 " mark helpers", n - 1);
+    ACQUIRE_LOCK(&mark_pool_lock);
+    for (uint32_t i = 0; i < n - 1; i++) {
+        OSThreadId tid;
+        if (createOSThread(&tid, "nonmoving-mark-helper",
+                           nonmovingMarkHelper, NULL) != 0) {
+            barf("nonmovingInitMarkHelpers: failed to spawn mark thread: %s",
+                 strerror(errno));
+        }
+        n_mark_helpers++;
+        n_mark_helpers_running++;
+    }
+    RELEASE_LOCK(&mark_pool_lock);
+}
+
+void
+nonmovingMarkExit (void)
+{
+    ACQUIRE_LOCK(&mark_pool_lock);
+    stop_mark_helpers = true;
+    broadcastCondition(&mark_helpers_start_cond);
+    while (n_mark_helpers_running > 0) {
+        waitCondition(&mark_helpers_done_cond, &mark_pool_lock);
+    }
+    n_mark_helpers = 0;
+    RELEASE_LOCK(&mark_pool_lock);
+
+    closeMutex(&mark_pool_lock);
+    closeCondition(&mark_pool_cond);
+    closeCondition(&mark_helpers_start_cond);
+    closeCondition(&mark_helpers_done_cond);
+}
+
+// An unlimited-budget mark pass shared with the helper threads.
+// See Note [Parallel nonmoving mark].
+static uint64_t
+nonmovingMarkParallel (MarkQueue *queue)
+{
+    ACQUIRE_LOCK(&mark_pool_lock);
+    ASSERT(mark_pool == NULL);
+    mark_pool_waiting = 0;
+    mark_pass_done = false;
+    n_markers = n_mark_helpers + 1;
+    mark_helpers_done = 0;
+    mark_helpers_count = 0;
+    RELAXED_STORE(&parallel_marking, true);
+    mark_generation++;
+    broadcastCondition(&mark_helpers_start_cond);
+    RELEASE_LOCK(&mark_pool_lock);
+
+    uint64_t count = nonmovingMarkParallelLoop(queue);
+
+    ACQUIRE_LOCK(&mark_pool_lock);
+    while (mark_helpers_done < n_mark_helpers) {
+        waitCondition(&mark_helpers_done_cond, &mark_pool_lock);
+    }
+    RELAXED_STORE(&parallel_marking, false);
+    count += mark_helpers_count;
+    RELEASE_LOCK(&mark_pool_lock);
+    return count;
+}
+
+#else
+
+void nonmovingMarkExit (void) {}
+
+#endif /* THREADED_RTS */
+
 /* This is the main mark loop.
  * Invariants:
  *
@@ -1823,6 +2195,16 @@ nonmovingMark (MarkBudget* budget, MarkQueue *queue)
 {
     traceConcMarkBegin();
     debugTrace(DEBUG_nonmoving_gc, "Starting mark pass");
+
+#if defined(THREADED_RTS)
+    if (*budget == UNLIMITED_MARK_BUDGET && n_mark_helpers > 0) {
+        uint64_t count = nonmovingMarkParallel(queue);
+        debugTrace(DEBUG_nonmoving_gc, "Finished parallel mark pass: %" FMT_Word64, count);
+        traceConcMarkEnd(count);
+        return;
+    }
+#endif
+
     uint64_t count = 0;
     while (true) {
         count++;
@@ -1834,28 +2216,9 @@ nonmovingMark (MarkBudget* budget, MarkQueue *queue)
 
         MarkQueueEnt ent = markQueuePop(queue);
 
-        switch (nonmovingMarkQueueEntryType(&ent)) {
-        case MARK_CLOSURE:
-            mark_closure(queue, ent.mark_closure.p, ent.mark_closure.origin);
-            break;
-        case MARK_ARRAY: {
-            const StgMutArrPtrs *arr = (const StgMutArrPtrs *)
-                UNTAG_CLOSURE((StgClosure *) ent.mark_array.array);
-            StgWord start = ent.mark_array.start_index;
-            StgWord end = start + MARK_ARRAY_CHUNK_LENGTH;
-            if (end < arr->ptrs) {
-                // There is more to be marked after this chunk.
-                markQueuePushArray(queue, arr, end);
-            } else {
-                end = arr->ptrs;
-            }
-            for (StgWord i = start; i < end; i++) {
-                StgClosure *c = ACQUIRE_LOAD(&arr->payload[i]);
-                markQueuePushClosure_(queue, c);
-            }
-            break;
-        }
-        case NULL_ENTRY:
+        if (nonmovingMarkQueueEntryType(&ent) != NULL_ENTRY) {
+            nonmovingMarkEntry(queue, &ent);
+        } else {
             // Perhaps the update remembered set has more to mark...
             // N.B. This must be atomic since we have not yet taken
             // upd_rem_set_lock.
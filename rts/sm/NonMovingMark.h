@@ -146,6 +146,7 @@ extern bdescr *upd_rem_set_block_list;
 
 
 void nonmovingMarkInit(void);
+void nonmovingMarkExit(void);
 
 void nonmovingInitUpdRemSet(UpdRemSet *rset);
 void updateRemembSetPushClosure(Capability *cap, StgClosure *p);
@@ -7,6 +7,7 @@
  * ---------------------------------------------------------------------------*/
 
 #include "Rts.h"
+#include "RtsUtils.h"
 #include "NonMovingSweep.h"
 #include "NonMoving.h"
 #include "NonMovingMark.h" // for nonmovingIsAlive
@@ -18,6 +19,9 @@
 #include "StableName.h"
 #include "CNF.h" // compactFree
 
+#include <string.h>
+#include <errno.h>
+
 // On which list should a particular segment be placed?
 enum SweepResult {
     SEGMENT_FREE,     // segment is empty: place on free list
@@ -129,8 +133,250 @@ nonmovingClearSegmentFreeBlocks(struct NonmovingSegment* seg)
     }
 }
 
+// Place a swept segment on the list determined by nonmovingSweepSegment. The
+// pushes are lock-free so this may be called by several sweepers at once.
+static void
+nonmovingSweepOneSegment(struct NonmovingSegment *seg)
+{
+    enum SweepResult ret = nonmovingSweepSegment(seg);
+
+    switch (ret) {
+    case SEGMENT_FREE:
+        IF_DEBUG(sanity, nonmovingClearSegment(seg));
+        nonmovingPushFreeSegment(seg);
+        break;
+    case SEGMENT_PARTIAL:
+        IF_DEBUG(sanity, nonmovingClearSegmentFreeBlocks(seg));
+        nonmovingPushActiveSegment(seg);
+        break;
+    case SEGMENT_FILLED:
+        nonmovingPushFilledSegment(seg);
+        break;
+    default:
+        barf("nonmovingSweep: weird sweep return: %d\n", ret);
+    }
+}
+
+/* Note [Parallel nonmoving sweep]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Sweeping a segment only touches the segment itself (its bitmap, next_free
+ * and snapshot pointer) and then pushes it onto one of the free, active or
+ * filled lists, all of which are lock-free stacks. Segments can therefore be
+ * swept independently and, on heaps with many segments, sweeping can take a
+ * significant part of a nonmoving collection cycle, which is why we allow it
+ * to be spread over several threads with +RTS --nonmoving-sweep-threads=<n>.
+ *
+ * The sweeper (the concurrent mark thread, or the GC leader if marking
+ * synchronously) unlinks the sweep list into an array, sweep_segs, and then
+ * it and n-1 helper threads claim chunks of SWEEP_CHUNK_SIZE consecutive
+ * entries by atomically bumping sweep_next until the array is exhausted.
+ * Chunks keep the cost of the atomic increment negligible while still
+ * balancing the load, as segments differ quite a bit in their sweep cost.
+ *
+ * The helpers are started by nonmovingInit and park on sweep_start_cond
+ * between sweeps; each sweep bumps sweep_generation to wake them and the
+ * sweeper waits on sweep_done_cond until all of them have run out of work.
+ * Small sweep lists are swept by the sweeper alone since waking the helpers
+ * would cost more than it saves.
+ *
+ * Since the order in which segments are pushed back is no longer
+ * deterministic, the order of the allocators' active and filled lists may
+ * differ from run to run. Nothing relies on this order.
+ */
+
+#if defined(THREADED_RTS)
+
+#define SWEEP_CHUNK_SIZE 256
+
+static Mutex sweep_mutex;
+static Condition sweep_start_cond;
+static Condition sweep_done_cond;
+
+// The helper threads; there are RtsFlags.GcFlags.nonmovingSweepThreads - 1 of
+// them.
+static uint32_t n_sweep_helpers = 0;
+static uint32_t n_sweep_helpers_running = 0;
+static bool stop_sweep_helpers = false;
+
+// Bumped by the sweeper to start a parallel sweep; protected by sweep_mutex.
+static StgWord sweep_generation = 0;
+// Number of helpers that have finished the current sweep.
+static uint32_t sweep_helpers_done = 0;
+
+// The segments of the current sweep, see Note [Parallel nonmoving sweep].
+static struct NonmovingSegment **sweep_segs = NULL;
+static StgWord sweep_segs_size = 0;
+static StgWord n_sweep_segs = 0;
+static volatile StgWord sweep_next = 0;
+
+static void
+nonmovingSweepChunks(void)
+{
+    while (true) {
+        const StgWord start =
+            atomic_inc(&sweep_next, SWEEP_CHUNK_SIZE) - SWEEP_CHUNK_SIZE;
+        if (start >= n_sweep_segs) {
+            break;
+        }
+        const StgWord end = stg_min(start + SWEEP_CHUNK_SIZE, n_sweep_segs);
+        for (StgWord i = start; i < end; i++) {
+            nonmovingSweepOneSegment(sweep_segs[i]);
+        }
+    }
+}
+
+static void *
+nonmovingSweepHelper(void *data STG_UNUSED)
+{
+    StgWord seen_generation = 0;
+
+    ACQUIRE_LOCK(&sweep_mutex);
+    while (true) {
+        while (sweep_generation == seen_generation && !stop_sweep_helpers) {
+            waitCondition(&sweep_start_cond, &sweep_mutex);
+        }
+        if (stop_sweep_helpers) {
+            n_sweep_helpers_running--;
+            broadcastCondition(&sweep_done_cond);
+            RELEASE_LOCK(&sweep_mutex);
+            return NULL;
+        }
+        seen_generation = sweep_generation;
+        RELEASE_LOCK(&sweep_mutex);
+
+        nonmovingSweepChunks();
+
+        ACQUIRE_LOCK(&sweep_mutex);
+        sweep_helpers_done++;
+        signalCondition(&sweep_done_cond);
+    }
+}
+
+void
+nonmovingInitSweepHelpers(void)
+{
+    const uint32_t n = RtsFlags.GcFlags.nonmovingSweepThreads;
+    if (n <= 1) {
+        return;
+    }
+
+    initMutex(&sweep_mutex);
+    initCondition(&sweep_start_cond);
+    initCondition(&sweep_done_cond);
+    stop_sweep_helpers = false;
+    sweep_generation = 0;
+    n_sweep_helpers = 0;
+    n_sweep_helpers_running = 0;
+
+    debugTrace(DEBUG_nonmoving_gc, "Starting %" FMT_Word32 " sweep helpers", n - 1);
+    ACQUIRE_LOCK(&sweep_mutex);
+    for (uint32_t i = 0; i < n - 1; i++) {
+        OSThreadId tid;
+        if (createOSThread(&tid, "nonmoving-sweep",
+                           nonmovingSweepHelper, NULL) != 0) {
+            barf("nonmovingInitSweepHelpers: failed to spawn sweep thread: %s",
+                 strerror(errno));
+        }
+        n_sweep_helpers++;
+        n_sweep_helpers_running++;
+    }
+    RELEASE_LOCK(&sweep_mutex);
+}
+
+void
+nonmovingExitSweepHelpers(void)
+{
+    if (n_sweep_helpers == 0) {
+        return;
+    }
+
+    ACQUIRE_LOCK(&sweep_mutex);
+    stop_sweep_helpers = true;
+    broadcastCondition(&sweep_start_cond);
+    while (n_sweep_helpers_running > 0) {
+        waitCondition(&sweep_done_cond, &sweep_mutex);
+    }
+    n_sweep_helpers = 0;
+    RELEASE_LOCK(&sweep_mutex);
+
+    closeMutex(&sweep_mutex);
+    closeCondition(&sweep_start_cond);
+    closeCondition(&sweep_done_cond);
+    if (sweep_segs != NULL) {
+        stgFree(sweep_segs);
+        sweep_segs = NULL;
+        sweep_segs_size = 0;
+    }
+}
+
+// Returns false if the sweep list is too short to be worth sweeping in
+// parallel, in which case the caller sweeps it alone.
+static bool
+nonmovingSweepParallel(void)
+{
+    StgWord n = 0;
+    for (struct NonmovingSegment *seg = nonmovingHeap.sweep_list;
+         seg != NULL; seg = seg->link) {
+        n++;
+    }
+    if (n < 2 * SWEEP_CHUNK_SIZE) {
+        return false;
+    }
+
+    if (n > sweep_segs_size) {
+        if (sweep_segs != NULL) {
+            stgFree(sweep_segs);
+        }
+        sweep_segs_size = n + n / 2;
+        sweep_segs = stgMallocBytes(sweep_segs_size * sizeof(struct NonmovingSegment *),
+                                    "nonmovingSweepParallel");
+    }
+
+    // Pushing a segment to one of the free/active/filled lists updates its
+    // link field, so unlink the whole sweep list before anyone starts.
+    StgWord i = 0;
+    for (struct NonmovingSegment *seg = nonmovingHeap.sweep_list;
+         seg != NULL; seg = seg->link) {
+        sweep_segs[i++] = seg;
+    }
+    nonmovingHeap.sweep_list = NULL;
+    n_sweep_segs = n;
+    sweep_next = 0;
+
+    ACQUIRE_LOCK(&sweep_mutex);
+    sweep_helpers_done = 0;
+    sweep_generation++;
+    broadcastCondition(&sweep_start_cond);
+    RELEASE_LOCK(&sweep_mutex);
+
+    nonmovingSweepChunks();
+
+    ACQUIRE_LOCK(&sweep_mutex);
+    while (sweep_helpers_done < n_sweep_helpers) {
+        waitCondition(&sweep_done_cond, &sweep_mutex);
+    }
+    RELEASE_LOCK(&sweep_mutex);
+
+    n_sweep_segs = 0;
+    return true;
+}
+
+#else
+
+void nonmovingInitSweepHelpers(void) {}
+void nonmovingExitSweepHelpers(void) {}
+
+#endif /* THREADED_RTS */
+
 GNUC_ATTR_HOT void nonmovingSweep(void)
 {
+#if defined(THREADED_RTS)
+    // See Note [Parallel nonmoving sweep].
+    if (n_sweep_helpers > 0 && nonmovingSweepParallel()) {
+        return;
+    }
+#endif
+
     while (nonmovingHeap.sweep_list) {
         struct NonmovingSegment *seg = nonmovingHeap.sweep_list;
 
@@ -138,23 +384,7 @@ GNUC_ATTR_HOT void nonmovingSweep(void)
         // updates the link field, so update sweep_list here
         nonmovingHeap.sweep_list = seg->link;
 
-        enum SweepResult ret = nonmovingSweepSegment(seg);
-
-        switch (ret) {
-        case SEGMENT_FREE:
-            IF_DEBUG(sanity, nonmovingClearSegment(seg));
-            nonmovingPushFreeSegment(seg);
-            break;
-        case SEGMENT_PARTIAL:
-            IF_DEBUG(sanity, nonmovingClearSegmentFreeBlocks(seg));
-            nonmovingPushActiveSegment(seg);
-            break;
-        case SEGMENT_FILLED:
-            nonmovingPushFilledSegment(seg);
-            break;
-        default:
-            barf("nonmovingSweep: weird sweep return: %d\n", ret);
-        }
+        nonmovingSweepOneSegment(seg);
     }
 }
 
@@ -12,6 +12,11 @@
 
 GNUC_ATTR_HOT void nonmovingSweep(void);
 
+// Start and stop the threads helping nonmovingSweep.
+// See Note [Parallel nonmoving sweep].
+void nonmovingInitSweepHelpers(void);
+void nonmovingExitSweepHelpers(void);
+
 // Remove unmarked entries in oldest generation mut_lists
 void nonmovingSweepMutLists(void);
 
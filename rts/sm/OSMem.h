@@ -23,6 +23,15 @@ uint32_t osNumaNodes(void);
 uint64_t osNumaMask(void);
 void osBindMBlocksToNode(void *addr, StgWord size, uint32_t node);
 
+// Replace the memory at @at (up to @size bytes, page aligned), which must be
+// heap memory from osGetMBlocks or osCommitMemory, by a private copy-on-write
+// mapping of @fd at @offset. Returns false, leaving the memory untouched, if
+// that isn't possible. See Note [Compact region files] in sm/CNF.c.
+bool osMapFileOverMemory(void *at, W_ size, int fd, StgWord64 offset);
+
+// Undo osMapFileOverMemory: @at is backed by ordinary memory again.
+void osUnmapFileFromMemory(void *at, W_ size);
+
 INLINE_HEADER size_t
 roundDownToPage (size_t x)
 {
@@ -90,6 +99,18 @@ void osDecommitMemory(void *p, W_ len);
 // This function is called once, when the block allocator is deinitialized
 // before the program terminates.
 void osReleaseHeapMemory(void);
+
+#if !defined(mingw32_HOST_OS)
+// Huge page usage of the heap, see +RTS --huge-pages.
+typedef struct {
+    uint32_t mode;          // HUGE_PAGES_*
+    W_ huge_page_size;      // 0 if the heap isn't using huge pages
+    W_ hugetlb_pages;       // huge pages mapped from the hugetlbfs pool
+    W_ fallback_pages;      // huge pages mapped with ordinary pages instead
+} HugePageStats;
+
+void osGetHugePageStats(HugePageStats *stats);
+#endif
 #endif
 
 #include "EndPrivate.h"
@@ -2164,6 +2164,13 @@ loop:
         goto loop;
     }
 
+    // Push out the blocks we have been filling for other NUMA nodes, see
+    // Note [NUMA-local evacuation] in GCUtils.c
+    if (push_node_todo_blocks()) {
+        did_anything = true;
+        goto loop;
+    }
+
 #if defined(THREADED_RTS)
     if (work_stealing) {
         // look for work to steal
@@ -42,6 +42,7 @@
 #include "Trace.h"
 #include "GC.h"
 #include "Evac.h"
+#include "GCTuning.h"
 #include "NonMovingAllocate.h"
 #include "NonMovingMark.h"
 #if defined(ios_HOST_OS) || defined(darwin_HOST_OS)
@@ -257,6 +258,8 @@ initStorage (void)
   }
   storageAddCapabilities(0, getNumCapabilities());
 
+  initGCTuning();
+
   IF_DEBUG(gc, statDescribeGens());
 
   RELEASE_SM_LOCK;
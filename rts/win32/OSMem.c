@@ -42,6 +42,11 @@ osMemInit(void)
 {
     allocs = NULL;
     free_blocks = NULL;
+    if (RtsFlags.GcFlags.hugePages != HUGE_PAGES_NONE) {
+        errorBelch("warning: --huge-pages is not supported on Windows; "
+                   "ignoring");
+        RtsFlags.GcFlags.hugePages = HUGE_PAGES_NONE;
+    }
 }
 
 static
@@ -481,6 +486,19 @@ void osReleaseHeapMemory (void)
 
 #endif
 
+bool osMapFileOverMemory(void *at STG_UNUSED, W_ size STG_UNUSED,
+                         int fd STG_UNUSED, StgWord64 offset STG_UNUSED)
+{
+    // Windows can't replace part of an existing allocation by a view of a
+    // file, so we always read the file instead.
+    return false;
+}
+
+void osUnmapFileFromMemory(void *at STG_UNUSED, W_ size STG_UNUSED)
+{
+    barf("osUnmapFileFromMemory: not supported");
+}
+
 bool osBuiltWithNumaSupport(void)
 {
     return true;
@@ -197,6 +197,9 @@ class TestConfig:
         # Are we running with UndefinedBehaviorSanitizer enabled?
         self.have_ubsan = False
 
+        # Was the RTS built with the linear hash table (rts/HashLinear.c)?
+        self.rts_linear_hash = False
+
         # Do symbols use leading underscores?
         self.leading_underscore = False
 
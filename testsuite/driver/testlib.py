@@ -1120,6 +1120,9 @@ def have_thread_sanitizer( ) -> bool:
 def have_ubsan( ) -> bool:
     return config.have_ubsan
 
+def rts_linear_hash( ) -> bool:
+    return config.rts_linear_hash
+
 def gcc_as_cmmp() -> bool:
     return config.cmm_cpp_is_gcc
 
@@ -0,0 +1,19 @@
+-- Overflow the buffers of +RTS --eventlog-async-buffers with a slow eventlog
+-- writer: some buffers must be dropped, which is reported on stderr, but the
+-- events which are written must stay in order.
+-- See Note [Eventlog flusher thread] in EventLog.c.
+
+import Control.Monad
+import Debug.Trace
+
+foreign import ccall safe "start_slow_eventlog"
+  start_slow_eventlog :: IO ()
+foreign import ccall safe "stop_slow_eventlog"
+  stop_slow_eventlog :: IO ()
+
+main :: IO ()
+main = do
+  start_slow_eventlog
+  -- About 20 buffers' worth of events
+  forM_ [0 .. 2000000 :: Int] $ \i -> traceEventIO ("seq " ++ show i)
+  stop_slow_eventlog
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <Rts.h>
+
+/* A deliberately slow eventlog writer, to make --eventlog-async-buffers drop
+ * buffers. It checks that the sequence numbers of the "seq <n>" user events
+ * it receives only ever go up: buffers may be dropped, but never reordered. */
+
+static bool header_seen = false;
+static long last_seq = -1;
+static long n_seqs = 0;
+static bool out_of_order = false;
+
+static void test_init(void) {
+}
+
+static bool test_write(void *eventlog, size_t eventlog_size) {
+  const char *p = eventlog;
+  const char *end = p + eventlog_size;
+  if (!header_seen) {
+    // the first write is the header
+    header_seen = true;
+    return true;
+  }
+  for (; p + 4 < end; p++) {
+    if (memcmp(p, "seq ", 4) == 0) {
+      long n = 0;
+      const char *q = p + 4;
+      while (q < end && *q >= '0' && *q <= '9') {
+        n = n * 10 + (*q - '0');
+        q++;
+      }
+      if (n <= last_seq) {
+        out_of_order = true;
+      }
+      last_seq = n;
+      n_seqs++;
+      p = q - 1;
+    }
+  }
+  usleep(500000);
+  return true;
+}
+
+static void test_flush(void) {
+}
+
+static void test_stop(void) {
+}
+
+static const EventLogWriter writer = {
+  .initEventLogWriter = test_init,
+  .writeEventLog = test_write,
+  .flushEventLog = test_flush,
+  .stopEventLogWriter = test_stop
+};
+
+void start_slow_eventlog(void) {
+  // Stop the eventlog started by -l first.
+  endEventLogging();
+  if (!startEventLogging(&writer)) {
+    printf("failed to start eventlog\n");
+  }
+}
+
+void stop_slow_eventlog(void) {
+  endEventLogging();
+  printf("events received: %s\n", n_seqs > 0 ? "yes" : "no");
+  printf("events in order: %s\n", out_of_order ? "no" : "yes");
+  fflush(stdout);
+}
@@ -0,0 +1,25 @@
+-- With +RTS --eventlog-flush-interval the timer worker writes the eventlog out
+-- periodically, even with -V0 where there are no ticks.
+-- See Note [Timer worker] in Timer.c.
+
+import Control.Concurrent
+import Control.Monad
+import Debug.Trace
+
+foreign import ccall safe "start_recording_eventlog"
+  start_recording_eventlog :: IO ()
+foreign import ccall safe "stop_recording_eventlog"
+  stop_recording_eventlog :: IO ()
+foreign import ccall unsafe "tick_written"
+  tick_written :: Int -> IO Bool
+
+main :: IO ()
+main = do
+  start_recording_eventlog
+  forM_ [1 .. 3] $ \i -> do
+    traceEventIO ("tick " ++ show i)
+    -- a few flush intervals
+    threadDelay 500000
+    written <- tick_written i
+    putStrLn ("tick " ++ show i ++ " written: " ++ show written)
+  stop_recording_eventlog
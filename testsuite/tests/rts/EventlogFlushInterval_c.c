@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <string.h>
+#include <Rts.h>
+
+/* An eventlog writer which records which of the "tick <n>" user events it has
+ * been given, so that the program can check that they are written out by the
+ * periodic flush rather than when eventlogging stops. */
+
+static unsigned int ticks_seen = 0;
+
+static void test_init(void) {
+}
+
+static bool test_write(void *eventlog, size_t eventlog_size) {
+  const char *p = eventlog;
+  const char *end = p + eventlog_size;
+  for (; p + 6 <= end; p++) {
+    if (memcmp(p, "tick ", 5) == 0 && p[5] >= '0' && p[5] <= '9') {
+      __atomic_fetch_or(&ticks_seen, 1u << (p[5] - '0'), __ATOMIC_SEQ_CST);
+    }
+  }
+  return true;
+}
+
+static void test_flush(void) {
+}
+
+static void test_stop(void) {
+}
+
+static const EventLogWriter writer = {
+  .initEventLogWriter = test_init,
+  .writeEventLog = test_write,
+  .flushEventLog = test_flush,
+  .stopEventLogWriter = test_stop
+};
+
+void start_recording_eventlog(void) {
+  // Stop the eventlog started by -l first.
+  endEventLogging();
+  if (!startEventLogging(&writer)) {
+    printf("failed to start eventlog\n");
+  }
+}
+
+HsBool tick_written(HsInt n) {
+  return (__atomic_load_n(&ticks_seen, __ATOMIC_SEQ_CST) & (1u << n)) != 0;
+}
+
+void stop_recording_eventlog(void) {
+  endEventLogging();
+}
@@ -0,0 +1,47 @@
+-- Stream the eventlog to a Unix domain socket (-olunix:<path>), and check
+-- that every new connection receives the eventlog header and the init events
+-- (see Note [Eventlog socket writer] in EventLogSocketWriter.c).
+
+import Control.Concurrent
+import Control.Monad
+import Debug.Trace
+import Foreign.C.String
+import Foreign.C.Types
+
+foreign import ccall unsafe "collector_listen"
+  collector_listen :: CString -> IO CInt
+foreign import ccall unsafe "collector_poll"
+  collector_poll :: IO CInt
+foreign import ccall unsafe "collector_got_header"
+  collector_got_header :: IO CInt
+foreign import ccall unsafe "collector_got_init_events"
+  collector_got_init_events :: IO CInt
+foreign import ccall unsafe "collector_hang_up"
+  collector_hang_up :: IO ()
+
+-- Keep writing events until the n'th connection has received the header and
+-- the init events. The RTS reconnects at most once a second.
+waitForConnection :: CInt -> IO ()
+waitForConnection n = go (100 :: Int)
+  where
+    go 0 = putStrLn ("connection " ++ show n ++ ": timed out")
+    go k = do
+      traceEventIO "ping"
+      flushEventLog
+      threadDelay 100000
+      conns <- collector_poll
+      header <- collector_got_header
+      init_events <- collector_got_init_events
+      if conns == n && header /= 0 && init_events /= 0
+        then putStrLn ("connection " ++ show n ++ ": header and init events")
+        else go (k - 1)
+
+main :: IO ()
+main = do
+  r <- withCString "EventlogSocket.sock" collector_listen
+  when (r /= 0) $ error "collector_listen failed"
+  waitForConnection 1
+  -- The RTS notices that the collector has gone when it next writes, and
+  -- then connects again.
+  collector_hang_up
+  waitForConnection 2
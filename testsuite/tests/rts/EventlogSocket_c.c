@@ -0,0 +1,103 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* A minimal eventlog collector for the EventlogSocket test: it listens on a
+ * Unix domain socket and looks at what each connection receives. */
+
+static int listener = -1;
+static int conn = -1;
+static int n_conns = 0;
+
+static char *data = NULL;
+static size_t data_size = 0;
+
+int collector_listen(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1
+        || bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0
+        || listen(listener, 1) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Accept a connection if there is one waiting, and read whatever has
+ * arrived, without blocking. Returns the number of connections so far. */
+int collector_poll(void)
+{
+    struct pollfd pfd;
+    if (conn == -1) {
+        pfd.fd = listener;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) <= 0) {
+            return n_conns;
+        }
+        conn = accept(listener, NULL, NULL);
+        if (conn == -1) {
+            return n_conns;
+        }
+        n_conns++;
+        free(data);
+        data = NULL;
+        data_size = 0;
+    }
+    while (1) {
+        pfd.fd = conn;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) <= 0) {
+            break;
+        }
+        char buf[65536];
+        ssize_t r = read(conn, buf, sizeof(buf));
+        if (r <= 0) {
+            break;
+        }
+        data = realloc(data, data_size + r);
+        memcpy(data + data_size, buf, r);
+        data_size += r;
+    }
+    return n_conns;
+}
+
+static const char *find(const char *from, const char *s)
+{
+    const size_t n = strlen(s);
+    const char *end = data + data_size;
+    for (const char *p = from; p + n <= end; p++) {
+        if (memcmp(p, s, n) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* Did the current connection start with the eventlog header? */
+int collector_got_header(void)
+{
+    return data_size >= 4 && memcmp(data, "hdrb", 4) == 0;
+}
+
+/* Has the current connection received the RTS_IDENTIFIER event, which is
+ * posted at startup with postInitEvent? Its name starts with "GHC-". */
+int collector_got_init_events(void)
+{
+    const char *events = data == NULL ? NULL : find(data, "datb");
+    return events != NULL && find(events, "GHC-") != NULL;
+}
+
+void collector_hang_up(void)
+{
+    close(conn);
+    conn = -1;
+}
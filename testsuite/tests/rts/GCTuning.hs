@@ -0,0 +1,30 @@
+-- Run with --gc-pause-target and --gc-cpu-target (see Note [Adaptive GC
+-- sizing] in GCTuning.c): the allocation area and -F change as the program
+-- runs, which must not change its result.
+--
+-- The CPU target is so low that the GC is always over budget, so the
+-- allocation area (reported by +RTS -s) and -F must both have grown.
+
+import Control.Monad
+import Data.IORef
+import qualified Data.Map.Strict as M
+import GHC.RTS.Flags
+import GHC.Stats
+import System.Mem
+
+main :: IO ()
+main = do
+  f0 <- oldGenFactor . gcFlags <$> getRTSFlags
+  ref <- newIORef M.empty
+  -- Keep a live set of a few thousand entries while allocating a lot of
+  -- short-lived data.
+  mapM_ (\i -> modifyIORef' ref (M.delete (i - 5000) . M.insert i i))
+        [1 .. 200000 :: Int]
+  m <- readIORef ref
+  print (M.size m, sum (M.elems m))
+  stats <- getRTSStats
+  print (gcs stats > 0)
+  -- Each major GC grows -F by at most a quarter
+  replicateM_ 10 performMajorGC
+  f1 <- oldGenFactor . gcFlags <$> getRTSFlags
+  putStrLn ("-F grew: " ++ show (f1 > f0))
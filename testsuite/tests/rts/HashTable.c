@@ -0,0 +1,294 @@
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "Hash.h"
+#include "GetTime.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h> // for the PRI* macros for printf for types like int64_t
+
+/* Tests and benchmarks for the RTS hash tables (rts/Hash.c).
+ *
+ * By default this only runs the tests, whose output is deterministic. Run
+ * with cli arg "--show-timing" to also run the benchmarks, with 1M keys, and
+ * show their times.
+ *
+ * The benchmark uses whichever implementation the RTS was built with: build
+ * the RTS with the linear_hash flavour transformer to time the old linear
+ * hash table (rts/HashLinear.c) instead. The tests check that inserting a
+ * key which is already present replaces it, which the linear table doesn't
+ * do, so the testsuite skips this test in that flavour.
+ */
+
+/* A local prng, so that we get the same keys on every platform; see
+ * TimeoutQueue.c. */
+static unsigned long int next = 1;
+static int prng(void) // RAND_MAX assumed to be 32767
+{
+    next = next * 1103515245 + 12345;
+    return (unsigned int)(next/65536) % 32768;
+}
+
+/* Word keys look like heap pointers: aligned, and close together. */
+static StgWord word_key(int i)
+{
+    return 0x42000000 + (StgWord)i * 2 * sizeof(StgWord);
+}
+
+static void check(bool ok, const char *what, int i)
+{
+    if (!ok) {
+        printf("FAILED: %s (%d)\n", what, i);
+        exit(1);
+    }
+}
+
+/* Keys compared by contents, like the fingerprints in the SPT. */
+static int hashPair(const HashTable *table, StgWord key)
+{
+    return hashWord(table, ((StgWord *)key)[1]);
+}
+
+static int comparePair(StgWord key1, StgWord key2)
+{
+    const StgWord *a = (StgWord *)key1, *b = (StgWord *)key2;
+    return a[0] == b[0] && a[1] == b[1];
+}
+
+static void test_replace (void)
+{
+    printf("===== Test replace =====\n");
+    HashTable *table = allocHashTable();
+    insertHashTable(table, word_key(1), (void *)(StgWord)1);
+    insertHashTable(table, word_key(1), (void *)(StgWord)2);
+    check(lookupHashTable(table, word_key(1)) == (void *)(StgWord)2,
+          "lookup replaced", 1);
+    printf("word key inserted twice, count = %d\n", keyCountHashTable(table));
+    check(removeHashTable(table, word_key(1), NULL) == (void *)(StgWord)2,
+          "remove replaced", 1);
+    check(lookupHashTable(table, word_key(1)) == NULL,
+          "lookup removed", 1);
+    freeHashTable(table, NULL);
+
+    // Two different copies of the same key
+    StgWord pair1[2] = { 17, 42 }, pair2[2] = { 17, 42 }, pair3[2] = { 18, 42 };
+    table = allocHashTable();
+    insertHashTable_(table, (StgWord)pair1, pair1, hashPair, comparePair);
+    insertHashTable_(table, (StgWord)pair3, pair3, hashPair, comparePair);
+    insertHashTable_(table, (StgWord)pair2, pair2, hashPair, comparePair);
+    printf("pair key inserted twice, count = %d\n", keyCountHashTable(table));
+    check(lookupHashTable_(table, (StgWord)pair1, hashPair, comparePair) == pair2,
+          "lookup replaced pair", 1);
+    StgWord keys[2];
+    check(keysHashTable(table, keys, 2) == 2, "keys", 2);
+    check(keys[0] != (StgWord)pair1 && keys[1] != (StgWord)pair1,
+          "replaced key", 1);
+    check(removeHashTable_(table, (StgWord)pair1, NULL, hashPair, comparePair)
+          == pair2, "remove replaced pair", 1);
+    check(lookupHashTable_(table, (StgWord)pair2, hashPair, comparePair) == NULL,
+          "lookup removed pair", 1);
+    check(lookupHashTable_(table, (StgWord)pair3, hashPair, comparePair) == pair3,
+          "lookup other pair", 1);
+    freeHashTable(table, NULL);
+
+    StrHashTable *strtable = allocStrHashTable();
+    char str1[] = "base_GHCziBase_id_closure", str2[] = "base_GHCziBase_id_closure";
+    insertStrHashTable(strtable, str1, str1);
+    insertStrHashTable(strtable, str2, str2);
+    printf("string key inserted twice, count = %d\n",
+           keyCountHashTable((HashTable *)strtable));
+    check(lookupStrHashTable(strtable, str1) == str2, "lookup replaced str", 1);
+    freeStrHashTable(strtable, NULL);
+}
+
+static int main_test (void)
+{
+    const int N = 10000;
+
+    printf("===== Test word keys =====\n");
+    HashTable *table = allocHashTable();
+    for (int i = 0; i < N; i++) {
+        insertHashTable(table, word_key(i), (void *)(StgWord)(i + 1));
+    }
+    printf("inserted %d keys, count = %d\n", N, keyCountHashTable(table));
+    for (int i = 0; i < N; i++) {
+        check(lookupHashTable(table, word_key(i)) == (void *)(StgWord)(i + 1),
+              "lookup", i);
+    }
+    check(lookupHashTable(table, word_key(N)) == NULL, "lookup absent", N);
+
+    for (int i = 0; i < N; i += 2) {
+        check(removeHashTable(table, word_key(i), NULL) == (void *)(StgWord)(i + 1),
+              "remove", i);
+    }
+    printf("removed %d keys, count = %d\n", N / 2, keyCountHashTable(table));
+    for (int i = 0; i < N; i++) {
+        void *expected = i % 2 ? (void *)(StgWord)(i + 1) : NULL;
+        check(lookupHashTable(table, word_key(i)) == expected,
+              "lookup after remove", i);
+    }
+
+    /* Lots of insertions and removals, leaving tombstones behind */
+    for (int r = 1; r <= 10; r++) {
+        for (int i = 0; i < N; i += 2) {
+            insertHashTable(table, word_key(r * N + i), NULL);
+        }
+        for (int i = 0; i < N; i += 2) {
+            removeHashTable(table, word_key(r * N + i), NULL);
+        }
+    }
+    printf("after churn, count = %d\n", keyCountHashTable(table));
+    for (int i = 1; i < N; i += 2) {
+        check(lookupHashTable(table, word_key(i)) == (void *)(StgWord)(i + 1),
+              "lookup after churn", i);
+    }
+
+    StgWord *keys = calloc(N, sizeof(StgWord));
+    printf("keysHashTable: %d keys\n", keysHashTable(table, keys, N));
+    free(keys);
+    freeHashTable(table, NULL);
+
+    printf("===== Test string keys =====\n");
+    StrHashTable *strtable = allocStrHashTable();
+    char **strs = calloc(N, sizeof(char *));
+    char buf[48];
+    for (int i = 0; i < N; i++) {
+        strs[i] = malloc(48);
+        snprintf(strs[i], 48, "ghczmprim_GHCziTypes_Izh%d_con_info", i);
+        insertStrHashTable(strtable, strs[i], strs[i]);
+    }
+    for (int i = 0; i < N; i++) {
+        // look up with a different copy of the string
+        snprintf(buf, sizeof(buf), "ghczmprim_GHCziTypes_Izh%d_con_info", i);
+        check(lookupStrHashTable(strtable, buf) == strs[i], "lookup str", i);
+    }
+    check(lookupStrHashTable(strtable, "absent") == NULL, "lookup absent str", 0);
+    for (int i = 0; i < N; i += 3) {
+        check(removeStrHashTable(strtable, strs[i], NULL) == strs[i],
+              "remove str", i);
+    }
+    printf("count = %d\n", keyCountHashTable((HashTable *)strtable));
+    for (int i = 0; i < N; i++) {
+        check((lookupStrHashTable(strtable, strs[i]) != NULL) == (i % 3 != 0),
+              "lookup str after remove", i);
+    }
+    freeStrHashTable(strtable, NULL);
+    for (int i = 0; i < N; i++) {
+        free(strs[i]);
+    }
+    free(strs);
+
+    return 0;
+}
+
+static void report (bool showtiming, Time before, Time after, int ops)
+{
+    if (showtiming) {
+        Time ns = after - before;
+        printf("completed in %" PRIi64 " nsec, %.1f ns per op\n",
+               ns, (double)ns/ops);
+    }
+}
+
+static int main_bench (bool showtiming)
+{
+    const int N = 1000000;
+    const int LOOKUPS = 4 * N;
+    Time before, after;
+    StgWord found;
+    initializeTimer();
+
+    int *order = calloc(LOOKUPS, sizeof(int));
+    for (int i = 0; i < LOOKUPS; i++) {
+        order[i] = (prng() * 32768 + prng()) % N;
+    }
+
+    printf("===== Benchmark insert %d word keys =====\n", N);
+    HashTable *table = allocHashTable();
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N; i++) {
+        insertHashTable(table, word_key(i), (void *)(StgWord)1);
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, N);
+
+    printf("===== Benchmark %d lookups of word keys =====\n", LOOKUPS);
+    found = 0;
+    before = getProcessElapsedTime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        found += (StgWord)lookupHashTable(table, word_key(order[i]));
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, LOOKUPS);
+    printf("found %" FMT_Word "\n", found);
+
+    printf("===== Benchmark %d failing lookups of word keys =====\n", LOOKUPS);
+    found = 0;
+    before = getProcessElapsedTime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        found += (StgWord)lookupHashTable(table, word_key(N + order[i]));
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, LOOKUPS);
+    printf("found %" FMT_Word "\n", found);
+
+    printf("===== Benchmark remove %d word keys =====\n", N);
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N; i++) {
+        removeHashTable(table, word_key(i), NULL);
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, N);
+    printf("count = %d\n", keyCountHashTable(table));
+    freeHashTable(table, NULL);
+
+    /* String keys, like the linker's symbol table */
+    char **strs = calloc(N, sizeof(char *));
+    for (int i = 0; i < N; i++) {
+        strs[i] = malloc(48);
+        snprintf(strs[i], 48, "base_GHCziBase_zdfMonadIO%d_closure", i);
+    }
+
+    printf("===== Benchmark insert %d string keys =====\n", N);
+    StrHashTable *strtable = allocStrHashTable();
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N; i++) {
+        insertStrHashTable(strtable, strs[i], (void *)(StgWord)1);
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, N);
+
+    printf("===== Benchmark %d lookups of string keys =====\n", LOOKUPS);
+    found = 0;
+    before = getProcessElapsedTime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        found += (StgWord)lookupStrHashTable(strtable, strs[order[i]]);
+    }
+    after = getProcessElapsedTime();
+    report(showtiming, before, after, LOOKUPS);
+    printf("found %" FMT_Word "\n", found);
+
+    freeStrHashTable(strtable, NULL);
+    for (int i = 0; i < N; i++) {
+        free(strs[i]);
+    }
+    free(strs);
+    free(order);
+
+    return 0;
+}
+
+int main (int argc, char *argv[])
+{
+    bool showtiming = argc > 1 ? strcmp(argv[1], "--show-timing") == 0 : false;
+
+    main_test();
+    test_replace();
+    if (showtiming) {
+        main_bench(showtiming);
+    }
+    return 0;
+}
@@ -0,0 +1,16 @@
+-- +RTS --huge-pages=hugetlb usually finds the hugetlbfs pool empty (or the
+-- kernel without huge page support), in which case the RTS must fall back to
+-- ordinary pages and carry on. See Note [Huge pages for the heap] in
+-- rts/posix/OSMem.c.
+
+import Control.Monad
+import System.Mem
+import qualified Data.Map.Strict as M
+
+main :: IO ()
+main = do
+  -- enough live data for a few megablocks, copied by several major GCs
+  let m = M.fromList [ (i, [i .. i + 10]) | i <- [1 .. 100000 :: Int] ]
+  print (M.size m)
+  replicateM_ 3 performMajorGC
+  print (M.foldl' (\acc xs -> acc + sum xs) 0 m)
@@ -0,0 +1,18 @@
+-- Take heap censuses (+RTS -hT) after parallel GCs, so that the census is
+-- split between the GC threads (see Note [Parallel heap census]).
+import Control.Concurrent
+import Control.Monad
+import System.Mem (performMajorGC)
+
+main :: IO ()
+main = do
+  dones <- forM [1..4 :: Int] $ \i -> do
+    done <- newEmptyMVar
+    _ <- forkIO $ do
+      let xs = [i .. i + 100000]
+      performMajorGC
+      putMVar done $! sum xs + length (filter even xs)
+    return done
+  rs <- mapM takeMVar dones
+  performMajorGC
+  print rs
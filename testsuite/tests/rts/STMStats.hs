@@ -0,0 +1,42 @@
+-- Check the counters of getSTMStats (see Note [STM statistics] in STM.c).
+
+import Control.Concurrent
+import Control.Concurrent.STM
+import Control.Monad
+import Data.Word
+import Foreign.Marshal.Alloc
+import Foreign.Ptr
+import Foreign.Storable
+
+foreign import ccall unsafe "getSTMStats"
+  c_getSTMStats :: Ptr Word64 -> IO ()
+
+-- starts, commits, aborts, retries, validation failures, trec entries,
+-- max trec entries, trec chunks
+getSTMStats :: IO [Word64]
+getSTMStats = allocaBytes (8 * 8) $ \p -> do
+  c_getSTMStats p
+  mapM (peekElemOff p) [0 .. 7]
+
+main :: IO ()
+main = do
+  [starts0, commits0, _, retries0, _, _, _, _] <- getSTMStats
+  tvs <- mapM newTVarIO [1 .. 10 :: Int]
+  forM_ [1 .. 100 :: Int] $ \_ ->
+    atomically $ forM_ tvs $ \tv -> modifyTVar' tv (+1)
+
+  flag <- newTVarIO False
+  done <- newEmptyMVar
+  _ <- forkIO $ do
+    atomically $ readTVar flag >>= check
+    putMVar done ()
+  threadDelay 100000
+  atomically $ writeTVar flag True
+  takeMVar done
+
+  [starts, commits, _, retries, _, entries, max_entries, chunks] <- getSTMStats
+  print (starts - starts0 >= 103)
+  print (commits - commits0 >= 102)
+  print (retries - retries0 >= 1)
+  print (max_entries >= 10)
+  print (entries >= 1000 && chunks >= 100)
@@ -0,0 +1,51 @@
+-- Check that transactions committed with +RTS --stm-version-clock stay
+-- atomic: transfers between accounts preserve the total, which readers
+-- taking long read-only snapshots must always see.
+
+import Control.Concurrent
+import Control.Concurrent.STM
+import Control.Exception
+import Control.Monad
+
+nAccounts, nWorkers, nTransfers :: Int
+nAccounts = 64
+nWorkers = 4
+nTransfers = 20000
+
+main :: IO ()
+main = do
+  accounts <- mapM (const (newTVarIO (100 :: Int))) [1 .. nAccounts]
+  let account i = accounts !! (i `mod` nAccounts)
+      total = sum <$> mapM readTVar accounts
+
+  done <- newEmptyMVar
+  forM_ [1 .. nWorkers] $ \w -> forkIO $ do
+    forM_ [1 .. nTransfers] $ \i -> atomically $ do
+      let from = account (i * w)
+          to = account (i * 7 + w)
+      b <- readTVar from
+      -- Exercise nested transactions too.
+      (do when (b < 10) retry
+          modifyTVar' from (subtract 10)
+          modifyTVar' to (+ 10))
+        `orElse` return ()
+    putMVar done ()
+
+  bad <- newTVarIO False
+  reader <- forkIO $ forever $ do
+    t <- atomically total
+    when (t /= 100 * nAccounts) $ atomically $ writeTVar bad True
+
+  replicateM_ nWorkers (takeMVar done)
+  killThread reader
+  t <- atomically total
+  print t
+  readTVarIO bad >>= print
+
+  -- An exception raised in a transaction rolls it back.
+  before <- readTVarIO (head accounts)
+  r <- try $ atomically $ do
+    writeTVar (head accounts) (before + 1)
+    throwSTM (ErrorCall "abort")
+  print (either (\(ErrorCall e) -> e) (const "no exception") r)
+  readTVarIO (head accounts) >>= print . (== before)
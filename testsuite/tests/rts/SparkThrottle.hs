@@ -0,0 +1,39 @@
+-- Check that +RTS --spark-throttle drops sparks which all fizzle, and the
+-- counters of getCapabilitySparkPoolStats (see Note [Spark throttling] in
+-- Sparks.c).
+
+import Control.Exception
+import Control.Monad
+import Data.Word
+import Foreign.Marshal.Alloc
+import Foreign.Ptr
+import Foreign.Storable
+import GHC.Conc
+import System.Mem
+
+foreign import ccall unsafe "getCapabilitySparkPoolStats"
+  c_getCapabilitySparkPoolStats :: Word32 -> Ptr Word64 -> IO ()
+
+-- converted, wasted, ratio, throttled, dropped
+getSparkPoolStats :: Word32 -> IO [Word64]
+getSparkPoolStats cap = allocaBytes (5 * 8) $ \p -> do
+  c_getCapabilitySparkPoolStats cap p
+  mapM (peekElemOff p) [0 .. 4]
+
+main :: IO ()
+main = do
+  -- With a single capability nothing runs the sparks: the main thread
+  -- evaluates each of them straight away, so they all fizzle.
+  forM_ [1 .. 200000 :: Int] $ \i -> do
+    let x = sum [i .. i + 100]
+    x `par` return ()
+    evaluate x
+    -- fizzled sparks are only noticed at GC
+    when (i `mod` 1000 == 0) performMinorGC
+  [converted, wasted, ratio, throttled, dropped] <- getSparkPoolStats 0
+  print converted
+  print (wasted > 0)
+  print (ratio < 200)
+  print throttled
+  print (dropped > 100000)
+  getSparkPoolStats 1 >>= print
@@ -0,0 +1,34 @@
+-- Create and free stable pointers on several capabilities at once, freeing
+-- some of them on another capability than the one which created them, with
+-- GCs in between (see Note [Sharded stable pointer free lists] in
+-- StablePtr.c). Every stable pointer must keep pointing to its own value.
+
+import Control.Concurrent
+import Control.Monad
+import Foreign.StablePtr
+import System.Mem
+
+worker :: Int -> MVar [StablePtr Int] -> IO Int
+worker n handoff = do
+  bad <- forM [1 .. 20 :: Int] $ \r -> do
+    sps <- forM [1 .. 5000] $ \i -> newStablePtr (n * 1000000 + i)
+    when (r `mod` 5 == 0) performGC
+    vals <- mapM deRefStablePtr sps
+    let (mine, theirs) = splitAt 2500 sps
+    mapM_ freeStablePtr mine
+    -- Free the other half on whichever thread takes it next.
+    others <- modifyMVar handoff (\old -> return (theirs, old))
+    mapM_ freeStablePtr others
+    return (length (filter id (zipWith (/=) vals [n * 1000000 + i | i <- [1 ..]])))
+  return (sum bad)
+
+main :: IO ()
+main = do
+  handoff <- newMVar []
+  dones <- forM [0 .. 7] $ \n -> do
+    done <- newEmptyMVar
+    _ <- forkOn n (worker n handoff >>= putMVar done)
+    return done
+  bad <- mapM takeMVar dones
+  readMVar handoff >>= mapM_ freeStablePtr
+  print (sum bad)
@@ -0,0 +1,28 @@
+-- +RTS --stack-samples under -l writes STACK_SAMPLE events.
+-- See Note [Stack sampling] in Proftimer.c.
+
+import Control.Monad
+import GHC.Clock
+import System.IO
+
+foreign import ccall safe "start_recording_eventlog"
+  start_recording_eventlog :: IO ()
+foreign import ccall safe "stop_recording_eventlog"
+  stop_recording_eventlog :: IO ()
+
+-- Allocate for half a second, i.e. many ticks, returning to the scheduler to
+-- be sampled.
+work :: Double -> Int -> IO Int
+work deadline acc = do
+  now <- getMonotonicTime
+  if now > deadline
+    then return acc
+    else work deadline $! acc + length (show (sum [1 .. 1000 + acc `mod` 7]))
+
+main :: IO ()
+main = do
+  start_recording_eventlog
+  start <- getMonotonicTime
+  n <- work (start + 0.5) 0
+  when (n > 0) $ putStrLn "done" >> hFlush stdout
+  stop_recording_eventlog
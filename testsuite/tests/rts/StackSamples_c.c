@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Rts.h>
+#include <rts/EventLogFormat.h>
+
+/* An eventlog writer which keeps the whole eventlog in memory, so that we can
+ * parse it once eventlogging stops and count the STACK_SAMPLE events. */
+
+static uint8_t *log_buf = NULL;
+static size_t log_size = 0, log_cap = 0;
+
+static void test_init(void) {
+}
+
+static bool test_write(void *eventlog, size_t eventlog_size) {
+  if (log_size + eventlog_size > log_cap) {
+    log_cap = (log_size + eventlog_size) * 2;
+    log_buf = realloc(log_buf, log_cap);
+  }
+  memcpy(log_buf + log_size, eventlog, eventlog_size);
+  log_size += eventlog_size;
+  return true;
+}
+
+static void test_flush(void) {
+}
+
+static void test_stop(void) {
+}
+
+static const EventLogWriter writer = {
+  .initEventLogWriter = test_init,
+  .writeEventLog = test_write,
+  .flushEventLog = test_flush,
+  .stopEventLogWriter = test_stop
+};
+
+/* The eventlog is big-endian */
+static size_t pos;
+
+static uint64_t get(int bytes) {
+  uint64_t x = 0;
+  if (pos + bytes > log_size) {
+    printf("truncated eventlog\n");
+    exit(1);
+  }
+  for (int i = 0; i < bytes; i++) {
+    x = (x << 8) | log_buf[pos++];
+  }
+  return x;
+}
+
+static void expect(uint32_t marker) {
+  if (get(4) != marker) {
+    printf("malformed eventlog at offset %zu\n", pos - 4);
+    exit(1);
+  }
+}
+
+static int count_stack_samples(void) {
+  int16_t sizes[NUM_GHC_EVENT_TAGS];
+  int n = 0;
+
+  memset(sizes, 0, sizeof(sizes));
+  pos = 0;
+  expect(EVENT_HEADER_BEGIN);
+  expect(EVENT_HET_BEGIN);
+  for (;;) {
+    uint32_t marker = get(4);
+    if (marker == EVENT_HET_END) break;
+    if (marker != EVENT_ET_BEGIN) {
+      printf("malformed event type at offset %zu\n", pos - 4);
+      exit(1);
+    }
+    uint16_t tag = get(2);
+    int16_t size = get(2);
+    if (tag < NUM_GHC_EVENT_TAGS) sizes[tag] = size;
+    pos += get(4); // description
+    pos += get(4); // extra info
+    expect(EVENT_ET_END);
+  }
+  expect(EVENT_HEADER_END);
+  expect(EVENT_DATA_BEGIN);
+
+  for (;;) {
+    uint16_t tag = get(2);
+    if (tag == EVENT_DATA_END) break;
+    get(8); // timestamp
+    if (tag >= NUM_GHC_EVENT_TAGS) {
+      printf("unknown event %d\n", tag);
+      exit(1);
+    }
+    if (sizes[tag] == -1) { // variable size
+      pos += get(2);
+    } else {
+      pos += sizes[tag];
+    }
+    if (tag == EVENT_STACK_SAMPLE) n++;
+  }
+  return n;
+}
+
+void start_recording_eventlog(void) {
+  // Stop the eventlog started by -l first.
+  endEventLogging();
+  if (!startEventLogging(&writer)) {
+    printf("failed to start eventlog\n");
+  }
+}
+
+void stop_recording_eventlog(void) {
+  endEventLogging();
+  printf("stack samples written: %s\n",
+         count_stack_samples() > 0 ? "yes" : "no");
+  fflush(stdout);
+  free(log_buf);
+}
@@ -0,0 +1,44 @@
+-- Exercise thread stealing (+RTS -qs): lots of short-lived runnable
+-- threads, some sharing thunks (blackholes), some communicating over
+-- MVars, and some being killed while they may be on offer to a thief.
+import Control.Concurrent
+import Control.Exception
+import Control.Monad
+
+fib :: Int -> Integer
+fib n = if n < 2 then toInteger n else fib (n-1) + fib (n-2)
+
+main :: IO ()
+main = do
+  let shared = fib 24
+  results <- forM [1..200 :: Int] $ \i -> do
+    r <- newEmptyMVar
+    _ <- forkIO $ do
+      let x = fib (10 + i `mod` 10)
+      yield
+      putMVar r $! x + shared
+    return r
+  total <- sum <$> mapM takeMVar results
+  print total
+
+  -- ping-pong between pairs of threads
+  done <- newEmptyMVar
+  forM_ [1..50 :: Int] $ \_ -> do
+    a <- newEmptyMVar
+    b <- newEmptyMVar
+    _ <- forkIO $ replicateM_ 100 (putMVar a () >> takeMVar b)
+    _ <- forkIO $ replicateM_ 100 (takeMVar a >> putMVar b ()) >> putMVar done ()
+    return ()
+  replicateM_ 50 (takeMVar done)
+  putStrLn "ping-pong done"
+
+  -- kill runnable threads
+  killed <- forM [1..100 :: Int] $ \_ -> do
+    started <- newEmptyMVar
+    m <- newEmptyMVar
+    t <- forkIO $ (putMVar started () >> forever yield)
+                    `catch` \ThreadKilled -> putMVar m ()
+    takeMVar started
+    return (t, m)
+  forM_ killed $ \(t, m) -> killThread t >> takeMVar m
+  putStrLn "killed"
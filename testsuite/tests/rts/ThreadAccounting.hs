@@ -0,0 +1,37 @@
+{-# LANGUAGE MagicHash, UnliftedFFITypes #-}
+
+-- Check that +RTS --thread-accounting attributes allocation and CPU time to
+-- the thread that did the work.
+
+import Control.Concurrent
+import Control.Exception
+import Data.Word
+import GHC.Conc.Sync (ThreadId(..))
+import GHC.Exts (ThreadId#)
+
+foreign import ccall unsafe "rts_getThreadAllocated"
+  getThreadAllocated :: ThreadId# -> IO Word64
+
+foreign import ccall unsafe "rts_getThreadCPUTime"
+  getThreadCPUTime :: ThreadId# -> IO Word64
+
+main :: IO ()
+main = do
+  done <- newEmptyMVar
+  worker <- forkIO $ do
+    _ <- evaluate (length (show (product [1 .. 3000 :: Integer])))
+    putMVar done ()
+  idle <- forkIO $ threadDelay 1000000000
+  takeMVar done
+  -- Give the worker a chance to finish its last run slice.
+  threadDelay 100000
+
+  let ThreadId w = worker
+      ThreadId i = idle
+  wAlloc <- getThreadAllocated w
+  wCpu <- getThreadCPUTime w
+  iAlloc <- getThreadAllocated i
+  print (wAlloc > 1000 * 1000)
+  print (wCpu > 0)
+  print (iAlloc < wAlloc `div` 100)
+  killThread idle
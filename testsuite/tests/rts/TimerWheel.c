@@ -0,0 +1,312 @@
+#include "rts/PosixSource.h"
+#include "Rts.h"
+
+#include "TimeoutQueue.h"
+#include "TimerWheel.h"
+#include "rts/Time.h"
+#include "GetTime.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h> // for the PRI* macros for printf for types like int64_t
+
+/* Tests and benchmarks for the TimerWheel, and a comparison with the
+ * TimeoutQueue (leftist heap) it can replace.
+ *
+ * Run with cli arg "--show-timing" to enable timing. Otherwise it doesn't show
+ * times, so the output is deterministic and can be used as a regression test.
+ *
+ * Compile with -DDEBUG and link with the -debug RTS to enable assertions.
+ */
+
+#define EMPTY ((StgTimeoutQueue *) &stg_TIMEOUT_QUEUE_EMPTY_closure)
+
+#define TICK ((Time)1 << TIMER_WHEEL_TICK_SHIFT)
+
+/* The same prng as in the TimeoutQueue test, for the same reasons. */
+static unsigned long int next = 1;
+static int prng(void) // RAND_MAX assumed to be 32767
+{
+    next = next * 1103515245 + 12345;
+    return (unsigned int)(next/65536) % 32768;
+}
+
+/* A random time in [0..range-1], for ranges up to 2^45 */
+static Time random_time(Time range)
+{
+    Time r = prng();
+    r = (r << 15) | prng();
+    r = (r << 15) | prng();
+    return r % range;
+}
+
+/* The waketime of a timeout, rounded up to a tick as the wheel does */
+static Time rounded(Time t)
+{
+    if (t > TIME_MAX - TICK) {
+        return TIME_MAX;
+    }
+    return (t + TICK - 1) / TICK * TICK;
+}
+
+static StgTimeout *new_elems(int N)
+{
+    StgTimeout *elems = calloc(N, sizeof(StgTimeout));
+    for (int i = 0; i < N; i++) {
+        /* we'll never actually notify, so we can fill it in as empty */
+        union NotifyCompletion notify = { .mvar = (StgMVar *) EMPTY };
+        initElemTimeoutQueue(&elems[i], notify, NotifyMVar, NULL /*CCS*/);
+    }
+    return elems;
+}
+
+static void random_permutation(int *perm, int N)
+{
+    for (int i = 0; i < N; i++) {
+        perm[i] = i;
+    }
+    for (int i = N-1; i > 0; i--) {
+        int j = ((prng() << 15) | prng()) % (i+1);
+        int temp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = temp;
+    }
+}
+
+/* Expire the timeouts due by now, checking that none is early. Returns the
+ * number expired.
+ */
+static int expire(TimerWheel *w, Time now, bool *in_wheel, StgTimeout *elems)
+{
+    int n = 0;
+    StgTimeout *t = expireTimerWheel(w, now);
+    while (t != EMPTY) {
+        StgTimeout *next = t->a;
+        t->a = EMPTY;
+        if (rounded(t->waketime) > now) {
+            printf("FAIL: timeout at %" PRIi64 " expired at %" PRIi64 "\n",
+                   t->waketime, now);
+        }
+        in_wheel[t - elems] = false;
+        n++;
+        t = next;
+    }
+    return n;
+}
+
+/* Check that nothing due by now is left in the wheel, and that the answer of
+ * findMinWaketimeTimerWheel is a lower bound later than now.
+ */
+static void check_after_expiry(TimerWheel *w, Time now, bool *in_wheel,
+                               StgTimeout *elems, int N)
+{
+    int n = 0;
+    Time min = TIME_MAX;
+    for (int i = 0; i < N; i++) {
+        if (in_wheel[i]) {
+            n++;
+            if (rounded(elems[i].waketime) <= now) {
+                printf("FAIL: timeout at %" PRIi64 " not expired at %" PRIi64
+                       "\n", elems[i].waketime, now);
+            }
+            if (elems[i].waketime < min) {
+                min = elems[i].waketime;
+            }
+        }
+    }
+    if ((StgWord)n != w->size) {
+        printf("FAIL: size %" FMT_Word ", expected %i\n", w->size, n);
+    }
+    if (n > 0) {
+        Time found = findMinWaketimeTimerWheel(w);
+        if (found <= now || found > rounded(min)) {
+            printf("FAIL: findMin %" PRIi64 ", now %" PRIi64 ", min %" PRIi64
+                   "\n", found, now, min);
+        }
+    }
+}
+
+int main_test (void)
+{
+    const int N = 1000;
+    TimerWheel w;
+    initTimerWheel(&w);
+
+    StgTimeout *elems = new_elems(N);
+    bool *in_wheel = calloc(N, sizeof(bool));
+    int *rperm = calloc(N, sizeof(int));
+    random_permutation(rperm, N);
+
+    /* Insert timeouts spread over a wide range of levels */
+    printf("===== Test insert =====\n");
+    for (int i = 0; i < N; i++) {
+        Time range = TICK << (prng() % 24);
+        insertTimerWheel(&w, &elems[i], random_time(range));
+        in_wheel[i] = true;
+    }
+    printf("size: %" FMT_Word "\n", w.size);
+    check_after_expiry(&w, -1, in_wheel, elems, N);
+
+    /* Delete a random half */
+    printf("===== Test delete in random order =====\n");
+    for (int i = 0; i < N/2; i++) {
+        deleteTimerWheel(&w, &elems[rperm[i]]);
+        in_wheel[rperm[i]] = false;
+    }
+    printf("size: %" FMT_Word "\n", w.size);
+    check_after_expiry(&w, -1, in_wheel, elems, N);
+
+    /* Expire at increasing times, with steps of all sizes, inserting some
+     * more timeouts relative to the current time as we go.
+     */
+    printf("===== Test expire =====\n");
+    Time now = 0;
+    for (int step = 0; !isEmptyTimerWheel(&w); step++) {
+        now += random_time(TICK << (step % 24));
+        int expired = expire(&w, now, in_wheel, elems);
+        check_after_expiry(&w, now, in_wheel, elems, N);
+
+        int inserted = 0;
+        for (int i = 0; i < N/2 && step < 64; i++) {
+            if (!in_wheel[rperm[i]] && prng() % 4 == 0) {
+                elems[rperm[i]].a = EMPTY;
+                insertTimerWheel(&w, &elems[rperm[i]],
+                                 now + random_time(TICK << (prng() % 24)));
+                in_wheel[rperm[i]] = true;
+                inserted++;
+            }
+        }
+        printf("step %2i: expired %4i, inserted %4i, size %4" FMT_Word "\n",
+               step, expired, inserted, w.size);
+    }
+
+    /* Timeouts in the past, or at the end of time */
+    printf("===== Test extremes =====\n");
+    insertTimerWheel(&w, &elems[0], 0);
+    insertTimerWheel(&w, &elems[1], now - TICK * 100);
+    insertTimerWheel(&w, &elems[2], TIME_MAX);
+    in_wheel[0] = in_wheel[1] = in_wheel[2] = true;
+    printf("expired: %i\n", expire(&w, now, in_wheel, elems));
+    check_after_expiry(&w, now, in_wheel, elems, N);
+    /* TIME_MAX isn't a whole number of ticks, so this one never expires */
+    printf("expired: %i\n", expire(&w, TIME_MAX, in_wheel, elems));
+    printf("size: %" FMT_Word "\n", w.size);
+    deleteTimerWheel(&w, &elems[2]);
+    printf("size: %" FMT_Word "\n", w.size);
+
+    free(rperm);
+    free(in_wheel);
+    free(elems);
+    return 0;
+}
+
+static void report(bool showtiming, Time before, Time after, int N)
+{
+    if (showtiming) {
+      Time ns = after - before;
+      printf("completed in %" PRIi64 " nsec, %.1f ns per op\n", ns, (double)ns/N);
+    }
+}
+
+/* Timeouts up to a minute away, as for network timeouts. Insert them, delete
+ * half in random order, and expire the rest in steps of a millisecond, with
+ * both the leftist heap and the wheel.
+ */
+static void bench (bool showtiming, int N)
+{
+    const Time range = SecondsToTime(60);
+    Time before, after;
+
+    StgTimeout *elems = new_elems(N);
+    Time *keys  = calloc(N, sizeof(Time));
+    int  *rperm = calloc(N, sizeof(int));
+    for (int i = 0; i < N; i++) {
+        keys[i] = random_time(range);
+    }
+    random_permutation(rperm, N);
+
+    StgTimeoutQueue *root = EMPTY;
+    printf("===== Benchmark %i timeouts, leftist heap =====\n", N);
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N; i++) {
+        insertTimeoutQueue(&root, &elems[i], keys[i]);
+    }
+    after = getProcessElapsedTime();
+    printf("insert\n");
+    report(showtiming, before, after, N);
+
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N/2; i++) {
+        deleteTimeoutQueue(&root, &elems[rperm[i]]);
+    }
+    after = getProcessElapsedTime();
+    printf("delete %i\n", N/2);
+    report(showtiming, before, after, N/2);
+
+    int expired = 0;
+    before = getProcessElapsedTime();
+    for (Time now = 0; !isEmptyTimeoutQueue(root); now += MSToTime(1)) {
+        while (!isEmptyTimeoutQueue(root)
+               && findMinWaketimeTimeoutQueue(root) <= now) {
+            StgTimeout *unused_min;
+            deleteMinTimeoutQueue(&root, &unused_min);
+            expired++;
+        }
+    }
+    after = getProcessElapsedTime();
+    printf("expire %i\n", expired);
+    report(showtiming, before, after, expired);
+
+    TimerWheel *w = malloc(sizeof(TimerWheel));
+    initTimerWheel(w);
+    printf("===== Benchmark %i timeouts, timer wheel =====\n", N);
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N; i++) {
+        insertTimerWheel(w, &elems[i], keys[i]);
+    }
+    after = getProcessElapsedTime();
+    printf("insert\n");
+    report(showtiming, before, after, N);
+
+    before = getProcessElapsedTime();
+    for (int i = 0; i < N/2; i++) {
+        deleteTimerWheel(w, &elems[rperm[i]]);
+    }
+    after = getProcessElapsedTime();
+    printf("delete %i\n", N/2);
+    report(showtiming, before, after, N/2);
+
+    expired = 0;
+    before = getProcessElapsedTime();
+    for (Time now = 0; !isEmptyTimerWheel(w); now += MSToTime(1)) {
+        StgTimeout *t = expireTimerWheel(w, now);
+        while (t != EMPTY) {
+            StgTimeout *next = t->a;
+            t->a = EMPTY;
+            expired++;
+            t = next;
+        }
+    }
+    after = getProcessElapsedTime();
+    printf("expire %i\n", expired);
+    report(showtiming, before, after, expired);
+
+    free(w);
+    free(rperm);
+    free(keys);
+    free(elems);
+}
+
+int main (int argc, char *argv[])
+{
+    bool showtiming = argc > 1 ? strcmp(argv[1], "--show-timing") == 0 : false;
+
+    main_test();
+    initializeTimer();
+    bench(showtiming, 10000);
+    bench(showtiming, 100000);
+    bench(showtiming, 1000000);
+    return 0;
+}
@@ -0,0 +1,7 @@
+// lazy_b is defined by another member of the archive, which must be loaded
+// when this one is relocated.
+extern int lazy_b(void);
+
+int lazy_a(void) {
+    return 1 + lazy_b();
+}
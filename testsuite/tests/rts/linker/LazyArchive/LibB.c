@@ -0,0 +1,3 @@
+int lazy_b(void) {
+    return 41;
+}
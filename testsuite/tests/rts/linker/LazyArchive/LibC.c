@@ -0,0 +1,7 @@
+// Nothing refers to this member, so it is never loaded and the undefined
+// reference below is never resolved.
+extern int lazy_missing(void);
+
+int lazy_c(void) {
+    return lazy_missing();
+}
@@ -0,0 +1,48 @@
+// Test that with +RTS --linker-lazy-archives the RTS linker loads archive
+// members on demand, including members needed only to relocate other members.
+
+#include "Rts.h"
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+    RtsConfig conf = defaultRtsConfig;
+    conf.rts_opts_enabled = RtsOptsAll;
+    conf.rts_opts = "--linker-lazy-archives";
+    hs_init_ghc(&argc, &argv, conf);
+
+    initLinker_(0);
+
+    int ok;
+    ok = loadArchive("Lib.a");
+    if (!ok) {
+        errorBelch("loadArchive(Lib.a) failed");
+        return 1;
+    }
+    ok = resolveObjs();
+    if (!ok) {
+        errorBelch("resolveObjs() failed");
+        return 1;
+    }
+
+    int (*lazy_a)(void) = lookupSymbol("lazy_a");
+    if (!lazy_a) {
+        errorBelch("lookupSymbol(lazy_a) failed");
+        return 1;
+    }
+    printf("lazy_a() = %d\n", lazy_a());
+    fflush(stdout);
+
+    ok = unloadObj("Lib.a");
+    if (!ok) {
+        errorBelch("unloadObj(Lib.a) failed");
+        return 1;
+    }
+    if (lookupSymbol("lazy_b") != NULL) {
+        errorBelch("lazy_b still defined after unloadObj(Lib.a)");
+        return 1;
+    }
+    performMajorGC();
+
+    hs_exit();
+    return 0;
+}
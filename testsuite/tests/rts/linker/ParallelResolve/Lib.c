@@ -0,0 +1,10 @@
+// Compiled once for each IDX, giving a chain of objects each of which
+// refers to the next.
+#define CAT_(a, b) a##b
+#define CAT(a, b) CAT_(a, b)
+
+extern int CAT(chain_, NEXT)(void);
+
+int CAT(chain_, IDX)(void) {
+    return IDX + CAT(chain_, NEXT)();
+}
@@ -0,0 +1,3 @@
+int chain_8(void) {
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Test that the RTS linker resolves objects correctly when relocating them on
+// several threads (+RTS --linker-threads), both when all of them are loaded
+// up front and when all but the first are loaded lazily from an archive, so
+// that they are discovered one at a time while relocating.
+
+#include "Rts.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *objs[] = {
+    "Lib0.o", "Lib1.o", "Lib2.o", "Lib3.o", "Lib4.o",
+    "Lib5.o", "Lib6.o", "Lib7.o", "LibEnd.o", NULL
+};
+
+int main(int argc, char *argv[]) {
+    RtsConfig conf = defaultRtsConfig;
+    conf.rts_opts_enabled = RtsOptsAll;
+    hs_init_ghc(&argc, &argv, conf);
+
+    initLinker_(0);
+
+    int ok;
+    bool archive = argc > 1 && strcmp(argv[1], "archive") == 0;
+    if (archive) {
+        ok = loadObj("Lib0.o");
+        if (!ok) {
+            errorBelch("loadObj(Lib0.o) failed");
+            return 1;
+        }
+        ok = loadArchive("Lib.a");
+        if (!ok) {
+            errorBelch("loadArchive(Lib.a) failed");
+            return 1;
+        }
+    } else {
+        for (int i = 0; objs[i] != NULL; i++) {
+            ok = loadObj((char *) objs[i]);
+            if (!ok) {
+                errorBelch("loadObj(%s) failed", objs[i]);
+                return 1;
+            }
+        }
+    }
+    ok = resolveObjs();
+    if (!ok) {
+        errorBelch("resolveObjs() failed");
+        return 1;
+    }
+
+    int (*chain_0)(void) = lookupSymbol("chain_0");
+    if (!chain_0) {
+        errorBelch("lookupSymbol(chain_0) failed");
+        return 1;
+    }
+    printf("chain_0() = %d (%s)\n", chain_0(), archive ? "archive" : "objects");
+    fflush(stdout);
+
+    hs_exit();
+    return 0;
+}
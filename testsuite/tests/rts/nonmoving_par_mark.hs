@@ -0,0 +1,29 @@
+-- Exercise the parallel concurrent mark of the nonmoving collector
+-- (--nonmoving-mark-threads). A large, mutable and shared structure is kept
+-- alive while the program keeps modifying it, so that marking runs
+-- concurrently with the mutator and has plenty of work to share.
+
+import Control.Monad
+import Data.IORef
+import qualified Data.IntMap.Strict as IM
+import System.Mem
+
+data Tree = Leaf | Node Tree !Int Tree
+
+build :: Int -> Int -> Tree
+build 0 _ = Leaf
+build d x = Node (build (d-1) (2*x)) x (build (d-1) (2*x+1))
+
+sumTree :: Tree -> Int
+sumTree Leaf = 0
+sumTree (Node l x r) = sumTree l + x + sumTree r
+
+main :: IO ()
+main = do
+  trees <- newIORef (IM.fromList [ (i, build 12 i) | i <- [1 .. 64] ])
+  forM_ [1 .. 2000 :: Int] $ \i -> do
+    let k = i `mod` 64 + 1
+    modifyIORef' trees (IM.insert k $! build 12 i)
+    when (i `mod` 500 == 0) performMajorGC
+  m <- readIORef trees
+  print (IM.size m, sum (map sumTree (IM.elems m)) > 0)
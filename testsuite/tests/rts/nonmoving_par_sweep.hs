@@ -0,0 +1,20 @@
+-- Exercise the parallel sweep of the nonmoving heap (--nonmoving-sweep-threads).
+-- The program keeps a large, changing set of small objects alive in the
+-- oldest generation so that every collection sweeps many segments.
+
+import Control.Monad
+import Data.IORef
+import qualified Data.Map.Strict as M
+import System.Mem
+
+main :: IO ()
+main = do
+  ref <- newIORef M.empty
+  forM_ [1 .. 40 :: Int] $ \i -> do
+    let base = i * 10000
+    modifyIORef' ref $ \m ->
+      M.union (M.fromList [ (k, show k) | k <- [base .. base + 50000] ])
+              (M.filterWithKey (\k _ -> k `mod` 3 /= 0) m)
+    when (i `mod` 10 == 0) performMajorGC
+  m <- readIORef ref
+  print (M.size m, sum (map length (M.elems m)) > 0)
@@ -0,0 +1,28 @@
+-- Build a live structure on each of two capabilities, which --debug-numa=2
+-- puts on different NUMA nodes, and make the GC copy it around a few times.
+-- The GC keeps each object on the node it lives on (see
+-- Note [NUMA-local evacuation] in GCUtils.c); check that nothing got lost on
+-- the way and that +RTS -s reports the per-node copying.
+
+import Control.Concurrent
+import Control.Monad
+import System.Mem
+import qualified Data.Map.Strict as M
+
+build :: Int -> M.Map Int [Int]
+build k = M.fromList [ (i, [i .. i + k]) | i <- [1 .. 20000] ]
+
+total :: M.Map Int [Int] -> Int
+total = M.foldl' (\acc xs -> acc + sum xs) 0
+
+main :: IO ()
+main = do
+  results <- forM [0, 1] $ \c -> do
+    done <- newEmptyMVar
+    _ <- forkOn c $ do
+      let m = build (c + 3)
+      M.size m `seq` return ()
+      replicateM_ 5 performMajorGC
+      putMVar done $! total m
+    return done
+  mapM takeMVar results >>= print
@@ -0,0 +1,20 @@
+-- Exercise the parallel compaction of the oldest generation (+RTS -qc).
+-- The program keeps a large, changing Map alive so that every major
+-- collection compacts many regions, and then checks that the Map survived.
+
+import Control.Monad
+import Data.IORef
+import qualified Data.Map.Strict as M
+import System.Mem
+
+main :: IO ()
+main = do
+  ref <- newIORef M.empty
+  forM_ [1 .. 20 :: Int] $ \i -> do
+    let base = i * 5000
+    modifyIORef' ref $ \m ->
+      M.union (M.fromList [ (k, 2 * k) | k <- [base .. base + 20000] ])
+              (M.filterWithKey (\k _ -> odd k) m)
+    performMajorGC
+  m <- readIORef ref
+  print (M.size m, M.foldlWithKey' (\ok k v -> ok && v == 2 * k) True m)